@@ -8,6 +8,13 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "include/dart_api.h"
+
+
+static void HeapDumpSignalHandler(int signal) {
+  Dart_RequestHeapDump();
+}
+
 
 bool Platform::Initialize() {
   // Turn off the signal handler for SIGPIPE as it causes the process
@@ -20,6 +27,13 @@ bool Platform::Initialize() {
     perror("Setting signal handler failed");
     return false;
   }
+  // Dump the heap of all isolates on SIGUSR2, see Dart_RequestHeapDump.
+  act.sa_handler = HeapDumpSignalHandler;
+  act.sa_flags = SA_RESTART;
+  if (sigaction(SIGUSR2, &act, 0) != 0) {
+    perror("Setting signal handler failed");
+    return false;
+  }
   return true;
 }
 
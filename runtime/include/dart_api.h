@@ -418,6 +418,87 @@ DART_EXPORT Dart_Handle Dart_CreateScriptSnapshot(uint8_t** buffer,
  */
 DART_EXPORT void Dart_InterruptIsolate(Dart_Isolate isolate);
 
+// --- Heap Statistics ---
+
+/**
+ * Memory usage and garbage collection statistics of an isolate heap.
+ *
+ * Sizes are in bytes and times in microseconds. The counts and times are
+ * cumulative since the isolate was created.
+ */
+typedef struct {
+  int64_t new_in_use;
+  int64_t new_capacity;
+  int64_t old_in_use;
+  int64_t old_capacity;
+  int64_t code_in_use;
+  int64_t code_capacity;
+
+  int64_t scavenge_count;
+  int64_t scavenge_time;
+  int64_t last_scavenge_time;
+  // Bytes moved from new space to old space by the scavenges.
+  int64_t promoted_bytes;
+
+  int64_t mark_sweep_count;
+  int64_t mark_sweep_time;
+  int64_t last_mark_sweep_time;
+} Dart_HeapStats;
+
+/**
+ * Gets the heap statistics of the current isolate.
+ *
+ * The statistics are read from counters maintained by the garbage collector,
+ * so this is cheap enough to be polled periodically.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \param stats Returns the heap statistics.
+ */
+DART_EXPORT void Dart_GetHeapStats(Dart_HeapStats* stats);
+
+/**
+ * Notifies the current isolate that it is idle until the given deadline,
+ * e.g. because the embedder has no events for it. The time is used for
+ * garbage collection work which would otherwise pause the isolate later: a
+ * scavenge, incremental marking or lazy sweeping. The isolate returns at or
+ * shortly after the deadline.
+ *
+ * Dart_RunLoop already does this while its message queue is empty.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \param deadline The end of the idle time in microseconds since the epoch.
+ */
+DART_EXPORT void Dart_NotifyIdle(int64_t deadline);
+
+/**
+ * Collects all garbage of the current isolate and prints a histogram of the
+ * remaining objects by class: their number of instances and bytes.
+ *
+ * If graph_file is not NULL, the heap graph is also written to that file. It
+ * has one line per object with its address, class, size and the addresses of
+ * the objects it references, so that two heap graphs can be compared.
+ *
+ * Requires there to be a current isolate.
+ *
+ * \param graph_file The path of the heap graph file, or NULL.
+ *
+ * \return A valid handle if no error occurs during the operation.
+ */
+DART_EXPORT Dart_Handle Dart_DumpHeap(const char* graph_file);
+
+/**
+ * Requests all isolates to dump their heap as in Dart_DumpHeap. Each isolate
+ * dumps its heap at its next scavenge. The heap graph files are only written
+ * if the --heap_graph_file flag is set, their names are the value of the flag
+ * followed by the main port of the isolate and the number of the request.
+ *
+ * This function may be called from a signal handler and does not require a
+ * current isolate.
+ */
+DART_EXPORT void Dart_RequestHeapDump();
+
 // --- Messages and Ports ---
 
 /**
@@ -288,16 +288,18 @@ static RawInteger* IntegerBinopHelper(Token::Kind operation,
     int64_t result = BinaryOpWithTwoSmis(operation, left_smi, right_smi);
     if (Smi::IsValid64(result)) {
       return Smi::New(result);
-    } else {
-      // TODO(regis): This is not going to work on x64. Check other operations.
+    }
 #if defined(TARGET_ARCH_X64)
-      UNIMPLEMENTED();
-      return 0;
-#else
+    // On x64 the product of two Smis may not fit in a Mint, in which case
+    // 'result' is not valid and the Bigint operation below is used.
+    if (operation != Token::kMUL) {
       // Overflow to Mint.
       return Mint::New(result);
-#endif
     }
+#else
+    // Overflow to Mint.
+    return Mint::New(result);
+#endif
   } else if (AreBoth64bitOperands(left_int, right_int)) {
     // TODO(srdjan): Test for overflow of result instead of operand
     // types.
@@ -478,7 +480,9 @@ static RawInteger* SmiShiftOperation(Token::Kind kind,
       result = left.Value() << right.Value();
       break;
     case Token::kSAR: {
-        int shift_amount = (right.Value() > 0x1F) ? 0x1F : right.Value();
+        const intptr_t kMaxShift = kBitsPerWord - 1;
+        intptr_t shift_amount =
+            (right.Value() > kMaxShift) ? kMaxShift : right.Value();
         result = left.Value() >> shift_amount;
         break;
       }
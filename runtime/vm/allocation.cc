@@ -10,16 +10,21 @@
 
 namespace dart {
 
-StackResource::StackResource(Isolate* isolate) : isolate_(isolate) {
-  previous_ = isolate->top_resource();
-  isolate->set_top_resource(this);
+StackResource::StackResource(Isolate* isolate)
+    : isolate_(isolate), previous_(NULL) {
+  if (isolate != NULL) {
+    previous_ = isolate->top_resource();
+    isolate->set_top_resource(this);
+  }
 }
 
 
 StackResource::~StackResource() {
-  StackResource* top = isolate()->top_resource();
-  ASSERT(top == this);
-  isolate()->set_top_resource(previous_);
+  if (isolate() != NULL) {
+    StackResource* top = isolate()->top_resource();
+    ASSERT(top == this);
+    isolate()->set_top_resource(previous_);
+  }
 }
 
 ZoneAllocated::~ZoneAllocated() {
@@ -33,6 +33,8 @@ class ValueObject {
 // objects location on the stack. Use stack resource objects if objects
 // need to be destroyed even in the case of exceptions when a Longjump is done
 // to a stack frame above the frame where these objects were allocated.
+// Threads without a current isolate, e.g. GC helper threads, pass a NULL
+// isolate in which case the resource is not tracked.
 class StackResource {
  public:
   explicit StackResource(Isolate* isolate);
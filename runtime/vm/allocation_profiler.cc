@@ -0,0 +1,206 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/allocation_profiler.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm/code_index_table.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/os.h"
+#include "vm/stack_frame.h"
+#include "vm/utils.h"
+#include "vm/zone.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, profile_allocations, false,
+            "Sample allocations and print the allocating call sites when the"
+            " isolate shuts down.");
+DEFINE_FLAG(int, allocation_sample_interval, 512 * KB,
+            "Average number of bytes allocated between two allocation"
+            " samples.");
+DEFINE_FLAG(int, allocation_sample_depth, 8,
+            "Number of Dart frames recorded with each allocation sample.");
+
+
+AllocationProfiler::AllocationProfiler(intptr_t sample_interval,
+                                       intptr_t sample_depth)
+    : sample_interval_(Utils::Maximum(sample_interval,
+                                      static_cast<intptr_t>(KB))),
+      sample_depth_(Utils::Minimum(sample_depth, kMaxSampleDepth)),
+      random_state_(2463534242u),
+      old_sample_distance_(0),
+      sample_address_(0),
+      num_samples_(0),
+      capacity_(kInitialCapacity),
+      count_(0) {
+  old_sample_distance_ = NextSampleDistance();
+  call_sites_ = new CallSite*[capacity_];
+  memset(call_sites_, 0, capacity_ * sizeof(call_sites_[0]));
+}
+
+
+AllocationProfiler::~AllocationProfiler() {
+  for (intptr_t i = 0; i < capacity_; i++) {
+    if (call_sites_[i] != NULL) {
+      free(call_sites_[i]->class_name);
+      delete call_sites_[i];
+    }
+  }
+  delete[] call_sites_;
+}
+
+
+intptr_t AllocationProfiler::NextSampleDistance() {
+  // Xorshift, the isolate random seed is not used so that sampling does not
+  // change the random numbers seen by the program.
+  random_state_ ^= random_state_ << 13;
+  random_state_ ^= random_state_ >> 17;
+  random_state_ ^= random_state_ << 5;
+  // Uniformly distributed in [interval / 2, 3 * interval / 2[.
+  intptr_t distance =
+      (sample_interval_ / 2) + (random_state_ % sample_interval_);
+  return Utils::RoundUp(distance, kObjectAlignment);
+}
+
+
+void AllocationProfiler::RecordSample(const Class& cls) {
+  sample_address_ = 0;
+  // Classes only have names once the isolate is initialized.
+  if (Isolate::Current()->stub_code() == NULL) {
+    return;
+  }
+  num_samples_++;
+
+  CallSite key;
+  // The classes of the VM objects have no name field, avoid allocating a
+  // symbol for them.
+  intptr_t index = Object::GetSingletonClassIndex(cls.raw());
+  const char* class_name;
+  if (index != Object::kInvalidIndex) {
+    class_name = Object::GetSingletonClassName(index);
+  } else {
+    class_name = String::Handle(cls.Name()).ToCString();
+  }
+  key.class_name = const_cast<char*>(class_name);
+  key.hash = Utils::StringHash(class_name, strlen(class_name));
+  key.depth = 0;
+  DartFrameIterator iterator;
+  DartFrame* frame = iterator.NextFrame();
+  while ((frame != NULL) && (key.depth < sample_depth_)) {
+    key.pcs[key.depth++] = frame->pc();
+    key.hash = (key.hash * 31) + frame->pc();
+    frame = iterator.NextFrame();
+  }
+
+  CallSite** slot = Lookup(key);
+  if (*slot == NULL) {
+    CallSite* call_site = new CallSite(key);
+    call_site->class_name = strdup(class_name);
+    call_site->samples = 0;
+    *slot = call_site;
+    count_++;
+    if ((count_ * 2) > capacity_) {
+      Grow();
+      slot = Lookup(key);
+    }
+  }
+  (*slot)->samples++;
+}
+
+
+AllocationProfiler::CallSite** AllocationProfiler::Lookup(
+    const CallSite& key) {
+  intptr_t mask = capacity_ - 1;
+  intptr_t index = key.hash & mask;
+  while (call_sites_[index] != NULL) {
+    CallSite* call_site = call_sites_[index];
+    if ((call_site->hash == key.hash) &&
+        (call_site->depth == key.depth) &&
+        (memcmp(call_site->pcs, key.pcs, key.depth * sizeof(key.pcs[0])) ==
+         0) &&
+        (strcmp(call_site->class_name, key.class_name) == 0)) {
+      break;
+    }
+    index = (index + 1) & mask;
+  }
+  return &call_sites_[index];
+}
+
+
+void AllocationProfiler::Grow() {
+  CallSite** old_call_sites = call_sites_;
+  intptr_t old_capacity = capacity_;
+  capacity_ *= 2;
+  call_sites_ = new CallSite*[capacity_];
+  memset(call_sites_, 0, capacity_ * sizeof(call_sites_[0]));
+  for (intptr_t i = 0; i < old_capacity; i++) {
+    if (old_call_sites[i] != NULL) {
+      *Lookup(*old_call_sites[i]) = old_call_sites[i];
+    }
+  }
+  delete[] old_call_sites;
+}
+
+
+int AllocationProfiler::CompareSamples(const void* a, const void* b) {
+  const CallSite* site_a = *reinterpret_cast<CallSite* const*>(a);
+  const CallSite* site_b = *reinterpret_cast<CallSite* const*>(b);
+  if (site_a->samples != site_b->samples) {
+    return (site_a->samples > site_b->samples) ? -1 : 1;
+  }
+  return strcmp(site_a->class_name, site_b->class_name);
+}
+
+
+void AllocationProfiler::Print() const {
+  Isolate* isolate = Isolate::Current();
+  Zone zone(isolate);
+  HandleScope handle_scope(isolate);
+  CallSite** sorted = new CallSite*[count_];
+  intptr_t length = 0;
+  for (intptr_t i = 0; i < capacity_; i++) {
+    if (call_sites_[i] != NULL) {
+      sorted[length++] = call_sites_[i];
+    }
+  }
+  ASSERT(length == count_);
+  qsort(sorted, length, sizeof(sorted[0]), CompareSamples);
+
+  // Each sample stands for the bytes allocated since the previous one.
+  OS::Print("Allocation profile of isolate %lld (%d samples, one per %dK "
+            "allocated):\n",
+            isolate->main_port(),
+            num_samples_,
+            sample_interval_ / KB);
+  OS::Print("%10s %12s  %s\n", "samples", "allocated", "class and call site");
+  CodeIndexTable* code_index_table = isolate->code_index_table();
+  Code& code = Code::Handle();
+  Function& function = Function::Handle();
+  for (intptr_t i = 0; i < length; i++) {
+    const CallSite* call_site = sorted[i];
+    OS::Print("%10d %11dK  %s\n",
+              call_site->samples,
+              (call_site->samples * sample_interval_) / KB,
+              call_site->class_name);
+    for (intptr_t j = 0; j < call_site->depth; j++) {
+      uword pc = call_site->pcs[j];
+      code = code_index_table->LookupCode(pc);
+      if (code.IsNull()) {
+        OS::Print("%25s at %p\n", "", reinterpret_cast<void*>(pc));
+        continue;
+      }
+      function = code.function();
+      OS::Print("%25s at %s+0x%x\n", "",
+                function.ToFullyQualifiedCString(),
+                pc - code.EntryPoint());
+    }
+  }
+  delete[] sorted;
+}
+
+}  // namespace dart
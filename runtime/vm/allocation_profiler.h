@@ -0,0 +1,101 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ALLOCATION_PROFILER_H_
+#define VM_ALLOCATION_PROFILER_H_
+
+#include "vm/allocation.h"
+#include "vm/flags.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class Class;
+
+DECLARE_FLAG(bool, profile_allocations);
+DECLARE_FLAG(int, allocation_sample_interval);
+DECLARE_FLAG(int, allocation_sample_depth);
+
+// Samples the allocations of an isolate heap to find the code paths that
+// allocate the most. On average one allocation is sampled every
+// --allocation_sample_interval bytes, and the class of the sampled object is
+// recorded with the innermost --allocation_sample_depth Dart frames. The
+// samples are aggregated by class and call site.
+//
+// New space allocations are sampled by lowering the allocation end of the
+// new space to the next sample, so that the inlined allocation in generated
+// code and Scavenger::TryAllocate fail there and go through
+// Heap::AllocateNew. Old space allocations are counted in Heap::AllocateOld.
+class AllocationProfiler {
+ public:
+  AllocationProfiler(intptr_t sample_interval, intptr_t sample_depth);
+  ~AllocationProfiler();
+
+  // Bytes to allocate before the next sample. The distance varies randomly
+  // around the sample interval so that allocation patterns with the same
+  // period as the interval are not over or under sampled.
+  intptr_t NextSampleDistance();
+
+  // Count an old space allocation, returns true if it should be sampled.
+  bool CountAllocation(intptr_t size) {
+    old_sample_distance_ -= size;
+    if (old_sample_distance_ > 0) {
+      return false;
+    }
+    old_sample_distance_ = NextSampleDistance();
+    return true;
+  }
+
+  // The heap sets the address of the allocation to sample, the object is
+  // recorded once it has been initialized by Object::Allocate.
+  void set_sample_address(uword addr) { sample_address_ = addr; }
+  bool IsSampleAddress(uword addr) const { return sample_address_ == addr; }
+
+  // Record the class and the Dart stack of the sampled object.
+  void RecordSample(const Class& cls);
+
+  // Print the call sites by decreasing number of samples.
+  void Print() const;
+
+  intptr_t sample_interval() const { return sample_interval_; }
+  intptr_t num_samples() const { return num_samples_; }
+  // Number of distinct combinations of class and stack.
+  intptr_t num_call_sites() const { return count_; }
+
+ private:
+  static const intptr_t kMaxSampleDepth = 32;
+  static const intptr_t kInitialCapacity = 256;
+
+  struct CallSite {
+    uword hash;
+    char* class_name;
+    intptr_t depth;
+    uword pcs[kMaxSampleDepth];
+    intptr_t samples;
+  };
+
+  static int CompareSamples(const void* a, const void* b);
+
+  CallSite** Lookup(const CallSite& key);
+  void Grow();
+
+  intptr_t sample_interval_;
+  intptr_t sample_depth_;
+  uint32_t random_state_;
+  intptr_t old_sample_distance_;
+  uword sample_address_;
+  intptr_t num_samples_;
+
+  // Open addressing hash table of the call sites.
+  intptr_t capacity_;
+  intptr_t count_;
+  CallSite** call_sites_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocationProfiler);
+};
+
+}  // namespace dart
+
+#endif  // VM_ALLOCATION_PROFILER_H_
@@ -0,0 +1,66 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/allocation_profiler.h"
+#include "vm/assert.h"
+#include "vm/globals.h"
+#include "vm/object.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+UNIT_TEST_CASE(AllocationSampleDistance) {
+  const intptr_t kInterval = 64 * KB;
+  AllocationProfiler profiler(kInterval, 8);
+  EXPECT_EQ(kInterval, profiler.sample_interval());
+  const intptr_t kCount = 1000;
+  intptr_t total = 0;
+  for (intptr_t i = 0; i < kCount; i++) {
+    intptr_t distance = profiler.NextSampleDistance();
+    EXPECT(distance >= (kInterval / 2));
+    EXPECT(distance <= (3 * kInterval / 2));
+    EXPECT(Utils::IsAligned(distance, kObjectAlignment));
+    total += distance;
+  }
+  // The distances average to the interval.
+  intptr_t average = total / kCount;
+  EXPECT(average > (9 * kInterval / 10));
+  EXPECT(average < (11 * kInterval / 10));
+
+  // Old space allocations are sampled about once per interval.
+  intptr_t samples = 0;
+  for (intptr_t i = 0; i < kCount * kInterval / KB; i++) {
+    if (profiler.CountAllocation(KB)) {
+      samples++;
+    }
+  }
+  EXPECT(samples > (9 * kCount / 10));
+  EXPECT(samples < (11 * kCount / 10));
+}
+
+
+TEST_CASE(AllocationSamples) {
+  AllocationProfiler profiler(KB, 8);
+  const Array& array = Array::Handle(Array::New(1));
+  const Class& array_class = Class::Handle(array.clazz());
+  const String& str = String::Handle(String::New("sample"));
+  const Class& string_class = Class::Handle(str.clazz());
+
+  // Samples of the same class and stack share a call site.
+  profiler.RecordSample(array_class);
+  profiler.RecordSample(array_class);
+  profiler.RecordSample(string_class);
+  EXPECT_EQ(3, profiler.num_samples());
+  EXPECT_EQ(2, profiler.num_call_sites());
+
+  // Only the allocation at the sample address is recorded.
+  profiler.set_sample_address(RawObject::ToAddr(array.raw()));
+  EXPECT(profiler.IsSampleAddress(RawObject::ToAddr(array.raw())));
+  EXPECT(!profiler.IsSampleAddress(RawObject::ToAddr(str.raw())));
+  profiler.RecordSample(array_class);
+  EXPECT(!profiler.IsSampleAddress(RawObject::ToAddr(array.raw())));
+  profiler.Print();
+}
+
+}  // namespace dart
@@ -1324,11 +1324,49 @@ void Assembler::CompareObject(Register reg, const Object& object) {
 }
 
 
+// Jumps to 'no_update' if storing 'value' into 'object' does not need to be
+// recorded in the store buffer, i.e. unless an old object is made to point to
+// a new object.
+void Assembler::StoreIntoObjectFilter(Register object,
+                                      Register value,
+                                      Label* no_update) {
+  // Smis are never remembered.
+  testl(value, Immediate(kHeapObjectTag));
+  j(ZERO, no_update, Assembler::kNearJump);
+  // Stores into new objects are never remembered.
+  testl(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, no_update, Assembler::kNearJump);
+  // Stores of old objects are only recorded while the old generation is being
+  // marked incrementally.
+  Label update;
+  testl(value, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &update, Assembler::kNearJump);
+  cmpl(Address::Absolute(Heap::MarkingBarrierAddress()), Immediate(0));
+  j(EQUAL, no_update, Assembler::kNearJump);
+  Bind(&update);
+}
+
+
 void Assembler::StoreIntoObject(Register object,
                                 const FieldAddress& dest,
                                 Register value) {
-  // TODO(iposva): Add write barrier.
   movl(dest, value);
+  Label done;
+  StoreIntoObjectFilter(object, value, &done);
+  // A store buffer update is required. Pass the object in EAX and the address
+  // of the updated slot on the stack.
+  pushl(EAX);
+  leal(EAX, dest);
+  pushl(EAX);
+  if (object == EAX) {
+    movl(EAX, Address(ESP, kWordSize));
+  } else {
+    movl(EAX, object);
+  }
+  call(&StubCode::UpdateStoreBufferLabel());
+  popl(EAX);  // Drop the slot address.
+  popl(EAX);
+  Bind(&done);
 }
 
 
@@ -506,6 +506,8 @@ class Assembler : public ValueObject {
   void CompareObject(Register reg, const Object& object);
   void LoadDoubleConstant(XmmRegister dst, double value);
 
+  // Store 'value' into 'dest' and record 'object' in the store buffer if the
+  // store creates a pointer from old space into new space.
   void StoreIntoObject(Register object,  // Object we are storing into.
                        const FieldAddress& dest,  // Where we are storing into.
                        Register value);  // Value we are storing.
@@ -563,6 +565,8 @@ class Assembler : public ValueObject {
   AssemblerBuffer buffer_;
   int prolog_offset_;
 
+  void StoreIntoObjectFilter(Register object, Register value, Label* no_update);
+
   inline void EmitUint8(uint8_t value);
   inline void EmitInt32(int32_t value);
   inline void EmitRegisterOperand(int rm, int reg);
@@ -22,7 +22,6 @@ void AssemblerMacros::TryAllocate(Assembler* assembler,
                                   Label* failure,
                                   Register instance_reg) {
 #if defined(DEBUG)
-  __ Untested("AssemblerMacros::TryAllocate");
   Label ok;
   __ LoadObject(instance_reg, cls);
   __ cmpq(instance_reg, class_reg);
@@ -519,6 +519,66 @@ void Assembler::divsd(XmmRegister dst, XmmRegister src) {
 }
 
 
+void Assembler::sqrtsd(XmmRegister dst, XmmRegister src) {
+  // TODO(srdjan): implement and test XMM8 - XMM15.
+  ASSERT(src <= XMM7);
+  ASSERT(dst <= XMM7);
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitUint8(0xF2);
+  EmitUint8(0x0F);
+  EmitUint8(0x51);
+  EmitXmmRegisterOperand(dst, src);
+}
+
+
+void Assembler::xorps(XmmRegister dst, XmmRegister src) {
+  // TODO(srdjan): implement and test XMM8 - XMM15.
+  ASSERT(src <= XMM7);
+  ASSERT(dst <= XMM7);
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitUint8(0x0F);
+  EmitUint8(0x57);
+  EmitXmmRegisterOperand(dst, src);
+}
+
+
+void Assembler::xorpd(XmmRegister dst, XmmRegister src) {
+  // TODO(srdjan): implement and test XMM8 - XMM15.
+  ASSERT(src <= XMM7);
+  ASSERT(dst <= XMM7);
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitUint8(0x66);
+  EmitUint8(0x0F);
+  EmitUint8(0x57);
+  EmitXmmRegisterOperand(dst, src);
+}
+
+
+void Assembler::cvtsi2sd(XmmRegister dst, Register src) {
+  // TODO(srdjan): implement and test XMM8 - XMM15.
+  ASSERT(dst <= XMM7);
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  Operand operand(src);
+  EmitUint8(0xF2);
+  EmitOperandREX(0, operand, REX_W);
+  EmitUint8(0x0F);
+  EmitUint8(0x2A);
+  EmitOperand(dst & 7, operand);
+}
+
+
+void Assembler::comisd(XmmRegister a, XmmRegister b) {
+  // TODO(srdjan): implement and test XMM8 - XMM15.
+  ASSERT(a <= XMM7);
+  ASSERT(b <= XMM7);
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitUint8(0x66);
+  EmitUint8(0x0F);
+  EmitUint8(0x2F);
+  EmitXmmRegisterOperand(a, b);
+}
+
+
 void Assembler::xchgl(Register dst, Register src) {
   AssemblerBuffer::EnsureCapacity ensured(&buffer_);
   Operand operand(src);
@@ -1037,6 +1097,22 @@ void Assembler::negq(Register reg) {
 }
 
 
+void Assembler::notl(Register reg) {
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitRegisterREX(reg, REX_NONE);
+  EmitUint8(0xF7);
+  EmitUint8(0xD0 | (reg & 7));
+}
+
+
+void Assembler::notq(Register reg) {
+  AssemblerBuffer::EnsureCapacity ensured(&buffer_);
+  EmitRegisterREX(reg, REX_W);
+  EmitUint8(0xF7);
+  EmitUint8(0xD0 | (reg & 7));
+}
+
+
 void Assembler::enter(const Immediate& imm) {
   AssemblerBuffer::EnsureCapacity ensured(&buffer_);
   EmitUint8(0xC8);
@@ -1297,11 +1373,50 @@ void Assembler::CompareObject(Register reg, const Object& object) {
 }
 
 
+// Jumps to 'no_update' if storing 'value' into 'object' does not need to be
+// recorded in the store buffer, i.e. unless an old object is made to point to
+// a new object.
+void Assembler::StoreIntoObjectFilter(Register object,
+                                      Register value,
+                                      Label* no_update) {
+  // Smis are never remembered.
+  testq(value, Immediate(kHeapObjectTag));
+  j(ZERO, no_update, Assembler::kNearJump);
+  // Stores into new objects are never remembered.
+  testq(object, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, no_update, Assembler::kNearJump);
+  // Stores of old objects are only recorded while the old generation is being
+  // marked incrementally.
+  Label update;
+  testq(value, Immediate(kNewObjectAlignmentOffset));
+  j(NOT_ZERO, &update, Assembler::kNearJump);
+  movq(TMP, Immediate(Heap::MarkingBarrierAddress()));
+  cmpq(Address(TMP, 0), Immediate(0));
+  j(EQUAL, no_update, Assembler::kNearJump);
+  Bind(&update);
+}
+
+
 void Assembler::StoreIntoObject(Register object,
                                 const FieldAddress& dest,
                                 Register value) {
-  // TODO(iposva): Add write barrier.
   movq(dest, value);
+  Label done;
+  StoreIntoObjectFilter(object, value, &done);
+  // A store buffer update is required. Pass the object in RAX and the address
+  // of the updated slot on the stack.
+  pushq(RAX);
+  leaq(RAX, dest);
+  pushq(RAX);
+  if (object == RAX) {
+    movq(RAX, Address(RSP, kWordSize));
+  } else {
+    movq(RAX, object);
+  }
+  call(&StubCode::UpdateStoreBufferLabel());
+  popq(RAX);  // Drop the slot address.
+  popq(RAX);
+  Bind(&done);
 }
 
 
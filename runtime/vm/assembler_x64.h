@@ -369,6 +369,15 @@ class Assembler : public ValueObject {
   void subsd(XmmRegister dst, XmmRegister src);
   void mulsd(XmmRegister dst, XmmRegister src);
   void divsd(XmmRegister dst, XmmRegister src);
+  void sqrtsd(XmmRegister dst, XmmRegister src);
+
+  void xorps(XmmRegister dst, XmmRegister src);
+  void xorpd(XmmRegister dst, XmmRegister src);
+
+  // Converts the 64 bit integer in 'src' to a double.
+  void cvtsi2sd(XmmRegister dst, Register src);
+
+  void comisd(XmmRegister a, XmmRegister b);
 
   void xchgl(Register dst, Register src);
   void xchgq(Register dst, Register src);
@@ -455,6 +464,9 @@ class Assembler : public ValueObject {
   void negl(Register reg);
   void negq(Register reg);
 
+  void notl(Register reg);
+  void notq(Register reg);
+
   void enter(const Immediate& imm);
   void leave();
   void ret();
@@ -494,6 +506,8 @@ class Assembler : public ValueObject {
   void CompareObject(Register reg, const Object& object);
   void LoadDoubleConstant(XmmRegister dst, double value);
 
+  // Store 'value' into 'dest' and record 'object' in the store buffer if the
+  // store creates a pointer from old space into new space.
   void StoreIntoObject(Register object,  // Object we are storing into.
                        const FieldAddress& dest,  // Where we are storing into.
                        Register value);  // Value we are storing.
@@ -551,6 +565,8 @@ class Assembler : public ValueObject {
   AssemblerBuffer buffer_;
   int prolog_offset_;
 
+  void StoreIntoObjectFilter(Register object, Register value, Label* no_update);
+
   inline void EmitUint8(uint8_t value);
   inline void EmitInt32(int32_t value);
   inline void EmitInt64(int64_t value);
@@ -461,6 +461,20 @@ ASSEMBLER_TEST_RUN(Negate, entry) {
 }
 
 
+ASSEMBLER_TEST_GENERATE(BitwiseNot, assembler) {
+  __ movq(R9, Immediate(0x0000000100000000LL));
+  __ notq(R9);
+  __ movq(RAX, R9);
+  __ ret();
+}
+
+
+ASSEMBLER_TEST_RUN(BitwiseNot, entry) {
+  typedef int64_t (*BitwiseNot)();
+  EXPECT_EQ(~0x0000000100000000LL, reinterpret_cast<BitwiseNot>(entry)());
+}
+
+
 ASSEMBLER_TEST_GENERATE(MoveExtend, assembler) {
   __ movq(RDX, Immediate(0xffff));
   __ movzxb(RAX, RDX);  // RAX = 0xff
@@ -1107,6 +1121,90 @@ ASSEMBLER_TEST_RUN(DoubleFPOperations, entry) {
 }
 
 
+ASSEMBLER_TEST_GENERATE(SquareRootDouble, assembler) {
+  __ movq(RAX, Immediate(bit_cast<int64_t, double>(16.0)));
+  __ pushq(RAX);
+  __ movsd(XMM1, Address(RSP, 0));
+  __ sqrtsd(XMM0, XMM1);
+  __ popq(RAX);
+  __ ret();
+}
+
+
+ASSEMBLER_TEST_RUN(SquareRootDouble, entry) {
+  typedef double (*SquareRootDoubleCode)();
+  double res = reinterpret_cast<SquareRootDoubleCode>(entry)();
+  EXPECT_FLOAT_EQ(4.0, res, 0.001);
+}
+
+
+ASSEMBLER_TEST_GENERATE(XorpdZeroing, assembler) {
+  __ movq(RAX, Immediate(bit_cast<int64_t, double>(12.56e3)));
+  __ pushq(RAX);
+  __ movsd(XMM0, Address(RSP, 0));
+  __ movsd(XMM1, XMM0);
+  __ xorpd(XMM0, XMM0);
+  __ xorps(XMM1, XMM1);
+  __ addsd(XMM0, XMM1);
+  __ popq(RAX);
+  __ ret();
+}
+
+
+ASSEMBLER_TEST_RUN(XorpdZeroing, entry) {
+  typedef double (*XorpdZeroingCode)();
+  double res = reinterpret_cast<XorpdZeroingCode>(entry)();
+  EXPECT_FLOAT_EQ(0.0, res, 0.0001);
+}
+
+
+ASSEMBLER_TEST_GENERATE(IntToDoubleConversion, assembler) {
+  // Needs all 64 bits of the source register.
+  __ movq(R8, Immediate(0x0000000100000006LL));
+  __ cvtsi2sd(XMM0, R8);
+  __ movq(RDX, Immediate(-6));
+  __ cvtsi2sd(XMM1, RDX);
+  __ addsd(XMM0, XMM1);
+  __ ret();
+}
+
+
+ASSEMBLER_TEST_RUN(IntToDoubleConversion, entry) {
+  typedef double (*IntToDoubleConversionCode)();
+  double res = reinterpret_cast<IntToDoubleConversionCode>(entry)();
+  EXPECT_FLOAT_EQ(4294967296.0, res, 0.001);
+}
+
+
+ASSEMBLER_TEST_GENERATE(DoubleCompare, assembler) {
+  Label is_below, done;
+  __ movq(RAX, Immediate(bit_cast<int64_t, double>(1.5)));
+  __ pushq(RAX);
+  __ movsd(XMM0, Address(RSP, 0));
+  __ movq(RAX, Immediate(bit_cast<int64_t, double>(2.5)));
+  __ movq(Address(RSP, 0), RAX);
+  __ movsd(XMM1, Address(RSP, 0));
+  __ popq(RAX);
+  __ comisd(XMM0, XMM1);
+  __ j(BELOW, &is_below);
+  __ movq(RAX, Immediate(0));
+  __ jmp(&done);
+  __ Bind(&is_below);
+  __ comisd(XMM1, XMM1);
+  __ movq(RAX, Immediate(1));
+  __ j(EQUAL, &done);
+  __ movq(RAX, Immediate(0));
+  __ Bind(&done);
+  __ ret();
+}
+
+
+ASSEMBLER_TEST_RUN(DoubleCompare, entry) {
+  typedef int (*DoubleCompareCode)();
+  EXPECT_EQ(1, reinterpret_cast<DoubleCompareCode>(entry)());
+}
+
+
 ASSEMBLER_TEST_GENERATE(TestObjectCompare, assembler) {
   ObjectStore* object_store = Isolate::Current()->object_store();
   const Object& obj = Object::ZoneHandle(object_store->smi_class());
@@ -0,0 +1,29 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_ATOMIC_H_
+#define VM_ATOMIC_H_
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Atomic operations with full memory barrier semantics.
+class AtomicOperations : public AllStatic {
+ public:
+  // Atomically add 'value' to the value at 'ptr'. Returns the original value
+  // at 'ptr'.
+  static intptr_t FetchAndAdd(volatile intptr_t* ptr, intptr_t value);
+
+  // Atomically compare the value at 'ptr' to 'old_value' and store 'new_value'
+  // if they are equal. Returns the original value at 'ptr'.
+  static uword CompareAndSwapWord(volatile uword* ptr,
+                                  uword old_value,
+                                  uword new_value);
+};
+
+}  // namespace dart
+
+#endif  // VM_ATOMIC_H_
@@ -0,0 +1,21 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/atomic.h"
+
+namespace dart {
+
+intptr_t AtomicOperations::FetchAndAdd(volatile intptr_t* ptr,
+                                       intptr_t value) {
+  return __sync_fetch_and_add(ptr, value);
+}
+
+
+uword AtomicOperations::CompareAndSwapWord(volatile uword* ptr,
+                                           uword old_value,
+                                           uword new_value) {
+  return __sync_val_compare_and_swap(ptr, old_value, new_value);
+}
+
+}  // namespace dart
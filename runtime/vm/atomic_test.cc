@@ -0,0 +1,29 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/assert.h"
+#include "vm/atomic.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+UNIT_TEST_CASE(FetchAndAdd) {
+  intptr_t v = 42;
+  EXPECT_EQ(42, AtomicOperations::FetchAndAdd(&v, 1));
+  EXPECT_EQ(43, v);
+  EXPECT_EQ(43, AtomicOperations::FetchAndAdd(&v, -3));
+  EXPECT_EQ(40, v);
+}
+
+
+UNIT_TEST_CASE(CompareAndSwapWord) {
+  uword v = 42;
+  EXPECT_EQ(42, AtomicOperations::CompareAndSwapWord(&v, 42, 7));
+  EXPECT_EQ(7, v);
+  // The swap fails if the expected value does not match.
+  EXPECT_EQ(7, AtomicOperations::CompareAndSwapWord(&v, 42, 3));
+  EXPECT_EQ(7, v);
+}
+
+}  // namespace dart
@@ -0,0 +1,32 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include <windows.h>
+
+#include "vm/atomic.h"
+
+namespace dart {
+
+intptr_t AtomicOperations::FetchAndAdd(volatile intptr_t* ptr,
+                                       intptr_t value) {
+#if defined(ARCH_IS_32_BIT)
+  return static_cast<intptr_t>(InterlockedExchangeAdd(
+      reinterpret_cast<volatile LONG*>(ptr), static_cast<LONG>(value)));
+#else
+  return static_cast<intptr_t>(InterlockedExchangeAdd64(
+      reinterpret_cast<volatile LONGLONG*>(ptr), static_cast<LONGLONG>(value)));
+#endif
+}
+
+
+uword AtomicOperations::CompareAndSwapWord(volatile uword* ptr,
+                                           uword old_value,
+                                           uword new_value) {
+  return reinterpret_cast<uword>(InterlockedCompareExchangePointer(
+      reinterpret_cast<volatile PVOID*>(ptr),
+      reinterpret_cast<PVOID>(new_value),
+      reinterpret_cast<PVOID>(old_value)));
+}
+
+}  // namespace dart
@@ -151,7 +151,8 @@ DEFINE_RUNTIME_ENTRY(AllocateArray, 3) {
 DEFINE_RUNTIME_ENTRY(AllocateObject, 3) {
   ASSERT(arguments.Count() == kAllocateObjectRuntimeEntry.argument_count());
   const Class& cls = Class::CheckedHandle(arguments.At(0));
-  const Instance& instance = Instance::Handle(Instance::New(cls));
+  const Instance& instance =
+      Instance::Handle(Instance::New(cls, cls.AllocationSpace()));
   arguments.SetReturn(instance);
   if (!cls.HasTypeArguments()) {
     // No type arguments required for a non-parameterized type.
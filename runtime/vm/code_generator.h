@@ -80,6 +80,7 @@ enum DeoptReasonId {
   kDeoptNoTypeFeedback,
   kDeoptSAR,
   kDeoptUnaryOp,
+  kDeoptCheckClass,
 };
 
 // This class wraps around the array RawClass::functions_cache_.
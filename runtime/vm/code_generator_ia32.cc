@@ -1019,6 +1019,15 @@ void CodeGenerator::VisitArrayNode(ArrayNode* node) {
   for (int i = node->length() - 1; i >= 0; i--) {
     __ popl(Address(ECX, i * kWordSize));
   }
+  // The array may have been allocated in old space, in which case it has to be
+  // remembered as the stored elements may be new objects.
+  Label array_is_new;
+  __ testl(EAX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &array_is_new, Assembler::kNearJump);
+  __ pushl(Immediate(0));  // All elements have been updated.
+  __ call(&StubCode::UpdateStoreBufferLabel());
+  __ AddImmediate(ESP, Immediate(kWordSize));
+  __ Bind(&array_is_new);
 
   if (IsResultNeeded(node)) {
     __ pushl(EAX);
@@ -25,6 +25,8 @@ namespace dart {
 DEFINE_FLAG(bool, print_ast, false, "Print abstract syntax tree.");
 DEFINE_FLAG(bool, print_scopes, false, "Print scopes of local variables.");
 DEFINE_FLAG(bool, trace_functions, false, "Trace entry of each function.");
+DEFINE_FLAG(bool, print_ic_in_optimized, false,
+    "Debugging helper to identify potential performance pitfalls.");
 DEFINE_FLAG(int, optimization_invocation_threshold, 1000,
     "number of invocations before a function is optimized, -1 means never.");
 DECLARE_FLAG(bool, enable_type_checks);
@@ -444,6 +446,10 @@ void CodeGenerator::GenerateInstanceCall(
     int num_arguments,
     const Array& optional_arguments_names,
     intptr_t num_args_checked) {
+  if (FLAG_print_ic_in_optimized && IsOptimizing()) {
+    OS::Print("Generate IC in optimized code: id %d name: '%s'\n",
+        node_id, function_name.ToCString());
+  }
   ASSERT(num_args_checked > 0);  // At least receiver check is necessary.
   // Set up the function name and number of arguments (including the receiver)
   // to the InstanceCall stub which will resolve the correct entrypoint for
@@ -1020,6 +1026,15 @@ void CodeGenerator::VisitArrayNode(ArrayNode* node) {
   for (int i = node->length() - 1; i >= 0; i--) {
     __ popq(Address(RCX, i * kWordSize));
   }
+  // The array may have been allocated in old space, in which case it has to be
+  // remembered as the stored elements may be new objects.
+  Label array_is_new;
+  __ testq(RAX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &array_is_new, Assembler::kNearJump);
+  __ pushq(Immediate(0));  // All elements have been updated.
+  __ call(&StubCode::UpdateStoreBufferLabel());
+  __ AddImmediate(RSP, Immediate(kWordSize));
+  __ Bind(&array_is_new);
 
   if (IsResultNeeded(node)) {
     __ pushq(RAX);
@@ -2251,6 +2266,9 @@ void CodeGenerator::VisitInstanceCallNode(InstanceCallNode* node) {
 
 void CodeGenerator::VisitStaticCallNode(StaticCallNode* node) {
   node->arguments()->Visit(this);
+  // The target may be inlined in optimized code, therefore this may be a
+  // deoptimization point.
+  MarkDeoptPoint(node->id(), node->token_index());
   __ LoadObject(RBX, node->function());
   __ LoadObject(R10, ArgumentsDescriptor(node->arguments()->length(),
                                          node->arguments()->names()));
@@ -130,6 +130,7 @@ NODE_LIST(DEFINE_VISITOR_FUNCTION)
  private:
   // TODO(srdjan): Remove the friendship once the two compilers are properly
   // structured.
+  friend class FlowGraphCompiler;
   friend class OptimizingCodeGenerator;
 
   // Forward declarations.
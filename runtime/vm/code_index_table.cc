@@ -4,11 +4,17 @@
 
 #include "vm/code_index_table.h"
 
+#include "vm/code_patcher.h"
+#include "vm/debugger.h"
+#include "vm/growable_array.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
 #include "vm/pages.h"
 #include "vm/raw_object.h"
+#include "vm/stack_frame.h"
+#include "vm/stub_code.h"
 #include "vm/visitor.h"
+#include "vm/zone.h"
 
 namespace dart {
 
@@ -64,6 +70,115 @@ RawFunction* CodeIndexTable::LookupFunction(uword pc) const {
 }
 
 
+// The code of static functions and constructors is only reached through
+// static calls, which can be reset to the lazy compilation stub. Instance
+// functions are also called through inline caches and functions caches, and
+// closure functions through closures, which jump to the code directly.
+static bool IsFlushable(const Function& function, const Code& code) {
+  // Only the current code of a function is dropped, and only if it is
+  // unoptimized: optimized code depends on its unoptimized code.
+  if ((function.code() != code.raw()) ||
+      (function.unoptimized_code() != code.raw())) {
+    return false;
+  }
+  switch (function.kind()) {
+    case RawFunction::kFunction:
+    case RawFunction::kGetterFunction:
+    case RawFunction::kSetterFunction:
+      return function.is_static();
+    case RawFunction::kConstructor:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+static bool ContainsFunction(const GrowableArray<RawFunction*>& functions,
+                             RawFunction* function) {
+  for (intptr_t i = 0; i < functions.length(); i++) {
+    if (functions[i] == function) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+intptr_t CodeIndexTable::FlushUnusedCode(intptr_t max_age) {
+  ASSERT(max_age > 0);
+  Isolate* isolate = Isolate::Current();
+  // Breakpoints are set by patching the static calls of the code.
+  if ((isolate->debugger() != NULL) && isolate->debugger()->IsActive()) {
+    return 0;
+  }
+  // Nothing is allocated in the heap while the code is flushed, the raw
+  // function pointers collected below stay valid.
+  Zone zone(isolate);
+  HandleScope handle_scope(isolate);
+
+  // The code of functions with an activation on the stack is still needed.
+  GrowableArray<RawFunction*> active_functions;
+  DartFrameIterator iterator;
+  for (DartFrame* frame = iterator.NextFrame();
+       frame != NULL;
+       frame = iterator.NextFrame()) {
+    active_functions.Add(frame->LookupDartFunction());
+  }
+
+  GrowableArray<RawFunction*> unused_functions;
+  const Array& codes_list = Array::Handle(code_lists_);
+  Array& codes = Array::Handle();
+  for (intptr_t i = 0; i < code_pages_->length(); i++) {
+    codes ^= codes_list.At(i);
+    AgeList(code_pages_->At(i).pc_ranges,
+            codes,
+            max_age,
+            active_functions,
+            &unused_functions);
+  }
+  codes = largecode_list_;
+  AgeList(largecode_pc_ranges_,
+          codes,
+          max_age,
+          active_functions,
+          &unused_functions);
+  if (unused_functions.length() == 0) {
+    return 0;
+  }
+
+  // Static calls are patched to call their target directly once it is
+  // compiled, make them go through the lazy compilation stub again.
+  Code& code = Code::Handle();
+  for (intptr_t i = 0; i < code_pages_->length(); i++) {
+    codes ^= codes_list.At(i);
+    for (intptr_t j = 0; j < code_pages_->At(i).pc_ranges->length(); j++) {
+      code ^= codes.At(j);
+      ResetStaticCalls(code, unused_functions);
+    }
+  }
+  if (largecode_pc_ranges_ != NULL) {
+    codes = largecode_list_;
+    for (intptr_t j = 0; j < largecode_pc_ranges_->length(); j++) {
+      code ^= codes.At(j);
+      ResetStaticCalls(code, unused_functions);
+    }
+  }
+
+  Function& function = Function::Handle();
+  for (intptr_t i = 0; i < unused_functions.length(); i++) {
+    function = unused_functions[i];
+    code = function.code();
+    RemoveCode(code);
+    function.ClearCode();
+    // Aging starts over once the function has been compiled and invoked
+    // again.
+    function.set_invocation_counter(0);
+  }
+  return unused_functions.length();
+}
+
+
 RawCode* CodeIndexTable::LookupCode(uword pc) const {
   uword page_start = (pc & ~(PageSpace::kPageSize - 1));
   int page_index = FindPageIndex(page_start);
@@ -187,9 +302,123 @@ void CodeIndexTable::AddFuncHelper(IndexArray<PcRange>* pc_ranges,
   PcRange pc_range;
   pc_range.entrypoint = entrypoint;
   pc_range.size = size;
-  intptr_t next_slot = pc_ranges->length();
-  pc_ranges->Add(pc_range);  // pc_range gets added at 'next_slot'.
-  codes.SetAt(next_slot, Code::Handle(func.code()));
+  pc_range.invocation_count = func.invocation_counter();
+  pc_range.age = 0;
+  // Code is allocated in ascending order unless the memory of flushed code
+  // is reused, keep the pc ranges sorted by moving the later ones up.
+  intptr_t index = pc_ranges->length();
+  pc_ranges->Add(pc_range);
+  Object& code = Object::Handle();
+  while ((index > 0) && (pc_ranges->At(index - 1).entrypoint > entrypoint)) {
+    pc_ranges->At(index) = pc_ranges->At(index - 1);
+    code = codes.At(index - 1);
+    codes.SetAt(index, code);
+    index--;
+  }
+  pc_ranges->At(index) = pc_range;
+  codes.SetAt(index, Code::Handle(func.code()));
+}
+
+
+void CodeIndexTable::RemoveFromList(IndexArray<PcRange>* pc_ranges,
+                                    const Array& codes,
+                                    intptr_t index) {
+  intptr_t last = pc_ranges->length() - 1;
+  Object& code = Object::Handle();
+  for (intptr_t i = index; i < last; i++) {
+    pc_ranges->At(i) = pc_ranges->At(i + 1);
+    code = codes.At(i + 1);
+    codes.SetAt(i, code);
+  }
+  codes.SetAt(last, Object::Handle());
+  pc_ranges->RemoveLast();
+}
+
+
+void CodeIndexTable::RemoveCode(const Code& code) {
+  uword entrypoint = code.EntryPoint();
+  if (PageSpace::IsPageAllocatableSize(code.Size())) {
+    uword page_start = (entrypoint & ~(PageSpace::kPageSize - 1));
+    int page_index = FindPageIndex(page_start);
+    ASSERT(page_index != -1);
+    IndexArray<PcRange>* pc_ranges = code_pages_->At(page_index).pc_ranges;
+    const Array& codes_list = Array::Handle(code_lists_);
+    Array& codes = Array::Handle();
+    codes ^= codes_list.At(page_index);
+    intptr_t index = FindPcIndex(*pc_ranges, entrypoint, kIsSorted);
+    ASSERT(index != -1);
+    RemoveFromList(pc_ranges, codes, index);
+  } else {
+    ASSERT(largecode_pc_ranges_ != NULL);
+    const Array& large_codes = Array::Handle(largecode_list_);
+    intptr_t index =
+        FindPcIndex(*largecode_pc_ranges_, entrypoint, kIsNotSorted);
+    ASSERT(index != -1);
+    RemoveFromList(largecode_pc_ranges_, large_codes, index);
+  }
+}
+
+
+void CodeIndexTable::AgeList(
+    IndexArray<PcRange>* pc_ranges,
+    const Array& codes,
+    intptr_t max_age,
+    const GrowableArray<RawFunction*>& active_functions,
+    GrowableArray<RawFunction*>* unused_functions) {
+  if (pc_ranges == NULL) {
+    return;
+  }
+  Code& code = Code::Handle();
+  Function& function = Function::Handle();
+  for (intptr_t i = 0; i < pc_ranges->length(); i++) {
+    PcRange& pc_range = pc_ranges->At(i);
+    code ^= codes.At(i);
+    function = code.function();
+    if (!IsFlushable(function, code)) {
+      continue;
+    }
+    // The invocation counter is incremented on entry of unoptimized code.
+    // Code which was not invoked since it was compiled is not aged, the call
+    // which compiled it may not have reached it yet.
+    intptr_t count = function.invocation_counter();
+    if ((count == 0) || (count != pc_range.invocation_count)) {
+      pc_range.invocation_count = count;
+      pc_range.age = 0;
+      continue;
+    }
+    pc_range.age++;
+    if ((pc_range.age >= max_age) &&
+        !ContainsFunction(active_functions, function.raw())) {
+      unused_functions->Add(function.raw());
+    }
+  }
+}
+
+
+void CodeIndexTable::ResetStaticCalls(
+    const Code& code,
+    const GrowableArray<RawFunction*>& functions) {
+  const PcDescriptors& descriptors =
+      PcDescriptors::Handle(code.pc_descriptors());
+  // The descriptors are only set once the code has been added to the table.
+  if (descriptors.IsNull()) {
+    return;
+  }
+  Function& target_function = Function::Handle();
+  uword target = 0;
+  for (intptr_t i = 0; i < descriptors.Length(); i++) {
+    uword pc = descriptors.PC(i);
+    if ((descriptors.DescriptorKind(i) != PcDescriptors::kOther) ||
+        !CodePatcher::IsDartCall(pc)) {
+      continue;
+    }
+    CodePatcher::GetStaticCallAt(pc, &target_function, &target);
+    if ((target != StubCode::CallStaticFunctionEntryPoint()) &&
+        ContainsFunction(functions, target_function.raw())) {
+      CodePatcher::PatchStaticCallAt(pc,
+                                     StubCode::CallStaticFunctionEntryPoint());
+    }
+  }
 }
 
 
@@ -19,6 +19,7 @@ class ObjectPointerVisitor;
 class RawArray;
 class RawCode;
 class RawFunction;
+template<typename T> class GrowableArray;
 
 // This class is used to lookup a Function object given a pc.
 // This functionality is used while stack walking in order to find the Dart
@@ -43,6 +44,13 @@ class CodeIndexTable {
   // Lookup code index table to find corresponding code object.
   RawCode* LookupCode(uword pc) const;
 
+  // Drop the unoptimized code of the static functions which were not invoked
+  // during the last 'max_age' calls. The calls to these functions are reset
+  // to the lazy compilation stub and their code is removed from the table, so
+  // that the next collection can free it.
+  // Returns the number of functions whose code was dropped.
+  intptr_t FlushUnusedCode(intptr_t max_age);
+
   // Visit all object pointers (support for GC).
   void VisitObjectPointers(ObjectPointerVisitor* visitor);
 
@@ -84,6 +92,10 @@ class CodeIndexTable {
       data_[length_] = value;
       length_ += 1;
     }
+    void RemoveLast() {
+      ASSERT(length_ > 0);
+      length_ -= 1;
+    }
     void Resize(int new_capacity) {
       ASSERT(new_capacity > capacity_);
       T* new_data = reinterpret_cast<T*>(realloc(reinterpret_cast<void*>(data_),
@@ -104,6 +116,8 @@ class CodeIndexTable {
   typedef struct {
     uword entrypoint;  // Entry point for the function.
     intptr_t size;  // Code size for the function.
+    intptr_t invocation_count;  // Invocation counter seen by the last aging.
+    intptr_t age;  // Number of agings without an invocation.
   } PcRange;
 
   // Information about function pc ranges for a code page.
@@ -139,6 +153,28 @@ class CodeIndexTable {
                      intptr_t size,
                      const Function& func);
 
+  // Remove the entry at 'index' of the list.
+  static void RemoveFromList(IndexArray<PcRange>* pc_ranges,
+                             const Array& codes,
+                             intptr_t index);
+
+  // Age the entries of the list and collect the functions whose code was not
+  // invoked during the last 'max_age' agings. The functions with an
+  // activation are not collected.
+  static void AgeList(IndexArray<PcRange>* pc_ranges,
+                      const Array& codes,
+                      intptr_t max_age,
+                      const GrowableArray<RawFunction*>& active_functions,
+                      GrowableArray<RawFunction*>* unused_functions);
+
+  // Reset the static calls of 'code' to one of 'functions' to the lazy
+  // compilation stub.
+  static void ResetStaticCalls(const Code& code,
+                               const GrowableArray<RawFunction*>& functions);
+
+  // Remove the entry of 'code' from the table.
+  void RemoveCode(const Code& code);
+
   // Lookup code corresponding to the pc in the large functions list
   RawCode* LookupLargeCode(uword pc) const;
 
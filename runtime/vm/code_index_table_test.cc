@@ -7,11 +7,14 @@
 #include "vm/assert.h"
 #include "vm/class_finalizer.h"
 #include "vm/compiler.h"
+#include "vm/heap.h"
 #include "vm/object.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(int, code_flushing_age);
+
 // Compiler only implemented on IA32 and x64 now.
 #if defined(TARGET_ARCH_IA32) || defined(TARGET_ARCH_X64)
 
@@ -153,6 +156,80 @@ TEST_CASE(CodeIndexTable) {
   EXPECT(code_index_table->LookupCode(pc) == code.raw());
 }
 
+
+
+TEST_CASE(CodeFlushing) {
+  const char* kScriptChars =
+      "class A {\n"
+      "  static used() { return 1; }\n"
+      "  static unused() { return 2; }\n"
+      "  unusedMethod() { return 3; }\n"
+      "}\n";
+  const intptr_t saved_code_flushing_age = FLAG_code_flushing_age;
+  FLAG_code_flushing_age = 2;
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  CodeIndexTable* code_index_table = isolate->code_index_table();
+  const Library& lib = Library::Handle(Library::CoreLibrary());
+  const String& url = String::Handle(String::New("dart-test:CodeFlushing"));
+  const String& source = String::Handle(String::New(kScriptChars));
+  const Script& script =
+      Script::Handle(Script::New(url, source, RawScript::kSource));
+  EXPECT(CompilerTest::TestCompileScript(lib, script));
+  ClassFinalizer::FinalizePendingClasses();
+  const Class& cls =
+      Class::Handle(lib.LookupClass(String::Handle(String::NewSymbol("A"))));
+  EXPECT(!cls.IsNull());
+  const Function& used = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(String::New("used"))));
+  const Function& unused = Function::Handle(
+      cls.LookupStaticFunction(String::Handle(String::New("unused"))));
+  const Function& unused_method = Function::Handle(
+      cls.LookupDynamicFunction(String::Handle(String::New("unusedMethod"))));
+  uword unused_pc = 0;
+  {
+    // The code is only referenced by the functions and the code index table.
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    EXPECT(CompilerTest::TestCompileFunction(used));
+    EXPECT(CompilerTest::TestCompileFunction(unused));
+    EXPECT(CompilerTest::TestCompileFunction(unused_method));
+    unused_pc = Code::Handle(unused.code()).EntryPoint();
+  }
+  // Code which was never invoked is not aged.
+  for (intptr_t i = 0; i < 4; i++) {
+    heap->CollectGarbage(Heap::kOld);
+  }
+  EXPECT(unused.HasCode());
+
+  // Code is flushed once it was not invoked during two collections.
+  used.set_invocation_counter(1);
+  unused.set_invocation_counter(1);
+  unused_method.set_invocation_counter(1);
+  heap->CollectGarbage(Heap::kOld);
+  intptr_t code_in_use = heap->Used(Heap::kExecutable);
+  for (intptr_t i = 0; i < 2; i++) {
+    used.set_invocation_counter(used.invocation_counter() + 1);
+    heap->CollectGarbage(Heap::kOld);
+  }
+  EXPECT(used.HasCode());
+  EXPECT(!unused.HasCode());
+  EXPECT_EQ(0, unused.invocation_counter());
+  EXPECT(code_index_table->LookupCode(unused_pc) == Code::null());
+  // Instance methods are also called through inline caches, their code is
+  // kept.
+  EXPECT(unused_method.HasCode());
+  // The instructions of the flushed code were freed.
+  EXPECT(heap->Used(Heap::kExecutable) < code_in_use);
+
+  // Flushed functions are compiled again.
+  EXPECT(CompilerTest::TestCompileFunction(unused));
+  EXPECT(unused.HasCode());
+  const Code& code = Code::Handle(unused.code());
+  EXPECT(code_index_table->LookupCode(code.EntryPoint()) == code.raw());
+  FLAG_code_flushing_age = saved_code_flushing_age;
+}
+
 #endif  // TARGET_ARCH_IA32 || TARGET_ARCH_X64
 
 }  // namespace dart
@@ -41,8 +41,8 @@ DEFINE_RUNTIME_ENTRY(CompileFunction, 1) {
 
 // Extracts IC data associated with a node id.
 // TODO(srdjan): Check performance impact of node id search loop.
-static void ExtractTypeFeedback(const Code& code,
-                                SequenceNode* sequence_node) {
+void Compiler::ExtractTypeFeedback(const Code& code,
+                                   SequenceNode* sequence_node) {
   ASSERT(!code.IsNull() && !code.is_optimized());
   GrowableArray<AstNode*> all_nodes;
   sequence_node->CollectAllNodes(&all_nodes);
@@ -99,8 +99,9 @@ static void CompileFunctionHelper(const Function& function, bool optimized) {
     // Do not use type feedback to optimize a function that was deoptimized.
     if (parsed_function.function().deoptimization_counter() <
         FLAG_deoptimization_counter_threshold) {
-      ExtractTypeFeedback(Code::Handle(parsed_function.function().code()),
-                          parsed_function.node_sequence());
+      Compiler::ExtractTypeFeedback(
+          Code::Handle(parsed_function.function().code()),
+          parsed_function.node_sequence());
     }
     OptimizingCodeGenerator code_gen(&assembler, parsed_function);
     code_gen.GenerateCode();
@@ -13,6 +13,7 @@ namespace dart {
 
 // Forward declarations.
 class Class;
+class Code;
 class Function;
 class Library;
 class RawInstance;
@@ -40,6 +41,11 @@ class Compiler : public AllStatic {
 
   // Eagerly compiles all functions in a class.
   static void CompileAllFunctions(const Class& cls);
+
+  // Attaches the IC data collected by the unoptimized 'code' of a function
+  // to the nodes of its freshly parsed 'sequence_node'.
+  static void ExtractTypeFeedback(const Code& code,
+                                  SequenceNode* sequence_node);
 };
 
 }  // namespace dart
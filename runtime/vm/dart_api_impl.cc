@@ -14,6 +14,8 @@
 #include "vm/debuginfo.h"
 #include "vm/exceptions.h"
 #include "vm/growable_array.h"
+#include "vm/heap.h"
+#include "vm/heap_profiler.h"
 #include "vm/longjump.h"
 #include "vm/native_entry.h"
 #include "vm/object.h"
@@ -615,6 +617,57 @@ DART_EXPORT void Dart_InterruptIsolate(Dart_Isolate isolate) {
 }
 
 
+// --- Heap Statistics ---
+
+
+DART_EXPORT void Dart_GetHeapStats(Dart_HeapStats* stats) {
+  Isolate* isolate = Isolate::Current();
+  CHECK_ISOLATE(isolate);
+  if (stats == NULL) {
+    FATAL1("%s expects argument 'stats' to be non-null.", CURRENT_FUNC);
+  }
+  Heap* heap = isolate->heap();
+  stats->new_in_use = heap->Used(Heap::kNew);
+  stats->new_capacity = heap->Capacity(Heap::kNew);
+  stats->old_in_use = heap->Used(Heap::kOld);
+  stats->old_capacity = heap->Capacity(Heap::kOld);
+  stats->code_in_use = heap->Used(Heap::kExecutable);
+  stats->code_capacity = heap->Capacity(Heap::kExecutable);
+
+  stats->scavenge_count = heap->Collections(Heap::kNew);
+  stats->scavenge_time = heap->TotalCollectionTime(Heap::kNew);
+  stats->last_scavenge_time = heap->LastCollectionTime(Heap::kNew);
+  stats->promoted_bytes = heap->PromotedBytes();
+
+  stats->mark_sweep_count = heap->Collections(Heap::kOld);
+  stats->mark_sweep_time = heap->TotalCollectionTime(Heap::kOld);
+  stats->last_mark_sweep_time = heap->LastCollectionTime(Heap::kOld);
+}
+
+
+DART_EXPORT void Dart_NotifyIdle(int64_t deadline) {
+  Isolate* isolate = Isolate::Current();
+  CHECK_ISOLATE(isolate);
+  isolate->heap()->NotifyIdle(deadline);
+}
+
+
+DART_EXPORT Dart_Handle Dart_DumpHeap(const char* graph_file) {
+  Isolate* isolate = Isolate::Current();
+  DARTSCOPE(isolate);
+  if (!HeapProfiler::DumpHeap(isolate, graph_file)) {
+    return Api::NewError("%s: could not write heap graph to '%s'.",
+                         CURRENT_FUNC, graph_file);
+  }
+  return Api::Success();
+}
+
+
+DART_EXPORT void Dart_RequestHeapDump() {
+  HeapProfiler::RequestDump();
+}
+
+
 // --- Messages and Ports ---
 
 
@@ -997,6 +997,37 @@ UNIT_TEST_CASE(SetMessageCallbacks) {
 }
 
 
+TEST_CASE(HeapStats) {
+  Heap* heap = Isolate::Current()->heap();
+  Dart_HeapStats before;
+  Dart_GetHeapStats(&before);
+  EXPECT(before.old_in_use > 0);
+  EXPECT(before.old_in_use <= before.old_capacity);
+  EXPECT(before.new_in_use <= before.new_capacity);
+  EXPECT(before.code_in_use > 0);
+
+  // A new string surviving a few scavenges is promoted.
+  const String& str = String::Handle(String::New("promoted", Heap::kNew));
+  for (intptr_t i = 0; i < 3; i++) {
+    heap->CollectGarbage(Heap::kNew);
+  }
+  EXPECT(str.raw()->IsOldObject());
+  Dart_HeapStats after;
+  Dart_GetHeapStats(&after);
+  EXPECT_EQ(before.scavenge_count + 3, after.scavenge_count);
+  EXPECT(after.scavenge_time >=
+         before.scavenge_time + after.last_scavenge_time);
+  EXPECT(after.promoted_bytes >= before.promoted_bytes + str.raw()->Size());
+  EXPECT_EQ(before.mark_sweep_count, after.mark_sweep_count);
+
+  heap->CollectGarbage(Heap::kOld);
+  Dart_GetHeapStats(&after);
+  EXPECT_EQ(before.mark_sweep_count + 1, after.mark_sweep_count);
+  EXPECT_EQ(before.mark_sweep_time + after.last_mark_sweep_time,
+            after.mark_sweep_time);
+}
+
+
 #if defined(TARGET_ARCH_IA32)  // only ia32 can run execution tests.
 
 TEST_CASE(FieldAccess) {
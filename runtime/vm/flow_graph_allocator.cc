@@ -0,0 +1,449 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/flow_graph_allocator.h"
+
+#include "vm/flags.h"
+#include "vm/os.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, allocate_registers, true,
+    "Keep values of optimized code in registers when possible.");
+DEFINE_FLAG(bool, trace_register_allocation, false,
+    "Print the live ranges and locations of the values of flow graphs.");
+
+
+// The positions at which a value is live, as a list of disjoint segments
+// sorted by position. The code of the instruction at position p reads its
+// inputs at p and writes its result at p + 1, so that the result may be
+// assigned the location of an input used for the last time.
+class FlowGraphAllocator::LiveRange : public ZoneAllocated {
+ public:
+  LiveRange() : starts_(2), ends_(2) { }
+
+  intptr_t Start() const { return starts_[0]; }
+  intptr_t End() const { return ends_.Last(); }
+
+  void AddSegment(intptr_t start, intptr_t end) {
+    ASSERT(start <= end);
+    ASSERT(starts_.is_empty() || (ends_.Last() < start));
+    starts_.Add(start);
+    ends_.Add(end);
+  }
+
+  bool Intersects(const LiveRange& other) const {
+    intptr_t i = 0;
+    intptr_t j = 0;
+    while ((i < starts_.length()) && (j < other.starts_.length())) {
+      if (ends_[i] < other.starts_[j]) {
+        i++;
+      } else if (other.ends_[j] < starts_[i]) {
+        j++;
+      } else {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Returns true if the value is live both before and after the
+  // instruction at 'position' executes.
+  bool IsLiveAcross(intptr_t position) const {
+    for (intptr_t i = 0; i < starts_.length(); i++) {
+      if ((starts_[i] <= position) && (position < ends_[i])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void Print() const {
+    for (intptr_t i = 0; i < starts_.length(); i++) {
+      OS::Print(" [%d, %d]", starts_[i], ends_[i]);
+    }
+  }
+
+ private:
+  GrowableArray<intptr_t> starts_;
+  GrowableArray<intptr_t> ends_;
+
+  DISALLOW_COPY_AND_ASSIGN(LiveRange);
+};
+
+
+FlowGraphAllocator::FlowGraphAllocator(FlowGraph* graph,
+                                       intptr_t register_count)
+    : graph_(graph),
+      register_count_(FLAG_allocate_registers ? register_count : 0),
+      value_count_(graph->max_ssa_temp_index()),
+      words_per_set_((graph->max_ssa_temp_index() + kBitsPerWord - 1) /
+                     kBitsPerWord),
+      block_start_(graph->reverse_postorder().length()),
+      block_end_(graph->reverse_postorder().length()),
+      call_positions_(8),
+      live_in_(),
+      live_out_(),
+      ranges_(graph->max_ssa_temp_index()),
+      registers_(graph->max_ssa_temp_index()),
+      spill_slots_(graph->max_ssa_temp_index()),
+      spill_slot_count_(0) {
+}
+
+
+void FlowGraphAllocator::AllocateRegisters() {
+  NumberInstructions();
+  ComputeLiveness();
+  BuildLiveRanges();
+  AssignRegisters();
+  AssignSpillSlots();
+  if (FLAG_trace_register_allocation) {
+    Print();
+  }
+}
+
+
+intptr_t FlowGraphAllocator::RegisterOf(Definition* defn) const {
+  const intptr_t index = defn->ssa_temp_index();
+  return (index < 0) ? -1 : registers_[index];
+}
+
+
+intptr_t FlowGraphAllocator::SpillSlotOf(Definition* defn) const {
+  const intptr_t index = defn->ssa_temp_index();
+  return (index < 0) ? -1 : spill_slots_[index];
+}
+
+
+// Block entries and instructions get even positions in block order. The phis
+// of a join are defined at the position of the block entry.
+void FlowGraphAllocator::NumberInstructions() {
+  for (intptr_t i = 0; i < value_count_; i++) {
+    ranges_.Add(NULL);
+    registers_.Add(-1);
+    spill_slots_.Add(-1);
+  }
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  intptr_t position = 0;
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    BlockEntryInstr* block = blocks[i];
+    block_start_.Add(position);
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      position += 2;
+      if (instr->is_call()) {
+        call_positions_.Add(position);
+      }
+    }
+    block_end_.Add(position);
+    position += 2;
+  }
+}
+
+
+// Live sets are bit vectors over the SSA temp indices of the values, stored
+// at 'offset' in an array of words.
+static bool Contains(const GrowableArray<uword>& sets,
+                     intptr_t offset,
+                     intptr_t value) {
+  const uword bit = static_cast<uword>(1) << (value % kBitsPerWord);
+  return (sets[offset + value / kBitsPerWord] & bit) != 0;
+}
+
+
+static void Add(GrowableArray<uword>* sets,
+                intptr_t offset,
+                Definition* value) {
+  const intptr_t index = value->ssa_temp_index();
+  // Constants and parameters are not allocated.
+  if (index < 0) return;
+  const uword bit = static_cast<uword>(1) << (index % kBitsPerWord);
+  (*sets)[offset + index / kBitsPerWord] |= bit;
+}
+
+
+static void Remove(GrowableArray<uword>* sets,
+                   intptr_t offset,
+                   Definition* value) {
+  const intptr_t index = value->ssa_temp_index();
+  const uword bit = static_cast<uword>(1) << (index % kBitsPerWord);
+  (*sets)[offset + index / kBitsPerWord] &= ~bit;
+}
+
+
+// Backward data flow analysis over the blocks until the live sets do not
+// change anymore. The inputs of a phi are live out of the corresponding
+// predecessor, not live into the block of the phi.
+void FlowGraphAllocator::ComputeLiveness() {
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length() * words_per_set_; i++) {
+    live_in_.Add(0);
+    live_out_.Add(0);
+  }
+  GrowableArray<uword> live(words_per_set_);
+  for (intptr_t i = 0; i < words_per_set_; i++) {
+    live.Add(0);
+  }
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (intptr_t i = blocks.length() - 1; i >= 0; i--) {
+      BlockEntryInstr* block = blocks[i];
+      const intptr_t block_id = block->block_id();
+      Instruction* last = block->last_instruction();
+      const intptr_t successor_count = (last == NULL) ? 0
+                                                      : last->SuccessorCount();
+      for (intptr_t j = 0; j < successor_count; j++) {
+        BlockEntryInstr* successor = last->SuccessorAt(j);
+        const intptr_t successor_id = successor->block_id();
+        for (intptr_t k = 0; k < words_per_set_; k++) {
+          live_out_[block_id * words_per_set_ + k] |=
+              live_in_[successor_id * words_per_set_ + k];
+        }
+        if (!successor->IsJoinEntry()) continue;
+        JoinEntryInstr* join = successor->AsJoinEntry();
+        intptr_t predecessor_index = 0;
+        while (join->PredecessorAt(predecessor_index) != block) {
+          predecessor_index++;
+        }
+        for (intptr_t k = 0; k < join->PhiCount(); k++) {
+          PhiInstr* phi = join->PhiAt(k);
+          if (phi->use_count() == 0) continue;
+          Add(&live_out_,
+              block_id * words_per_set_,
+              phi->InputAt(predecessor_index));
+        }
+      }
+      for (intptr_t k = 0; k < words_per_set_; k++) {
+        live[k] = live_out_[block_id * words_per_set_ + k];
+      }
+      for (Instruction* instr = last;
+           (instr != NULL) && (instr != block);
+           instr = instr->previous()) {
+        Definition* defn = instr->AsDefinition();
+        if (defn != NULL) {
+          Remove(&live, 0, defn);
+        }
+        for (intptr_t k = 0; k < instr->InputCount(); k++) {
+          Add(&live, 0, instr->InputAt(k));
+        }
+        Environment* env = instr->env();
+        if (env != NULL) {
+          for (intptr_t k = 0; k < env->Length(); k++) {
+            Add(&live, 0, env->ValueAt(k));
+          }
+        }
+      }
+      if (block->IsJoinEntry()) {
+        JoinEntryInstr* join = block->AsJoinEntry();
+        for (intptr_t k = 0; k < join->PhiCount(); k++) {
+          Remove(&live, 0, join->PhiAt(k));
+        }
+      }
+      for (intptr_t k = 0; k < words_per_set_; k++) {
+        const intptr_t index = block_id * words_per_set_ + k;
+        if ((live_in_[index] | live[k]) != live_in_[index]) {
+          live_in_[index] |= live[k];
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+
+// Each block adds a segment to the live range of the values live in it,
+// from the block entry or the definition to the end of the block or the last
+// use.
+void FlowGraphAllocator::BuildLiveRanges() {
+  GrowableArray<intptr_t> segment_start(value_count_);
+  GrowableArray<intptr_t> segment_end(value_count_);
+  for (intptr_t i = 0; i < value_count_; i++) {
+    segment_start.Add(-1);
+    segment_end.Add(-1);
+  }
+  GrowableArray<intptr_t> block_values(8);
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    BlockEntryInstr* block = blocks[i];
+    const intptr_t block_id = block->block_id();
+    const intptr_t offset = block_id * words_per_set_;
+    block_values.Clear();
+    for (intptr_t value = 0; value < value_count_; value++) {
+      if (Contains(live_in_, offset, value)) {
+        segment_start[value] = block_start_[block_id];
+        segment_end[value] = block_start_[block_id];
+        block_values.Add(value);
+      }
+    }
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        PhiInstr* phi = join->PhiAt(j);
+        if (phi->use_count() == 0) continue;
+        const intptr_t value = phi->ssa_temp_index();
+        segment_start[value] = block_start_[block_id];
+        segment_end[value] = block_start_[block_id];
+        block_values.Add(value);
+      }
+    }
+    intptr_t position = block_start_[block_id];
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      position += 2;
+      for (intptr_t j = 0; j < instr->InputCount(); j++) {
+        const intptr_t value = instr->InputAt(j)->ssa_temp_index();
+        if (value < 0) continue;
+        ASSERT(segment_start[value] >= 0);
+        segment_end[value] = position;
+      }
+      Environment* env = instr->env();
+      if (env != NULL) {
+        for (intptr_t j = 0; j < env->Length(); j++) {
+          const intptr_t value = env->ValueAt(j)->ssa_temp_index();
+          if (value < 0) continue;
+          ASSERT(segment_start[value] >= 0);
+          segment_end[value] = position;
+        }
+      }
+      Definition* defn = instr->AsDefinition();
+      if ((defn != NULL) && (defn->use_count() > 0)) {
+        const intptr_t value = defn->ssa_temp_index();
+        segment_start[value] = position + 1;
+        segment_end[value] = position + 1;
+        block_values.Add(value);
+      }
+    }
+    for (intptr_t j = 0; j < block_values.length(); j++) {
+      const intptr_t value = block_values[j];
+      if (Contains(live_out_, offset, value)) {
+        segment_end[value] = block_end_[block_id];
+      }
+      if (ranges_[value] == NULL) {
+        ranges_[value] = new LiveRange();
+      }
+      ranges_[value]->AddSegment(segment_start[value], segment_end[value]);
+      segment_start[value] = -1;
+    }
+  }
+}
+
+
+bool FlowGraphAllocator::IsLiveAcrossCall(intptr_t value) const {
+  for (intptr_t i = 0; i < call_positions_.length(); i++) {
+    if (ranges_[value]->IsLiveAcross(call_positions_[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+bool FlowGraphAllocator::AssignLocation(
+    intptr_t value,
+    GrowableArray<ZoneGrowableArray<intptr_t>*>* locations,
+    GrowableArray<intptr_t>* assignment,
+    bool can_evict) {
+  const LiveRange& range = *ranges_[value];
+  intptr_t evicted_location = -1;
+  intptr_t evicted_index = -1;
+  intptr_t evicted_end = range.End();
+  for (intptr_t location = 0; location < locations->length(); location++) {
+    ZoneGrowableArray<intptr_t>* values = (*locations)[location];
+    // Ranges ending before this one starts do not intersect the following
+    // ones either.
+    intptr_t live_count = 0;
+    intptr_t conflict_count = 0;
+    intptr_t conflict_index = -1;
+    for (intptr_t i = 0; i < values->length(); i++) {
+      const LiveRange& other = *ranges_[(*values)[i]];
+      if (other.End() < range.Start()) continue;
+      (*values)[live_count++] = (*values)[i];
+      if (other.Intersects(range)) {
+        conflict_count++;
+        conflict_index = live_count - 1;
+      }
+    }
+    while (values->length() > live_count) {
+      values->RemoveLast();
+    }
+    if (conflict_count == 0) {
+      values->Add(value);
+      (*assignment)[value] = location;
+      return true;
+    }
+    if (can_evict && (conflict_count == 1)) {
+      const intptr_t conflict_end = ranges_[(*values)[conflict_index]]->End();
+      if (conflict_end > evicted_end) {
+        evicted_location = location;
+        evicted_index = conflict_index;
+        evicted_end = conflict_end;
+      }
+    }
+  }
+  if (evicted_location < 0) {
+    return false;
+  }
+  // Spill the value whose live range ends last.
+  ZoneGrowableArray<intptr_t>* values = (*locations)[evicted_location];
+  (*assignment)[(*values)[evicted_index]] = -1;
+  for (intptr_t i = evicted_index; i < values->length() - 1; i++) {
+    (*values)[i] = (*values)[i + 1];
+  }
+  values->RemoveLast();
+  values->Add(value);
+  (*assignment)[value] = evicted_location;
+  return true;
+}
+
+
+// Values are numbered in block order, hence visited in order of the start of
+// their live range.
+void FlowGraphAllocator::AssignRegisters() {
+  GrowableArray<ZoneGrowableArray<intptr_t>*> register_values(register_count_);
+  for (intptr_t i = 0; i < register_count_; i++) {
+    register_values.Add(new ZoneGrowableArray<intptr_t>(4));
+  }
+  for (intptr_t value = 0; value < value_count_; value++) {
+    if ((ranges_[value] == NULL) || IsLiveAcrossCall(value)) continue;
+    AssignLocation(value, &register_values, &registers_, true);
+  }
+}
+
+
+// Spill slots are shared by values whose live ranges do not intersect.
+void FlowGraphAllocator::AssignSpillSlots() {
+  GrowableArray<ZoneGrowableArray<intptr_t>*> slot_values(8);
+  for (intptr_t value = 0; value < value_count_; value++) {
+    if ((ranges_[value] == NULL) || (registers_[value] >= 0)) continue;
+    if (!AssignLocation(value, &slot_values, &spill_slots_, false)) {
+      slot_values.Add(new ZoneGrowableArray<intptr_t>(4));
+      slot_values.Last()->Add(value);
+      spill_slots_[value] = slot_values.length() - 1;
+    }
+  }
+  spill_slot_count_ = slot_values.length();
+}
+
+
+void FlowGraphAllocator::Print() const {
+  OS::Print("==== Register allocation (%d registers, %d spill slots)\n",
+            register_count_, spill_slot_count_);
+  for (intptr_t value = 0; value < value_count_; value++) {
+    if (ranges_[value] == NULL) continue;
+    OS::Print("  v%d", value);
+    ranges_[value]->Print();
+    if (registers_[value] >= 0) {
+      OS::Print(" register %d\n", registers_[value]);
+    } else {
+      OS::Print(" spill slot %d%s\n",
+                spill_slots_[value],
+                IsLiveAcrossCall(value) ? " (live across call)" : "");
+    }
+  }
+}
+
+}  // namespace dart
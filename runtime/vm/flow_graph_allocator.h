@@ -0,0 +1,87 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_FLOW_GRAPH_ALLOCATOR_H_
+#define VM_FLOW_GRAPH_ALLOCATOR_H_
+
+#include "vm/allocation.h"
+#include "vm/growable_array.h"
+#include "vm/intermediate_language.h"
+
+namespace dart {
+
+// Linear scan register allocation for the values of a flow graph.
+//
+// Instructions are numbered in block order. The live range of a value is the
+// list of positions from its definition to its uses, with holes where the
+// value is not live, e.g., in the exit of a loop placed before the body of
+// the loop. Ranges are visited in order of their start and assigned one of
+// 'register_count' registers, or a spill slot when they are live across a
+// call (see Instruction::is_call) or no register is free. Values keep their
+// location for their whole live range, so that no moves are needed between
+// blocks except for phis.
+//
+// Values held in registers are never live across calls: the garbage
+// collector and the deoptimization stubs of call sites only see the spill
+// slots, which always hold tagged values.
+class FlowGraphAllocator : public ValueObject {
+ public:
+  FlowGraphAllocator(FlowGraph* graph, intptr_t register_count);
+
+  void AllocateRegisters();
+
+  // Index of the register assigned to 'defn', or -1 if it has none.
+  intptr_t RegisterOf(Definition* defn) const;
+  // Spill slot assigned to 'defn', or -1 if it has none.
+  intptr_t SpillSlotOf(Definition* defn) const;
+  intptr_t spill_slot_count() const { return spill_slot_count_; }
+
+ private:
+  class LiveRange;
+
+  void NumberInstructions();
+  void ComputeLiveness();
+  void BuildLiveRanges();
+  bool IsLiveAcrossCall(intptr_t value) const;
+  // Assigns 'value' to a location whose values do not intersect it, or if
+  // 'can_evict' to the location of a value whose live range ends later.
+  // Returns false if there is no such location.
+  bool AssignLocation(intptr_t value,
+                      GrowableArray<ZoneGrowableArray<intptr_t>*>* locations,
+                      GrowableArray<intptr_t>* assignment,
+                      bool can_evict);
+  void AssignRegisters();
+  void AssignSpillSlots();
+  void Print() const;
+
+  FlowGraph* graph_;
+  const intptr_t register_count_;
+  const intptr_t value_count_;
+  const intptr_t words_per_set_;
+
+  // Positions of the entry and of the last instruction of each block by
+  // block id.
+  GrowableArray<intptr_t> block_start_;
+  GrowableArray<intptr_t> block_end_;
+  // Positions of the instructions calling out, in increasing order.
+  GrowableArray<intptr_t> call_positions_;
+
+  // Values live into and out of each block: 'words_per_set_' words of bits
+  // indexed by SSA temp index for each block id.
+  GrowableArray<uword> live_in_;
+  GrowableArray<uword> live_out_;
+
+  // Live ranges by SSA temp index, NULL for values that are never used.
+  GrowableArray<LiveRange*> ranges_;
+
+  GrowableArray<intptr_t> registers_;
+  GrowableArray<intptr_t> spill_slots_;
+  intptr_t spill_slot_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowGraphAllocator);
+};
+
+}  // namespace dart
+
+#endif  // VM_FLOW_GRAPH_ALLOCATOR_H_
@@ -0,0 +1,1213 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/flow_graph_builder.h"
+
+#include "vm/flags.h"
+#include "vm/object_store.h"
+#include "vm/os.h"
+#include "vm/parser.h"
+#include "vm/resolver.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, print_flow_graph, false, "Print the flow graph.");
+DEFINE_FLAG(bool, trace_bailout, false,
+    "Print why a function is not compiled from a flow graph.");
+
+
+// A join point of the control flow. The predecessors jump to the join with
+// the state of their locals and expression stack, and the state at the join
+// is merged with phis when the join is bound.
+class FlowGraphBuilder::PendingJoin : public ZoneAllocated {
+ public:
+  PendingJoin() : entry_(new JoinEntryInstr()), states_(2) { }
+
+  JoinEntryInstr* entry() const { return entry_; }
+  intptr_t StateCount() const { return states_.length(); }
+  State* StateAt(intptr_t i) const { return states_[i]; }
+  void AddState(State* state) { states_.Add(state); }
+
+ private:
+  JoinEntryInstr* entry_;
+  GrowableArray<State*> states_;
+
+  DISALLOW_COPY_AND_ASSIGN(PendingJoin);
+};
+
+
+// The targets of break and continue statements referring to 'label'.
+class FlowGraphBuilder::JumpTarget : public ZoneAllocated {
+ public:
+  JumpTarget(SourceLabel* label,
+             PendingJoin* break_join,
+             PendingJoin* continue_join)
+      : label_(label),
+        break_join_(break_join),
+        continue_join_(continue_join) { }
+
+  SourceLabel* label() const { return label_; }
+  PendingJoin* break_join() const { return break_join_; }
+  PendingJoin* continue_join() const { return continue_join_; }
+
+ private:
+  SourceLabel* label_;
+  PendingJoin* break_join_;
+  PendingJoin* continue_join_;
+
+  DISALLOW_COPY_AND_ASSIGN(JumpTarget);
+};
+
+
+FlowGraphBuilder::FlowGraphBuilder(const ParsedFunction& parsed_function,
+                                   intptr_t stack_local_count)
+    : parsed_function_(parsed_function),
+      parameter_count_(parsed_function.function().num_fixed_parameters()),
+      stack_local_count_(stack_local_count),
+      values_(16),
+      root_node_(NULL),
+      current_block_(NULL),
+      current_(NULL),
+      blocks_(8),
+      phis_(8),
+      jump_targets_(4) {
+}
+
+
+FlowGraph* FlowGraphBuilder::BuildGraph() {
+  // No stack resources may be created while building the graph, a bailout
+  // long jumps back here.
+  if (setjmp(bailout_) != 0) {
+    return NULL;
+  }
+  const Function& function = parsed_function_.function();
+  if (function.num_optional_parameters() > 0) {
+    Bailout("optional parameters");
+  }
+  for (intptr_t i = 0; i < parameter_count_; i++) {
+    Push(new ParameterInstr(1 + parameter_count_ - i));
+  }
+  ConstantInstr* null_constant = Constant(Object::ZoneHandle());
+  for (intptr_t i = 0; i < stack_local_count_; i++) {
+    Push(null_constant);
+  }
+
+  TargetEntryInstr* normal_entry = new TargetEntryInstr();
+  GraphEntryInstr* graph_entry = new GraphEntryInstr(normal_entry);
+  normal_entry->AddPredecessor(graph_entry);
+  blocks_.Add(normal_entry);
+  current_block_ = normal_entry;
+  current_ = normal_entry;
+
+  SequenceNode* node_sequence = parsed_function_.node_sequence();
+  VisitSequenceNode(node_sequence);
+  if (is_open()) {
+    CloseBlock(new ReturnInstr(node_sequence->token_index(), null_constant));
+  }
+  ASSERT(values_.length() == parameter_count_ + stack_local_count_);
+
+  EliminateRedundantPhis();
+  FlowGraph* graph =
+      new FlowGraph(graph_entry, parameter_count_, stack_local_count_);
+  graph->Finalize();
+  if (FLAG_print_flow_graph) {
+    OS::Print("Flow graph of '%s'\n", function.ToFullyQualifiedCString());
+    graph->Print();
+  }
+  return graph;
+}
+
+
+void FlowGraphBuilder::Bailout(const char* reason) {
+  if (FLAG_trace_bailout) {
+    OS::Print("Flow graph bailout of '%s': %s\n",
+              parsed_function_.function().ToFullyQualifiedCString(),
+              reason);
+  }
+  longjmp(bailout_, 1);
+}
+
+
+void FlowGraphBuilder::Append(Instruction* instr) {
+  ASSERT(is_open());
+  ASSERT(!instr->IsBlockEntry());
+  current_->set_next(instr);
+  instr->set_previous(current_);
+  current_ = instr;
+}
+
+
+Definition* FlowGraphBuilder::Emit(Definition* defn) {
+  Append(defn);
+  return defn;
+}
+
+
+void FlowGraphBuilder::CloseBlock(Instruction* control) {
+  ASSERT(control->IsControl());
+  Append(control);
+  current_block_->set_last_instruction(control);
+  current_ = NULL;
+}
+
+
+Definition* FlowGraphBuilder::Pop() {
+  ASSERT(values_.length() > parameter_count_ + stack_local_count_);
+  Definition* result = values_.Last();
+  values_.RemoveLast();
+  return result;
+}
+
+
+Definition* FlowGraphBuilder::ValueFor(AstNode* node) {
+  ASSERT(node != root_node_);
+  node->Visit(this);
+  if (!is_open()) {
+    Bailout("expression does not complete normally");
+  }
+  return Pop();
+}
+
+
+void FlowGraphBuilder::ReturnValue(AstNode* node, Definition* value) {
+  if (IsResultNeeded(node)) {
+    Push(value);
+  }
+}
+
+
+ConstantInstr* FlowGraphBuilder::Constant(const Object& value) {
+  return new ConstantInstr(value);
+}
+
+
+// Parameter i lives at frame index 1 + parameter_count - i and stack local j
+// at frame index -1 - j.
+intptr_t FlowGraphBuilder::LocalIndex(const LocalVariable& variable) {
+  if (variable.is_captured()) {
+    Bailout("captured variable");
+  }
+  const intptr_t frame_index = variable.index();
+  intptr_t result;
+  if (frame_index > 0) {
+    result = 1 + parameter_count_ - frame_index;
+  } else {
+    result = parameter_count_ - 1 - frame_index;
+  }
+  ASSERT((0 <= result) && (result < parameter_count_ + stack_local_count_));
+  return result;
+}
+
+
+Environment* FlowGraphBuilder::CreateEnvironment(intptr_t deopt_id,
+                                                 intptr_t token_index) {
+  return new Environment(deopt_id,
+                         token_index,
+                         parameter_count_ + stack_local_count_,
+                         values_);
+}
+
+
+FlowGraphBuilder::State* FlowGraphBuilder::SaveState() const {
+  State* state = new State(values_.length());
+  for (intptr_t i = 0; i < values_.length(); i++) {
+    state->Add(values_[i]);
+  }
+  return state;
+}
+
+
+void FlowGraphBuilder::RestoreState(const State& state) {
+  values_.Clear();
+  for (intptr_t i = 0; i < state.length(); i++) {
+    values_.Add(state[i]);
+  }
+}
+
+
+FlowGraphBuilder::State* FlowGraphBuilder::Branch(
+    Definition* value,
+    TargetEntryInstr** true_successor,
+    TargetEntryInstr** false_successor) {
+  *true_successor = new TargetEntryInstr();
+  *false_successor = new TargetEntryInstr();
+  BlockEntryInstr* block = current_block_;
+  CloseBlock(new BranchInstr(value, *true_successor, *false_successor));
+  (*true_successor)->AddPredecessor(block);
+  (*false_successor)->AddPredecessor(block);
+  return SaveState();
+}
+
+
+void FlowGraphBuilder::StartBlock(TargetEntryInstr* block,
+                                  const State& state) {
+  ASSERT(!is_open());
+  RestoreState(state);
+  blocks_.Add(block);
+  current_block_ = block;
+  current_ = block;
+}
+
+
+FlowGraphBuilder::PendingJoin* FlowGraphBuilder::NewJoin() {
+  return new PendingJoin();
+}
+
+
+void FlowGraphBuilder::GotoJoin(PendingJoin* join) {
+  if (!is_open()) return;
+  BlockEntryInstr* block = current_block_;
+  CloseBlock(new GotoInstr(join->entry()));
+  join->entry()->AddPredecessor(block);
+  join->AddState(SaveState());
+}
+
+
+// Continues at a forward join. A phi is created for every value that differs
+// between the predecessors.
+void FlowGraphBuilder::BindJoin(PendingJoin* join) {
+  ASSERT(!is_open());
+  if (join->StateCount() == 0) {
+    // No predecessor, the code following the join is unreachable.
+    return;
+  }
+  JoinEntryInstr* entry = join->entry();
+  const State& first = *join->StateAt(0);
+  values_.Clear();
+  for (intptr_t i = 0; i < first.length(); i++) {
+    Definition* value = first[i];
+    for (intptr_t j = 1; j < join->StateCount(); j++) {
+      ASSERT(join->StateAt(j)->length() == first.length());
+      if ((*join->StateAt(j))[i] != first[i]) {
+        value = NULL;
+        break;
+      }
+    }
+    if (value == NULL) {
+      PhiInstr* phi = new PhiInstr(entry);
+      for (intptr_t j = 0; j < join->StateCount(); j++) {
+        phi->AddInput((*join->StateAt(j))[i]);
+      }
+      entry->AddPhi(phi);
+      phis_.Add(phi);
+      value = phi;
+    }
+    values_.Add(value);
+  }
+  blocks_.Add(entry);
+  current_block_ = entry;
+  current_ = entry;
+}
+
+
+// Starts a loop header. The back edges are not known yet, so every local gets
+// a phi and redundant ones are removed once the graph is complete.
+FlowGraphBuilder::PendingJoin* FlowGraphBuilder::StartLoop() {
+  ASSERT(values_.length() == parameter_count_ + stack_local_count_);
+  PendingJoin* header = NewJoin();
+  GotoJoin(header);
+  JoinEntryInstr* entry = header->entry();
+  const State& state = *header->StateAt(0);
+  values_.Clear();
+  for (intptr_t i = 0; i < state.length(); i++) {
+    PhiInstr* phi = new PhiInstr(entry);
+    phi->AddInput(state[i]);
+    entry->AddPhi(phi);
+    phis_.Add(phi);
+    values_.Add(phi);
+  }
+  blocks_.Add(entry);
+  current_block_ = entry;
+  current_ = entry;
+  return header;
+}
+
+
+// Adds the inputs flowing in from the back edges to the header phis.
+void FlowGraphBuilder::CloseLoop(PendingJoin* header) {
+  ASSERT(!is_open());
+  JoinEntryInstr* entry = header->entry();
+  for (intptr_t i = 0; i < entry->PhiCount(); i++) {
+    PhiInstr* phi = entry->PhiAt(i);
+    for (intptr_t j = 1; j < header->StateCount(); j++) {
+      phi->AddInput((*header->StateAt(j))[i]);
+    }
+  }
+}
+
+
+void FlowGraphBuilder::PushJumpTarget(SourceLabel* label,
+                                      PendingJoin* break_join,
+                                      PendingJoin* continue_join) {
+  jump_targets_.Add(new JumpTarget(label, break_join, continue_join));
+}
+
+
+void FlowGraphBuilder::PopJumpTarget() {
+  jump_targets_.RemoveLast();
+}
+
+
+// Removes phis merging a single value, until no more are found since
+// removing a phi can make other phis redundant. Uses of removed phis are then
+// replaced.
+void FlowGraphBuilder::EliminateRedundantPhis() {
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (intptr_t i = 0; i < phis_.length(); i++) {
+      PhiInstr* phi = phis_[i];
+      if (phi->replacement() != NULL) continue;
+      Definition* input = phi->UniqueInput();
+      if (input != NULL) {
+        phi->set_replacement(input);
+        changed = true;
+      }
+    }
+  }
+  for (intptr_t i = 0; i < blocks_.length(); i++) {
+    BlockEntryInstr* block = blocks_[i];
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      join->RemoveDeadPhis();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        PhiInstr* phi = join->PhiAt(j);
+        for (intptr_t k = 0; k < phi->InputCount(); k++) {
+          phi->SetInputAt(k, phi->InputAt(k)->Resolve());
+        }
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      for (intptr_t k = 0; k < instr->InputCount(); k++) {
+        instr->SetInputAt(k, instr->InputAt(k)->Resolve());
+      }
+      Environment* env = instr->env();
+      if (env != NULL) {
+        for (intptr_t k = 0; k < env->Length(); k++) {
+          env->SetValueAt(k, env->ValueAt(k)->Resolve());
+        }
+      }
+    }
+  }
+}
+
+
+Definition* FlowGraphBuilder::BuildInstanceCall(
+    intptr_t node_id,
+    intptr_t token_index,
+    const String& function_name,
+    Token::Kind token_kind,
+    intptr_t argument_count,
+    const Array& argument_names,
+    intptr_t checked_argument_count,
+    const ICData& ic_data,
+    bool can_deoptimize) {
+  Environment* env =
+      can_deoptimize ? CreateEnvironment(node_id, token_index) : NULL;
+  InstanceCallInstr* call = new InstanceCallInstr(node_id,
+                                                  token_index,
+                                                  function_name,
+                                                  token_kind,
+                                                  argument_names,
+                                                  checked_argument_count,
+                                                  ic_data);
+  const intptr_t first = values_.length() - argument_count;
+  ASSERT(first >= parameter_count_ + stack_local_count_);
+  for (intptr_t i = first; i < values_.length(); i++) {
+    call->AddInput(values_[i]);
+  }
+  for (intptr_t i = 0; i < argument_count; i++) {
+    Pop();
+  }
+  call->set_env(env);
+  return Emit(call);
+}
+
+
+Definition* FlowGraphBuilder::BuildStaticCall(intptr_t token_index,
+                                              const Function& function,
+                                              intptr_t argument_count,
+                                              const Array& argument_names) {
+  StaticCallInstr* call =
+      new StaticCallInstr(token_index, function, argument_names);
+  const intptr_t first = values_.length() - argument_count;
+  ASSERT(first >= parameter_count_ + stack_local_count_);
+  for (intptr_t i = first; i < values_.length(); i++) {
+    call->AddInput(values_[i]);
+  }
+  for (intptr_t i = 0; i < argument_count; i++) {
+    Pop();
+  }
+  return Emit(call);
+}
+
+
+static const String& OperatorName(const char* name) {
+  return String::ZoneHandle(String::NewSymbol(name));
+}
+
+
+void FlowGraphBuilder::VisitReturnNode(ReturnNode* node) {
+  if (node->inlined_finally_list_length() > 0) {
+    Bailout("return through finally");
+  }
+  Definition* value = node->value()->IsLiteralNode()
+      ? Constant(node->value()->AsLiteralNode()->literal())
+      : ValueFor(node->value());
+  CloseBlock(new ReturnInstr(node->token_index(), value));
+}
+
+
+void FlowGraphBuilder::VisitLiteralNode(LiteralNode* node) {
+  ReturnValue(node, Constant(node->literal()));
+}
+
+
+void FlowGraphBuilder::VisitTypeNode(TypeNode* node) {
+  Bailout("type node");
+}
+
+
+void FlowGraphBuilder::VisitAssignableNode(AssignableNode* node) {
+  Bailout("type check");
+}
+
+
+void FlowGraphBuilder::VisitBinaryOpNode(BinaryOpNode* node) {
+  if ((node->kind() == Token::kAND) || (node->kind() == Token::kOR)) {
+    // The right operand is only evaluated if the left one does not decide the
+    // result, which is then whether the right operand is true.
+    const Bool& bool_true = Bool::ZoneHandle(Bool::True());
+    const Bool& bool_false = Bool::ZoneHandle(Bool::False());
+    Definition* left = ValueFor(node->left());
+    TargetEntryInstr* true_successor;
+    TargetEntryInstr* false_successor;
+    State* state = Branch(left, &true_successor, &false_successor);
+    PendingJoin* join = NewJoin();
+    StartBlock(true_successor, *state);
+    if (node->kind() == Token::kAND) {
+      Definition* right = ValueFor(node->right());
+      Push(Emit(new StrictCompareInstr(Token::kEQ_STRICT,
+                                       right,
+                                       Constant(bool_true))));
+    } else {
+      Push(Constant(bool_true));
+    }
+    GotoJoin(join);
+    StartBlock(false_successor, *state);
+    if (node->kind() == Token::kAND) {
+      Push(Constant(bool_false));
+    } else {
+      Definition* right = ValueFor(node->right());
+      Push(Emit(new StrictCompareInstr(Token::kEQ_STRICT,
+                                       right,
+                                       Constant(bool_true))));
+    }
+    GotoJoin(join);
+    BindJoin(join);
+    ReturnValue(node, Pop());
+    return;
+  }
+  node->left()->Visit(this);
+  node->right()->Visit(this);
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         OperatorName(node->Name()),
+                                         node->kind(),
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->id()),
+                                         true);
+  ReturnValue(node, result);
+}
+
+
+void FlowGraphBuilder::VisitStringConcatNode(StringConcatNode* node) {
+  for (intptr_t i = 0; i < node->values()->length(); i++) {
+    if (!node->values()->ElementAt(i)->IsLiteralNode()) {
+      const String& cls_name =
+          String::Handle(String::NewSymbol("StringBase"));
+      const Library& core_lib = Library::Handle(
+          Isolate::Current()->object_store()->core_library());
+      const Class& cls = Class::Handle(core_lib.LookupClass(cls_name));
+      ASSERT(!cls.IsNull());
+      const String& func_name =
+          String::Handle(String::NewSymbol("_interpolate"));
+      const Function& interpolate = Function::ZoneHandle(
+          Resolver::ResolveStatic(cls,
+                                  func_name,
+                                  1,
+                                  Array::Handle(),
+                                  Resolver::kIsQualified));
+      ASSERT(!interpolate.IsNull());
+      node->values()->Visit(this);
+      ReturnValue(node,
+                  BuildStaticCall(node->token_index(),
+                                  interpolate,
+                                  1,
+                                  Array::ZoneHandle()));
+      return;
+    }
+  }
+  // Interpolation of literals is done at compile time by the code generator.
+  Bailout("constant string interpolation");
+}
+
+
+void FlowGraphBuilder::VisitComparisonNode(ComparisonNode* node) {
+  if (Token::IsInstanceofOperator(node->kind())) {
+    Bailout("instanceof");
+  }
+  if ((node->kind() == Token::kEQ_STRICT) ||
+      (node->kind() == Token::kNE_STRICT)) {
+    node->left()->Visit(this);
+    node->right()->Visit(this);
+    Definition* right = Pop();
+    Definition* left = Pop();
+    ReturnValue(node,
+                Emit(new StrictCompareInstr(node->kind(), left, right)));
+    return;
+  }
+  node->left()->Visit(this);
+  node->right()->Visit(this);
+  if ((node->kind() == Token::kEQ) || (node->kind() == Token::kNE)) {
+    Environment* env = CreateEnvironment(node->id(), node->token_index());
+    Definition* right = Pop();
+    Definition* left = Pop();
+    EqualityCompareInstr* compare =
+        new EqualityCompareInstr(node->id(),
+                                 node->token_index(),
+                                 node->kind(),
+                                 left,
+                                 right,
+                                 node->ICDataAtId(node->id()));
+    compare->set_env(env);
+    ReturnValue(node, Emit(compare));
+    return;
+  }
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         OperatorName(node->Name()),
+                                         node->kind(),
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->id()),
+                                         true);
+  ReturnValue(node, result);
+}
+
+
+void FlowGraphBuilder::VisitUnaryOpNode(UnaryOpNode* node) {
+  if (node->kind() == Token::kNOT) {
+    Definition* value = ValueFor(node->operand());
+    ReturnValue(node, Emit(new BooleanNegateInstr(value)));
+    return;
+  }
+  if (node->kind() == Token::kADD) {
+    ReturnValue(node, ValueFor(node->operand()));
+    return;
+  }
+  node->operand()->Visit(this);
+  const Token::Kind kind =
+      (node->kind() == Token::kSUB) ? Token::kNEGATE : node->kind();
+  const char* name =
+      (node->kind() == Token::kSUB) ? Token::Str(Token::kNEGATE) : node->Name();
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         OperatorName(name),
+                                         kind,
+                                         1,
+                                         Array::ZoneHandle(),
+                                         1,
+                                         node->ICDataAtId(node->id()),
+                                         true);
+  ReturnValue(node, result);
+}
+
+
+static Token::Kind IncrOpKind(Token::Kind kind) {
+  ASSERT((kind == Token::kINCR) || (kind == Token::kDECR));
+  return (kind == Token::kINCR) ? Token::kADD : Token::kSUB;
+}
+
+
+// The unoptimized code deoptimizes to the beginning of the node.
+void FlowGraphBuilder::VisitIncrOpLocalNode(IncrOpLocalNode* node) {
+  const intptr_t index = LocalIndex(node->local());
+  Definition* value = values_[index];
+  const Token::Kind kind = IncrOpKind(node->kind());
+  Environment* env = CreateEnvironment(node->id(), node->token_index());
+  Push(value);
+  Push(Constant(Smi::ZoneHandle(Smi::New(1))));
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         OperatorName(Token::Str(kind)),
+                                         kind,
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->id()),
+                                         false);
+  result->set_env(env);
+  values_[index] = result;
+  ReturnValue(node, node->prefix() ? result : value);
+}
+
+
+void FlowGraphBuilder::VisitIncrOpInstanceFieldNode(
+    IncrOpInstanceFieldNode* node) {
+  Definition* receiver = ValueFor(node->receiver());
+  Push(receiver);
+  Push(receiver);
+  Definition* value = BuildInstanceCall(
+      node->getter_id(),
+      node->token_index(),
+      String::ZoneHandle(Field::GetterName(node->field_name())),
+      Token::kGET,
+      1,
+      Array::ZoneHandle(),
+      1,
+      node->ICDataAtId(node->getter_id()),
+      true);
+  // The receiver duplicated for the setter is still on the stack.
+  Pop();
+  const Token::Kind kind = IncrOpKind(node->kind());
+  Push(value);
+  Push(Constant(Smi::ZoneHandle(Smi::New(1))));
+  Definition* result = BuildInstanceCall(node->operator_id(),
+                                         node->token_index(),
+                                         OperatorName(Token::Str(kind)),
+                                         kind,
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->operator_id()),
+                                         false);
+  Push(receiver);
+  Push(result);
+  BuildInstanceCall(node->setter_id(),
+                    node->token_index(),
+                    String::ZoneHandle(Field::SetterName(node->field_name())),
+                    Token::kSET,
+                    2,
+                    Array::ZoneHandle(),
+                    1,
+                    node->ICDataAtId(node->setter_id()),
+                    false);
+  ReturnValue(node, node->prefix() ? result : value);
+}
+
+
+// The unoptimized code deoptimizes to the beginning of the node.
+void FlowGraphBuilder::VisitIncrOpStaticFieldNode(IncrOpStaticFieldNode* node) {
+  if (node->field().IsNull()) {
+    Bailout("static field accessed through a getter");
+  }
+  Environment* env = CreateEnvironment(node->id(), node->token_index());
+  Definition* value = Emit(new LoadStaticFieldInstr(node->field()));
+  const Token::Kind kind = IncrOpKind(node->kind());
+  Push(value);
+  Push(Constant(Smi::ZoneHandle(Smi::New(1))));
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         OperatorName(Token::Str(kind)),
+                                         kind,
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->id()),
+                                         false);
+  result->set_env(env);
+  Append(new StoreStaticFieldInstr(node->field(), result));
+  ReturnValue(node, node->prefix() ? result : value);
+}
+
+
+void FlowGraphBuilder::VisitIncrOpIndexedNode(IncrOpIndexedNode* node) {
+  node->array()->Visit(this);
+  node->index()->Visit(this);
+  Definition* index = values_[values_.length() - 1];
+  Definition* array = values_[values_.length() - 2];
+  Definition* value = BuildInstanceCall(node->load_id(),
+                                        node->token_index(),
+                                        OperatorName(Token::Str(Token::kINDEX)),
+                                        Token::kINDEX,
+                                        2,
+                                        Array::ZoneHandle(),
+                                        1,
+                                        node->ICDataAtId(node->load_id()),
+                                        true);
+  const Token::Kind kind = IncrOpKind(node->kind());
+  Push(value);
+  Push(Constant(Smi::ZoneHandle(Smi::New(1))));
+  Definition* result = BuildInstanceCall(node->operator_id(),
+                                         node->token_index(),
+                                         OperatorName(Token::Str(kind)),
+                                         kind,
+                                         2,
+                                         Array::ZoneHandle(),
+                                         2,
+                                         node->ICDataAtId(node->operator_id()),
+                                         false);
+  Push(array);
+  Push(index);
+  Push(result);
+  BuildInstanceCall(node->store_id(),
+                    node->token_index(),
+                    OperatorName(Token::Str(Token::kASSIGN_INDEX)),
+                    Token::kASSIGN_INDEX,
+                    3,
+                    Array::ZoneHandle(),
+                    1,
+                    node->ICDataAtId(node->store_id()),
+                    false);
+  ReturnValue(node, node->prefix() ? result : value);
+}
+
+
+void FlowGraphBuilder::VisitConditionalExprNode(ConditionalExprNode* node) {
+  Definition* condition = ValueFor(node->condition());
+  TargetEntryInstr* true_successor;
+  TargetEntryInstr* false_successor;
+  State* state = Branch(condition, &true_successor, &false_successor);
+  PendingJoin* join = NewJoin();
+  StartBlock(true_successor, *state);
+  Push(ValueFor(node->true_expr()));
+  GotoJoin(join);
+  StartBlock(false_successor, *state);
+  Push(ValueFor(node->false_expr()));
+  GotoJoin(join);
+  BindJoin(join);
+  ReturnValue(node, Pop());
+}
+
+
+void FlowGraphBuilder::VisitIfNode(IfNode* node) {
+  Definition* condition = ValueFor(node->condition());
+  TargetEntryInstr* true_successor;
+  TargetEntryInstr* false_successor;
+  State* state = Branch(condition, &true_successor, &false_successor);
+  PendingJoin* join = NewJoin();
+  StartBlock(true_successor, *state);
+  node->true_branch()->Visit(this);
+  GotoJoin(join);
+  StartBlock(false_successor, *state);
+  if (node->false_branch() != NULL) {
+    node->false_branch()->Visit(this);
+  }
+  GotoJoin(join);
+  BindJoin(join);
+}
+
+
+void FlowGraphBuilder::VisitSwitchNode(SwitchNode* node) {
+  Bailout("switch");
+}
+
+
+void FlowGraphBuilder::VisitCaseNode(CaseNode* node) {
+  Bailout("case");
+}
+
+
+void FlowGraphBuilder::VisitWhileNode(WhileNode* node) {
+  PendingJoin* header = StartLoop();
+  PendingJoin* exit = NewJoin();
+  Definition* condition = ValueFor(node->condition());
+  TargetEntryInstr* body_entry;
+  TargetEntryInstr* loop_exit;
+  State* state = Branch(condition, &body_entry, &loop_exit);
+  StartBlock(body_entry, *state);
+  PushJumpTarget(node->label(), exit, header);
+  node->body()->Visit(this);
+  PopJumpTarget();
+  GotoJoin(header);
+  CloseLoop(header);
+  StartBlock(loop_exit, *state);
+  GotoJoin(exit);
+  BindJoin(exit);
+}
+
+
+void FlowGraphBuilder::VisitDoWhileNode(DoWhileNode* node) {
+  PendingJoin* header = StartLoop();
+  PendingJoin* exit = NewJoin();
+  PendingJoin* test = NewJoin();
+  PushJumpTarget(node->label(), exit, test);
+  node->body()->Visit(this);
+  PopJumpTarget();
+  GotoJoin(test);
+  BindJoin(test);
+  if (is_open()) {
+    Definition* condition = ValueFor(node->condition());
+    TargetEntryInstr* loop_entry;
+    TargetEntryInstr* loop_exit;
+    State* state = Branch(condition, &loop_entry, &loop_exit);
+    StartBlock(loop_entry, *state);
+    GotoJoin(header);
+    StartBlock(loop_exit, *state);
+    GotoJoin(exit);
+  }
+  CloseLoop(header);
+  BindJoin(exit);
+}
+
+
+void FlowGraphBuilder::VisitForNode(ForNode* node) {
+  node->initializer()->Visit(this);
+  if (!is_open()) return;
+  PendingJoin* header = StartLoop();
+  PendingJoin* exit = NewJoin();
+  PendingJoin* increment = NewJoin();
+  if (node->condition() != NULL) {
+    Definition* condition = ValueFor(node->condition());
+    TargetEntryInstr* body_entry;
+    TargetEntryInstr* loop_exit;
+    State* state = Branch(condition, &body_entry, &loop_exit);
+    StartBlock(loop_exit, *state);
+    GotoJoin(exit);
+    StartBlock(body_entry, *state);
+  }
+  PushJumpTarget(node->label(), exit, increment);
+  node->body()->Visit(this);
+  PopJumpTarget();
+  GotoJoin(increment);
+  BindJoin(increment);
+  if (is_open()) {
+    node->increment()->Visit(this);
+    GotoJoin(header);
+  }
+  CloseLoop(header);
+  BindJoin(exit);
+}
+
+
+void FlowGraphBuilder::VisitJumpNode(JumpNode* node) {
+  if (node->inlined_finally_list_length() > 0) {
+    Bailout("jump through finally");
+  }
+  for (intptr_t i = jump_targets_.length() - 1; i >= 0; i--) {
+    JumpTarget* target = jump_targets_[i];
+    if (target->label() == node->label()) {
+      PendingJoin* join = (node->kind() == Token::kBREAK)
+          ? target->break_join()
+          : target->continue_join();
+      if (join == NULL) break;
+      GotoJoin(join);
+      return;
+    }
+  }
+  Bailout("unknown jump target");
+}
+
+
+void FlowGraphBuilder::VisitArgumentListNode(ArgumentListNode* node) {
+  for (intptr_t i = 0; i < node->length(); i++) {
+    node->NodeAt(i)->Visit(this);
+  }
+}
+
+
+void FlowGraphBuilder::VisitArrayNode(ArrayNode* node) {
+  for (intptr_t i = 0; i < node->length(); i++) {
+    node->ElementAt(i)->Visit(this);
+  }
+  CreateArrayInstr* array =
+      new CreateArrayInstr(node->token_index(), node->type_arguments());
+  const intptr_t first = values_.length() - node->length();
+  for (intptr_t i = first; i < values_.length(); i++) {
+    array->AddInput(values_[i]);
+  }
+  for (intptr_t i = 0; i < node->length(); i++) {
+    Pop();
+  }
+  ReturnValue(node, Emit(array));
+}
+
+
+void FlowGraphBuilder::VisitClosureNode(ClosureNode* node) {
+  Bailout("closure");
+}
+
+
+void FlowGraphBuilder::VisitInstanceCallNode(InstanceCallNode* node) {
+  node->receiver()->Visit(this);
+  VisitArgumentListNode(node->arguments());
+  Definition* result = BuildInstanceCall(node->id(),
+                                         node->token_index(),
+                                         node->function_name(),
+                                         Token::kILLEGAL,
+                                         node->arguments()->length() + 1,
+                                         node->arguments()->names(),
+                                         1,
+                                         node->ICDataAtId(node->id()),
+                                         true);
+  ReturnValue(node, result);
+}
+
+
+// The environment of the call is only used if its target is inlined, the
+// unoptimized code then deoptimizes to the call.
+void FlowGraphBuilder::VisitStaticCallNode(StaticCallNode* node) {
+  VisitArgumentListNode(node->arguments());
+  Environment* env = CreateEnvironment(node->id(), node->token_index());
+  Definition* result = BuildStaticCall(node->token_index(),
+                                       node->function(),
+                                       node->arguments()->length(),
+                                       node->arguments()->names());
+  result->set_env(env);
+  ReturnValue(node, result);
+}
+
+
+void FlowGraphBuilder::VisitClosureCallNode(ClosureCallNode* node) {
+  Bailout("closure call");
+}
+
+
+void FlowGraphBuilder::VisitCloneContextNode(CloneContextNode* node) {
+  Bailout("context");
+}
+
+
+void FlowGraphBuilder::VisitConstructorCallNode(ConstructorCallNode* node) {
+  const AbstractTypeArguments& type_arguments = node->type_arguments();
+  if (!type_arguments.IsNull() && !type_arguments.IsInstantiated()) {
+    Bailout("uninstantiated type arguments");
+  }
+  if (node->constructor().IsFactory()) {
+    // The type arguments are the first argument of a factory.
+    Push(Constant(type_arguments));
+    VisitArgumentListNode(node->arguments());
+    ReturnValue(node, BuildStaticCall(node->token_index(),
+                                      node->constructor(),
+                                      node->arguments()->length() + 1,
+                                      node->arguments()->names()));
+    return;
+  }
+  const Class& cls = Class::ZoneHandle(node->constructor().owner());
+  Definition* instance = Emit(
+      new AllocateObjectInstr(node->token_index(), cls, type_arguments));
+  ReturnValue(node, instance);
+  // The constructor is invoked with the instance and the construction phase
+  // as implicit arguments.
+  Push(instance);
+  Push(Constant(Smi::ZoneHandle(Smi::New(Function::kCtorPhaseAll))));
+  VisitArgumentListNode(node->arguments());
+  BuildStaticCall(node->token_index(),
+                  node->constructor(),
+                  node->arguments()->length() + 2,
+                  node->arguments()->names());
+}
+
+
+void FlowGraphBuilder::VisitInstanceGetterNode(InstanceGetterNode* node) {
+  node->receiver()->Visit(this);
+  Definition* result = BuildInstanceCall(
+      node->id(),
+      node->token_index(),
+      String::ZoneHandle(Field::GetterName(node->field_name())),
+      Token::kGET,
+      1,
+      Array::ZoneHandle(),
+      1,
+      node->ICDataAtId(node->id()),
+      true);
+  ReturnValue(node, result);
+}
+
+
+void FlowGraphBuilder::VisitInstanceSetterNode(InstanceSetterNode* node) {
+  node->receiver()->Visit(this);
+  node->value()->Visit(this);
+  Definition* value = values_.Last();
+  BuildInstanceCall(node->id(),
+                    node->token_index(),
+                    String::ZoneHandle(Field::SetterName(node->field_name())),
+                    Token::kSET,
+                    2,
+                    Array::ZoneHandle(),
+                    1,
+                    node->ICDataAtId(node->id()),
+                    true);
+  ReturnValue(node, value);
+}
+
+
+void FlowGraphBuilder::VisitStaticGetterNode(StaticGetterNode* node) {
+  const String& getter_name =
+      String::Handle(Field::GetterName(node->field_name()));
+  const Function& getter =
+      Function::ZoneHandle(node->cls().LookupStaticFunction(getter_name));
+  if (getter.IsNull()) {
+    Bailout("unresolved static getter");
+  }
+  ReturnValue(node,
+              BuildStaticCall(node->token_index(), getter, 0, Array::Handle()));
+}
+
+
+void FlowGraphBuilder::VisitStaticSetterNode(StaticSetterNode* node) {
+  const String& setter_name =
+      String::Handle(Field::SetterName(node->field_name()));
+  const Function& setter =
+      Function::ZoneHandle(node->cls().LookupStaticFunction(setter_name));
+  if (setter.IsNull()) {
+    Bailout("unresolved static setter");
+  }
+  Definition* value = ValueFor(node->value());
+  ReturnValue(node, value);
+  Push(value);
+  BuildStaticCall(node->token_index(), setter, 1, Array::ZoneHandle());
+}
+
+
+void FlowGraphBuilder::VisitNativeBodyNode(NativeBodyNode* node) {
+  Bailout("native body");
+}
+
+
+void FlowGraphBuilder::VisitPrimaryNode(PrimaryNode* node) {
+  Bailout("primary");
+}
+
+
+void FlowGraphBuilder::VisitLoadLocalNode(LoadLocalNode* node) {
+  ReturnValue(node, values_[LocalIndex(node->local())]);
+}
+
+
+void FlowGraphBuilder::VisitStoreLocalNode(StoreLocalNode* node) {
+  const intptr_t index = LocalIndex(node->local());
+  Definition* value = ValueFor(node->value());
+  values_[index] = value;
+  ReturnValue(node, value);
+}
+
+
+void FlowGraphBuilder::VisitLoadInstanceFieldNode(LoadInstanceFieldNode* node) {
+  Definition* instance = ValueFor(node->instance());
+  ReturnValue(node,
+              Emit(new LoadInstanceFieldInstr(node->field(), instance)));
+}
+
+
+void FlowGraphBuilder::VisitStoreInstanceFieldNode(
+    StoreInstanceFieldNode* node) {
+  node->instance()->Visit(this);
+  node->value()->Visit(this);
+  Definition* value = Pop();
+  Definition* instance = Pop();
+  Append(new StoreInstanceFieldInstr(node->field(), instance, value));
+  ReturnValue(node, value);
+}
+
+
+void FlowGraphBuilder::VisitLoadStaticFieldNode(LoadStaticFieldNode* node) {
+  ReturnValue(node, Emit(new LoadStaticFieldInstr(node->field())));
+}
+
+
+void FlowGraphBuilder::VisitStoreStaticFieldNode(StoreStaticFieldNode* node) {
+  Definition* value = ValueFor(node->value());
+  Append(new StoreStaticFieldInstr(node->field(), value));
+  ReturnValue(node, value);
+}
+
+
+void FlowGraphBuilder::VisitLoadIndexedNode(LoadIndexedNode* node) {
+  node->array()->Visit(this);
+  node->index_expr()->Visit(this);
+  Definition* result = BuildInstanceCall(
+      node->id(),
+      node->token_index(),
+      OperatorName(Token::Str(Token::kINDEX)),
+      Token::kINDEX,
+      2,
+      Array::ZoneHandle(),
+      1,
+      node->ICDataAtId(node->id()),
+      true);
+  ReturnValue(node, result);
+}
+
+
+void FlowGraphBuilder::VisitStoreIndexedNode(StoreIndexedNode* node) {
+  node->array()->Visit(this);
+  node->index_expr()->Visit(this);
+  node->value()->Visit(this);
+  Definition* value = values_.Last();
+  BuildInstanceCall(node->id(),
+                    node->token_index(),
+                    OperatorName(Token::Str(Token::kASSIGN_INDEX)),
+                    Token::kASSIGN_INDEX,
+                    3,
+                    Array::ZoneHandle(),
+                    1,
+                    node->ICDataAtId(node->id()),
+                    true);
+  ReturnValue(node, value);
+}
+
+
+// Statements following a statement that does not complete normally are
+// unreachable and are not translated.
+void FlowGraphBuilder::VisitSequenceNode(SequenceNode* node) {
+  LocalScope* scope = node->scope();
+  if ((scope != NULL) && (scope->num_context_variables() > 0)) {
+    Bailout("context variables");
+  }
+  AstNode* saved_root_node = root_node_;
+  PendingJoin* exit = NULL;
+  if (node->label() != NULL) {
+    exit = NewJoin();
+    PushJumpTarget(node->label(), exit, NULL);
+  }
+  for (intptr_t i = 0; (i < node->length()) && is_open(); i++) {
+    AstNode* statement = node->NodeAt(i);
+    root_node_ = statement;
+    statement->Visit(this);
+    ASSERT(!is_open() ||
+           (values_.length() == parameter_count_ + stack_local_count_));
+  }
+  if (exit != NULL) {
+    PopJumpTarget();
+    GotoJoin(exit);
+    BindJoin(exit);
+  }
+  root_node_ = saved_root_node;
+}
+
+
+void FlowGraphBuilder::VisitCatchClauseNode(CatchClauseNode* node) {
+  Bailout("catch");
+}
+
+
+void FlowGraphBuilder::VisitTryCatchNode(TryCatchNode* node) {
+  Bailout("try");
+}
+
+
+void FlowGraphBuilder::VisitThrowNode(ThrowNode* node) {
+  if (node->stacktrace() != NULL) {
+    Bailout("rethrow");
+  }
+  if (IsResultNeeded(node)) {
+    Bailout("throw in expression");
+  }
+  Definition* exception = ValueFor(node->exception());
+  CloseBlock(new ThrowInstr(node->id(), node->token_index(), exception));
+}
+
+
+void FlowGraphBuilder::VisitInlinedFinallyNode(InlinedFinallyNode* node) {
+  Bailout("finally");
+}
+
+}  // namespace dart
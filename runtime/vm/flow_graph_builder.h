@@ -0,0 +1,126 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_FLOW_GRAPH_BUILDER_H_
+#define VM_FLOW_GRAPH_BUILDER_H_
+
+#include <setjmp.h>
+
+#include "vm/allocation.h"
+#include "vm/ast.h"
+#include "vm/growable_array.h"
+#include "vm/intermediate_language.h"
+
+namespace dart {
+
+class ParsedFunction;
+
+// Builds the SSA flow graph of a function from its AST.
+//
+// The builder simulates the expression stack of the unoptimized code, so
+// that the environment of an instruction that may deoptimize describes the
+// frame the unoptimized code expects at the deoptimization point of the
+// corresponding AST node. Must be run after the frame indices of the
+// parameters and locals have been allocated.
+class FlowGraphBuilder : public AstNodeVisitor {
+ public:
+  FlowGraphBuilder(const ParsedFunction& parsed_function,
+                   intptr_t stack_local_count);
+
+  // Returns NULL if the function uses a construct not supported by the flow
+  // graph yet, in which case the caller falls back to the AST based code
+  // generator.
+  FlowGraph* BuildGraph();
+
+#define DECLARE_VISIT(type, name) virtual void Visit##type(type* node);
+NODE_LIST(DECLARE_VISIT)
+#undef DECLARE_VISIT
+
+ private:
+  class PendingJoin;
+  class JumpTarget;
+
+  typedef ZoneGrowableArray<Definition*> State;
+
+  void Bailout(const char* reason);
+
+  bool is_open() const { return current_ != NULL; }
+  void Append(Instruction* instr);
+  Definition* Emit(Definition* defn);
+  void CloseBlock(Instruction* control);
+
+  void Push(Definition* value) { values_.Add(value); }
+  Definition* Pop();
+  // Visits 'node' and returns its value.
+  Definition* ValueFor(AstNode* node);
+  // Pushes the value of 'node' if its result is needed by its parent.
+  void ReturnValue(AstNode* node, Definition* value);
+  bool IsResultNeeded(AstNode* node) const { return node != root_node_; }
+
+  ConstantInstr* Constant(const Object& value);
+  intptr_t LocalIndex(const LocalVariable& variable);
+  Environment* CreateEnvironment(intptr_t deopt_id, intptr_t token_index);
+
+  State* SaveState() const;
+  void RestoreState(const State& state);
+
+  // Ends the current block with a branch on 'value' and returns the state
+  // to start both successors with.
+  State* Branch(Definition* value,
+                TargetEntryInstr** true_successor,
+                TargetEntryInstr** false_successor);
+  void StartBlock(TargetEntryInstr* block, const State& state);
+
+  PendingJoin* NewJoin();
+  void GotoJoin(PendingJoin* join);
+  void BindJoin(PendingJoin* join);
+  PendingJoin* StartLoop();
+  void CloseLoop(PendingJoin* header);
+
+  void PushJumpTarget(SourceLabel* label,
+                      PendingJoin* break_join,
+                      PendingJoin* continue_join);
+  void PopJumpTarget();
+
+  // Pops the arguments of the call from the simulated expression stack.
+  Definition* BuildInstanceCall(intptr_t node_id,
+                                intptr_t token_index,
+                                const String& function_name,
+                                Token::Kind token_kind,
+                                intptr_t argument_count,
+                                const Array& argument_names,
+                                intptr_t checked_argument_count,
+                                const ICData& ic_data,
+                                bool can_deoptimize);
+  Definition* BuildStaticCall(intptr_t token_index,
+                              const Function& function,
+                              intptr_t argument_count,
+                              const Array& argument_names);
+
+  void EliminateRedundantPhis();
+
+  const ParsedFunction& parsed_function_;
+  const intptr_t parameter_count_;
+  const intptr_t stack_local_count_;
+
+  // Values of the parameters and stack locals followed by the expression
+  // stack.
+  GrowableArray<Definition*> values_;
+  AstNode* root_node_;
+  BlockEntryInstr* current_block_;
+  // Last instruction of the current block, NULL if the current position is
+  // unreachable.
+  Instruction* current_;
+  GrowableArray<BlockEntryInstr*> blocks_;
+  GrowableArray<PhiInstr*> phis_;
+  GrowableArray<JumpTarget*> jump_targets_;
+
+  jmp_buf bailout_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowGraphBuilder);
+};
+
+}  // namespace dart
+
+#endif  // VM_FLOW_GRAPH_BUILDER_H_
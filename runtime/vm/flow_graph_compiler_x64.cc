@@ -0,0 +1,1360 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/globals.h"  // Needed here to get TARGET_ARCH_X64.
+#if defined(TARGET_ARCH_X64)
+
+#include "vm/flow_graph_compiler_x64.h"
+
+#include "vm/assembler_macros.h"
+#include "vm/object_store.h"
+#include "vm/opt_code_generator.h"
+#include "vm/resolver.h"
+#include "vm/stub_code.h"
+
+namespace dart {
+
+#define __ assembler()->
+
+
+class FlowGraphCompiler::BlockInfo : public ZoneAllocated {
+ public:
+  BlockInfo() : label_() { }
+
+  Label* label() { return &label_; }
+
+ private:
+  Label label_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockInfo);
+};
+
+
+// Deoptimization code emitted after the blocks for an instruction that may
+// deoptimize.
+class FlowGraphCompiler::DeoptimizationStub : public ZoneAllocated {
+ public:
+  DeoptimizationStub(Environment* env, DeoptReasonId reason)
+      : env_(env), reason_(reason), label_() { }
+
+  Environment* env() const { return env_; }
+  DeoptReasonId reason() const { return reason_; }
+  Label* label() { return &label_; }
+
+ private:
+  Environment* env_;
+  const DeoptReasonId reason_;
+  Label label_;
+
+  DISALLOW_COPY_AND_ASSIGN(DeoptimizationStub);
+};
+
+
+static const char* kGrowableArrayClassName = "GrowableObjectArray";
+static const char* kGrowableArrayLengthFieldName = "_length";
+static const char* kGrowableArrayArrayFieldName = "backingArray";
+
+// Registers holding values. They are not used as temporaries by the code of
+// the instructions, the assembler or the store buffer update stub.
+static const Register kAllocatableRegisters[] = {
+  RSI, RDI, R8, R9, R12, R13, R14
+};
+
+
+FlowGraphCompiler::FlowGraphCompiler(OptimizingCodeGenerator* codegen,
+                                     FlowGraph* graph)
+    : codegen_(codegen),
+      graph_(graph),
+      allocator_(graph, ARRAY_SIZE(kAllocatableRegisters)),
+      block_info_(graph->reverse_postorder().length()),
+      current_block_index_(-1),
+      current_block_(NULL),
+      deoptimization_stubs_(4),
+      smi_class_(Class::ZoneHandle(
+          Isolate::Current()->object_store()->smi_class())),
+      double_class_(Class::ZoneHandle(
+          Isolate::Current()->object_store()->double_class())) {
+}
+
+
+Assembler* FlowGraphCompiler::assembler() const {
+  return codegen_->assembler();
+}
+
+
+static Condition NegateCondition(Condition condition) {
+  switch (condition) {
+    case EQUAL:         return NOT_EQUAL;
+    case NOT_EQUAL:     return EQUAL;
+    case LESS:          return GREATER_EQUAL;
+    case LESS_EQUAL:    return GREATER;
+    case GREATER:       return LESS_EQUAL;
+    case GREATER_EQUAL: return LESS;
+    default:
+      UNREACHABLE();
+      return EQUAL;
+  }
+}
+
+
+// Returns true if the class of argument 'arg_index' is 'cls' in all checks.
+static bool ICDataHasClassAt(const ICData& ic_data,
+                             const Class& cls,
+                             intptr_t arg_index) {
+  if (ic_data.NumberOfChecks() == 0) {
+    return false;
+  }
+  ASSERT(ic_data.NumberOfArgumentsChecked() > arg_index);
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
+    GrowableArray<const Class*> classes;
+    Function& target = Function::Handle();
+    ic_data.GetCheckAt(i, &classes, &target);
+    if (classes[arg_index]->raw() != cls.raw()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Returns true if 'ic_data' has the single check 'cls0', 'cls1'.
+static bool ICDataHasTwoClasses(const ICData& ic_data,
+                                const Class& cls0,
+                                const Class& cls1) {
+  if ((ic_data.NumberOfChecks() != 1) ||
+      (ic_data.NumberOfArgumentsChecked() != 2)) {
+    return false;
+  }
+  GrowableArray<const Class*> classes;
+  Function& target = Function::Handle();
+  ic_data.GetCheckAt(0, &classes, &target);
+  return (classes[0]->raw() == cls0.raw()) && (classes[1]->raw() == cls1.raw());
+}
+
+
+static intptr_t GetFieldOffset(const Class& field_class,
+                               const String& field_name) {
+  Class& cls = Class::Handle(field_class.raw());
+  Field& field = Field::Handle();
+  while (!cls.IsNull()) {
+    field = cls.LookupInstanceField(field_name);
+    if (!field.IsNull()) {
+      return field.Offset();
+    }
+    cls = cls.SuperClass();
+  }
+  return -1;
+}
+
+
+static RawClass* GrowableArrayClass() {
+  const String& class_name =
+      String::Handle(String::NewSymbol(kGrowableArrayClassName));
+  return Library::Handle(Library::CoreImplLibrary()).LookupClass(class_name);
+}
+
+
+static intptr_t GrowableArrayFieldOffset(const Class& growable_array_class,
+                                         const char* name) {
+  const String& field_name = String::Handle(String::NewSymbol(name));
+  const intptr_t offset = GetFieldOffset(growable_array_class, field_name);
+  ASSERT(offset > 0);
+  return offset;
+}
+
+
+void FlowGraphCompiler::CompileGraph() {
+  MarkCalls();
+  allocator_.AllocateRegisters();
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    block_info_.Add(new BlockInfo());
+  }
+  const intptr_t spill_slot_count = allocator_.spill_slot_count();
+  if (spill_slot_count > 0) {
+    // Spill slots are scanned by the GC, initialize them.
+    __ LoadObject(RAX, Object::ZoneHandle());
+    for (intptr_t i = 0; i < spill_slot_count; i++) {
+      __ pushq(RAX);
+    }
+  }
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    current_block_index_ = i;
+    current_block_ = blocks[i];
+    __ Bind(BlockLabel(current_block_));
+    for (Instruction* instr = current_block_->next();
+         instr != NULL;
+         instr = instr->next()) {
+      instr->Accept(this);
+    }
+  }
+  for (intptr_t i = 0; i < deoptimization_stubs_.length(); i++) {
+    GenerateDeoptimizationStub(deoptimization_stubs_[i]);
+  }
+}
+
+
+bool FlowGraphCompiler::IsCall(Instruction* instr) const {
+  if (instr->IsInstanceCall()) {
+    InstanceCallInstr* call = instr->AsInstanceCall();
+    if ((call->env() == NULL) || (call->ic_data().NumberOfChecks() == 0)) {
+      return true;
+    }
+    GrowableArray<const Class*> classes;
+    return !IsSmiRelationalCompare(call) &&
+           !IsSmiBinaryOp(call) &&
+           !IsSmiUnaryOp(call) &&
+           !IsInlinedLoadIndexed(call) &&
+           !IsInlinedStoreIndexed(call) &&
+           (ImplicitAccessorFieldOffset(call, &classes) < 0);
+  }
+  if (instr->IsEqualityCompare()) {
+    return !IsSmiEqualityCompare(instr->AsEqualityCompare());
+  }
+  return instr->IsStaticCall() ||
+         instr->IsThrow() ||
+         instr->IsCreateArray() ||
+         instr->IsAllocateObject();
+}
+
+
+void FlowGraphCompiler::MarkCalls() {
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    for (Instruction* instr = blocks[i]->next();
+         instr != NULL;
+         instr = instr->next()) {
+      instr->set_is_call(IsCall(instr));
+    }
+  }
+}
+
+
+// Values defined by constants and parameters are read from their origin, all
+// other values used by an instruction, phi or environment have a register or
+// a spill slot.
+bool FlowGraphCompiler::HasLocation(Definition* defn) const {
+  return HasRegister(defn) || (allocator_.SpillSlotOf(defn) >= 0);
+}
+
+
+bool FlowGraphCompiler::HasRegister(Definition* defn) const {
+  return allocator_.RegisterOf(defn) >= 0;
+}
+
+
+Register FlowGraphCompiler::RegisterOf(Definition* defn) const {
+  ASSERT(HasRegister(defn));
+  return kAllocatableRegisters[allocator_.RegisterOf(defn)];
+}
+
+
+Address FlowGraphCompiler::SpillSlotAddress(Definition* defn) const {
+  const intptr_t slot = allocator_.SpillSlotOf(defn);
+  ASSERT(slot >= 0);
+  return Address(RBP,
+                 -(codegen_->locals_space_size() + (slot + 1) * kWordSize));
+}
+
+
+bool FlowGraphCompiler::IsSameLocation(Definition* a, Definition* b) const {
+  if (HasRegister(a)) {
+    return allocator_.RegisterOf(a) == allocator_.RegisterOf(b);
+  }
+  const intptr_t slot = allocator_.SpillSlotOf(a);
+  return (slot >= 0) && (slot == allocator_.SpillSlotOf(b));
+}
+
+
+void FlowGraphCompiler::LoadValue(Register dst, Definition* value) {
+  if (value->IsConstant()) {
+    const Object& constant = value->AsConstant()->value();
+    if (constant.IsSmi()) {
+      __ movq(dst, Immediate(reinterpret_cast<int64_t>(constant.raw())));
+    } else {
+      __ LoadObject(dst, constant);
+    }
+  } else if (value->IsParameter()) {
+    __ movq(dst,
+            Address(RBP, value->AsParameter()->frame_index() * kWordSize));
+  } else if (HasRegister(value)) {
+    if (RegisterOf(value) != dst) {
+      __ movq(dst, RegisterOf(value));
+    }
+  } else {
+    __ movq(dst, SpillSlotAddress(value));
+  }
+}
+
+
+void FlowGraphCompiler::PushValue(Definition* value) {
+  if (value->IsConstant()) {
+    __ PushObject(value->AsConstant()->value());
+  } else if (value->IsParameter()) {
+    __ pushq(Address(RBP, value->AsParameter()->frame_index() * kWordSize));
+  } else if (HasRegister(value)) {
+    __ pushq(RegisterOf(value));
+  } else {
+    __ pushq(SpillSlotAddress(value));
+  }
+}
+
+
+void FlowGraphCompiler::PopValue(Definition* defn) {
+  if (HasRegister(defn)) {
+    __ popq(RegisterOf(defn));
+  } else {
+    __ popq(SpillSlotAddress(defn));
+  }
+}
+
+
+void FlowGraphCompiler::StoreResult(Definition* defn, Register src) {
+  if (HasRegister(defn)) {
+    __ movq(RegisterOf(defn), src);
+  } else if (HasLocation(defn)) {
+    __ movq(SpillSlotAddress(defn), src);
+  }
+}
+
+
+Label* FlowGraphCompiler::BlockLabel(BlockEntryInstr* block) {
+  return block_info_[block->block_id()]->label();
+}
+
+
+bool FlowGraphCompiler::IsNextBlock(BlockEntryInstr* block) const {
+  return block->block_id() == current_block_index_ + 1;
+}
+
+
+Label* FlowGraphCompiler::AddDeoptimizationStub(Instruction* instr,
+                                                DeoptReasonId reason) {
+  ASSERT(instr->env() != NULL);
+  DeoptimizationStub* stub = new DeoptimizationStub(instr->env(), reason);
+  deoptimization_stubs_.Add(stub);
+  return stub->label();
+}
+
+
+// Rebuilds the frame of the unoptimized code: the locals that differ from
+// their frame slot are stored, and the expression stack is moved right below
+// the locals, over the spill slots.
+void FlowGraphCompiler::GenerateDeoptimizationStub(DeoptimizationStub* stub) {
+  Environment* env = stub->env();
+  __ Bind(stub->label());
+  for (intptr_t i = env->local_count(); i < env->Length(); i++) {
+    PushValue(env->ValueAt(i));
+  }
+  // Values are pushed before any frame slot is written as parameters may be
+  // permuted.
+  GrowableArray<intptr_t> written_locals;
+  for (intptr_t i = 0; i < env->local_count(); i++) {
+    Definition* value = env->ValueAt(i);
+    const intptr_t frame_index = graph_->FrameIndexOf(i);
+    if (i < graph_->parameter_count()) {
+      if (value->IsParameter() &&
+          (value->AsParameter()->frame_index() == frame_index)) {
+        continue;
+      }
+    } else if (value->IsConstant() && value->AsConstant()->value().IsNull()) {
+      // Stack locals are initialized to null and never written by optimized
+      // code.
+      continue;
+    }
+    PushValue(value);
+    written_locals.Add(frame_index);
+  }
+  for (intptr_t i = written_locals.length() - 1; i >= 0; i--) {
+    __ popq(Address(RBP, written_locals[i] * kWordSize));
+  }
+  const intptr_t stack_height = env->StackHeight();
+  const intptr_t locals_space_size = codegen_->locals_space_size();
+  for (intptr_t i = 0; i < stack_height; i++) {
+    __ movq(RAX, Address(RSP, (stack_height - 1 - i) * kWordSize));
+    __ movq(Address(RBP, -(locals_space_size + (i + 1) * kWordSize)), RAX);
+  }
+  __ leaq(RSP,
+          Address(RBP, -(locals_space_size + stack_height * kWordSize)));
+  __ movq(RAX, Immediate(Smi::RawValue(stub->reason())));
+  codegen_->CallDeoptimize(env->deopt_id(), env->token_index());
+#if defined(DEBUG)
+  // Check that deoptimization point exists in unoptimized code.
+  const Code& unoptimized_code = Code::Handle(
+      codegen_->parsed_function().function().unoptimized_code());
+  ASSERT(!unoptimized_code.IsNull());
+  ASSERT(unoptimized_code.GetDeoptPcAtNodeId(env->deopt_id()) != 0);
+#endif  // DEBUG
+}
+
+
+void FlowGraphCompiler::VisitGraphEntry(GraphEntryInstr* instr) {
+  UNREACHABLE();
+}
+
+
+void FlowGraphCompiler::VisitTargetEntry(TargetEntryInstr* instr) {
+  UNREACHABLE();
+}
+
+
+void FlowGraphCompiler::VisitJoinEntry(JoinEntryInstr* instr) {
+  UNREACHABLE();
+}
+
+
+// Moves the inputs of the successor's phis into the locations of the phis.
+// A move is emitted once no other pending move reads its destination, the
+// moves left form cycles and go through the stack: all their inputs are read
+// before any phi is written.
+void FlowGraphCompiler::VisitGoto(GotoInstr* instr) {
+  JoinEntryInstr* successor = instr->successor();
+  intptr_t predecessor_index = -1;
+  for (intptr_t i = 0; i < successor->PredecessorCount(); i++) {
+    if (successor->PredecessorAt(i) == current_block_) {
+      predecessor_index = i;
+      break;
+    }
+  }
+  ASSERT(predecessor_index >= 0);
+  GrowableArray<PhiInstr*> pending_phis;
+  for (intptr_t i = 0; i < successor->PhiCount(); i++) {
+    PhiInstr* phi = successor->PhiAt(i);
+    if (!HasLocation(phi)) continue;
+    Definition* input = phi->InputAt(predecessor_index);
+    if ((input == phi) || IsSameLocation(phi, input)) continue;
+    pending_phis.Add(phi);
+  }
+  bool progress = true;
+  while (progress) {
+    progress = false;
+    for (intptr_t i = 0; i < pending_phis.length(); i++) {
+      PhiInstr* phi = pending_phis[i];
+      bool is_blocked = false;
+      for (intptr_t j = 0; j < pending_phis.length(); j++) {
+        if ((j != i) &&
+            IsSameLocation(phi, pending_phis[j]->InputAt(predecessor_index))) {
+          is_blocked = true;
+          break;
+        }
+      }
+      if (is_blocked) continue;
+      Definition* input = phi->InputAt(predecessor_index);
+      if (HasRegister(phi)) {
+        LoadValue(RegisterOf(phi), input);
+      } else {
+        LoadValue(RAX, input);
+        StoreResult(phi, RAX);
+      }
+      pending_phis[i] = pending_phis.Last();
+      pending_phis.RemoveLast();
+      progress = true;
+      break;
+    }
+  }
+  for (intptr_t i = 0; i < pending_phis.length(); i++) {
+    PushValue(pending_phis[i]->InputAt(predecessor_index));
+  }
+  for (intptr_t i = pending_phis.length() - 1; i >= 0; i--) {
+    PopValue(pending_phis[i]);
+  }
+  if (!IsNextBlock(successor)) {
+    __ jmp(BlockLabel(successor));
+  }
+}
+
+
+void FlowGraphCompiler::GenerateBranch(BranchInstr* branch,
+                                       Condition true_condition) {
+  BlockEntryInstr* true_successor = branch->true_successor();
+  BlockEntryInstr* false_successor = branch->false_successor();
+  if (IsNextBlock(true_successor)) {
+    __ j(NegateCondition(true_condition), BlockLabel(false_successor));
+  } else {
+    __ j(true_condition, BlockLabel(true_successor));
+    if (!IsNextBlock(false_successor)) {
+      __ jmp(BlockLabel(false_successor));
+    }
+  }
+}
+
+
+void FlowGraphCompiler::VisitBranch(BranchInstr* instr) {
+  if (IsFusedWithBranch(instr->value())) {
+    // The comparison emitted the branch.
+    return;
+  }
+  LoadValue(RAX, instr->value());
+  __ CompareObject(RAX, Bool::ZoneHandle(Bool::True()));
+  GenerateBranch(instr, EQUAL);
+}
+
+
+void FlowGraphCompiler::VisitReturn(ReturnInstr* instr) {
+  LoadValue(RAX, instr->value());
+  if (allocator_.spill_slot_count() > 0) {
+    __ addq(RSP, Immediate(allocator_.spill_slot_count() * kWordSize));
+  }
+  codegen_->GenerateReturnEpilog();
+}
+
+
+void FlowGraphCompiler::VisitThrow(ThrowInstr* instr) {
+  __ PushObject(Object::ZoneHandle());  // Make room for the result.
+  PushValue(instr->exception());
+  codegen_->GenerateCallRuntime(instr->node_id(),
+                                instr->token_index(),
+                                kThrowRuntimeEntry);
+  // We should never return here.
+  __ int3();
+}
+
+
+void FlowGraphCompiler::VisitConstant(ConstantInstr* instr) {
+  // Constants are materialized at their uses.
+}
+
+
+void FlowGraphCompiler::VisitParameter(ParameterInstr* instr) {
+  // Parameters are read from the caller's frame at their uses.
+}
+
+
+void FlowGraphCompiler::VisitPhi(PhiInstr* instr) {
+  // Phis are assigned at the gotos to their block.
+}
+
+
+bool FlowGraphCompiler::IsFusedWithBranch(Definition* defn) const {
+  if ((defn->use_count() != 1) ||
+      (defn->next() == NULL) ||
+      !defn->next()->IsBranch() ||
+      (defn->next()->AsBranch()->value() != defn)) {
+    return false;
+  }
+  if (defn->IsStrictCompare() ||
+      defn->IsBooleanNegate() ||
+      defn->IsEqualityCompare() ||
+      defn->IsClassTest()) {
+    return true;
+  }
+  return defn->IsInstanceCall() &&
+         IsSmiRelationalCompare(defn->AsInstanceCall());
+}
+
+
+void FlowGraphCompiler::GenerateConditionResult(Definition* defn,
+                                                Condition true_condition) {
+  if (IsFusedWithBranch(defn)) {
+    GenerateBranch(defn->next()->AsBranch(), true_condition);
+    return;
+  }
+  Label is_true, done;
+  __ j(true_condition, &is_true, Assembler::kNearJump);
+  __ LoadObject(RAX, Bool::ZoneHandle(Bool::False()));
+  __ jmp(&done, Assembler::kNearJump);
+  __ Bind(&is_true);
+  __ LoadObject(RAX, Bool::ZoneHandle(Bool::True()));
+  __ Bind(&done);
+  StoreResult(defn, RAX);
+}
+
+
+void FlowGraphCompiler::VisitStrictCompare(StrictCompareInstr* instr) {
+  if (!HasLocation(instr) && !IsFusedWithBranch(instr)) return;
+  LoadValue(RAX, instr->left());
+  if (instr->right()->IsConstant()) {
+    __ CompareObject(RAX, instr->right()->AsConstant()->value());
+  } else {
+    LoadValue(RDX, instr->right());
+    __ cmpq(RAX, RDX);
+  }
+  GenerateConditionResult(
+      instr, (instr->kind() == Token::kEQ_STRICT) ? EQUAL : NOT_EQUAL);
+}
+
+
+void FlowGraphCompiler::VisitBooleanNegate(BooleanNegateInstr* instr) {
+  if (!HasLocation(instr) && !IsFusedWithBranch(instr)) return;
+  LoadValue(RAX, instr->value());
+  __ CompareObject(RAX, Bool::ZoneHandle(Bool::True()));
+  GenerateConditionResult(instr, NOT_EQUAL);
+}
+
+
+bool FlowGraphCompiler::IsSmiEqualityCompare(
+    EqualityCompareInstr* instr) const {
+  return (instr->env() != NULL) &&
+         ICDataHasClassAt(instr->ic_data(), smi_class_, 0);
+}
+
+
+// Smi receivers are compared inline, otherwise a null left operand is
+// compared by identity and the '==' operator is invoked for other values.
+void FlowGraphCompiler::VisitEqualityCompare(EqualityCompareInstr* instr) {
+  const Bool& bool_true = Bool::ZoneHandle(Bool::True());
+  const Bool& bool_false = Bool::ZoneHandle(Bool::False());
+  if (IsSmiEqualityCompare(instr)) {
+    Label* deopt = AddDeoptimizationStub(instr, kDeoptSmiEquality);
+    LoadValue(RAX, instr->left());
+    LoadValue(RDX, instr->right());
+    __ movq(RCX, RAX);
+    __ orq(RCX, RDX);
+    __ testq(RCX, Immediate(kSmiTagMask));
+    __ j(NOT_ZERO, deopt);
+    __ cmpq(RAX, RDX);
+    GenerateConditionResult(
+        instr, (instr->kind() == Token::kEQ) ? EQUAL : NOT_EQUAL);
+    return;
+  }
+  // The result of the generic comparison is computed as a Bool.
+  Label operator_call, is_true, done;
+  LoadValue(RAX, instr->left());
+  __ CompareObject(RAX, Object::ZoneHandle());
+  __ j(NOT_EQUAL, &operator_call);
+  LoadValue(RDX, instr->right());
+  __ cmpq(RAX, RDX);
+  __ j((instr->kind() == Token::kEQ) ? EQUAL : NOT_EQUAL, &is_true);
+  __ LoadObject(RAX, bool_false);
+  __ jmp(&done);
+  __ Bind(&operator_call);
+  PushValue(instr->left());
+  PushValue(instr->right());
+  const String& operator_name = String::ZoneHandle(String::NewSymbol("=="));
+  const int kNumberOfArguments = 2;
+  const int kNumArgumentsChecked = 1;
+  codegen_->GenerateInstanceCall(instr->node_id(),
+                                 instr->token_index(),
+                                 operator_name,
+                                 kNumberOfArguments,
+                                 Array::ZoneHandle(),
+                                 kNumArgumentsChecked);
+  if (instr->kind() == Token::kNE) {
+    // '!=' is true iff '==' returns false.
+    __ CompareObject(RAX, bool_false);
+    __ j(EQUAL, &is_true);
+    __ LoadObject(RAX, bool_false);
+    __ jmp(&done);
+  } else {
+    __ jmp(&done);
+  }
+  __ Bind(&is_true);
+  __ LoadObject(RAX, bool_true);
+  __ Bind(&done);
+  __ CompareObject(RAX, bool_true);
+  GenerateConditionResult(instr, EQUAL);
+}
+
+
+void FlowGraphCompiler::VisitLoadInstanceField(LoadInstanceFieldInstr* instr) {
+  if (!HasLocation(instr)) return;
+  LoadValue(RAX, instr->instance());
+  __ movq(RAX, FieldAddress(RAX, instr->field().Offset()));
+  StoreResult(instr, RAX);
+}
+
+
+void FlowGraphCompiler::VisitStoreInstanceField(
+    StoreInstanceFieldInstr* instr) {
+  LoadValue(RDX, instr->instance());
+  LoadValue(RAX, instr->value());
+  __ StoreIntoObject(RDX, FieldAddress(RDX, instr->field().Offset()), RAX);
+}
+
+
+void FlowGraphCompiler::VisitLoadStaticField(LoadStaticFieldInstr* instr) {
+  if (!HasLocation(instr)) return;
+  __ LoadObject(RDX, instr->field());
+  __ movq(RAX, FieldAddress(RDX, Field::value_offset()));
+  StoreResult(instr, RAX);
+}
+
+
+void FlowGraphCompiler::VisitStoreStaticField(StoreStaticFieldInstr* instr) {
+  LoadValue(RAX, instr->value());
+  __ LoadObject(RDX, instr->field());
+  __ StoreIntoObject(RDX, FieldAddress(RDX, Field::value_offset()), RAX);
+}
+
+
+void FlowGraphCompiler::VisitCreateArray(CreateArrayInstr* instr) {
+  for (intptr_t i = 0; i < instr->ElementCount(); i++) {
+    PushValue(instr->ElementAt(i));
+  }
+  // Allocate the array.
+  //   R10 : Array length as Smi.
+  //   RBX : element type for the array.
+  __ movq(R10, Immediate(Smi::RawValue(instr->ElementCount())));
+  __ LoadObject(RBX, instr->type_arguments());
+  codegen_->GenerateCall(instr->token_index(), &StubCode::AllocateArrayLabel());
+  // Pop the element values from the stack into the array.
+  __ leaq(RCX, FieldAddress(RAX, Array::data_offset()));
+  for (intptr_t i = instr->ElementCount() - 1; i >= 0; i--) {
+    __ popq(Address(RCX, i * kWordSize));
+  }
+  // The array may have been allocated in old space, in which case it has to be
+  // remembered as the stored elements may be new objects.
+  Label array_is_new;
+  __ testq(RAX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &array_is_new, Assembler::kNearJump);
+  __ pushq(Immediate(0));  // All elements have been updated.
+  __ call(&StubCode::UpdateStoreBufferLabel());
+  __ AddImmediate(RSP, Immediate(kWordSize));
+  __ Bind(&array_is_new);
+  StoreResult(instr, RAX);
+}
+
+
+void FlowGraphCompiler::VisitAllocateObject(AllocateObjectInstr* instr) {
+  const Class& cls = instr->cls();
+  const bool requires_type_arguments = cls.HasTypeArguments();
+  if (requires_type_arguments) {
+    __ PushObject(instr->type_arguments());
+    __ PushObject(Object::ZoneHandle());  // Null instantiator.
+  }
+  const Code& stub = Code::Handle(StubCode::GetAllocationStubForClass(cls));
+  const ExternalLabel label(cls.ToCString(), stub.EntryPoint());
+  codegen_->GenerateCall(instr->token_index(), &label);
+  if (requires_type_arguments) {
+    __ popq(RCX);  // Pop type arguments.
+    __ popq(RCX);  // Pop instantiator type arguments.
+  }
+  StoreResult(instr, RAX);
+}
+
+
+void FlowGraphCompiler::VisitStaticCall(StaticCallInstr* instr) {
+  for (intptr_t i = 0; i < instr->ArgumentCount(); i++) {
+    PushValue(instr->ArgumentAt(i));
+  }
+  __ LoadObject(RBX, instr->function());
+  __ LoadObject(R10, CodeGenerator::ArgumentsDescriptor(
+      instr->ArgumentCount(), instr->argument_names()));
+  codegen_->GenerateCall(instr->token_index(),
+                         &StubCode::CallStaticFunctionLabel());
+  __ addq(RSP, Immediate(instr->ArgumentCount() * kWordSize));
+  StoreResult(instr, RAX);
+}
+
+
+// Loads the class of 'instance' into 'dst', the Smi class for Smis.
+void FlowGraphCompiler::LoadClassOf(Register instance, Register dst) {
+  Label done;
+  __ LoadObject(dst, smi_class_);
+  __ testq(instance, Immediate(kSmiTagMask));
+  __ j(ZERO, &done, Assembler::kNearJump);
+  __ movq(dst, FieldAddress(instance, Object::class_offset()));
+  __ Bind(&done);
+}
+
+
+void FlowGraphCompiler::VisitCheckClass(CheckClassInstr* instr) {
+  Label* deopt = AddDeoptimizationStub(instr, kDeoptCheckClass);
+  LoadValue(RAX, instr->value());
+  LoadClassOf(RAX, RCX);
+  Label class_ok;
+  for (intptr_t i = 0; i < instr->ClassCount(); i++) {
+    __ CompareObject(RCX, instr->ClassAt(i));
+    if (i == (instr->ClassCount() - 1)) {
+      __ j(NOT_EQUAL, deopt);
+    } else {
+      __ j(EQUAL, &class_ok);
+    }
+  }
+  __ Bind(&class_ok);
+}
+
+
+void FlowGraphCompiler::VisitClassTest(ClassTestInstr* instr) {
+  if (!HasLocation(instr) && !IsFusedWithBranch(instr)) return;
+  LoadValue(RAX, instr->value());
+  LoadClassOf(RAX, RCX);
+  __ CompareObject(RCX, instr->cls());
+  GenerateConditionResult(instr, EQUAL);
+}
+
+
+void FlowGraphCompiler::GenerateClassCheck(Register instance,
+                                           const Class& cls,
+                                           Register temp,
+                                           Label* deopt) {
+  __ testq(instance, Immediate(kSmiTagMask));
+  __ j(ZERO, deopt);
+  __ movq(temp, FieldAddress(instance, Object::class_offset()));
+  __ CompareObject(temp, cls);
+  __ j(NOT_EQUAL, deopt);
+}
+
+
+static bool IsSmiBinaryOpKind(Token::Kind kind) {
+  switch (kind) {
+    case Token::kADD:
+    case Token::kSUB:
+    case Token::kMUL:
+    case Token::kTRUNCDIV:
+    case Token::kBIT_AND:
+    case Token::kBIT_OR:
+    case Token::kBIT_XOR:
+    case Token::kSAR:
+      return true;
+    default:
+      return false;
+  }
+}
+
+
+bool FlowGraphCompiler::IsSmiBinaryOp(InstanceCallInstr* instr) const {
+  return IsSmiBinaryOpKind(instr->token_kind()) &&
+         ICDataHasTwoClasses(instr->ic_data(), smi_class_, smi_class_);
+}
+
+
+void FlowGraphCompiler::GenerateSmiBinaryOp(InstanceCallInstr* instr) {
+  ASSERT(IsSmiBinaryOp(instr));
+  const Token::Kind kind = instr->token_kind();
+  Label* deopt = AddDeoptimizationStub(
+      instr, (kind == Token::kSAR) ? kDeoptSAR : kDeoptSmiBinaryOp);
+  LoadValue(RAX, instr->ArgumentAt(0));
+  LoadValue(RDX, instr->ArgumentAt(1));
+  __ movq(RCX, RAX);
+  __ orq(RCX, RDX);
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, deopt);
+  switch (kind) {
+    case Token::kADD:
+      __ addq(RAX, RDX);
+      __ j(OVERFLOW, deopt);
+      break;
+    case Token::kSUB:
+      __ subq(RAX, RDX);
+      __ j(OVERFLOW, deopt);
+      break;
+    case Token::kMUL:
+      __ SmiUntag(RAX);
+      __ imulq(RAX, RDX);
+      __ j(OVERFLOW, deopt);
+      break;
+    case Token::kBIT_AND:
+      __ andq(RAX, RDX);
+      break;
+    case Token::kBIT_OR:
+      __ orq(RAX, RDX);
+      break;
+    case Token::kBIT_XOR:
+      __ xorq(RAX, RDX);
+      break;
+    case Token::kTRUNCDIV: {
+      // Handle divide by zero in runtime.
+      __ cmpq(RDX, Immediate(0));
+      __ j(EQUAL, deopt);
+      __ movq(RCX, RDX);
+      __ SmiUntag(RCX);
+      __ SmiUntag(RAX);
+      // Sign extend RAX -> RDX:RAX.
+      __ cqo();
+      __ idivq(RCX);  // Result in RAX.
+      // Check the corner case of dividing the 'MIN_SMI' with -1, in which
+      // case we cannot tag the result.
+      __ cmpq(RAX, Immediate(0x4000000000000000LL));
+      __ j(EQUAL, deopt);
+      __ SmiTag(RAX);
+      break;
+    }
+    case Token::kSAR: {
+      // Negative shift counts throw in the operator.
+      __ cmpq(RDX, Immediate(0));
+      __ j(LESS, deopt);
+      Immediate count_limit = Immediate(0x3F);
+      __ movq(RCX, RDX);
+      __ SmiUntag(RCX);
+      __ cmpq(RCX, count_limit);
+      Label shift_count_ok;
+      __ j(LESS_EQUAL, &shift_count_ok, Assembler::kNearJump);
+      __ movq(RCX, count_limit);
+      __ Bind(&shift_count_ok);
+      // Shift amount must be in RCX.
+      __ SmiUntag(RAX);
+      __ sarq(RAX, RCX);
+      __ SmiTag(RAX);
+      break;
+    }
+    default:
+      UNREACHABLE();
+  }
+  StoreResult(instr, RAX);
+}
+
+
+bool FlowGraphCompiler::IsDoubleBinaryOp(InstanceCallInstr* instr) const {
+  const Token::Kind kind = instr->token_kind();
+  return ((kind == Token::kADD) ||
+          (kind == Token::kSUB) ||
+          (kind == Token::kMUL) ||
+          (kind == Token::kDIV)) &&
+         ICDataHasClassAt(instr->ic_data(), double_class_, 0);
+}
+
+
+// Double receivers with double or Smi arguments. The operands are checked
+// before the result is allocated, and kept on the stack during the
+// allocation where the GC can find them.
+void FlowGraphCompiler::GenerateDoubleBinaryOp(InstanceCallInstr* instr) {
+  ASSERT(IsDoubleBinaryOp(instr));
+  const Token::Kind kind = instr->token_kind();
+  Label* deopt = AddDeoptimizationStub(instr, kDeoptDoubleBinaryOp);
+  LoadValue(RAX, instr->ArgumentAt(0));
+  GenerateClassCheck(RAX, double_class_, RBX, deopt);
+  LoadValue(RDX, instr->ArgumentAt(1));
+  Label right_checked;
+  __ testq(RDX, Immediate(kSmiTagMask));
+  __ j(ZERO, &right_checked, Assembler::kNearJump);
+  __ movq(RBX, FieldAddress(RDX, Object::class_offset()));
+  __ CompareObject(RBX, double_class_);
+  __ j(NOT_EQUAL, deopt);
+  __ Bind(&right_checked);
+  __ pushq(RAX);
+  __ pushq(RDX);
+  const Code& stub =
+      Code::Handle(StubCode::GetAllocationStubForClass(double_class_));
+  const ExternalLabel label(double_class_.ToCString(), stub.EntryPoint());
+  codegen_->GenerateCall(instr->token_index(), &label);
+  __ movq(RCX, RAX);  // Result.
+  __ popq(RDX);
+  __ popq(RAX);
+  __ movsd(XMM0, FieldAddress(RAX, Double::value_offset()));
+  Label right_is_smi, right_done;
+  __ testq(RDX, Immediate(kSmiTagMask));
+  __ j(ZERO, &right_is_smi, Assembler::kNearJump);
+  __ movsd(XMM1, FieldAddress(RDX, Double::value_offset()));
+  __ jmp(&right_done, Assembler::kNearJump);
+  __ Bind(&right_is_smi);
+  __ SmiUntag(RDX);
+  __ cvtsi2sd(XMM1, RDX);
+  __ Bind(&right_done);
+  switch (kind) {
+    case Token::kADD: __ addsd(XMM0, XMM1); break;
+    case Token::kSUB: __ subsd(XMM0, XMM1); break;
+    case Token::kMUL: __ mulsd(XMM0, XMM1); break;
+    case Token::kDIV: __ divsd(XMM0, XMM1); break;
+    default: UNREACHABLE();
+  }
+  __ movsd(FieldAddress(RCX, Double::value_offset()), XMM0);
+  StoreResult(instr, RCX);
+}
+
+
+bool FlowGraphCompiler::IsSmiRelationalCompare(
+    InstanceCallInstr* instr) const {
+  const Token::Kind kind = instr->token_kind();
+  return (instr->env() != NULL) &&
+         ((kind == Token::kLT) ||
+          (kind == Token::kGT) ||
+          (kind == Token::kLTE) ||
+          (kind == Token::kGTE)) &&
+         ICDataHasTwoClasses(instr->ic_data(), smi_class_, smi_class_);
+}
+
+
+Condition FlowGraphCompiler::GenerateSmiRelationalCompare(
+    InstanceCallInstr* instr) {
+  Label* deopt = AddDeoptimizationStub(instr, kDeoptSmiCompareSmis);
+  LoadValue(RAX, instr->ArgumentAt(0));
+  LoadValue(RDX, instr->ArgumentAt(1));
+  __ movq(RCX, RAX);
+  __ orq(RCX, RDX);
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, deopt);
+  __ cmpq(RAX, RDX);
+  switch (instr->token_kind()) {
+    case Token::kLT: return LESS;
+    case Token::kGT: return GREATER;
+    case Token::kLTE: return LESS_EQUAL;
+    case Token::kGTE: return GREATER_EQUAL;
+    default:
+      UNREACHABLE();
+      return EQUAL;
+  }
+}
+
+
+bool FlowGraphCompiler::IsSmiUnaryOp(InstanceCallInstr* instr) const {
+  const Token::Kind kind = instr->token_kind();
+  return ((kind == Token::kNEGATE) || (kind == Token::kBIT_NOT)) &&
+         ICDataHasClassAt(instr->ic_data(), smi_class_, 0);
+}
+
+
+void FlowGraphCompiler::GenerateSmiUnaryOp(InstanceCallInstr* instr) {
+  ASSERT(IsSmiUnaryOp(instr));
+  const Token::Kind kind = instr->token_kind();
+  Label* deopt = AddDeoptimizationStub(instr, kDeoptUnaryOp);
+  LoadValue(RAX, instr->ArgumentAt(0));
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, deopt);
+  if (kind == Token::kNEGATE) {
+    __ negq(RAX);
+    __ j(OVERFLOW, deopt);
+  } else {
+    __ notq(RAX);
+    __ andq(RAX, Immediate(~kSmiTagMask));  // Remove inverted smi-tag.
+  }
+  StoreResult(instr, RAX);
+}
+
+
+bool FlowGraphCompiler::IsInlinedLoadIndexed(InstanceCallInstr* instr) const {
+  if (instr->token_kind() != Token::kINDEX) return false;
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const ICData& ic_data = instr->ic_data();
+  if (ICDataHasClassAt(ic_data,
+                       Class::Handle(object_store->array_class()),
+                       0) ||
+      ICDataHasClassAt(ic_data,
+                       Class::Handle(object_store->immutable_array_class()),
+                       0)) {
+    return true;
+  }
+  const Class& growable_array_class = Class::Handle(GrowableArrayClass());
+  return !growable_array_class.IsNull() &&
+         ICDataHasClassAt(ic_data, growable_array_class, 0);
+}
+
+
+void FlowGraphCompiler::GenerateLoadIndexed(InstanceCallInstr* instr) {
+  ASSERT(IsInlinedLoadIndexed(instr));
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const Class& object_array_class =
+      Class::ZoneHandle(object_store->array_class());
+  const Class& immutable_object_array_class =
+      Class::ZoneHandle(object_store->immutable_array_class());
+  const Class& growable_array_class =
+      Class::ZoneHandle(GrowableArrayClass());
+  const ICData& ic_data = instr->ic_data();
+  if (ICDataHasClassAt(ic_data, object_array_class, 0) ||
+      ICDataHasClassAt(ic_data, immutable_object_array_class, 0)) {
+    const Class& test_class = ICDataHasClassAt(ic_data, object_array_class, 0)
+        ? object_array_class : immutable_object_array_class;
+    Label* deopt = AddDeoptimizationStub(instr, kDeoptLoadIndexedFixedArray);
+    LoadValue(RBX, instr->ArgumentAt(0));
+    LoadValue(RDX, instr->ArgumentAt(1));
+    GenerateClassCheck(RBX, test_class, RAX, deopt);
+    __ testq(RDX, Immediate(kSmiTagMask));
+    __ j(NOT_ZERO, deopt);
+    // Range check.
+    __ cmpq(RDX, FieldAddress(RBX, Array::length_offset()));
+    __ j(ABOVE_EQUAL, deopt);
+    // Note that RDX is Smi, i.e, times 2.
+    ASSERT(kSmiTagShift == 1);
+    __ movq(RAX, FieldAddress(RBX, RDX, TIMES_4, sizeof(RawArray)));
+    StoreResult(instr, RAX);
+  } else {
+    ASSERT(ICDataHasClassAt(ic_data, growable_array_class, 0));
+    const intptr_t length_offset = GrowableArrayFieldOffset(
+        growable_array_class, kGrowableArrayLengthFieldName);
+    const intptr_t array_offset = GrowableArrayFieldOffset(
+        growable_array_class, kGrowableArrayArrayFieldName);
+    Label* deopt =
+        AddDeoptimizationStub(instr, kDeoptLoadIndexedGrowableArray);
+    LoadValue(RDX, instr->ArgumentAt(0));
+    LoadValue(RAX, instr->ArgumentAt(1));
+    __ testq(RAX, Immediate(kSmiTagMask));
+    __ j(NOT_ZERO, deopt);
+    GenerateClassCheck(RDX, growable_array_class, RBX, deopt);
+    // Range check: deoptimize if out of bounds.
+    __ cmpq(RAX, FieldAddress(RDX, length_offset));
+    __ j(ABOVE_EQUAL, deopt);
+    __ movq(RDX, FieldAddress(RDX, array_offset));  // backingArray.
+    // Note that RAX is Smi, i.e, times 2.
+    ASSERT(kSmiTagShift == 1);
+    __ movq(RAX, FieldAddress(RDX, RAX, TIMES_4, sizeof(RawArray)));
+    StoreResult(instr, RAX);
+  }
+}
+
+
+bool FlowGraphCompiler::IsInlinedStoreIndexed(InstanceCallInstr* instr) const {
+  if (instr->token_kind() != Token::kASSIGN_INDEX) return false;
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const ICData& ic_data = instr->ic_data();
+  if (ICDataHasClassAt(ic_data,
+                       Class::Handle(object_store->array_class()),
+                       0)) {
+    return true;
+  }
+  const Class& growable_array_class = Class::Handle(GrowableArrayClass());
+  return !growable_array_class.IsNull() &&
+         ICDataHasClassAt(ic_data, growable_array_class, 0);
+}
+
+
+void FlowGraphCompiler::GenerateStoreIndexed(InstanceCallInstr* instr) {
+  ASSERT(IsInlinedStoreIndexed(instr));
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const Class& object_array_class =
+      Class::ZoneHandle(object_store->array_class());
+  const Class& growable_array_class =
+      Class::ZoneHandle(GrowableArrayClass());
+  const ICData& ic_data = instr->ic_data();
+  Label* deopt = NULL;
+  if (ICDataHasClassAt(ic_data, object_array_class, 0)) {
+    deopt = AddDeoptimizationStub(instr, kDeoptStoreIndexed);
+    LoadValue(RAX, instr->ArgumentAt(0));
+    LoadValue(RBX, instr->ArgumentAt(1));
+    LoadValue(RCX, instr->ArgumentAt(2));
+    GenerateClassCheck(RAX, object_array_class, RDX, deopt);
+    __ testq(RBX, Immediate(kSmiTagMask));
+    __ j(NOT_ZERO, deopt);
+    // Range check.
+    __ cmpq(RBX, FieldAddress(RAX, Array::length_offset()));
+    __ j(ABOVE_EQUAL, deopt);
+    ASSERT(kSmiTagShift == 1);
+    __ StoreIntoObject(RAX,
+                       FieldAddress(RAX, RBX, TIMES_4, sizeof(RawArray)),
+                       RCX);
+  } else {
+    ASSERT(ICDataHasClassAt(ic_data, growable_array_class, 0));
+    const intptr_t length_offset = GrowableArrayFieldOffset(
+        growable_array_class, kGrowableArrayLengthFieldName);
+    const intptr_t array_offset = GrowableArrayFieldOffset(
+        growable_array_class, kGrowableArrayArrayFieldName);
+    deopt = AddDeoptimizationStub(instr, kDeoptStoreIndexed);
+    LoadValue(RAX, instr->ArgumentAt(0));
+    LoadValue(RBX, instr->ArgumentAt(1));
+    LoadValue(RCX, instr->ArgumentAt(2));
+    GenerateClassCheck(RAX, growable_array_class, RDX, deopt);
+    __ testq(RBX, Immediate(kSmiTagMask));
+    __ j(NOT_ZERO, deopt);
+    // Range check: deoptimize if out of bounds.
+    __ cmpq(RBX, FieldAddress(RAX, length_offset));
+    __ j(ABOVE_EQUAL, deopt);
+    __ movq(RDX, FieldAddress(RAX, array_offset));  // backingArray.
+    ASSERT(kSmiTagShift == 1);
+    __ StoreIntoObject(RDX,
+                       FieldAddress(RDX, RBX, TIMES_4, sizeof(RawArray)),
+                       RCX);
+  }
+  // The result of the operator is the stored value.
+  StoreResult(instr, RCX);
+}
+
+
+// Offset of the length field read by 'getter' if it is the length getter of
+// an array, a growable array or a string, -1 otherwise.
+static intptr_t LengthGetterOffset(const Function& getter,
+                                   const Class& receiver_class) {
+  const String& name = String::Handle(getter.name());
+  if (!name.Equals(String::Handle(String::NewSymbol("get:length")))) {
+    return -1;
+  }
+  const String& owner_name =
+      String::Handle(Class::Handle(getter.owner()).Name());
+  if (owner_name.Equals(String::Handle(String::NewSymbol("ObjectArray")))) {
+    return Array::length_offset();
+  }
+  if (owner_name.Equals(String::Handle(String::NewSymbol("StringBase")))) {
+    return String::length_offset();
+  }
+  if (owner_name.Equals(
+          String::Handle(String::NewSymbol(kGrowableArrayClassName)))) {
+    return GrowableArrayFieldOffset(receiver_class,
+                                    kGrowableArrayLengthFieldName);
+  }
+  return -1;
+}
+
+
+// Implicit getters and setters, and the length getters of arrays and strings,
+// are inlined when all receiver classes seen share the same target.
+intptr_t FlowGraphCompiler::ImplicitAccessorFieldOffset(
+    InstanceCallInstr* instr,
+    GrowableArray<const Class*>* classes) const {
+  const bool is_getter = (instr->token_kind() == Token::kGET);
+  if (!is_getter && (instr->token_kind() != Token::kSET)) return -1;
+  const ICData& ic_data = instr->ic_data();
+  if (ic_data.NumberOfChecks() == 0) return -1;
+  Function& target = Function::Handle();
+  Function& unique_target = Function::Handle();
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
+    Class& cls = Class::ZoneHandle();
+    ic_data.GetOneClassCheckAt(i, &cls, &target);
+    if (cls.raw() == smi_class_.raw()) return -1;
+    if (!unique_target.IsNull() && (unique_target.raw() != target.raw())) {
+      return -1;
+    }
+    unique_target = target.raw();
+    classes->Add(&cls);
+  }
+  if (is_getter) {
+    const intptr_t length_offset =
+        LengthGetterOffset(unique_target, *(*classes)[0]);
+    if (length_offset >= 0) return length_offset;
+  }
+  const RawFunction::Kind accessor_kind = is_getter ?
+      RawFunction::kImplicitGetter : RawFunction::kImplicitSetter;
+  if (unique_target.kind() != accessor_kind) return -1;
+  const String& field_name = String::Handle(
+      Field::NameFromGetter(String::Handle(unique_target.name())));
+  return GetFieldOffset(*(*classes)[0], field_name);
+}
+
+
+void FlowGraphCompiler::GenerateImplicitAccessor(InstanceCallInstr* instr) {
+  const bool is_getter = (instr->token_kind() == Token::kGET);
+  GrowableArray<const Class*> classes;
+  const intptr_t offset = ImplicitAccessorFieldOffset(instr, &classes);
+  ASSERT(offset >= 0);
+  Label* deopt = AddDeoptimizationStub(
+      instr,
+      is_getter ? kDeoptInstanceGetterSameTarget
+                : kDeoptInstanceSetterSameTarget);
+  LoadValue(RAX, instr->ArgumentAt(0));
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(ZERO, deopt);
+  __ movq(RBX, FieldAddress(RAX, Object::class_offset()));
+  Label class_ok;
+  for (intptr_t i = 0; i < classes.length(); i++) {
+    __ CompareObject(RBX, *classes[i]);
+    if (i == (classes.length() - 1)) {
+      __ j(NOT_EQUAL, deopt);
+    } else {
+      __ j(EQUAL, &class_ok);
+    }
+  }
+  __ Bind(&class_ok);
+  if (is_getter) {
+    __ movq(RAX, FieldAddress(RAX, offset));
+    StoreResult(instr, RAX);
+  } else {
+    LoadValue(RCX, instr->ArgumentAt(1));
+    __ StoreIntoObject(RAX, FieldAddress(RAX, offset), RCX);
+    // The result of a setter call is not used by the unoptimized code.
+    StoreResult(instr, RCX);
+  }
+}
+
+
+// Dispatches on the receiver classes seen by the unoptimized code and calls
+// the targets directly.
+void FlowGraphCompiler::GenerateCheckedInstanceCalls(InstanceCallInstr* instr) {
+  const ICData& ic_data = instr->ic_data();
+  const intptr_t num_args = instr->ArgumentCount();
+  const Array& argument_names = instr->argument_names();
+  const int num_named_args =
+      argument_names.IsNull() ? 0 : argument_names.Length();
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const Function& target_for_null = Function::ZoneHandle(
+      Resolver::ResolveDynamicForReceiverClass(
+          Class::Handle(object_store->object_class()),
+          String::Handle(ic_data.FunctionName()),
+          num_args,
+          num_named_args));
+  GrowableArray<const Class*> classes;
+  GrowableArray<const Function*> targets;
+  // Make Smi class the first one, if it is in the list.
+  codegen_->NormalizeClassChecks(ic_data, target_for_null, &classes, &targets);
+  ASSERT(!classes.is_empty());
+  Label* deopt =
+      AddDeoptimizationStub(instr, kDeoptCheckedInstanceCallCheckFail);
+  for (intptr_t i = 0; i < num_args; i++) {
+    PushValue(instr->ArgumentAt(i));
+  }
+  Label done;
+  intptr_t start_index = 0;
+  __ movq(RAX, Address(RSP, (num_args - 1) * kWordSize));  // Receiver.
+  __ testq(RAX, Immediate(kSmiTagMask));
+  if (classes[0]->raw() == smi_class_.raw()) {
+    start_index++;
+    if (classes.length() == 1) {
+      __ j(NOT_ZERO, deopt);
+    } else {
+      Label not_smi;
+      __ j(NOT_ZERO, &not_smi);
+      codegen_->GenerateDirectCall(instr->node_id(),
+                                   instr->token_index(),
+                                   *targets[0],
+                                   num_args,
+                                   argument_names);
+      __ jmp(&done);
+      __ Bind(&not_smi);
+    }
+  } else {
+    __ j(ZERO, deopt);
+  }
+  if (start_index < classes.length()) {
+    __ movq(RAX, FieldAddress(RAX, Object::class_offset()));
+  }
+  for (intptr_t i = start_index; i < classes.length(); i++) {
+    __ CompareObject(RAX, *classes[i]);
+    if (i == (classes.length() - 1)) {
+      __ j(NOT_EQUAL, deopt);
+      codegen_->GenerateDirectCall(instr->node_id(),
+                                   instr->token_index(),
+                                   *targets[i],
+                                   num_args,
+                                   argument_names);
+    } else {
+      Label next;
+      __ j(NOT_EQUAL, &next);
+      codegen_->GenerateDirectCall(instr->node_id(),
+                                   instr->token_index(),
+                                   *targets[i],
+                                   num_args,
+                                   argument_names);
+      __ jmp(&done);
+      __ Bind(&next);
+    }
+  }
+  if (start_index == classes.length()) {
+    codegen_->GenerateDirectCall(instr->node_id(),
+                                 instr->token_index(),
+                                 *targets[0],
+                                 num_args,
+                                 argument_names);
+  }
+  __ Bind(&done);
+  StoreResult(instr, RAX);
+}
+
+
+// Instance calls are specialized for the classes seen by the unoptimized code
+// if they may deoptimize, otherwise they use an inline cache.
+void FlowGraphCompiler::VisitInstanceCall(InstanceCallInstr* instr) {
+  if ((instr->env() != NULL) && (instr->ic_data().NumberOfChecks() > 0)) {
+    if (IsSmiRelationalCompare(instr)) {
+      GenerateConditionResult(instr, GenerateSmiRelationalCompare(instr));
+      return;
+    }
+    GrowableArray<const Class*> classes;
+    if (IsSmiBinaryOp(instr)) {
+      GenerateSmiBinaryOp(instr);
+    } else if (IsDoubleBinaryOp(instr)) {
+      GenerateDoubleBinaryOp(instr);
+    } else if (IsSmiUnaryOp(instr)) {
+      GenerateSmiUnaryOp(instr);
+    } else if (IsInlinedLoadIndexed(instr)) {
+      GenerateLoadIndexed(instr);
+    } else if (IsInlinedStoreIndexed(instr)) {
+      GenerateStoreIndexed(instr);
+    } else if (ImplicitAccessorFieldOffset(instr, &classes) >= 0) {
+      GenerateImplicitAccessor(instr);
+    } else {
+      GenerateCheckedInstanceCalls(instr);
+    }
+    return;
+  }
+  for (intptr_t i = 0; i < instr->ArgumentCount(); i++) {
+    PushValue(instr->ArgumentAt(i));
+  }
+  codegen_->GenerateInstanceCall(instr->node_id(),
+                                 instr->token_index(),
+                                 instr->function_name(),
+                                 instr->ArgumentCount(),
+                                 instr->argument_names(),
+                                 instr->checked_argument_count());
+  StoreResult(instr, RAX);
+}
+
+}  // namespace dart
+
+#endif  // defined TARGET_ARCH_X64
@@ -0,0 +1,115 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_FLOW_GRAPH_COMPILER_X64_H_
+#define VM_FLOW_GRAPH_COMPILER_X64_H_
+
+#include "vm/assembler.h"
+#include "vm/code_generator.h"
+#include "vm/flow_graph_allocator.h"
+#include "vm/growable_array.h"
+#include "vm/intermediate_language.h"
+
+namespace dart {
+
+class OptimizingCodeGenerator;
+
+// Generates optimized code from a flow graph. Runs inside the optimizing code
+// generator after the entry code of the function has been generated, and
+// uses it for calls, descriptors and deoptimization.
+//
+// Every value used by another instruction lives in a register or in a spill
+// slot below the stack locals, as assigned by the FlowGraphAllocator. Values
+// live across calls are in spill slots, and deoptimization rebuilds the frame
+// of the unoptimized code from the locations of the values of the environment
+// of the instruction.
+class FlowGraphCompiler : public FlowGraphVisitor {
+ public:
+  FlowGraphCompiler(OptimizingCodeGenerator* codegen, FlowGraph* graph);
+
+  void CompileGraph();
+
+#define DECLARE_VISIT_INSTRUCTION(type)                                        \
+  virtual void Visit##type(type##Instr* instr);
+FOR_EACH_INSTRUCTION(DECLARE_VISIT_INSTRUCTION)
+#undef DECLARE_VISIT_INSTRUCTION
+
+ private:
+  class BlockInfo;
+  class DeoptimizationStub;
+
+  Assembler* assembler() const;
+
+  // Returns true if the code generated for 'instr' calls out.
+  bool IsCall(Instruction* instr) const;
+  void MarkCalls();
+
+  bool HasLocation(Definition* defn) const;
+  bool HasRegister(Definition* defn) const;
+  Register RegisterOf(Definition* defn) const;
+  Address SpillSlotAddress(Definition* defn) const;
+  bool IsSameLocation(Definition* a, Definition* b) const;
+
+  void LoadValue(Register dst, Definition* value);
+  void PushValue(Definition* value);
+  void PopValue(Definition* defn);
+  void StoreResult(Definition* defn, Register src);
+
+  Label* BlockLabel(BlockEntryInstr* block);
+  bool IsNextBlock(BlockEntryInstr* block) const;
+
+  // Returns the label jumped to for deoptimizing at 'instr'.
+  Label* AddDeoptimizationStub(Instruction* instr, DeoptReasonId reason);
+  void GenerateDeoptimizationStub(DeoptimizationStub* stub);
+
+  // Comparisons either branch directly on the condition they compute, if
+  // they are only used by the branch following them, or produce a Bool.
+  bool IsFusedWithBranch(Definition* defn) const;
+  void GenerateConditionResult(Definition* defn, Condition true_condition);
+  void GenerateBranch(BranchInstr* branch, Condition true_condition);
+
+  // Instance calls specialized for the classes seen by the unoptimized code.
+  // All but the double operations are generated without calling out.
+  bool IsSmiRelationalCompare(InstanceCallInstr* instr) const;
+  Condition GenerateSmiRelationalCompare(InstanceCallInstr* instr);
+  bool IsSmiBinaryOp(InstanceCallInstr* instr) const;
+  void GenerateSmiBinaryOp(InstanceCallInstr* instr);
+  bool IsDoubleBinaryOp(InstanceCallInstr* instr) const;
+  void GenerateDoubleBinaryOp(InstanceCallInstr* instr);
+  bool IsSmiUnaryOp(InstanceCallInstr* instr) const;
+  void GenerateSmiUnaryOp(InstanceCallInstr* instr);
+  bool IsInlinedLoadIndexed(InstanceCallInstr* instr) const;
+  void GenerateLoadIndexed(InstanceCallInstr* instr);
+  bool IsInlinedStoreIndexed(InstanceCallInstr* instr) const;
+  void GenerateStoreIndexed(InstanceCallInstr* instr);
+  // Returns the offset of the field accessed by an implicit getter or setter
+  // that can be inlined and collects the receiver classes, -1 otherwise.
+  intptr_t ImplicitAccessorFieldOffset(
+      InstanceCallInstr* instr,
+      GrowableArray<const Class*>* classes) const;
+  void GenerateImplicitAccessor(InstanceCallInstr* instr);
+  void GenerateCheckedInstanceCalls(InstanceCallInstr* instr);
+  bool IsSmiEqualityCompare(EqualityCompareInstr* instr) const;
+  void LoadClassOf(Register instance, Register dst);
+  void GenerateClassCheck(Register instance,
+                          const Class& cls,
+                          Register temp,
+                          Label* deopt);
+
+  OptimizingCodeGenerator* codegen_;
+  FlowGraph* graph_;
+  FlowGraphAllocator allocator_;
+  GrowableArray<BlockInfo*> block_info_;
+  intptr_t current_block_index_;
+  BlockEntryInstr* current_block_;
+  GrowableArray<DeoptimizationStub*> deoptimization_stubs_;
+  const Class& smi_class_;
+  const Class& double_class_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowGraphCompiler);
+};
+
+}  // namespace dart
+
+#endif  // VM_FLOW_GRAPH_COMPILER_X64_H_
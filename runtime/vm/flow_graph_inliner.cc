@@ -0,0 +1,594 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/flow_graph_inliner.h"
+
+#include "vm/ast.h"
+#include "vm/compiler.h"
+#include "vm/flags.h"
+#include "vm/flow_graph_builder.h"
+#include "vm/object_store.h"
+#include "vm/os.h"
+#include "vm/parser.h"
+#include "vm/scopes.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, use_inlining, true, "Inline calls in optimized code.");
+DEFINE_FLAG(bool, trace_inlining, false, "Trace inlining decisions.");
+DEFINE_FLAG(int, inlining_size_threshold, 25,
+    "Maximum number of instructions of an inlined function.");
+DEFINE_FLAG(int, inlining_caller_size_threshold, 500,
+    "Stop inlining into a function once it has this many instructions.");
+DEFINE_FLAG(int, inlining_depth_threshold, 3,
+    "Maximum depth of nested inlining.");
+DEFINE_FLAG(int, max_polymorphic_inlining, 4,
+    "Maximum number of receiver classes of an inlined instance call.");
+DECLARE_FLAG(int, deoptimization_counter_threshold);
+DECLARE_FLAG(bool, print_flow_graph);
+
+
+FlowGraphInliner::FlowGraphInliner(FlowGraph* graph, const Function& function)
+    : graph_(graph),
+      depth_(0),
+      size_budget_(FLAG_inlining_caller_size_threshold),
+      size_(0),
+      inlining_stack_(&root_stack_),
+      root_stack_(4) {
+  root_stack_.Add(&function);
+}
+
+
+FlowGraphInliner::FlowGraphInliner(
+    FlowGraph* graph,
+    intptr_t depth,
+    intptr_t size_budget,
+    GrowableArray<const Function*>* inlining_stack)
+    : graph_(graph),
+      depth_(depth),
+      size_budget_(size_budget),
+      size_(0),
+      inlining_stack_(inlining_stack),
+      root_stack_(0) {
+}
+
+
+static intptr_t InstructionCount(FlowGraph* graph) {
+  intptr_t count = 0;
+  const GrowableArray<BlockEntryInstr*>& blocks = graph->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    for (Instruction* instr = blocks[i]->next();
+         instr != NULL;
+         instr = instr->next()) {
+      count++;
+    }
+  }
+  return count;
+}
+
+
+static BlockEntryInstr* BlockOf(Instruction* instr) {
+  while (!instr->IsBlockEntry()) {
+    instr = instr->previous();
+  }
+  return instr->AsBlockEntry();
+}
+
+
+static Instruction* AppendTo(Instruction* tail, Instruction* instr) {
+  tail->set_next(instr);
+  instr->set_previous(tail);
+  return instr;
+}
+
+
+static void TraceInlining(const Function& target, const char* message) {
+  if (FLAG_trace_inlining) {
+    OS::Print("Inlining '%s': %s\n",
+              target.ToFullyQualifiedCString(),
+              message);
+  }
+}
+
+
+static bool IsNumberOperatorKind(Token::Kind kind) {
+  switch (kind) {
+    case Token::kADD:
+    case Token::kSUB:
+    case Token::kMUL:
+    case Token::kDIV:
+    case Token::kTRUNCDIV:
+    case Token::kMOD:
+    case Token::kBIT_AND:
+    case Token::kBIT_OR:
+    case Token::kBIT_XOR:
+    case Token::kSHL:
+    case Token::kSAR:
+    case Token::kSHR:
+    case Token::kNEGATE:
+    case Token::kBIT_NOT:
+      return true;
+    default:
+      return Token::IsRelationalOperator(kind);
+  }
+}
+
+
+// Returns true if all classes checked by 'ic_data' are the Smi class, or also
+// the Double class if 'allow_double'.
+static bool HasOnlyNumberClasses(const ICData& ic_data, bool allow_double) {
+  if (ic_data.NumberOfChecks() == 0) return false;
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  const Class& smi_class = Class::Handle(object_store->smi_class());
+  const Class& double_class = Class::Handle(object_store->double_class());
+  Function& target = Function::Handle();
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
+    GrowableArray<const Class*> classes;
+    ic_data.GetCheckAt(i, &classes, &target);
+    for (intptr_t j = 0; j < classes.length(); j++) {
+      const bool is_number = (classes[j]->raw() == smi_class.raw()) ||
+          (allow_double && (classes[j]->raw() == double_class.raw()));
+      if (!is_number) return false;
+    }
+  }
+  return true;
+}
+
+
+static bool HasOnlyImplicitGetterTargets(const ICData& ic_data) {
+  if (ic_data.NumberOfChecks() == 0) return false;
+  Function& target = Function::Handle();
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
+    GrowableArray<const Class*> classes;
+    ic_data.GetCheckAt(i, &classes, &target);
+    if (target.kind() != RawFunction::kImplicitGetter) return false;
+  }
+  return true;
+}
+
+
+// Conservatively returns true unless 'instr' is known to have no side effect
+// when it is compiled with its environment: the code generator then
+// deoptimizes for receivers of classes not seen by the unoptimized code.
+static bool MayHaveSideEffect(Instruction* instr) {
+  if (instr->IsInstanceCall()) {
+    InstanceCallInstr* call = instr->AsInstanceCall();
+    if (IsNumberOperatorKind(call->token_kind())) {
+      return !HasOnlyNumberClasses(call->ic_data(), true);
+    }
+    if (call->token_kind() == Token::kGET) {
+      return !HasOnlyImplicitGetterTargets(call->ic_data());
+    }
+    return true;
+  }
+  if (instr->IsEqualityCompare()) {
+    // Only Smi equality is compared inline.
+    return !HasOnlyNumberClasses(instr->AsEqualityCompare()->ic_data(), false);
+  }
+  return instr->IsStaticCall() ||
+         instr->IsStoreInstanceField() ||
+         instr->IsStoreStaticField() ||
+         instr->IsThrow();
+}
+
+
+// Collects the phis and instructions of 'callee' in block order and whether
+// each of them may follow a side effect of the callee.
+static void CollectInstructions(FlowGraph* callee,
+                                GrowableArray<Instruction*>* instructions,
+                                GrowableArray<bool>* follows_side_effect) {
+  const GrowableArray<BlockEntryInstr*>& blocks = callee->reverse_postorder();
+  // Whether the end of each block may follow a side effect. Back edges are
+  // not known yet when the header of a loop is visited.
+  GrowableArray<bool> block_after_side_effect(blocks.length());
+  block_after_side_effect.Add(false);
+  for (intptr_t i = 1; i < blocks.length(); i++) {
+    BlockEntryInstr* block = blocks[i];
+    bool side_effect = false;
+    for (intptr_t j = 0; j < block->PredecessorCount(); j++) {
+      const intptr_t predecessor_id = block->PredecessorAt(j)->block_id();
+      if ((predecessor_id >= i) || block_after_side_effect[predecessor_id]) {
+        side_effect = true;
+      }
+    }
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        instructions->Add(join->PhiAt(j));
+        follows_side_effect->Add(side_effect);
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      instructions->Add(instr);
+      follows_side_effect->Add(side_effect);
+      if (MayHaveSideEffect(instr)) side_effect = true;
+    }
+    block_after_side_effect.Add(side_effect);
+  }
+}
+
+
+// Class checks of calls inlined in 'callee' must be able to deoptimize, they
+// may not follow a side effect.
+static bool CanDeoptimizeToCall(FlowGraph* callee) {
+  GrowableArray<Instruction*> instructions;
+  GrowableArray<bool> follows_side_effect;
+  CollectInstructions(callee, &instructions, &follows_side_effect);
+  for (intptr_t i = 0; i < instructions.length(); i++) {
+    if (instructions[i]->IsCheckClass() && follows_side_effect[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Prepares the code of 'callee' to replace 'call': its parameters are
+// replaced by the arguments of the call and its instructions deoptimize to
+// the call and are attributed to it in the descriptors.
+static void AdaptBody(FlowGraph* callee,
+                      Definition* call,
+                      intptr_t token_index) {
+  const intptr_t parameter_count = callee->parameter_count();
+  GrowableArray<Instruction*> instructions;
+  GrowableArray<bool> follows_side_effect;
+  CollectInstructions(callee, &instructions, &follows_side_effect);
+  for (intptr_t i = 0; i < instructions.length(); i++) {
+    Instruction* instr = instructions[i];
+    for (intptr_t j = 0; j < instr->InputCount(); j++) {
+      ParameterInstr* parameter = instr->InputAt(j)->AsParameter();
+      if ((parameter != NULL) && (parameter->replacement() == NULL)) {
+        const intptr_t index = 1 + parameter_count - parameter->frame_index();
+        parameter->set_replacement(call->InputAt(index));
+      }
+    }
+    if (instr->env() != NULL) {
+      ASSERT(!instr->IsCheckClass() || !follows_side_effect[i]);
+      instr->set_env(follows_side_effect[i] ? NULL : call->env());
+    }
+    if (instr->IsInstanceCall()) {
+      instr->AsInstanceCall()->set_node_id(AstNode::kNoId);
+      instr->AsInstanceCall()->set_token_index(token_index);
+    } else if (instr->IsEqualityCompare()) {
+      instr->AsEqualityCompare()->set_node_id(AstNode::kNoId);
+      instr->AsEqualityCompare()->set_token_index(token_index);
+    } else if (instr->IsStaticCall()) {
+      instr->AsStaticCall()->set_token_index(token_index);
+    } else if (instr->IsCreateArray()) {
+      instr->AsCreateArray()->set_token_index(token_index);
+    } else if (instr->IsAllocateObject()) {
+      instr->AsAllocateObject()->set_token_index(token_index);
+    }
+  }
+}
+
+
+FlowGraph* FlowGraphInliner::BuildCalleeGraph(const Function& target,
+                                              intptr_t argument_count) {
+  if ((target.num_optional_parameters() > 0) ||
+      (target.num_fixed_parameters() != argument_count)) {
+    TraceInlining(target, "optional parameters");
+    return NULL;
+  }
+  if (!target.is_optimizable() ||
+      (target.deoptimization_counter() >=
+       FLAG_deoptimization_counter_threshold)) {
+    TraceInlining(target, "not optimizable");
+    return NULL;
+  }
+  const Code& unoptimized_code = Code::Handle(target.unoptimized_code());
+  if (unoptimized_code.IsNull()) {
+    TraceInlining(target, "not compiled");
+    return NULL;
+  }
+  // The code generator recognizes many functions of the core libraries, or
+  // they are native.
+  const Library& library =
+      Library::Handle(Class::Handle(target.owner()).library());
+  if ((library.raw() == Library::CoreLibrary()) ||
+      (library.raw() == Library::CoreImplLibrary())) {
+    TraceInlining(target, "core library");
+    return NULL;
+  }
+  for (intptr_t i = 0; i < inlining_stack_->length(); i++) {
+    if ((*inlining_stack_)[i]->raw() == target.raw()) {
+      TraceInlining(target, "recursive");
+      return NULL;
+    }
+  }
+
+  ParsedFunction parsed_function(target);
+  Parser::ParseFunction(&parsed_function);
+  Compiler::ExtractTypeFeedback(unoptimized_code,
+                                parsed_function.node_sequence());
+  // Allocates the frame indices of the parameters and locals as the entry
+  // code of the unoptimized code does.
+  LocalScope* scope = parsed_function.node_sequence()->scope();
+  LocalScope* context_owner = NULL;
+  const intptr_t first_free_frame_index =
+      scope->AllocateVariables(1 + argument_count,
+                               argument_count,
+                               -1,
+                               scope,
+                               &context_owner);
+  if (context_owner != NULL) {
+    TraceInlining(target, "context");
+    return NULL;
+  }
+  FlowGraphBuilder builder(parsed_function, -1 - first_free_frame_index);
+  FlowGraph* callee = builder.BuildGraph();
+  if (callee == NULL) {
+    TraceInlining(target, "no flow graph");
+    return NULL;
+  }
+
+  inlining_stack_->Add(&target);
+  FlowGraphInliner inliner(callee,
+                           depth_ + 1,
+                           FLAG_inlining_size_threshold,
+                           inlining_stack_);
+  inliner.Inline();
+  inlining_stack_->RemoveLast();
+
+  if (InstructionCount(callee) > FLAG_inlining_size_threshold) {
+    TraceInlining(target, "too large");
+    return NULL;
+  }
+  // Inlined code has no frame to throw from, and code following a call that
+  // never returns would be unreachable.
+  const GrowableArray<BlockEntryInstr*>& blocks = callee->reverse_postorder();
+  bool returns = false;
+  for (intptr_t i = 1; i < blocks.length(); i++) {
+    Instruction* last = blocks[i]->last_instruction();
+    if (last->IsThrow()) {
+      TraceInlining(target, "throws");
+      return NULL;
+    }
+    if (last->IsReturn()) returns = true;
+  }
+  if (!returns) {
+    TraceInlining(target, "never returns");
+    return NULL;
+  }
+  if (!CanDeoptimizeToCall(callee)) {
+    TraceInlining(target, "class check after side effect");
+    return NULL;
+  }
+  return callee;
+}
+
+
+JoinEntryInstr* FlowGraphInliner::SplitAtCall(Definition* call) {
+  BlockEntryInstr* block = BlockOf(call);
+  JoinEntryInstr* exit = new JoinEntryInstr();
+  Instruction* last = block->last_instruction();
+  for (intptr_t i = 0; i < last->SuccessorCount(); i++) {
+    last->SuccessorAt(i)->ReplacePredecessor(block, exit);
+  }
+  AppendTo(exit, call->next());
+  exit->set_last_instruction(last);
+  call->previous()->set_next(NULL);
+  block->set_last_instruction(NULL);
+  return exit;
+}
+
+
+void FlowGraphInliner::InsertBody(FlowGraph* callee,
+                                  BlockEntryInstr* block,
+                                  Instruction* tail,
+                                  JoinEntryInstr* exit,
+                                  GrowableArray<Definition*>* results) {
+  const GrowableArray<BlockEntryInstr*>& blocks = callee->reverse_postorder();
+  for (intptr_t i = 1; i < blocks.length(); i++) {
+    ReturnInstr* ret = blocks[i]->last_instruction()->AsReturn();
+    if (ret == NULL) continue;
+    GotoInstr* goto_exit = new GotoInstr(exit);
+    AppendTo(ret->previous(), goto_exit);
+    blocks[i]->set_last_instruction(goto_exit);
+    exit->AddPredecessor(blocks[i]);
+    results->Add(ret->value());
+  }
+  // The code of the entry of the callee continues the block of the call.
+  TargetEntryInstr* entry = callee->graph_entry()->normal_entry();
+  Instruction* last = entry->last_instruction();
+  for (intptr_t i = 0; i < last->SuccessorCount(); i++) {
+    last->SuccessorAt(i)->ReplacePredecessor(entry, block);
+  }
+  AppendTo(tail, entry->next());
+  block->set_last_instruction(last);
+}
+
+
+void FlowGraphInliner::ReplaceCall(Definition* call,
+                                   JoinEntryInstr* exit,
+                                   const GrowableArray<Definition*>& results) {
+  ASSERT(results.length() == exit->PredecessorCount());
+  Definition* value = results[0]->Resolve();
+  for (intptr_t i = 1; i < results.length(); i++) {
+    if (results[i]->Resolve() != value) {
+      PhiInstr* phi = new PhiInstr(exit);
+      for (intptr_t j = 0; j < results.length(); j++) {
+        phi->AddInput(results[j]);
+      }
+      exit->AddPhi(phi);
+      value = phi;
+      break;
+    }
+  }
+  call->set_replacement(value);
+}
+
+
+bool FlowGraphInliner::TryInlineStaticCall(StaticCallInstr* call) {
+  if ((call->env() == NULL) || !call->argument_names().IsNull()) {
+    return false;
+  }
+  const Function& target = call->function();
+  FlowGraph* callee = BuildCalleeGraph(target, call->ArgumentCount());
+  if (callee == NULL) return false;
+  const intptr_t callee_size = InstructionCount(callee);
+  if (size_ + callee_size > size_budget_) {
+    TraceInlining(target, "size budget exhausted");
+    return false;
+  }
+  TraceInlining(target, "inlined static call");
+  AdaptBody(callee, call, call->token_index());
+  BlockEntryInstr* block = BlockOf(call);
+  Instruction* tail = call->previous();
+  JoinEntryInstr* exit = SplitAtCall(call);
+  GrowableArray<Definition*> results;
+  InsertBody(callee, block, tail, exit, &results);
+  ReplaceCall(call, exit, results);
+  size_ += callee_size;
+  return true;
+}
+
+
+// The receiver is checked against the classes seen by the unoptimized code,
+// then the inlined targets are dispatched to by testing all but the last
+// class.
+bool FlowGraphInliner::TryInlineInstanceCall(InstanceCallInstr* call) {
+  const ICData& ic_data = call->ic_data();
+  if ((call->env() == NULL) ||
+      !call->argument_names().IsNull() ||
+      (ic_data.NumberOfChecks() == 0) ||
+      (ic_data.NumberOfChecks() > FLAG_max_polymorphic_inlining)) {
+    return false;
+  }
+  // The receiver classes and the index of their target. Checks of several
+  // arguments may list a receiver class several times.
+  GrowableArray<const Class*> classes;
+  GrowableArray<intptr_t> class_targets;
+  GrowableArray<const Function*> targets;
+  Function& target = Function::Handle();
+  for (intptr_t i = 0; i < ic_data.NumberOfChecks(); i++) {
+    GrowableArray<const Class*> check_classes;
+    ic_data.GetCheckAt(i, &check_classes, &target);
+    bool is_new_class = true;
+    for (intptr_t j = 0; j < classes.length(); j++) {
+      if (classes[j]->raw() == check_classes[0]->raw()) is_new_class = false;
+    }
+    if (!is_new_class) continue;
+    intptr_t target_index = -1;
+    for (intptr_t j = 0; j < targets.length(); j++) {
+      if (targets[j]->raw() == target.raw()) target_index = j;
+    }
+    if (target_index < 0) {
+      target_index = targets.length();
+      targets.Add(&Function::ZoneHandle(target.raw()));
+    }
+    classes.Add(&Class::ZoneHandle(check_classes[0]->raw()));
+    class_targets.Add(target_index);
+  }
+  GrowableArray<FlowGraph*> callees;
+  intptr_t callees_size = 0;
+  for (intptr_t i = 0; i < targets.length(); i++) {
+    FlowGraph* callee = BuildCalleeGraph(*targets[i], call->ArgumentCount());
+    if (callee == NULL) return false;
+    callees.Add(callee);
+    callees_size += InstructionCount(callee);
+  }
+  if (size_ + callees_size > size_budget_) {
+    TraceInlining(*targets[0], "size budget exhausted");
+    return false;
+  }
+  for (intptr_t i = 0; i < targets.length(); i++) {
+    TraceInlining(*targets[i], (targets.length() == 1)
+        ? "inlined monomorphic instance call"
+        : "inlined polymorphic instance call");
+    AdaptBody(callees[i], call, call->token_index());
+  }
+
+  Definition* receiver = call->ArgumentAt(0);
+  BlockEntryInstr* block = BlockOf(call);
+  Instruction* tail = call->previous();
+  JoinEntryInstr* exit = SplitAtCall(call);
+  CheckClassInstr* check = new CheckClassInstr(receiver, classes);
+  check->set_env(call->env());
+  tail = AppendTo(tail, check);
+  GrowableArray<Definition*> results;
+  if (targets.length() == 1) {
+    InsertBody(callees[0], block, tail, exit, &results);
+  } else {
+    GrowableArray<JoinEntryInstr*> entries;
+    for (intptr_t i = 0; i < targets.length(); i++) {
+      entries.Add(new JoinEntryInstr());
+    }
+    for (intptr_t i = 0; i < classes.length(); i++) {
+      JoinEntryInstr* entry = entries[class_targets[i]];
+      if (i == (classes.length() - 1)) {
+        block->set_last_instruction(AppendTo(tail, new GotoInstr(entry)));
+        entry->AddPredecessor(block);
+        break;
+      }
+      ClassTestInstr* test = new ClassTestInstr(receiver, *classes[i]);
+      tail = AppendTo(tail, test);
+      TargetEntryInstr* is_class = new TargetEntryInstr();
+      TargetEntryInstr* is_not_class = new TargetEntryInstr();
+      block->set_last_instruction(
+          AppendTo(tail, new BranchInstr(test, is_class, is_not_class)));
+      is_class->AddPredecessor(block);
+      is_not_class->AddPredecessor(block);
+      is_class->set_last_instruction(
+          AppendTo(is_class, new GotoInstr(entry)));
+      entry->AddPredecessor(is_class);
+      block = is_not_class;
+      tail = is_not_class;
+    }
+    for (intptr_t i = 0; i < targets.length(); i++) {
+      InsertBody(callees[i], entries[i], entries[i], exit, &results);
+    }
+  }
+  ReplaceCall(call, exit, results);
+  size_ += callees_size;
+  return true;
+}
+
+
+void FlowGraphInliner::Inline() {
+  if (!FLAG_use_inlining || (depth_ >= FLAG_inlining_depth_threshold)) {
+    return;
+  }
+  const Function& function = *(*inlining_stack_)[0];
+  if ((depth_ == 0) &&
+      (function.deoptimization_counter() >=
+       FLAG_deoptimization_counter_threshold)) {
+    // Inlined code deoptimizes the function.
+    return;
+  }
+  size_ = InstructionCount(graph_);
+  // The calls are collected first as inlining changes the blocks.
+  GrowableArray<Definition*> calls;
+  const GrowableArray<BlockEntryInstr*>& blocks = graph_->reverse_postorder();
+  for (intptr_t i = 0; i < blocks.length(); i++) {
+    for (Instruction* instr = blocks[i]->next();
+         instr != NULL;
+         instr = instr->next()) {
+      if (instr->IsStaticCall() || instr->IsInstanceCall()) {
+        calls.Add(instr->AsDefinition());
+      }
+    }
+  }
+  bool changed = false;
+  for (intptr_t i = 0; i < calls.length(); i++) {
+    if (size_ >= size_budget_) break;
+    Definition* call = calls[i];
+    if (call->IsStaticCall()) {
+      changed = TryInlineStaticCall(call->AsStaticCall()) || changed;
+    } else {
+      changed = TryInlineInstanceCall(call->AsInstanceCall()) || changed;
+    }
+  }
+  if (!changed) return;
+  graph_->Finalize();
+  if (FLAG_print_flow_graph && (depth_ == 0)) {
+    OS::Print("Flow graph of '%s' after inlining\n",
+              function.ToFullyQualifiedCString());
+    graph_->Print();
+  }
+}
+
+}  // namespace dart
@@ -0,0 +1,77 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_FLOW_GRAPH_INLINER_H_
+#define VM_FLOW_GRAPH_INLINER_H_
+
+#include "vm/allocation.h"
+#include "vm/growable_array.h"
+#include "vm/intermediate_language.h"
+
+namespace dart {
+
+// Replaces calls of a flow graph by the flow graphs of their targets.
+//
+// Static calls are inlined, and instance calls whose type feedback shows a
+// few receiver classes are replaced by a class check followed by a dispatch
+// on the receiver class to the inlined targets. The targets are inlined
+// recursively, up to a depth, and must be small once their own calls have
+// been inlined.
+//
+// Inlined code has no frame of its own: its instructions deoptimize to the
+// call in the unoptimized code of the function, which then performs the
+// call again. This is correct as long as the inlined code has not had any
+// side effect yet, so the instructions of the inlined code that may follow
+// a side effect lose their environment and are compiled without type
+// feedback.
+class FlowGraphInliner : public ValueObject {
+ public:
+  FlowGraphInliner(FlowGraph* graph, const Function& function);
+
+  void Inline();
+
+ private:
+  FlowGraphInliner(FlowGraph* graph,
+                   intptr_t depth,
+                   intptr_t size_budget,
+                   GrowableArray<const Function*>* inlining_stack);
+
+  // Returns the flow graph of 'target' with its own calls inlined, or NULL if
+  // 'target' cannot be inlined.
+  FlowGraph* BuildCalleeGraph(const Function& target, intptr_t argument_count);
+
+  bool TryInlineStaticCall(StaticCallInstr* call);
+  bool TryInlineInstanceCall(InstanceCallInstr* call);
+
+  // Removes 'call' from its block and moves the instructions following it to
+  // a new join, which is returned.
+  JoinEntryInstr* SplitAtCall(Definition* call);
+  // Moves the code of 'callee' after 'tail', the last instruction of the open
+  // block 'block'. The returns of 'callee' jump to 'exit' and their values
+  // are added to 'results'.
+  void InsertBody(FlowGraph* callee,
+                  BlockEntryInstr* block,
+                  Instruction* tail,
+                  JoinEntryInstr* exit,
+                  GrowableArray<Definition*>* results);
+  // Replaces the uses of 'call' by the value returned by the inlined code.
+  void ReplaceCall(Definition* call,
+                   JoinEntryInstr* exit,
+                   const GrowableArray<Definition*>& results);
+
+  FlowGraph* graph_;
+  const intptr_t depth_;
+  // Number of instructions the graph may grow to.
+  const intptr_t size_budget_;
+  intptr_t size_;
+  // The functions being inlined into, the outermost first.
+  GrowableArray<const Function*>* inlining_stack_;
+  GrowableArray<const Function*> root_stack_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowGraphInliner);
+};
+
+}  // namespace dart
+
+#endif  // VM_FLOW_GRAPH_INLINER_H_
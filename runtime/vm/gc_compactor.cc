@@ -0,0 +1,172 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/gc_compactor.h"
+
+#include <stdlib.h>
+
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/pages.h"
+#include "vm/raw_object.h"
+#include "vm/stack_frame.h"
+#include "vm/store_buffer.h"
+#include "vm/visitor.h"
+
+namespace dart {
+
+// Evacuated objects store their new address in their header word, using the
+// same encoding as the scavenger.
+enum {
+  kForwardingMask = 3,
+  kNotForwarded = 1,  // Tagged pointer.
+  kForwarded = 3,  // Tagged pointer and forwarding bit set.
+};
+
+
+static inline bool IsForwarding(uword header) {
+  uword bits = header & kForwardingMask;
+  ASSERT((bits == kNotForwarded) || (bits == kForwarded));
+  return bits == kForwarded;
+}
+
+
+static inline uword ForwardedAddr(uword header) {
+  ASSERT(IsForwarding(header));
+  return header & ~kForwardingMask;
+}
+
+
+static inline void ForwardTo(uword original, uword target) {
+  // Make sure forwarding can be encoded.
+  ASSERT((target & kForwardingMask) == 0);
+  *reinterpret_cast<uword*>(original) = target | kForwarded;
+}
+
+
+class ForwardPointersVisitor : public ObjectPointerVisitor {
+ public:
+  explicit ForwardPointersVisitor(GCCompactor* compactor)
+      : compactor_(compactor) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (!raw_obj->IsHeapObject() || raw_obj->IsNewObject()) {
+        continue;
+      }
+      if (!compactor_->IsEvacuated(raw_obj)) {
+        continue;
+      }
+      // Dead objects, e.g. in new space, may still refer to unmarked objects
+      // which were not moved.
+      uword header = *reinterpret_cast<uword*>(RawObject::ToAddr(raw_obj));
+      if (IsForwarding(header)) {
+        *current = RawObject::FromAddr(ForwardedAddr(header));
+      }
+    }
+  }
+
+ private:
+  GCCompactor* compactor_;
+
+  DISALLOW_COPY_AND_ASSIGN(ForwardPointersVisitor);
+};
+
+
+static int ComparePageStarts(const void* a, const void* b) {
+  uword start_a = *reinterpret_cast<const uword*>(a);
+  uword start_b = *reinterpret_cast<const uword*>(b);
+  if (start_a < start_b) {
+    return -1;
+  }
+  return (start_a > start_b) ? 1 : 0;
+}
+
+
+GCCompactor::GCCompactor(Heap* heap, PageSpace* page_space)
+    : heap_(heap),
+      page_space_(page_space),
+      page_starts_(NULL),
+      num_pages_(0) {
+}
+
+
+GCCompactor::~GCCompactor() {
+  delete[] page_starts_;
+}
+
+
+bool GCCompactor::IsEvacuated(RawObject* raw_obj) const {
+  // Evacuated pages are regular pages, which are aligned to their size.
+  uword page_start =
+      RawObject::ToAddr(raw_obj) & ~(PageSpace::kPageAlignment - 1);
+  intptr_t low = 0;
+  intptr_t high = num_pages_ - 1;
+  while (low <= high) {
+    intptr_t mid = low + ((high - low) / 2);
+    if (page_starts_[mid] == page_start) {
+      return true;
+    }
+    if (page_starts_[mid] < page_start) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return false;
+}
+
+
+intptr_t GCCompactor::EvacuatePage(HeapPage* page) {
+  intptr_t moved = 0;
+  uword top = page->top();
+  uword current = page->NextMarkedObject(page->first_object_start(), top);
+  while (current < top) {
+    intptr_t size = RawObject::FromAddr(current)->Size();
+    uword new_addr = page_space_->AllocateForEvacuation(size);
+    memmove(reinterpret_cast<void*>(new_addr),
+            reinterpret_cast<void*>(current),
+            size);
+    ForwardTo(current, new_addr);
+    moved += size;
+    current = page->NextMarkedObject(current + size, top);
+  }
+  ASSERT(moved == static_cast<intptr_t>(page->used()));
+  return moved;
+}
+
+
+void GCCompactor::UpdatePointers(Isolate* isolate) {
+  ForwardPointersVisitor visitor(this);
+  isolate->VisitObjectPointers(&visitor,
+                               StackFrameIterator::kDontValidateFrames);
+  isolate->store_buffer()->VisitObjectPointers(&visitor);
+  heap_->IterateNewPointers(&visitor);
+  // Also updates the pointers embedded in the instructions of the code space.
+  heap_->IterateOldPointers(&visitor);
+}
+
+
+intptr_t GCCompactor::EvacuatePages(Isolate* isolate, HeapPage* pages) {
+  ASSERT(page_starts_ == NULL);
+  for (HeapPage* page = pages; page != NULL; page = page->next()) {
+    num_pages_++;
+  }
+  page_starts_ = new uword[num_pages_];
+  intptr_t i = 0;
+  for (HeapPage* page = pages; page != NULL; page = page->next()) {
+    page_starts_[i++] = page->start();
+  }
+  qsort(page_starts_, num_pages_, sizeof(page_starts_[0]), ComparePageStarts);
+
+  intptr_t moved = 0;
+  for (HeapPage* page = pages; page != NULL; page = page->next()) {
+    moved += EvacuatePage(page);
+  }
+  UpdatePointers(isolate);
+  return moved;
+}
+
+}  // namespace dart
@@ -0,0 +1,52 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_GC_COMPACTOR_H_
+#define VM_GC_COMPACTOR_H_
+
+#include "vm/allocation.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class Heap;
+class HeapPage;
+class Isolate;
+class PageSpace;
+class RawObject;
+
+// The class GCCompactor is used after marking to evacuate the marked objects
+// of sparse pages into the remaining pages of the page space. Evacuated objects
+// are replaced by forwarding addresses and all pointers to them are updated,
+// after which the evacuated pages can be released.
+class GCCompactor : public ValueObject {
+ public:
+  GCCompactor(Heap* heap, PageSpace* page_space);
+  ~GCCompactor();
+
+  // Evacuate the list of 'pages', which have been removed from the page space
+  // but not swept yet. Returns the number of bytes moved.
+  intptr_t EvacuatePages(Isolate* isolate, HeapPage* pages);
+
+  // Returns true if 'raw_obj' is located in one of the evacuated pages.
+  bool IsEvacuated(RawObject* raw_obj) const;
+
+ private:
+  intptr_t EvacuatePage(HeapPage* page);
+  void UpdatePointers(Isolate* isolate);
+
+  Heap* heap_;
+  PageSpace* page_space_;
+
+  // Start addresses of the evacuated pages, sorted in increasing order.
+  uword* page_starts_;
+  intptr_t num_pages_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(GCCompactor);
+};
+
+}  // namespace dart
+
+#endif  // VM_GC_COMPACTOR_H_
@@ -5,16 +5,19 @@
 #include "vm/gc_marker.h"
 
 #include "vm/allocation.h"
+#include "vm/atomic.h"
 #include "vm/isolate.h"
+#include "vm/object.h"
 #include "vm/pages.h"
 #include "vm/raw_object.h"
 #include "vm/stack_frame.h"
+#include "vm/thread.h"
 #include "vm/visitor.h"
 
 namespace dart {
 
 // A simple chunked marking stack.
-class MarkingStack : public ValueObject {
+class MarkingStack {
  public:
   MarkingStack()
       : head_(new MarkingStackChunk()),
@@ -45,13 +48,7 @@ class MarkingStack : public ValueObject {
     marking_stack_[top_] = value;
     top_++;
     if (IsMarkingStackChunkFull()) {
-      MarkingStackChunk* new_chunk;
-      if (empty_chunks_ == NULL) {
-        new_chunk = new MarkingStackChunk();
-      } else {
-        new_chunk = empty_chunks_;
-        empty_chunks_ = new_chunk->next();
-      }
+      MarkingStackChunk* new_chunk = AllocateChunk();
       new_chunk->set_next(head_);
       head_ = new_chunk;
       marking_stack_ = head_->MarkingStackChunkMemory();
@@ -74,10 +71,9 @@ class MarkingStack : public ValueObject {
     return marking_stack_[top_];
   }
 
- private:
   class MarkingStackChunk {
    public:
-    MarkingStackChunk() : next_(NULL) {}
+    MarkingStackChunk() : next_(NULL), count_(0) {}
     ~MarkingStackChunk() {}
 
     RawObject** MarkingStackChunkMemory() {
@@ -87,15 +83,79 @@ class MarkingStack : public ValueObject {
     MarkingStackChunk* next() const { return next_; }
     void set_next(MarkingStackChunk* value) { next_ = value; }
 
+    // Number of objects in a chunk which is shared between marking stacks.
+    uint32_t count() const { return count_; }
+    void set_count(uint32_t value) { count_ = value; }
+
     static const uint32_t kMarkingStackChunkSize = 1024;
 
    private:
     RawObject* memory_[kMarkingStackChunkSize];
     MarkingStackChunk* next_;
+    uint32_t count_;
 
     DISALLOW_COPY_AND_ASSIGN(MarkingStackChunk);
   };
 
+  bool HasFullChunk() const {
+    return head_->next() != NULL;
+  }
+
+  // Detach a chunk to be marked by another marking task. A full chunk is
+  // detached if there is one, otherwise half of the objects in the current
+  // chunk are moved to a new chunk if 'split' is true. Returns NULL if there
+  // is no work to share. The stack is never left empty.
+  MarkingStackChunk* TakeChunk(bool split) {
+    if (HasFullChunk() && !IsMarkingStackChunkEmpty()) {
+      MarkingStackChunk* chunk = head_->next();
+      head_->set_next(chunk->next());
+      chunk->set_next(NULL);
+      chunk->set_count(MarkingStackChunk::kMarkingStackChunkSize);
+      return chunk;
+    }
+    if (!split || (top_ < 2)) {
+      return NULL;
+    }
+    MarkingStackChunk* chunk = AllocateChunk();
+    uint32_t count = top_ / 2;
+    top_ -= count;
+    memmove(chunk->MarkingStackChunkMemory(),
+            &marking_stack_[top_],
+            count * sizeof(marking_stack_[0]));
+    chunk->set_next(NULL);
+    chunk->set_count(count);
+    return chunk;
+  }
+
+  // Continue with a chunk detached from another marking stack. This stack
+  // must be empty.
+  void SetChunk(MarkingStackChunk* chunk) {
+    ASSERT(IsEmpty());
+    head_->set_next(empty_chunks_);
+    empty_chunks_ = head_;
+    head_ = chunk;
+    marking_stack_ = head_->MarkingStackChunkMemory();
+    top_ = chunk->count();
+    if (IsMarkingStackChunkFull()) {
+      // Keep the invariant that the current chunk is never full.
+      MarkingStackChunk* new_chunk = AllocateChunk();
+      new_chunk->set_next(head_);
+      head_ = new_chunk;
+      marking_stack_ = head_->MarkingStackChunkMemory();
+      top_ = 0;
+    }
+  }
+
+ private:
+  MarkingStackChunk* AllocateChunk() {
+    if (empty_chunks_ == NULL) {
+      return new MarkingStackChunk();
+    }
+    MarkingStackChunk* chunk = empty_chunks_;
+    empty_chunks_ = chunk->next();
+    return chunk;
+  }
+
   bool IsMarkingStackChunkFull() const {
     return top_ == MarkingStackChunk::kMarkingStackChunkSize;
   }
@@ -115,11 +175,17 @@ class MarkingStack : public ValueObject {
 
 class MarkingVisitor : public ObjectPointerVisitor {
  public:
-  MarkingVisitor(Heap* heap, PageSpace* page_space, MarkingStack* marking_stack)
+  MarkingVisitor(Heap* heap,
+                 PageSpace* page_space,
+                 MarkingStack* marking_stack,
+                 bool is_parallel = false)
       : heap_(heap),
         vm_heap_(Dart::vm_isolate()->heap()),
         page_space_(page_space),
-        marking_stack_(marking_stack) {
+        marking_stack_(marking_stack),
+        is_parallel_(is_parallel),
+        used_page_(NULL),
+        used_(0) {
     ASSERT(heap_ != vm_heap_);
   }
 
@@ -131,57 +197,89 @@ class MarkingVisitor : public ObjectPointerVisitor {
     }
   }
 
+  // Visit an object popped from the marking stack. Returns its size.
+  intptr_t VisitMarkedObject(RawObject* raw_obj) {
+    // TODO(iposva): Should we mark the classes early?
+    MarkObject(raw_obj->ptr()->class_);
+    intptr_t size = raw_obj->VisitPointers(this);
+    HeapPage* page = PageSpace::PageFor(raw_obj);
+    if (is_parallel_) {
+      // Pages are shared by the marking tasks. Collect the used bytes per page
+      // locally to avoid an atomic update for every marked object.
+      if (page != used_page_) {
+        FlushUsed();
+        used_page_ = page;
+      }
+      used_ += size;
+    } else {
+      // Update the number of used bytes on this page for fast accounting.
+      page->AddUsed(size);
+    }
+    return size;
+  }
+
+  // Account the bytes marked by a parallel marking task which have not been
+  // added to their page yet.
+  void FlushUsed() {
+    if (used_page_ != NULL) {
+      used_page_->AtomicAddUsed(used_);
+      used_page_ = NULL;
+      used_ = 0;
+    }
+  }
+
  private:
-  void MarkAndPush(RawObject* raw_obj) {
+  // Only the mark bits of the page are written, the object itself is first
+  // accessed once it is popped from the marking stack.
+  void MarkAndPush(RawObject* raw_obj, HeapPage* page) {
     ASSERT(raw_obj->IsHeapObject());
     ASSERT(page_space_->Contains(RawObject::ToAddr(raw_obj)));
 
-    // Mark the object and push it on the marking stack.
-    ASSERT(!raw_obj->IsMarked());
-    RawClass* raw_class = raw_obj->ptr()->class_;
-    raw_obj->SetMarkBit();
+    if (is_parallel_) {
+      // Another marking task may be marking the same object.
+      if (!page->TryAcquireMarkBit(raw_obj)) {
+        return;
+      }
+    } else {
+      page->SetMarkBit(raw_obj);
+    }
     marking_stack_->Push(raw_obj);
-
-    // Update the number of used bytes on this page for fast accounting.
-    HeapPage* page = PageSpace::PageFor(raw_obj);
-    page->AddUsed(raw_obj->Size());
-
-    // TODO(iposva): Should we mark the classes early?
-    MarkObject(raw_class);
   }
 
   void MarkObject(RawObject* raw_obj) {
     // Fast exit if the raw object is a Smi.
     if (!raw_obj->IsHeapObject()) return;
 
-    // Fast exit if the raw object is marked.
-    if (raw_obj->IsMarked()) return;
-
     // Skip over new objects, but verify consistency of heap while at it.
     if (raw_obj->IsNewObject()) {
       // TODO(iposva): Add consistency check.
       return;
     }
 
-    uword raw_addr = RawObject::ToAddr(raw_obj);
-    // TODO(iposva): Premark vm_isolate objects, to avoid this extra check here.
-    if (vm_heap_->Contains(raw_addr)) {
-      return;
-    }
-    // TODO(iposva): merge old and code spaces.
-    ASSERT(heap_->Contains(raw_addr));
-    if (!page_space_->Contains(raw_addr)) {
-      // TODO(iposva): Skip code space if marking data space and vice-versa.
+    // Old objects of all spaces, including those of the VM isolate, live in
+    // heap pages whose header records the owning space.
+    ASSERT(heap_->Contains(RawObject::ToAddr(raw_obj)) ||
+           vm_heap_->Contains(RawObject::ToAddr(raw_obj)));
+    HeapPage* page = PageSpace::PageFor(raw_obj);
+    if (page->owner() != page_space_) {
+      // Skip VM isolate objects and code space if marking data space and
+      // vice-versa.
       return;
     }
 
-    MarkAndPush(raw_obj);
+    // Fast exit if the raw object is marked.
+    if (page->IsMarked(raw_obj)) return;
+
+    MarkAndPush(raw_obj, page);
   }
 
   Heap* heap_;
   Heap* vm_heap_;
   PageSpace* page_space_;
   MarkingStack* marking_stack_;
+  bool is_parallel_;
+  HeapPage* used_page_;
+  uword used_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(MarkingVisitor);
 };
@@ -196,7 +294,7 @@ class MarkingWeakVisitor : public ObjectPointerVisitor {
     for (RawObject** current = first; current <= last; current++) {
       RawObject* raw_obj = *current;
       ASSERT(raw_obj->IsHeapObject());
-      if (!raw_obj->IsMarked() && raw_obj->IsOldObject()) {
+      if (raw_obj->IsOldObject() && !PageSpace::IsMarked(raw_obj)) {
         *current = Object::null();
       }
     }
@@ -207,6 +305,210 @@ class MarkingWeakVisitor : public ObjectPointerVisitor {
 };
 
 
+class ParallelMarking;
+
+
+// A marking task owns a marking stack. It shares chunks of the stack with
+// the other tasks and steals shared chunks once its stack is empty.
+class ParallelMarkingTask {
+ public:
+  ParallelMarkingTask(ParallelMarking* marking,
+                      Heap* heap,
+                      PageSpace* page_space)
+      : marking_(marking),
+        marking_stack_(),
+        visitor_(heap, page_space, &marking_stack_, true) {}
+
+  ParallelMarking* marking() const { return marking_; }
+  MarkingVisitor* visitor() { return &visitor_; }
+
+  // Mark until none of the tasks has any work left.
+  void Run();
+
+ private:
+  void ShareWork();
+
+  ParallelMarking* marking_;
+  MarkingStack marking_stack_;
+  MarkingVisitor visitor_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelMarkingTask);
+};
+
+
+// State shared by the tasks of a parallel marking phase. The first task runs
+// on the thread which started the collection, the others on helper threads.
+class ParallelMarking {
+ public:
+  ParallelMarking(Heap* heap,
+                  PageSpace* page_space,
+                  Monitor* tasks_monitor,
+                  intptr_t num_tasks)
+      : tasks_monitor_(tasks_monitor),
+        num_tasks_(num_tasks),
+        tasks_(new ParallelMarkingTask*[num_tasks]),
+        running_helpers_(0),
+        idle_tasks_(0),
+        mutex_(),
+        shared_chunks_(NULL),
+        shared_count_(0) {
+    ASSERT(num_tasks > 1);
+    for (intptr_t i = 0; i < num_tasks; i++) {
+      tasks_[i] = new ParallelMarkingTask(this, heap, page_space);
+    }
+  }
+
+  ~ParallelMarking() {
+    ASSERT(running_helpers_ == 0);
+    ASSERT(shared_chunks_ == NULL);
+    for (intptr_t i = 0; i < num_tasks_; i++) {
+      delete tasks_[i];
+    }
+    delete[] tasks_;
+  }
+
+  ParallelMarkingTask* task(intptr_t i) const {
+    ASSERT((i >= 0) && (i < num_tasks_));
+    return tasks_[i];
+  }
+
+  void StartHelpers();
+  void WaitForHelpers();
+  // Called by each helper once it is done. The helper must not access this
+  // object afterwards.
+  void HelperDone();
+
+  void ShareChunk(MarkingStack::MarkingStackChunk* chunk);
+  MarkingStack::MarkingStackChunk* TakeChunk();
+  bool HasSharedWork() const { return shared_count_ > 0; }
+  bool HasIdleTasks() const { return idle_tasks_ > 0; }
+
+  // Called by a task which ran out of work. Returns true as soon as work is
+  // shared, and false once all tasks have run out of work.
+  bool WaitForWork();
+
+ private:
+  Monitor* tasks_monitor_;
+  intptr_t num_tasks_;
+  ParallelMarkingTask** tasks_;
+
+  // Number of helpers which are still running, protected by tasks_monitor_.
+  intptr_t running_helpers_;
+  // Number of tasks waiting for work.
+  volatile intptr_t idle_tasks_;
+
+  // Chunks which can be stolen by any task, protected by mutex_.
+  Mutex mutex_;
+  MarkingStack::MarkingStackChunk* shared_chunks_;
+  volatile intptr_t shared_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelMarking);
+};
+
+
+void ParallelMarkingTask::ShareWork() {
+  // Full chunks are always shared. Part of the current chunk is given away
+  // when other tasks are waiting for work.
+  bool split = !marking_->HasSharedWork() && marking_->HasIdleTasks();
+  if (marking_stack_.HasFullChunk() || split) {
+    MarkingStack::MarkingStackChunk* chunk = marking_stack_.TakeChunk(split);
+    if (chunk != NULL) {
+      marking_->ShareChunk(chunk);
+    }
+  }
+}
+
+
+void ParallelMarkingTask::Run() {
+  do {
+    while (true) {
+      if (marking_stack_.IsEmpty()) {
+        MarkingStack::MarkingStackChunk* chunk = marking_->TakeChunk();
+        if (chunk == NULL) {
+          break;
+        }
+        marking_stack_.SetChunk(chunk);
+      } else {
+        ShareWork();
+      }
+      visitor_.VisitMarkedObject(marking_stack_.Pop());
+    }
+  } while (marking_->WaitForWork());
+  visitor_.FlushUsed();
+}
+
+
+static void ParallelMarkingHelper(uword parameter) {
+  ParallelMarkingTask* task = reinterpret_cast<ParallelMarkingTask*>(parameter);
+  task->Run();
+  task->marking()->HelperDone();
+}
+
+
+void ParallelMarking::StartHelpers() {
+  running_helpers_ = num_tasks_ - 1;
+  for (intptr_t i = 1; i < num_tasks_; i++) {
+    new Thread(ParallelMarkingHelper, reinterpret_cast<uword>(tasks_[i]));
+  }
+}
+
+
+void ParallelMarking::WaitForHelpers() {
+  MonitorLocker ml(tasks_monitor_);
+  while (running_helpers_ > 0) {
+    ml.Wait();
+  }
+}
+
+
+void ParallelMarking::HelperDone() {
+  MonitorLocker ml(tasks_monitor_);
+  running_helpers_--;
+  if (running_helpers_ == 0) {
+    ml.Notify();
+  }
+}
+
+
+void ParallelMarking::ShareChunk(MarkingStack::MarkingStackChunk* chunk) {
+  MutexLocker ml(&mutex_);
+  chunk->set_next(shared_chunks_);
+  shared_chunks_ = chunk;
+  shared_count_++;
+}
+
+
+MarkingStack::MarkingStackChunk* ParallelMarking::TakeChunk() {
+  if (!HasSharedWork()) {
+    return NULL;
+  }
+  MutexLocker ml(&mutex_);
+  MarkingStack::MarkingStackChunk* chunk = shared_chunks_;
+  if (chunk != NULL) {
+    shared_chunks_ = chunk->next();
+    shared_count_--;
+    chunk->set_next(NULL);
+  }
+  return chunk;
+}
+
+
+bool ParallelMarking::WaitForWork() {
+  AtomicOperations::FetchAndAdd(&idle_tasks_, 1);
+  // Work is only shared by tasks which are not idle. Once all tasks are idle
+  // marking is complete.
+  while (idle_tasks_ < num_tasks_) {
+    if (HasSharedWork()) {
+      AtomicOperations::FetchAndAdd(&idle_tasks_, -1);
+      return true;
+    }
+    // Let the busy tasks run if there are more tasks than processors.
+    OS::Sleep(0);
+  }
+  return false;
+}
+
+
 void GCMarker::Prologue(Isolate* isolate) {
   // Nothing to do at the moment.
 }
@@ -216,7 +518,8 @@ void GCMarker::IterateRoots(Isolate* isolate, ObjectPointerVisitor* visitor) {
   isolate->VisitStrongObjectPointers(visitor,
                                      StackFrameIterator::kDontValidateFrames);
   heap_->IterateNewPointers(visitor);
-  heap_->IterateCodePointers(visitor);
+  // The code space is not a root: instructions only point back to their code
+  // object, and are kept alive by it (see GCMarker::MarkInstructions).
 }
 
 
@@ -229,20 +532,119 @@ void GCMarker::IterateWeakRoots(Isolate* isolate,
 void GCMarker::DrainMarkingStack(Isolate* isolate,
                                  MarkingVisitor* visitor) {
   while (!visitor->marking_stack()->IsEmpty()) {
-    RawObject* raw_obj = visitor->marking_stack()->Pop();
-    raw_obj->VisitPointers(visitor);
+    visitor->VisitMarkedObject(visitor->marking_stack()->Pop());
   }
 }
 
 
+// Marks the instructions of the marked code objects, the others are freed by
+// sweeping the code space.
+class InstructionsMarker : public ObjectVisitor {
+ public:
+  InstructionsMarker() {}
+
+  void VisitObject(RawObject* raw_obj) {
+    if (raw_obj->IsFreeListElement()) {
+      return;
+    }
+    RawCode* raw_code =
+        reinterpret_cast<RawInstructions*>(raw_obj)->ptr()->code_;
+    // The code object of instructions which are being finalized is allocated
+    // after them.
+    if ((raw_code == Code::null()) || PageSpace::IsMarked(raw_code)) {
+      PageSpace::PageFor(raw_obj)->SetMarkBit(raw_obj);
+    }
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(InstructionsMarker);
+};
+
+
+void GCMarker::MarkInstructions(PageSpace* code_space) {
+  ASSERT(code_space->is_executable());
+  InstructionsMarker marker;
+  code_space->VisitObjects(&marker);
+}
+
+
+void GCMarker::MarkInParallel(Isolate* isolate,
+                              PageSpace* page_space,
+                              intptr_t num_tasks) {
+  ParallelMarking marking(heap_, page_space, page_space->tasks_monitor(),
+                          num_tasks);
+  marking.StartHelpers();
+  // The helpers steal the work shared while this thread visits the roots.
+  ParallelMarkingTask* task = marking.task(0);
+  IterateRoots(isolate, task->visitor());
+  task->Run();
+  marking.WaitForHelpers();
+}
+
+
 void GCMarker::MarkObjects(Isolate* isolate, PageSpace* page_space) {
-  MarkingStack marking_stack;
   Prologue(isolate);
-  MarkingVisitor mark(heap_, page_space, &marking_stack);
-  IterateRoots(isolate, &mark);
-  DrainMarkingStack(isolate, &mark);
+  if (FLAG_marker_tasks > 1) {
+    MarkInParallel(isolate, page_space, FLAG_marker_tasks);
+  } else {
+    MarkingStack marking_stack;
+    MarkingVisitor mark(heap_, page_space, &marking_stack);
+    IterateRoots(isolate, &mark);
+    DrainMarkingStack(isolate, &mark);
+  }
   MarkingWeakVisitor mark_weak;
   IterateWeakRoots(isolate, &mark_weak);
 }
 
+
+IncrementalMarker::IncrementalMarker(Heap* heap, PageSpace* page_space)
+    : marker_(heap),
+      page_space_(page_space),
+      marking_stack_(new MarkingStack()),
+      visitor_(new MarkingVisitor(heap, page_space, marking_stack_)) {
+}
+
+
+IncrementalMarker::~IncrementalMarker() {
+  // Marking may be abandoned when the heap is destroyed.
+  while (!marking_stack_->IsEmpty()) {
+    marking_stack_->Pop();
+  }
+  delete visitor_;
+  delete marking_stack_;
+}
+
+
+void IncrementalMarker::Start(Isolate* isolate) {
+  marker_.Prologue(isolate);
+  marker_.IterateRoots(isolate, visitor_);
+}
+
+
+bool IncrementalMarker::Step(intptr_t budget) {
+  page_space_->GreyAllocatedObjects(visitor_);
+  intptr_t visited = 0;
+  while (!marking_stack_->IsEmpty() && (visited < budget)) {
+    visited += visitor_->VisitMarkedObject(marking_stack_->Pop());
+  }
+  return marking_stack_->IsEmpty();
+}
+
+
+void IncrementalMarker::Finish(Isolate* isolate) {
+  // The roots were not tracked by the write barrier and have to be visited
+  // again. Black objects only point to marked objects, so draining the
+  // marking stack afterwards completes the marking.
+  marker_.IterateRoots(isolate, visitor_);
+  page_space_->GreyAllocatedObjects(visitor_);
+  marker_.DrainMarkingStack(isolate, visitor_);
+  MarkingWeakVisitor mark_weak;
+  marker_.IterateWeakRoots(isolate, &mark_weak);
+}
+
+
+void IncrementalMarker::MarkFromBarrier(RawObject* raw_obj) {
+  visitor_->VisitPointer(&raw_obj);
+}
+
 }  // namespace dart
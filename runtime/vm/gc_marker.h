@@ -6,15 +6,20 @@
 #define VM_GC_MARKER_H_
 
 #include "vm/allocation.h"
+#include "vm/flags.h"
 
 namespace dart {
 
 // Forward declarations.
 class Heap;
 class Isolate;
+class MarkingStack;
 class MarkingVisitor;
 class ObjectPointerVisitor;
 class PageSpace;
+class RawObject;
+
+DECLARE_FLAG(int, marker_tasks);
 
 // The class GCMarker is used to mark reachable old generation objects as part
 // of the mark-sweep collection. The marking bit used is defined in RawObject.
@@ -25,17 +30,62 @@ class GCMarker : public ValueObject {
 
   void MarkObjects(Isolate* isolate, PageSpace* page_space);
 
+  // Mark the instructions in 'code_space' whose code object is marked. Called
+  // after the data space has been marked.
+  void MarkInstructions(PageSpace* code_space);
+
  private:
   void Prologue(Isolate* isolate);
   void IterateRoots(Isolate* isolate, ObjectPointerVisitor* visitor);
   void IterateWeakRoots(Isolate* isolate, ObjectPointerVisitor* visitor);
   void DrainMarkingStack(Isolate* isolate, MarkingVisitor* visitor);
+  void MarkInParallel(Isolate* isolate,
+                      PageSpace* page_space,
+                      intptr_t num_tasks);
 
   Heap* heap_;
 
+  friend class IncrementalMarker;
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCMarker);
 };
 
+
+// The class IncrementalMarker marks the old generation in steps which are
+// interleaved with the execution of the mutator. Marked objects are black once
+// their pointers have been visited and grey while they are on the marking
+// stack. The write barrier greys old objects stored into old objects while
+// marking is active (see Heap::MarkingBarrier), and objects allocated during
+// marking are greyed by the page space before each step. The roots are only
+// visited once more in the final pause, which ends marking.
+class IncrementalMarker {
+ public:
+  IncrementalMarker(Heap* heap, PageSpace* page_space);
+  ~IncrementalMarker();
+
+  // Grey the objects directly reachable from the roots.
+  void Start(Isolate* isolate);
+
+  // Visit the pointers of about 'budget' bytes of grey objects. Returns true
+  // once no grey objects are left.
+  bool Step(intptr_t budget);
+
+  // Complete marking, to be called in the pause which ends the collection.
+  void Finish(Isolate* isolate);
+
+  // Grey an old object which was stored into an old object.
+  void MarkFromBarrier(RawObject* raw_obj);
+
+  MarkingVisitor* visitor() const { return visitor_; }
+
+ private:
+  GCMarker marker_;
+  PageSpace* page_space_;
+  MarkingStack* marking_stack_;
+  MarkingVisitor* visitor_;
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(IncrementalMarker);
+};
+
 }  // namespace dart
 
 #endif  // VM_GC_MARKER_H_
@@ -10,50 +10,42 @@
 
 namespace dart {
 
+void GCSweeper::Free(HeapPage* page,
+                     FreeList* freelist,
+                     uword addr,
+                     intptr_t size) {
+  freelist->Free(addr, size);
+  if ((size >= kReleaseThreshold) && (released_ < release_budget_)) {
+    released_ += page->ReleaseFreeMemory(addr, size);
+  }
+}
+
+
 intptr_t GCSweeper::SweepPage(HeapPage* page, FreeList* freelist) {
-  // Keep track of the discovered live object sizes to be able to finish
-  // sweeping early. Reset the per page in_use count for the next marking phase.
+  // Reset the per page in_use count for the next marking phase.
   intptr_t in_use_swept = 0;
-  intptr_t in_use = page->used();
   page->set_used(0);
 
+  // Only the marked objects are visited, the gaps between them are found in
+  // the mark bits of the page.
   uword current = page->first_object_start();
   uword top = page->top();
-
-  while (current < top) {
-    if (in_use_swept == in_use) {
-      // No more marked objects will be found on this page.
-      page->set_top(current);
-      break;
-    }
-    RawObject* raw_obj = RawObject::FromAddr(current);
-    intptr_t obj_size;
-    if (raw_obj->IsMarked()) {
-      // Found marked object. Clear the mark bit and update swept bytes.
-      raw_obj->ClearMarkBit();
-      obj_size = raw_obj->Size();
-      in_use_swept += obj_size;
-    } else {
-      uword free_end = current + raw_obj->Size();
-      while (free_end < top) {
-        RawObject* next_obj = RawObject::FromAddr(free_end);
-        if (next_obj->IsMarked()) {
-          // Reached the end of the free block.
-          break;
-        }
-        // Expand the free block by the size of this object.
-        free_end += next_obj->Size();
-      }
-      obj_size = free_end - current;
-      if ((current + obj_size) == top) {
-        page->set_top(current);
-        break;
-      } else {
-        freelist->Free(current, obj_size);
-      }
+  uword marked = page->NextMarkedObject(current, top);
+  while (marked < top) {
+    if (marked > current) {
+      Free(page, freelist, current, marked - current);
     }
-    current += obj_size;
+    intptr_t obj_size = RawObject::FromAddr(marked)->Size();
+    in_use_swept += obj_size;
+    current = marked + obj_size;
+    marked = page->NextMarkedObject(current, top);
   }
+  // Only the last page of the space is used for bump allocation, the free
+  // block at the end of the other pages would be lost if top was lowered.
+  if (current < top) {
+    Free(page, freelist, current, top - current);
+  }
+  page->ClearMarkBits();
 
   return in_use_swept;
 }
@@ -61,12 +53,16 @@ intptr_t GCSweeper::SweepPage(HeapPage* page, FreeList* freelist) {
 
 intptr_t GCSweeper::SweepLargePage(HeapPage* page) {
   RawObject* raw_obj = RawObject::FromAddr(page->first_object_start());
-  if (!raw_obj->IsMarked()) {
+  if (!page->IsMarked(raw_obj)) {
     // The large object was not marked. Used size is zero, which also tells the
     // calling code that the large object page can be recycled.
     return 0;
   }
-  raw_obj->ClearMarkBit();
+  page->ClearMarkBits();
+  // Cards of objects which are no longer remembered are stale.
+  if (page->has_card_table() && !raw_obj->IsRemembered()) {
+    page->ClearCards();
+  }
   return raw_obj->Size();
 }
 
@@ -18,18 +18,34 @@ class HeapPage;
 // memory.
 class GCSweeper {
  public:
-  explicit GCSweeper(Heap* heap) : heap_(heap) {}
+  // At most about 'release_budget' bytes of free memory are given back to the
+  // system while sweeping.
+  GCSweeper(Heap* heap, intptr_t release_budget)
+      : heap_(heap), release_budget_(release_budget), released_(0) {}
   ~GCSweeper() {}
 
-  // Sweep the memory area for the page while clearing the mark bits and adding
-  // all the unmarked objects to the freelist.
+  // Sweep the memory area for the page while clearing its mark bits and adding
+  // the gaps between the marked objects to the freelist. The memory of large
+  // gaps is given back to the system within the release budget.
   // Returns the size of memory used by the marked objects.
   intptr_t SweepPage(HeapPage* page, FreeList* freelist);
 
   intptr_t SweepLargePage(HeapPage* page);
 
+  // Bytes of free memory given back to the system by SweepPage.
+  intptr_t released() const { return released_; }
+
  private:
+  // The memory of free blocks of at least this size is given back to the
+  // system. Smaller blocks are likely to be reused before the next
+  // collection and not worth a system call.
+  static const intptr_t kReleaseThreshold = 64 * KB;
+
+  void Free(HeapPage* page, FreeList* freelist, uword addr, intptr_t size);
+
   Heap* heap_;
+  intptr_t release_budget_;
+  intptr_t released_;
 
   DISALLOW_IMPLICIT_CONSTRUCTORS(GCSweeper);
 };
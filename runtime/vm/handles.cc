@@ -99,12 +99,16 @@ HandleScope::~HandleScope() {
 
 #if defined(DEBUG)
 NoHandleScope::NoHandleScope(Isolate* isolate) : StackResource(isolate) {
-  isolate->IncrementNoHandleScopeDepth();
+  if (isolate != NULL) {
+    isolate->IncrementNoHandleScopeDepth();
+  }
 }
 
 
 NoHandleScope::~NoHandleScope() {
-  isolate()->DecrementNoHandleScopeDepth();
+  if (isolate() != NULL) {
+    isolate()->DecrementNoHandleScopeDepth();
+  }
 }
 #endif  // defined(DEBUG)
 
@@ -4,9 +4,15 @@
 
 #include "vm/heap.h"
 
+#include "vm/allocation_profiler.h"
 #include "vm/assert.h"
+#include "vm/atomic.h"
+#include "vm/code_index_table.h"
 #include "vm/compiler_stats.h"
+#include "vm/dart.h"
 #include "vm/flags.h"
+#include "vm/gc_marker.h"
+#include "vm/heap_profiler.h"
 #include "vm/isolate.h"
 #include "vm/os.h"
 #include "vm/pages.h"
@@ -23,6 +29,44 @@ DEFINE_FLAG(bool, verify_before_gc, false,
 DEFINE_FLAG(bool, verify_after_gc, false,
             "Enables heap verification after GC.");
 DEFINE_FLAG(bool, gc_at_alloc, false, "GC at every allocation.");
+DEFINE_FLAG(int, scavenger_tasks, 1, "number of scavenger tasks,"
+            "e.g: --scavenger_tasks=4 scavenges new gen with 4 threads");
+DEFINE_FLAG(int, tenuring_threshold, 2,
+            "number of scavenges a new object survives before it is promoted,"
+            " at most 8, e.g: --tenuring_threshold=1 promotes all survivors");
+DEFINE_FLAG(bool, adaptive_tenuring, true,
+            "Lower the tenuring threshold while the survivors of the previous"
+            " scavenge fill more than half of the new gen semi-space.");
+DEFINE_FLAG(bool, pretenuring, false,
+            "Allocate the instances of classes whose instances mostly survive"
+            " their first scavenge directly in old gen.");
+DEFINE_FLAG(bool, lazy_sweep, false,
+            "Sweep old gen pages on demand after mark-sweep.");
+DEFINE_FLAG(bool, incremental_marking, false,
+            "Mark old gen incrementally, interleaved with the mutator.");
+DEFINE_FLAG(int, incremental_marking_threshold, 64,
+            "old gen size in MB at which incremental marking first starts,"
+            "e.g: --incremental_marking_threshold=128");
+DEFINE_FLAG(int, compaction_threshold, 0,
+            "percentage of free memory in old gen pages at which mark-sweep"
+            " evacuates and releases the sparse pages, 0 disables compaction,"
+            "e.g: --compaction_threshold=50");
+DEFINE_FLAG(int, code_flushing_age, 0,
+            "number of old gen collections without an invocation after which"
+            " the unoptimized code of a static function is dropped, 0 disables"
+            " code flushing, e.g: --code_flushing_age=5");
+DEFINE_FLAG(int, max_heap_free_ratio, 70,
+            "percentage of old gen pages which may stay free after mark-sweep,"
+            " empty pages beyond it are released,"
+            "e.g: --max_heap_free_ratio=0 releases all empty pages");
+DEFINE_FLAG(int, old_gen_page_cache, 16,
+            "number of empty old gen pages kept for reuse after mark-sweep,"
+            "e.g: --old_gen_page_cache=0 unmaps all empty pages");
+DEFINE_FLAG(bool, use_huge_pages, false,
+            "back the old and new gen heaps with transparent huge pages where"
+            " the OS supports them, e.g: --use_huge_pages");
+DEFINE_FLAG(int, marker_tasks, 1, "number of marking tasks,"
+            "e.g: --marker_tasks=4 marks old gen with 4 threads");
 DEFINE_FLAG(int, new_gen_heap_size, 32, "new gen heap size in MB,"
             "e.g: --new_gen_heap_size=64 allocates a 64MB new gen heap");
 DEFINE_FLAG(int, old_gen_heap_size, Heap::kHeapSizeInMB,
@@ -32,12 +76,24 @@ DEFINE_FLAG(int, code_heap_size, Heap::kCodeHeapSizeInMB,
             "code heap size in MB,"
             "e.g: --code_heap_size=8 allocates a 8MB old gen heap");
 
+volatile intptr_t Heap::marking_heaps_ = 0;
+
+
 Heap::Heap() {
   new_space_ = new Scavenger(this,
                              (FLAG_new_gen_heap_size * MB),
                              kNewObjectAlignmentOffset);
   old_space_ = new PageSpace(this, (FLAG_old_gen_heap_size * MB));
   code_space_ = new PageSpace(this, (FLAG_code_heap_size * MB), true);
+  // Only dump the heap for requests made after its creation.
+  handled_dump_requests_ = HeapProfiler::dump_requests();
+  allocation_profiler_ = NULL;
+  if (FLAG_profile_allocations) {
+    allocation_profiler_ =
+        new AllocationProfiler(FLAG_allocation_sample_interval,
+                               FLAG_allocation_sample_depth);
+    new_space_->SetAllocationLimit(allocation_profiler_->NextSampleDistance());
+  }
 }
 
 
@@ -45,6 +101,7 @@ Heap::~Heap() {
   delete new_space_;
   delete old_space_;
   delete code_space_;
+  delete allocation_profiler_;
 }
 
 
@@ -54,6 +111,16 @@ uword Heap::AllocateNew(intptr_t size) {
   if (addr != 0) {
     return addr;
   }
+  if (new_space_->AllocationLimitReached(size)) {
+    // Generated code and TryAllocate stop at the next allocation sample.
+    new_space_->SetAllocationLimit(
+        size + allocation_profiler_->NextSampleDistance());
+    addr = new_space_->TryAllocate(size);
+    if (addr != 0) {
+      allocation_profiler_->set_sample_address(addr);
+      return addr;
+    }
+  }
   CollectGarbage(kNew);
   if (FLAG_verbose_gc) {
     OS::PrintErr("New space (%dk) Old space (%dk) Code space (%dk)\n",
@@ -61,6 +128,8 @@ uword Heap::AllocateNew(intptr_t size) {
                  (old_space_->in_use() / KB),
                  (code_space_->in_use() / KB));
   }
+  // Most old objects are allocated by promotion.
+  old_space_->IncrementalMarkingStep();
   addr = new_space_->TryAllocate(size);
   if (addr != 0) {
     return addr;
@@ -71,6 +140,7 @@ uword Heap::AllocateNew(intptr_t size) {
 
 uword Heap::AllocateOld(intptr_t size) {
   ASSERT(Isolate::Current()->no_gc_scope_depth() == 0);
+  old_space_->IncrementalMarkingStep();
   uword addr = old_space_->TryAllocate(size);
   if (addr == 0) {
     CollectGarbage(kOld);
@@ -82,6 +152,10 @@ uword Heap::AllocateOld(intptr_t size) {
     }
     addr = old_space_->TryAllocate(size);
   }
+  if ((allocation_profiler_ != NULL) && (addr != 0) &&
+      allocation_profiler_->CountAllocation(size)) {
+    allocation_profiler_->set_sample_address(addr);
+  }
   return addr;
 }
 
@@ -101,10 +175,107 @@ uword Heap::AllocateCode(intptr_t size) {
 }
 
 
+void Heap::FreeUnused(uword addr, intptr_t size, Space space) {
+  switch (space) {
+    case kOld:
+      old_space_->FreeUnused(addr, size);
+      break;
+    case kExecutable:
+      code_space_->FreeUnused(addr, size);
+      break;
+    default:
+      // New space memory is reclaimed by the next scavenge.
+      UNREACHABLE();
+  }
+}
+
+
+intptr_t Heap::Capacity(Space space) const {
+  switch (space) {
+    case kNew:
+      return new_space_->capacity();
+    case kOld:
+      return old_space_->capacity();
+    case kExecutable:
+      return code_space_->capacity();
+    default:
+      UNREACHABLE();
+  }
+  return 0;
+}
+
+
+intptr_t Heap::Used(Space space) const {
+  switch (space) {
+    case kNew:
+      return new_space_->in_use();
+    case kOld:
+      return old_space_->in_use();
+    case kExecutable:
+      return code_space_->in_use();
+    default:
+      UNREACHABLE();
+  }
+  return 0;
+}
+
+
+int Heap::Collections(Space space) const {
+  switch (space) {
+    case kNew:
+      return new_space_->collections();
+    case kOld:
+      return old_space_->collections();
+    case kExecutable:
+      return code_space_->collections();
+    default:
+      UNREACHABLE();
+  }
+  return 0;
+}
+
+
+int64_t Heap::TotalCollectionTime(Space space) const {
+  switch (space) {
+    case kNew:
+      return new_space_->total_time();
+    case kOld:
+      return old_space_->total_time();
+    case kExecutable:
+      return code_space_->total_time();
+    default:
+      UNREACHABLE();
+  }
+  return 0;
+}
+
+
+int64_t Heap::LastCollectionTime(Space space) const {
+  switch (space) {
+    case kNew:
+      return new_space_->last_time();
+    case kOld:
+      return old_space_->last_time();
+    case kExecutable:
+      return code_space_->last_time();
+    default:
+      UNREACHABLE();
+  }
+  return 0;
+}
+
+
+int64_t Heap::PromotedBytes() const {
+  return new_space_->promoted_bytes();
+}
+
+
 bool Heap::Contains(uword addr) const {
-  return new_space_->Contains(addr) ||
-      old_space_->Contains(addr) ||
-      code_space_->Contains(addr);
+  if (new_space_->Contains(addr)) {
+    return true;
+  }
+  HeapPage* page = PageTable::Lookup(addr);
+  return (page != NULL) && (page->owner()->heap() == this);
 }
 
 
@@ -119,13 +290,17 @@ void Heap::IterateNewPointers(ObjectPointerVisitor* visitor) {
 
 
 void Heap::IterateOldPointers(ObjectPointerVisitor* visitor) {
+  old_space_->FinishSweeping();
   old_space_->VisitObjectPointers(visitor);
   code_space_->VisitObjectPointers(visitor);
 }
 
 
-void Heap::IterateCodePointers(ObjectPointerVisitor* visitor) {
-  code_space_->VisitObjectPointers(visitor);
+void Heap::VisitObjects(ObjectVisitor* visitor) {
+  new_space_->VisitObjects(visitor);
+  old_space_->FinishSweeping();
+  old_space_->VisitObjects(visitor);
+  code_space_->VisitObjects(visitor);
 }
 
 
@@ -133,9 +308,13 @@ void Heap::CollectGarbage(Space space) {
   switch (space) {
     case kNew:
       new_space_->Scavenge();
+      HeapProfiler::HandleDumpRequest(Isolate::Current());
       break;
     case kOld:
       old_space_->MarkSweep();
+      if (FLAG_print_class_histogram) {
+        HeapProfiler::PrintClassHistogram(Isolate::Current());
+      }
       break;
     case kExecutable:
       UNIMPLEMENTED();
@@ -155,6 +334,73 @@ void Heap::CollectAllGarbage() {
 }
 
 
+void Heap::FlushUnusedCode() {
+  if (FLAG_code_flushing_age <= 0) {
+    return;
+  }
+  // Code is only flushed once the isolate has been initialized, the heap of
+  // the VM isolate is never collected.
+  Isolate* isolate = Isolate::Current();
+  if ((isolate == Dart::vm_isolate()) || (isolate->stub_code() == NULL)) {
+    return;
+  }
+  intptr_t flushed =
+      isolate->code_index_table()->FlushUnusedCode(FLAG_code_flushing_age);
+  if (FLAG_verbose_gc && (flushed > 0)) {
+    OS::PrintErr("Code-Flush: %d functions\n", flushed);
+  }
+}
+
+
+void Heap::SweepCodeSpace() {
+  GCMarker marker(this);
+  marker.MarkInstructions(code_space_);
+  code_space_->SweepInstructions();
+}
+
+
+bool Heap::NeedsIdleScavenge() const {
+  return new_space_->allocated_since_scavenge() >=
+      (new_space_->capacity() / 100) * kIdleScavengePercent;
+}
+
+
+bool Heap::HasIdleWork() const {
+  return NeedsIdleScavenge() || old_space_->HasIdleWork();
+}
+
+
+void Heap::NotifyIdle(int64_t deadline) {
+  // The previous scavenge is the best estimate of the next one.
+  if (NeedsIdleScavenge() &&
+      ((OS::GetCurrentTimeMicros() + new_space_->last_time()) <= deadline)) {
+    CollectGarbage(kNew);
+  }
+  while ((OS::GetCurrentTimeMicros() < deadline) &&
+         old_space_->IdleStep(kIdleMarkingStepSize)) {
+    // Advance the old generation work in chunks until the deadline.
+  }
+}
+
+
+void Heap::IdleMarkingStep() {
+  if (old_space_->is_marking()) {
+    old_space_->MarkingStep(kIdleMarkingStepSize);
+  }
+}
+
+
+void Heap::ActivateMarkingBarrier() {
+  AtomicOperations::FetchAndAdd(&marking_heaps_, 1);
+}
+
+
+void Heap::DeactivateMarkingBarrier() {
+  AtomicOperations::FetchAndAdd(&marking_heaps_, -1);
+  ASSERT(marking_heaps_ >= 0);
+}
+
+
 uword Heap::TopAddress() {
   return reinterpret_cast<uword>(new_space_->TopAddress());
 }
@@ -172,11 +418,15 @@ void Heap::Init(Isolate* isolate) {
 }
 
 
-bool Heap::Verify() const {
+bool Heap::Verify() {
+  old_space_->FinishSweeping();
   VerifyPointersVisitor visitor;
   new_space_->VisitObjectPointers(&visitor);
   old_space_->VisitObjectPointers(&visitor);
   code_space_->VisitObjectPointers(&visitor);
+  VerifyStoreBufferVisitor store_buffer_visitor;
+  old_space_->VisitObjects(&store_buffer_visitor);
+  code_space_->VisitObjects(&store_buffer_visitor);
   // Only returning a value so that Heap::Validate can be called from an ASSERT.
   return true;
 }
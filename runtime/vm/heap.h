@@ -15,14 +15,24 @@
 namespace dart {
 
 // Forward declarations.
+class AllocationProfiler;
 class Isolate;
 class ObjectPointerVisitor;
+class ObjectVisitor;
+class RawObject;
 class VirtualMemory;
 
 DECLARE_FLAG(bool, verbose_gc);
 DECLARE_FLAG(bool, verify_before_gc);
 DECLARE_FLAG(bool, verify_after_gc);
 DECLARE_FLAG(bool, gc_at_alloc);
+DECLARE_FLAG(bool, lazy_sweep);
+DECLARE_FLAG(bool, incremental_marking);
+DECLARE_FLAG(int, incremental_marking_threshold);
+DECLARE_FLAG(int, compaction_threshold);
+DECLARE_FLAG(int, max_heap_free_ratio);
+DECLARE_FLAG(int, old_gen_page_cache);
+DECLARE_FLAG(bool, use_huge_pages);
 
 class Heap {
  public:
@@ -70,6 +80,23 @@ class Heap {
     return 0;
   }
 
+  // Return memory obtained from TryAllocate which ended up not being used.
+  void FreeUnused(uword addr, intptr_t size, Space space);
+
+  // Committed bytes of a space. For new space this is the size of the current
+  // semi-space.
+  intptr_t Capacity(Space space) const;
+  // Bytes used by the objects of a space.
+  intptr_t Used(Space space) const;
+
+  // Statistics of the collections of a space, times are in microseconds. The
+  // code space is not collected yet.
+  int Collections(Space space) const;
+  int64_t TotalCollectionTime(Space space) const;
+  int64_t LastCollectionTime(Space space) const;
+  // Bytes promoted to old space by all scavenges.
+  int64_t PromotedBytes() const;
+
   // Heap contains the specified address.
   bool Contains(uword addr) const;
   bool CodeContains(uword addr) const;
@@ -77,11 +104,46 @@ class Heap {
   // Visit all pointers in the space.
   void IterateNewPointers(ObjectPointerVisitor* visitor);
   void IterateOldPointers(ObjectPointerVisitor* visitor);
-  void IterateCodePointers(ObjectPointerVisitor* visitor);
+
+  // Visit all objects in the heap, including the unreachable objects in new
+  // space.
+  void VisitObjects(ObjectVisitor* visitor);
 
   void CollectGarbage(Space space);
   void CollectAllGarbage();
 
+  // Drop the unoptimized code of the static functions which were not invoked
+  // during the last --code_flushing_age old gen collections. Called before
+  // old gen marking starts.
+  void FlushUnusedCode();
+
+  // Instructions are only referenced by their code object. Once old gen has
+  // been marked, the instructions of the unmarked code objects are freed.
+  void SweepCodeSpace();
+
+  // Use the time until 'deadline', in microseconds as returned by
+  // OS::GetCurrentTimeMicros, for collection work while the isolate is idle: a
+  // scavenge once enough has been allocated since the last one, then chunks of
+  // incremental marking and lazy sweeping of the old generation.
+  void NotifyIdle(int64_t deadline);
+  bool HasIdleWork() const;
+
+  // Advance incremental marking of the old generation by one step.
+  void IdleMarkingStep();
+
+  // Write barrier for incremental marking. Stores of old objects into old
+  // objects only need to be recorded while some heap is being marked, the
+  // address of the counter of marking heaps is checked by generated code.
+  static bool IsMarkingBarrierActive() { return marking_heaps_ > 0; }
+  static uword MarkingBarrierAddress() {
+    return reinterpret_cast<uword>(&marking_heaps_);
+  }
+  static void ActivateMarkingBarrier();
+  static void DeactivateMarkingBarrier();
+  void MarkingBarrier(RawObject* value) {
+    old_space_->RecordStore(value);
+  }
+
   // Accessors for inlined allocation in generated code.
   uword TopAddress();
   uword EndAddress();
@@ -91,7 +153,18 @@ class Heap {
   static void Init(Isolate* isolate);
 
   // Verify that all pointers in the heap point to the heap.
-  bool Verify() const;
+  bool Verify();
+
+  // The allocation sampler of this heap, NULL unless --profile_allocations.
+  AllocationProfiler* allocation_profiler() const {
+    return allocation_profiler_;
+  }
+
+  // Number of heap dump requests this heap has handled, see HeapProfiler.
+  intptr_t handled_dump_requests() const { return handled_dump_requests_; }
+  void set_handled_dump_requests(intptr_t value) {
+    handled_dump_requests_ = value;
+  }
 
  private:
   Heap();
@@ -100,11 +173,26 @@ class Heap {
   uword AllocateOld(intptr_t size);
   uword AllocateCode(intptr_t size);
 
+  // Bytes marked in an idle marking step.
+  static const intptr_t kIdleMarkingStepSize = 1 * MB;
+  // A scavenge is done in idle time once this percentage of the new space has
+  // been allocated since the last one.
+  static const intptr_t kIdleScavengePercent = 50;
+
+  bool NeedsIdleScavenge() const;
+
   // The different spaces used for allocation.
   Scavenger* new_space_;
   PageSpace* old_space_;
   PageSpace* code_space_;
 
+  intptr_t handled_dump_requests_;
+
+  AllocationProfiler* allocation_profiler_;
+
+  // Number of heaps of all isolates which are being marked incrementally.
+  static volatile intptr_t marking_heaps_;
+
   DISALLOW_COPY_AND_ASSIGN(Heap);
 };
 
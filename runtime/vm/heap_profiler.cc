@@ -0,0 +1,295 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/heap_profiler.h"
+
+#include "vm/atomic.h"
+#include "vm/dart.h"
+#include "vm/growable_array.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/object.h"
+#include "vm/os.h"
+#include "vm/visitor.h"
+#include "vm/zone.h"
+
+namespace dart {
+
+DEFINE_FLAG(bool, print_class_histogram, false,
+            "Print a histogram of the live objects by class after every"
+            " mark-sweep.");
+DEFINE_FLAG(charp, heap_graph_file, NULL,
+            "Prefix of the heap graph files written when a heap dump is"
+            " requested, e.g. by Dart_RequestHeapDump.");
+
+volatile intptr_t HeapProfiler::dump_requests_ = 0;
+
+
+// Counts the instances and bytes of each class while visiting the heap.
+class ClassHistogram : public ObjectVisitor {
+ public:
+  struct Entry {
+    RawClass* raw_class;
+    intptr_t count;
+    intptr_t size;
+    const char* name;
+  };
+
+  ClassHistogram()
+      : capacity_(kInitialCapacity),
+        count_(0),
+        total_count_(0),
+        total_size_(0) {
+    entries_ = new Entry[capacity_];
+    memset(entries_, 0, capacity_ * sizeof(entries_[0]));
+  }
+
+  ~ClassHistogram() {
+    delete[] entries_;
+  }
+
+  void VisitObject(RawObject* raw_obj) {
+    // Free list elements fill the unused memory of old pages.
+    if (raw_obj->IsFreeListElement()) {
+      return;
+    }
+    Entry* entry = Add(raw_obj->ptr()->class_);
+    intptr_t size = raw_obj->Size();
+    entry->count++;
+    entry->size += size;
+    total_count_++;
+    total_size_ += size;
+  }
+
+  Entry* Add(RawClass* raw_class) {
+    Entry* entry = Lookup(raw_class);
+    if (entry->raw_class == NULL) {
+      entry->raw_class = raw_class;
+      count_++;
+      if ((count_ * 2) > capacity_) {
+        Grow();
+        entry = Lookup(raw_class);
+      }
+    }
+    return entry;
+  }
+
+  const Entry* Find(RawClass* raw_class) {
+    Entry* entry = Lookup(raw_class);
+    ASSERT(entry->raw_class == raw_class);
+    return entry;
+  }
+
+  // Look up the names of all classes, the C strings are allocated in the
+  // current zone.
+  void ResolveNames() {
+    Class& cls = Class::Handle();
+    String& name = String::Handle();
+    for (intptr_t i = 0; i < capacity_; i++) {
+      RawClass* raw_class = entries_[i].raw_class;
+      if (raw_class == NULL) {
+        continue;
+      }
+      // The classes of the VM objects have no name field, do not allocate
+      // a symbol for them in the middle of a heap walk.
+      intptr_t index = Object::GetSingletonClassIndex(raw_class);
+      if (index != Object::kInvalidIndex) {
+        entries_[i].name = Object::GetSingletonClassName(index);
+      } else {
+        cls = raw_class;
+        name = cls.Name();
+        entries_[i].name = name.ToCString();
+      }
+    }
+  }
+
+  // Print the classes by decreasing size.
+  void Print(Isolate* isolate) {
+    GrowableArray<Entry*> sorted;
+    for (intptr_t i = 0; i < capacity_; i++) {
+      if (entries_[i].raw_class != NULL) {
+        sorted.Add(&entries_[i]);
+      }
+    }
+    sorted.Sort(CompareSize);
+    OS::Print("Class histogram of isolate %lld (%d objects, %dK):\n",
+              isolate->main_port(),
+              total_count_,
+              (total_size_ + KB / 2) / KB);
+    OS::Print("%12s %12s  %s\n", "instances", "bytes", "class");
+    for (intptr_t i = 0; i < sorted.length(); i++) {
+      OS::Print("%12d %12d  %s\n",
+                sorted[i]->count,
+                sorted[i]->size,
+                sorted[i]->name);
+    }
+  }
+
+  intptr_t total_count() const { return total_count_; }
+
+ private:
+  static const intptr_t kInitialCapacity = 256;
+
+  static int CompareSize(Entry* const* a, Entry* const* b) {
+    if ((*a)->size != (*b)->size) {
+      return ((*a)->size > (*b)->size) ? -1 : 1;
+    }
+    return strcmp((*a)->name, (*b)->name);
+  }
+
+  Entry* Lookup(RawClass* raw_class) {
+    intptr_t mask = capacity_ - 1;
+    intptr_t index =
+        (reinterpret_cast<uword>(raw_class) >> kObjectAlignmentLog2) & mask;
+    while ((entries_[index].raw_class != NULL) &&
+           (entries_[index].raw_class != raw_class)) {
+      index = (index + 1) & mask;
+    }
+    return &entries_[index];
+  }
+
+  void Grow() {
+    Entry* old_entries = entries_;
+    intptr_t old_capacity = capacity_;
+    capacity_ *= 2;
+    entries_ = new Entry[capacity_];
+    memset(entries_, 0, capacity_ * sizeof(entries_[0]));
+    for (intptr_t i = 0; i < old_capacity; i++) {
+      if (old_entries[i].raw_class != NULL) {
+        *Lookup(old_entries[i].raw_class) = old_entries[i];
+      }
+    }
+    delete[] old_entries;
+  }
+
+  intptr_t capacity_;
+  intptr_t count_;
+  intptr_t total_count_;
+  intptr_t total_size_;
+  Entry* entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassHistogram);
+};
+
+
+// Writes a line per object: its address, class, size and the addresses of
+// the heap objects it references.
+class HeapGraphWriter : public ObjectVisitor, public ObjectPointerVisitor {
+ public:
+  HeapGraphWriter(FILE* file, ClassHistogram* histogram)
+      : file_(file), histogram_(histogram) {}
+
+  void VisitObject(RawObject* raw_obj) {
+    if (raw_obj->IsFreeListElement()) {
+      return;
+    }
+    const ClassHistogram::Entry* entry =
+        histogram_->Find(raw_obj->ptr()->class_);
+    fprintf(file_, "%p %s %d",
+            reinterpret_cast<void*>(RawObject::ToAddr(raw_obj)),
+            entry->name,
+            raw_obj->Size());
+    raw_obj->VisitPointers(this);
+    fprintf(file_, "\n");
+  }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (raw_obj->IsHeapObject()) {
+        fprintf(file_, " %p", reinterpret_cast<void*>(
+            RawObject::ToAddr(raw_obj)));
+      }
+    }
+  }
+
+ private:
+  FILE* file_;
+  ClassHistogram* histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(HeapGraphWriter);
+};
+
+
+bool HeapProfiler::DumpHeap(Isolate* isolate, const char* graph_file) {
+  isolate->heap()->CollectAllGarbage();
+  PrintClassHistogram(isolate);
+  if (graph_file == NULL) {
+    return true;
+  }
+  return WriteHeapGraph(isolate, graph_file);
+}
+
+
+void HeapProfiler::PrintClassHistogram(Isolate* isolate) {
+  Zone zone(isolate);
+  HandleScope handle_scope(isolate);
+  ClassHistogram histogram;
+  {
+    NoGCScope no_gc;
+    isolate->heap()->VisitObjects(&histogram);
+    histogram.ResolveNames();
+  }
+  histogram.Print(isolate);
+}
+
+
+bool HeapProfiler::WriteHeapGraph(Isolate* isolate, const char* graph_file) {
+  FILE* file = fopen(graph_file, "w");
+  if (file == NULL) {
+    return false;
+  }
+  Zone zone(isolate);
+  HandleScope handle_scope(isolate);
+  ClassHistogram histogram;
+  {
+    NoGCScope no_gc;
+    Heap* heap = isolate->heap();
+    heap->VisitObjects(&histogram);
+    histogram.ResolveNames();
+    fprintf(file, "# Heap graph of isolate %lld: %d objects\n",
+            isolate->main_port(),
+            histogram.total_count());
+    fprintf(file, "# address class size references...\n");
+    HeapGraphWriter writer(file, &histogram);
+    heap->VisitObjects(&writer);
+  }
+  return fclose(file) == 0;
+}
+
+
+void HeapProfiler::RequestDump() {
+  AtomicOperations::FetchAndAdd(&dump_requests_, 1);
+}
+
+
+void HeapProfiler::HandleDumpRequest(Isolate* isolate) {
+  Heap* heap = isolate->heap();
+  intptr_t requests = dump_requests_;
+  if (heap->handled_dump_requests() == requests) {
+    return;
+  }
+  // Class names are only available once the isolate has been initialized.
+  if ((isolate == Dart::vm_isolate()) || (isolate->stub_code() == NULL)) {
+    return;
+  }
+  heap->set_handled_dump_requests(requests);
+  if (FLAG_heap_graph_file == NULL) {
+    DumpHeap(isolate, NULL);
+    return;
+  }
+  // Each isolate writes its own files, numbered by request.
+  const char* kFormat = "%s.%lld.%d";
+  intptr_t len = OS::SNPrint(NULL, 0, kFormat, FLAG_heap_graph_file,
+                             isolate->main_port(), requests);
+  char* graph_file = new char[len + 1];
+  OS::SNPrint(graph_file, len + 1, kFormat, FLAG_heap_graph_file,
+              isolate->main_port(), requests);
+  if (!DumpHeap(isolate, graph_file)) {
+    OS::PrintErr("Could not write heap graph to %s\n", graph_file);
+  }
+  delete[] graph_file;
+}
+
+}  // namespace dart
@@ -0,0 +1,52 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_HEAP_PROFILER_H_
+#define VM_HEAP_PROFILER_H_
+
+#include "vm/allocation.h"
+#include "vm/flags.h"
+#include "vm/globals.h"
+
+namespace dart {
+
+// Forward declarations.
+class Isolate;
+
+DECLARE_FLAG(bool, print_class_histogram);
+
+// Walks the heap of an isolate to show what it is made of. The class histogram
+// lists the number of instances and bytes of each class. The heap graph file
+// lists one object per line with its address, class, size and the addresses
+// of the objects it references, so that the graphs written at two points in
+// time can be compared with text tools.
+class HeapProfiler : public AllStatic {
+ public:
+  // Collect all garbage, print the class histogram of the remaining objects
+  // and write the heap graph to 'graph_file' unless it is NULL. Returns false
+  // if the heap graph could not be written.
+  static bool DumpHeap(Isolate* isolate, const char* graph_file);
+
+  // Print the class histogram of the objects currently in the heap, which
+  // includes unreachable objects in new space.
+  static void PrintClassHistogram(Isolate* isolate);
+
+  // Ask all isolates to dump their heap at their next scavenge. The heap graph
+  // is written if --heap_graph_file is set. Only increments a counter so that
+  // it can be called from a signal handler.
+  static void RequestDump();
+  static intptr_t dump_requests() { return dump_requests_; }
+
+  // Dump the heap of 'isolate' if a dump was requested since its last one.
+  static void HandleDumpRequest(Isolate* isolate);
+
+ private:
+  static bool WriteHeapGraph(Isolate* isolate, const char* graph_file);
+
+  static volatile intptr_t dump_requests_;
+};
+
+}  // namespace dart
+
+#endif  // VM_HEAP_PROFILER_H_
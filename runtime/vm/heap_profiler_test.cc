@@ -0,0 +1,121 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include <stdio.h>
+
+#include "vm/assert.h"
+#include "vm/globals.h"
+#include "vm/heap.h"
+#include "vm/heap_profiler.h"
+#include "vm/object.h"
+#include "vm/os.h"
+#include "vm/unit_test.h"
+
+namespace dart {
+
+DECLARE_FLAG(charp, heap_graph_file);
+
+// Returns the contents of the file allocated in the current zone, or NULL if
+// it cannot be read.
+static const char* ReadFile(const char* path) {
+  FILE* file = fopen(path, "r");
+  if (file == NULL) {
+    return NULL;
+  }
+  fseek(file, 0, SEEK_END);
+  intptr_t size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* buffer = reinterpret_cast<char*>(
+      Isolate::Current()->current_zone()->Allocate(size + 1));
+  intptr_t read = fread(buffer, 1, size, file);
+  fclose(file);
+  buffer[read] = '\0';
+  return buffer;
+}
+
+
+// Returns the line of the heap graph which describes 'obj', or NULL.
+static const char* FindObject(const char* graph, const Object& obj) {
+  const Class& cls = Class::Handle(obj.clazz());
+  char prefix[64];
+  OS::SNPrint(prefix, sizeof(prefix), "\n%p %s %d",
+              reinterpret_cast<void*>(RawObject::ToAddr(obj.raw())),
+              String::Handle(cls.Name()).ToCString(),
+              obj.raw()->Size());
+  const char* line = strstr(graph, prefix);
+  return (line == NULL) ? NULL : line + 1;
+}
+
+
+static bool LineContains(const char* line, const Object& obj) {
+  char ref[32];
+  OS::SNPrint(ref, sizeof(ref), " %p",
+              reinterpret_cast<void*>(RawObject::ToAddr(obj.raw())));
+  intptr_t ref_len = strlen(ref);
+  const char* end = strchr(line, '\n');
+  for (const char* cur = strstr(line, ref);
+       (cur != NULL) && (cur < end);
+       cur = strstr(cur + 1, ref)) {
+    if ((cur[ref_len] == ' ') || (cur[ref_len] == '\n')) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+TEST_CASE(HeapGraph) {
+  const char* kGraphFile = "heap_profiler_test.graph";
+  const Array& outer = Array::Handle(Array::New(2, Heap::kOld));
+  const Array& inner = Array::Handle(Array::New(3));
+  outer.SetAt(0, inner);
+  outer.SetAt(1, Smi::Handle(Smi::New(42)));
+  EXPECT(HeapProfiler::DumpHeap(Isolate::Current(), kGraphFile));
+
+  const char* graph = ReadFile(kGraphFile);
+  remove(kGraphFile);
+  EXPECT(graph != NULL);
+  EXPECT(strncmp(graph, "# Heap graph", strlen("# Heap graph")) == 0);
+  // The outer array references the inner array but not the Smi.
+  const char* outer_line = FindObject(graph, outer);
+  EXPECT(outer_line != NULL);
+  EXPECT(LineContains(outer_line, inner));
+  const char* inner_line = FindObject(graph, inner);
+  EXPECT(inner_line != NULL);
+  EXPECT(!LineContains(inner_line, outer));
+
+  // Heap graphs which cannot be written are reported.
+  EXPECT(!HeapProfiler::DumpHeap(Isolate::Current(),
+                                 "/nonexistent/heap_profiler_test.graph"));
+}
+
+
+TEST_CASE(HeapDumpRequest) {
+  const char* saved_heap_graph_file = FLAG_heap_graph_file;
+  FLAG_heap_graph_file = "heap_profiler_test";
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  const Array& array = Array::Handle(Array::New(2, Heap::kOld));
+
+  // Requests are handled once, at the next scavenge.
+  HeapProfiler::RequestDump();
+  intptr_t request = HeapProfiler::dump_requests();
+  EXPECT(heap->handled_dump_requests() != request);
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT_EQ(request, heap->handled_dump_requests());
+
+  char graph_file[64];
+  OS::SNPrint(graph_file, sizeof(graph_file), "%s.%lld.%d",
+              FLAG_heap_graph_file, isolate->main_port(), request);
+  const char* graph = ReadFile(graph_file);
+  remove(graph_file);
+  EXPECT(graph != NULL);
+  EXPECT(FindObject(graph, array) != NULL);
+
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT_EQ(request, heap->handled_dump_requests());
+  FLAG_heap_graph_file = saved_heap_graph_file;
+}
+
+}  // namespace dart
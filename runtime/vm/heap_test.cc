@@ -3,12 +3,717 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "vm/assert.h"
+#include "vm/dart.h"
+#include "vm/dart_api_impl.h"
+#include "vm/gc_marker.h"
 #include "vm/globals.h"
 #include "vm/heap.h"
+#include "vm/object.h"
+#include "vm/os.h"
+#include "vm/stub_code.h"
+#include "vm/timer.h"
 #include "vm/unit_test.h"
 
 namespace dart {
 
+DECLARE_FLAG(int, new_gen_heap_size);
+DECLARE_FLAG(bool, pretenuring);
+DECLARE_FLAG(bool, print_class_histogram);
+
+TEST_CASE(StoreBuffer) {
+  Heap* heap = Isolate::Current()->heap();
+  const Array& old_array = Array::Handle(Array::New(2, Heap::kOld));
+  EXPECT(!old_array.raw()->IsRemembered());
+
+  // Storing Smis and old objects does not need to be remembered.
+  old_array.SetAt(0, Smi::Handle(Smi::New(42)));
+  old_array.SetAt(1, String::Handle(String::New("old", Heap::kOld)));
+  EXPECT(!old_array.raw()->IsRemembered());
+
+  // Storing a new object records the old array in the store buffer.
+  old_array.SetAt(1, String::Handle(String::New("new", Heap::kNew)));
+  EXPECT(old_array.raw()->IsRemembered());
+
+  // The new string is only reachable through the store buffer.
+  heap->CollectGarbage(Heap::kNew);
+  String& str = String::Handle();
+  str ^= old_array.At(1);
+  EXPECT(str.Equals("new"));
+  EXPECT_EQ(str.raw()->IsNewObject(), old_array.raw()->IsRemembered());
+}
+
+
+TEST_CASE(CardMarking) {
+  Heap* heap = Isolate::Current()->heap();
+  // Large enough to be allocated on its own large page.
+  const intptr_t kLength = 1024 * 1024;
+  const Array& array = Array::Handle(Array::New(kLength, Heap::kOld));
+  EXPECT(!array.raw()->IsRemembered());
+
+  array.SetAt(0, String::Handle(String::New("first", Heap::kNew)));
+  array.SetAt(kLength - 1, String::Handle(String::New("last", Heap::kNew)));
+  EXPECT(array.raw()->IsRemembered());
+
+  // Only the dirty cards are visited, but both new strings need to survive.
+  heap->CollectGarbage(Heap::kNew);
+  String& str = String::Handle();
+  str ^= array.At(0);
+  EXPECT(str.Equals("first"));
+  str ^= array.At(kLength - 1);
+  EXPECT(str.Equals("last"));
+
+  // The remembered set survives a mark-sweep.
+  heap->CollectGarbage(Heap::kOld);
+  heap->CollectGarbage(Heap::kNew);
+  str ^= array.At(kLength - 1);
+  EXPECT(str.Equals("last"));
+}
+
+
+// Scavenge time should not depend on the size of the old arrays which have
+// been updated, only on the number of updated cards.
+TEST_CASE(CardMarkingScavengeTime) {
+  Heap* heap = Isolate::Current()->heap();
+  for (intptr_t length = 64 * KB; length <= 4 * MB; length *= 4) {
+    const Array& array = Array::Handle(Array::New(length, Heap::kOld));
+    array.SetAt(length / 2, String::Handle(String::New("new", Heap::kNew)));
+    Timer timer(true, "Scavenge");
+    timer.Start();
+    heap->CollectGarbage(Heap::kNew);
+    timer.Stop();
+    OS::Print("Scavenge with an updated array of %d elements: %lldus\n",
+              length, timer.TotalElapsedTime());
+    String& str = String::Handle();
+    str ^= array.At(length / 2);
+    EXPECT(str.Equals("new"));
+  }
+}
+
+
+TEST_CASE(TenuringThreshold) {
+  Heap* heap = Isolate::Current()->heap();
+  intptr_t saved_threshold = FLAG_tenuring_threshold;
+  FLAG_tenuring_threshold = 3;
+  heap->CollectGarbage(Heap::kNew);
+
+  // New objects are promoted by the third scavenge they survive.
+  const Array& array = Array::Handle(Array::New(1, Heap::kOld));
+  array.SetAt(0, String::Handle(String::New("young", Heap::kNew)));
+  for (intptr_t i = 1; i <= 3; i++) {
+    heap->CollectGarbage(Heap::kNew);
+    RawObject* raw_str = array.At(0);
+    EXPECT_EQ(i < 3, raw_str->IsNewObject());
+    if (raw_str->IsNewObject()) {
+      EXPECT_EQ(i, raw_str->Age());
+    } else {
+      EXPECT_EQ(0, raw_str->Age());
+    }
+  }
+
+  FLAG_tenuring_threshold = 1;
+  heap->CollectGarbage(Heap::kNew);
+  array.SetAt(0, String::Handle(String::New("young", Heap::kNew)));
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(array.At(0)->IsOldObject());
+
+  FLAG_tenuring_threshold = saved_threshold;
+  heap->CollectGarbage(Heap::kNew);
+}
+
+
+TEST_CASE(AdaptiveTenuring) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  intptr_t saved_threshold = FLAG_tenuring_threshold;
+  bool saved_adaptive = FLAG_adaptive_tenuring;
+  FLAG_tenuring_threshold = 4;
+  FLAG_adaptive_tenuring = true;
+  heap->CollectGarbage(Heap::kNew);
+
+  // Survivors filling most of the semi-space are promoted by their second
+  // scavenge instead of their fourth.
+  intptr_t num_arrays = heap->Capacity(Heap::kNew) * 3 / 4 / (8 * KB);
+  const Array& live = Array::Handle(Array::New(num_arrays, Heap::kOld));
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t i = 0; i < num_arrays; i++) {
+      live.SetAt(i, Array::Handle(Array::New(1 * KB, Heap::kNew)));
+    }
+  }
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(live.At(0)->IsNewObject());
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(live.At(0)->IsOldObject());
+
+  // Once the survivors have been promoted the threshold is raised again.
+  live.SetAt(0, String::Handle(String::New("young", Heap::kNew)));
+  heap->CollectGarbage(Heap::kNew);
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT(live.At(0)->IsNewObject());
+
+  FLAG_tenuring_threshold = saved_threshold;
+  FLAG_adaptive_tenuring = saved_adaptive;
+  heap->CollectGarbage(Heap::kNew);
+}
+
+
+TEST_CASE(NewSpaceSizing) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  intptr_t max_capacity = FLAG_new_gen_heap_size * MB / 2;
+
+  // The semi-spaces grow to their maximum size while allocating quickly.
+  for (intptr_t i = 0; (i < 100) && (heap->Capacity(Heap::kNew) < max_capacity);
+       i++) {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t j = 0; j < 100; j++) {
+      Array::New(1 * KB, Heap::kNew);
+    }
+  }
+  EXPECT_EQ(max_capacity, heap->Capacity(Heap::kNew));
+
+  // And shrink once the isolate is idle.
+  OS::Sleep(1100);
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT_EQ(max_capacity / 2, heap->Capacity(Heap::kNew));
+}
+
+
+TEST_CASE(ParallelScavenge) {
+  Heap* heap = Isolate::Current()->heap();
+  intptr_t saved_scavenger_tasks = FLAG_scavenger_tasks;
+  bool saved_verify_after_gc = FLAG_verify_after_gc;
+  intptr_t saved_threshold = FLAG_tenuring_threshold;
+  FLAG_scavenger_tasks = 4;
+  FLAG_verify_after_gc = true;
+  FLAG_tenuring_threshold = 2;
+
+  // Chains of new arrays, reachable from a handle and from an old array.
+  const intptr_t kChains = 64;
+  const intptr_t kLength = 1000;
+  const Array& roots = Array::Handle(Array::New(kChains, Heap::kOld));
+  Array& chain = Array::Handle();
+  Array& link = Array::Handle();
+  for (intptr_t i = 0; i < kChains; i++) {
+    chain = Array::New(2, Heap::kNew);
+    chain.SetAt(0, Smi::Handle(Smi::New(i)));
+    for (intptr_t j = 1; j < kLength; j++) {
+      link = Array::New(2, Heap::kNew);
+      link.SetAt(0, Smi::Handle(Smi::New(i)));
+      link.SetAt(1, chain);
+      chain = link.raw();
+    }
+    roots.SetAt(i, chain);
+  }
+  const Array& shared = Array::Handle(Array::New(kChains, Heap::kNew));
+  for (intptr_t i = 0; i < kChains; i++) {
+    shared.SetAt(i, Object::Handle(roots.At(i)));
+  }
+
+  // The second scavenge promotes the survivors of the first one.
+  for (intptr_t k = 0; k < 3; k++) {
+    heap->CollectGarbage(Heap::kNew);
+    for (intptr_t i = 0; i < kChains; i++) {
+      chain ^= roots.At(i);
+      EXPECT_EQ(chain.raw(), shared.At(i));
+      intptr_t length = 0;
+      while (!chain.IsNull()) {
+        EXPECT_EQ(Smi::New(i), chain.At(0));
+        chain ^= chain.At(1);
+        length++;
+      }
+      EXPECT_EQ(kLength, length);
+    }
+  }
+  EXPECT(shared.raw()->IsOldObject());
+
+  FLAG_scavenger_tasks = saved_scavenger_tasks;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+  FLAG_tenuring_threshold = saved_threshold;
+}
+
+
+TEST_CASE(ParallelMarking) {
+  Heap* heap = Isolate::Current()->heap();
+  intptr_t saved_marker_tasks = FLAG_marker_tasks;
+  bool saved_verify_after_gc = FLAG_verify_after_gc;
+  FLAG_marker_tasks = 4;
+  FLAG_verify_after_gc = true;
+
+  // Chains of old arrays. Every other chain becomes garbage.
+  const intptr_t kChains = 64;
+  const intptr_t kLength = 1000;
+  const Array& roots = Array::Handle(Array::New(kChains, Heap::kOld));
+  Array& chain = Array::Handle();
+  Array& link = Array::Handle();
+  for (intptr_t k = 0; k < 2; k++) {
+    for (intptr_t i = 0; i < kChains; i++) {
+      chain = Array::New(2, Heap::kOld);
+      chain.SetAt(0, Smi::Handle(Smi::New(i)));
+      for (intptr_t j = 1; j < kLength; j++) {
+        link = Array::New(2, Heap::kOld);
+        link.SetAt(0, Smi::Handle(Smi::New(i)));
+        link.SetAt(1, chain);
+        chain = link.raw();
+      }
+      roots.SetAt(i, ((i % 2) == 0) ? chain : Array::Handle());
+    }
+    heap->CollectGarbage(Heap::kOld);
+    for (intptr_t i = 0; i < kChains; i += 2) {
+      chain ^= roots.At(i);
+      intptr_t length = 0;
+      while (!chain.IsNull()) {
+        EXPECT_EQ(Smi::New(i), chain.At(0));
+        chain ^= chain.At(1);
+        length++;
+      }
+      EXPECT_EQ(kLength, length);
+    }
+  }
+
+  FLAG_marker_tasks = saved_marker_tasks;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+}
+
+
+TEST_CASE(LazySweep) {
+  Heap* heap = Isolate::Current()->heap();
+  bool saved_lazy_sweep = FLAG_lazy_sweep;
+  FLAG_lazy_sweep = true;
+
+  // Fill several pages with old arrays, only every tenth one stays reachable.
+  const intptr_t kCount = 10000;
+  const Array& live = Array::Handle(Array::New(kCount / 10, Heap::kOld));
+  Array& array = Array::Handle();
+  for (intptr_t i = 0; i < kCount; i++) {
+    array = Array::New(8, Heap::kOld);
+    array.SetAt(0, Smi::Handle(Smi::New(i)));
+    if ((i % 10) == 0) {
+      live.SetAt(i / 10, array);
+    }
+  }
+  heap->CollectGarbage(Heap::kOld);
+
+  // Allocation reuses the memory of the unswept pages.
+  for (intptr_t i = 0; i < kCount; i++) {
+    array = Array::New(8, Heap::kOld);
+  }
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT_EQ(Smi::New(i * 10), array.At(0));
+  }
+
+  // Pages which are still unswept are swept before the next marking.
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->Verify());
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT_EQ(Smi::New(i * 10), array.At(0));
+  }
+
+  FLAG_lazy_sweep = saved_lazy_sweep;
+}
+
+
+TEST_CASE(ReleaseEmptyPages) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  intptr_t saved_max_free_ratio = FLAG_max_heap_free_ratio;
+  intptr_t saved_compaction_threshold = FLAG_compaction_threshold;
+  FLAG_max_heap_free_ratio = 0;
+  // Sparse pages would be evacuated and released otherwise.
+  FLAG_compaction_threshold = 0;
+  heap->CollectGarbage(Heap::kOld);
+  intptr_t capacity = heap->Capacity(Heap::kOld);
+
+  // Fill many pages with garbage, only the last array stays reachable.
+  const Array& live = Array::Handle(Array::New(1, Heap::kOld));
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t i = 0; i < 1000; i++) {
+      live.SetAt(0, Array::Handle(Array::New(1 * KB, Heap::kOld)));
+    }
+  }
+  EXPECT(heap->Capacity(Heap::kOld) > capacity + 4 * MB);
+
+  // The empty pages are released by the next mark-sweep.
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->Capacity(Heap::kOld) <= capacity + PageSpace::kPageSize);
+  Array& array = Array::Handle();
+  array ^= live.At(0);
+  EXPECT_EQ(1 * KB, array.Length());
+
+  // Cached pages are reused.
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t i = 0; i < 1000; i++) {
+      live.SetAt(0, Array::Handle(Array::New(1 * KB, Heap::kOld)));
+    }
+  }
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->Verify());
+  array ^= live.At(0);
+  EXPECT_EQ(1 * KB, array.Length());
+
+  // Empty pages are kept as long as the free memory stays below the ratio.
+  FLAG_max_heap_free_ratio = 100;
+  capacity = heap->Capacity(Heap::kOld);
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t i = 0; i < 1000; i++) {
+      live.SetAt(0, Array::Handle(Array::New(1 * KB, Heap::kOld)));
+    }
+  }
+  intptr_t grown_capacity = heap->Capacity(Heap::kOld);
+  EXPECT(grown_capacity > capacity + 4 * MB);
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT_EQ(grown_capacity, heap->Capacity(Heap::kOld));
+
+  FLAG_max_heap_free_ratio = saved_max_free_ratio;
+  FLAG_compaction_threshold = saved_compaction_threshold;
+}
+
+
+TEST_CASE(MarkBits) {
+  Heap* heap = Isolate::Current()->heap();
+  bool saved_lazy_sweep = FLAG_lazy_sweep;
+  FLAG_lazy_sweep = true;
+  // Verification and the class histogram sweep the whole heap.
+  bool saved_verify_after_gc = FLAG_verify_after_gc;
+  FLAG_verify_after_gc = false;
+  bool saved_print_class_histogram = FLAG_print_class_histogram;
+  FLAG_print_class_histogram = false;
+
+  // Fill several pages with old arrays, only every tenth one stays reachable.
+  const intptr_t kCount = 10000;
+  const Array& live = Array::Handle(Array::New(kCount / 10, Heap::kOld));
+  Array& array = Array::Handle();
+  for (intptr_t i = 0; i < kCount; i++) {
+    array = Array::New(8, Heap::kOld);
+    if ((i % 10) == 0) {
+      live.SetAt(i / 10, array);
+    }
+  }
+  uword* headers = new uword[kCount / 10];
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT(!PageSpace::IsMarked(array.raw()));
+    headers[i] = *reinterpret_cast<uword*>(RawObject::ToAddr(array.raw()));
+  }
+
+  // Marking does not write to the live objects. The objects on the pages left
+  // unswept by the lazy sweep are still marked.
+  heap->CollectGarbage(Heap::kOld);
+  intptr_t num_marked = 0;
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT_EQ(headers[i],
+              *reinterpret_cast<uword*>(RawObject::ToAddr(array.raw())));
+    if (PageSpace::IsMarked(array.raw())) {
+      num_marked++;
+    }
+  }
+  EXPECT(num_marked > 0);
+
+  // Sweeping clears the mark bits.
+  FLAG_lazy_sweep = false;
+  heap->CollectGarbage(Heap::kOld);
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT_EQ(headers[i],
+              *reinterpret_cast<uword*>(RawObject::ToAddr(array.raw())));
+    EXPECT(!PageSpace::IsMarked(array.raw()));
+  }
+  delete[] headers;
+
+  FLAG_lazy_sweep = saved_lazy_sweep;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+  FLAG_print_class_histogram = saved_print_class_histogram;
+}
+
+
+TEST_CASE(IncrementalMarking) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  bool saved_incremental_marking = FLAG_incremental_marking;
+  intptr_t saved_threshold = FLAG_incremental_marking_threshold;
+  // Complete any marking started by the test setup.
+  FLAG_incremental_marking = false;
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(!Heap::IsMarkingBarrierActive());
+
+  // Build a chain of old arrays which takes several steps to mark. The last
+  // array of the chain refers to the target. The handles used while building
+  // the chain are released so that only the head is a root.
+  const intptr_t kLength = 100000;
+  const Array& head = Array::Handle(Array::New(2, Heap::kOld));
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    Array& array = Array::Handle(head.raw());
+    Array& next = Array::Handle();
+    for (intptr_t i = 0; i < kLength; i++) {
+      next = Array::New(2, Heap::kOld);
+      array.SetAt(0, next);
+      array = next.raw();
+    }
+    next = Array::New(1, Heap::kOld);
+    next.SetAt(0, Smi::Handle(Smi::New(42)));
+    array.SetAt(1, next);
+  }
+
+  // The next old allocation starts marking. Step until the head of the chain
+  // has been visited.
+  FLAG_incremental_marking = true;
+  FLAG_incremental_marking_threshold = 0;
+  Array& array = Array::Handle(Array::New(2, Heap::kOld));
+  EXPECT(Heap::IsMarkingBarrierActive());
+  array ^= head.At(0);
+  while (!PageSpace::IsMarked(array.raw())) {
+    heap->IdleMarkingStep();
+  }
+  EXPECT(Heap::IsMarkingBarrierActive());
+
+  // Move the target, which has not been reached yet, into the head so that
+  // it is only reachable through a visited object.
+  while (array.At(0) != Object::null()) {
+    array ^= array.At(0);
+  }
+  Array& target = Array::Handle();
+  target ^= array.At(1);
+  EXPECT(!PageSpace::IsMarked(target.raw()));
+  head.SetAt(1, target);
+  array.SetAt(1, Object::Handle());
+  array = Array::null();
+  target = Array::null();
+  while (Heap::IsMarkingBarrierActive()) {
+    heap->IdleMarkingStep();
+  }
+
+  // The write barrier kept the target alive.
+  target ^= head.At(1);
+  EXPECT_EQ(Smi::New(42), target.At(0));
+  EXPECT(heap->Verify());
+
+  FLAG_incremental_marking = saved_incremental_marking;
+  FLAG_incremental_marking_threshold = saved_threshold;
+}
+
+
+TEST_CASE(IdleCollection) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  bool saved_lazy_sweep = FLAG_lazy_sweep;
+  bool saved_incremental_marking = FLAG_incremental_marking;
+  FLAG_lazy_sweep = false;
+  FLAG_incremental_marking = false;
+  // Verification and the class histogram sweep the whole heap.
+  bool saved_verify_after_gc = FLAG_verify_after_gc;
+  FLAG_verify_after_gc = false;
+  bool saved_print_class_histogram = FLAG_print_class_histogram;
+  FLAG_print_class_histogram = false;
+  heap->CollectAllGarbage();
+  EXPECT(!heap->HasIdleWork());
+
+  // Allocate garbage in new space until it is worth a scavenge.
+  for (intptr_t i = 0; (i < 100000) && !heap->HasIdleWork(); i++) {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    Array::Handle(Array::New(16));
+  }
+  EXPECT(heap->HasIdleWork());
+  int scavenges = heap->Collections(Heap::kNew);
+  // The previous scavenge does not fit before a passed deadline.
+  heap->NotifyIdle(0);
+  EXPECT_EQ(scavenges, heap->Collections(Heap::kNew));
+  heap->NotifyIdle(OS::GetCurrentTimeMicros() + 10000000);
+  EXPECT_EQ(scavenges + 1, heap->Collections(Heap::kNew));
+  EXPECT(!heap->HasIdleWork());
+
+  // The pages left by a lazy sweep are swept in idle time.
+  FLAG_lazy_sweep = true;
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    for (intptr_t i = 0; i < 1000; i++) {
+      Array::Handle(Array::New(1 * KB, Heap::kOld));
+    }
+  }
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->HasIdleWork());
+  heap->NotifyIdle(OS::GetCurrentTimeMicros() + 10000000);
+  EXPECT(!heap->HasIdleWork());
+  EXPECT(heap->Verify());
+
+  FLAG_lazy_sweep = saved_lazy_sweep;
+  FLAG_incremental_marking = saved_incremental_marking;
+  FLAG_verify_after_gc = saved_verify_after_gc;
+  FLAG_print_class_histogram = saved_print_class_histogram;
+}
+
+
+TEST_CASE(Compaction) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  intptr_t saved_threshold = FLAG_compaction_threshold;
+  FLAG_compaction_threshold = 50;
+
+  // Fill several pages with old arrays, only every tenth one stays reachable.
+  // Some of them refer to new objects. The handles used while filling the
+  // pages are released.
+  const intptr_t kCount = 100000;
+  const Array& live = Array::Handle(Array::New(kCount / 10, Heap::kOld));
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    Array& array = Array::Handle();
+    for (intptr_t i = 0; i < kCount; i++) {
+      array = Array::New(8, Heap::kOld);
+      array.SetAt(0, Smi::Handle(Smi::New(i)));
+      if ((i % 1000) == 0) {
+        array.SetAt(1, String::Handle(String::New("new")));
+      }
+      if ((i % 10) == 0) {
+        live.SetAt(i / 10, array);
+      }
+    }
+  }
+  Array& array = Array::Handle();
+  array ^= live.At(kCount / 20);
+  RawArray* raw_before = array.raw();
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(heap->Verify());
+
+  // The surviving arrays were moved and the pointers to them updated.
+  array ^= live.At(kCount / 20);
+  EXPECT(array.raw() != raw_before);
+  heap->CollectGarbage(Heap::kNew);
+  String& str = String::Handle();
+  for (intptr_t i = 0; i < kCount / 10; i++) {
+    array ^= live.At(i);
+    EXPECT_EQ(Smi::New(i * 10), array.At(0));
+    if ((i % 100) == 0) {
+      str ^= array.At(1);
+      EXPECT(str.Equals("new"));
+    }
+  }
+  EXPECT(heap->Verify());
+
+  FLAG_compaction_threshold = saved_threshold;
+}
+
+
+TEST_CASE(PageTable) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  Heap* vm_heap = Dart::vm_isolate()->heap();
+  const String& new_str = String::Handle(String::New("new", Heap::kNew));
+  const String& old_str = String::Handle(String::New("old", Heap::kOld));
+  const intptr_t kLength = 1024 * 1024;
+  const Array& large = Array::Handle(Array::New(kLength, Heap::kOld));
+  uword new_addr = RawObject::ToAddr(new_str.raw());
+  uword old_addr = RawObject::ToAddr(old_str.raw());
+  uword large_end =
+      RawObject::ToAddr(large.raw()) + large.raw()->Size() - kWordSize;
+  uword null_addr = RawObject::ToAddr(Object::null());
+  uword stack_addr = reinterpret_cast<uword>(&heap);
+
+  EXPECT(heap->Contains(new_addr));
+  EXPECT(heap->Contains(old_addr));
+  EXPECT(!heap->CodeContains(old_addr));
+  EXPECT(!vm_heap->Contains(old_addr));
+  // Every chunk of a large page is covered by the page table.
+  EXPECT(heap->Contains(large_end));
+  EXPECT(!heap->Contains(null_addr));
+  EXPECT(vm_heap->Contains(null_addr));
+  EXPECT(heap->CodeContains(StubCode::InvokeDartCodeEntryPoint()));
+  EXPECT(vm_heap->CodeContains(StubCode::AllocateArrayEntryPoint()));
+  EXPECT(!heap->Contains(stack_addr));
+  EXPECT(!vm_heap->Contains(stack_addr));
+
+  // Released pages are removed from the table.
+  uword garbage_addr;
+  {
+    Zone zone(isolate);
+    HandleScope scope(isolate);
+    garbage_addr = RawObject::ToAddr(Array::New(kLength, Heap::kOld));
+  }
+  EXPECT(heap->Contains(garbage_addr));
+  heap->CollectGarbage(Heap::kOld);
+  EXPECT(!heap->Contains(garbage_addr));
+  EXPECT(heap->Contains(large_end));
+}
+
+
+// The time spent marking a pointer should not depend on the number of pages
+// in the heap.
+TEST_CASE(MarkingTimeByPageCount) {
+  Isolate* isolate = Isolate::Current();
+  Heap* heap = isolate->heap();
+  for (intptr_t num_arrays = 16 * KB; num_arrays <= 256 * KB;
+       num_arrays *= 4) {
+    const Array& live = Array::Handle(Array::New(num_arrays, Heap::kOld));
+    {
+      Zone zone(isolate);
+      HandleScope scope(isolate);
+      for (intptr_t i = 0; i < num_arrays; i++) {
+        live.SetAt(i, Array::Handle(Array::New(8, Heap::kOld)));
+      }
+    }
+    Timer timer(true, "Mark-Sweep");
+    timer.Start();
+    heap->CollectGarbage(Heap::kOld);
+    timer.Stop();
+    OS::Print("Mark-sweep of %d arrays: %lldus\n",
+              num_arrays, timer.TotalElapsedTime());
+  }
+}
+
+
+// Compares the throughput of the collections of a large heap with and
+// without transparent huge pages, each in a fresh isolate as the new space is
+// only set up for huge pages when the isolate is created.
+UNIT_TEST_CASE(HugePagesCollectionTime) {
+  if (!VirtualMemory::SupportsHugePages()) {
+    return;
+  }
+  const intptr_t kNumArrays = 128 * KB;
+  const intptr_t kNumCollections = 4;
+  bool saved_use_huge_pages = FLAG_use_huge_pages;
+  for (intptr_t i = 0; i < 2; i++) {
+    FLAG_use_huge_pages = (i == 1);
+    TestIsolateScope test_isolate;
+    Isolate* isolate = test_isolate.isolate();
+    Zone zone(isolate);
+    HandleScope handle_scope(isolate);
+    Heap* heap = isolate->heap();
+    const Array& live = Array::Handle(Array::New(kNumArrays, Heap::kOld));
+    for (intptr_t j = 0; j < kNumArrays; j++) {
+      HandleScope scope(isolate);
+      live.SetAt(j, Array::Handle(Array::New(8)));
+    }
+    Timer timer(true, "Collections");
+    timer.Start();
+    for (intptr_t j = 0; j < kNumCollections; j++) {
+      heap->CollectGarbage(Heap::kNew);
+      heap->CollectGarbage(Heap::kOld);
+    }
+    timer.Stop();
+    OS::Print("%d scavenges and mark-sweeps of %d arrays %s huge pages: "
+              "%lldus\n",
+              kNumCollections, kNumArrays,
+              FLAG_use_huge_pages ? "with" : "without",
+              timer.TotalElapsedTime());
+  }
+  FLAG_use_huge_pages = saved_use_huge_pages;
+}
+
+
 #if defined(TARGET_ARCH_IA32)
 TEST_CASE(OldGC) {
   const char* kScriptChars =
@@ -58,5 +763,65 @@ TEST_CASE(LargeSweep) {
   heap->CollectGarbage(Heap::kOld);
 }
 
+
+TEST_CASE(Pretenuring) {
+  const char* kScriptChars =
+  "class Record {\n"
+  "  Record(this.value);\n"
+  "  var value;\n"
+  "}\n"
+  "class HeapTester {\n"
+  "  static var records;\n"
+  "  static void fill(int count) {\n"
+  "    records = new List(count);\n"
+  "    for (int i = 0; i < count; i++) {\n"
+  "      records[i] = new Record(i);\n"
+  "    }\n"
+  "  }\n"
+  "  static void drop(int count) {\n"
+  "    for (int i = 0; i < count; i++) {\n"
+  "      new Record(i);\n"
+  "    }\n"
+  "  }\n"
+  "  static Record newRecord() {\n"
+  "    return new Record(0);\n"
+  "  }\n"
+  "}\n";
+  bool saved_pretenuring = FLAG_pretenuring;
+  FLAG_pretenuring = true;
+  Heap* heap = Isolate::Current()->heap();
+  Dart_Handle lib = TestCase::LoadTestScript(kScriptChars, NULL);
+  Dart_EnterScope();
+  Dart_Handle cls = Dart_NewString("HeapTester");
+  Dart_Handle count = Dart_NewInteger(10000);
+  Object& record = Object::Handle();
+
+  // Records which survive their first scavenge are allocated in old space.
+  heap->CollectGarbage(Heap::kNew);
+  EXPECT_VALID(Dart_InvokeStatic(lib, cls, Dart_NewString("fill"), 1, &count));
+  heap->CollectGarbage(Heap::kNew);
+  for (intptr_t i = 0; i < Class::kPretenuringSampleRate; i++) {
+    Dart_Handle result =
+        Dart_InvokeStatic(lib, cls, Dart_NewString("newRecord"), 0, NULL);
+    EXPECT_VALID(result);
+    record = Api::UnwrapHandle(result);
+    // Some records are still allocated in new space as samples.
+    EXPECT_EQ((i % Class::kPretenuringSampleRate) != 0,
+              record.raw()->IsOldObject());
+  }
+
+  // Until their survival rate drops.
+  EXPECT_VALID(Dart_InvokeStatic(lib, cls, Dart_NewString("drop"), 1, &count));
+  heap->CollectGarbage(Heap::kNew);
+  Dart_Handle result =
+      Dart_InvokeStatic(lib, cls, Dart_NewString("newRecord"), 0, NULL);
+  EXPECT_VALID(result);
+  record = Api::UnwrapHandle(result);
+  EXPECT(record.raw()->IsNewObject());
+
+  Dart_ExitScope();
+  FLAG_pretenuring = saved_pretenuring;
+}
+
 #endif  // TARGET_ARCH_IA32
 }
@@ -0,0 +1,339 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#include "vm/intermediate_language.h"
+
+#include "vm/os.h"
+
+namespace dart {
+
+#define DEFINE_ACCEPT(type)                                                    \
+  void type##Instr::Accept(FlowGraphVisitor* visitor) {                        \
+    visitor->Visit##type(this);                                                \
+  }
+FOR_EACH_INSTRUCTION(DEFINE_ACCEPT)
+#undef DEFINE_ACCEPT
+
+
+BlockEntryInstr* BranchInstr::SuccessorAt(intptr_t index) const {
+  ASSERT((index == 0) || (index == 1));
+  return (index == 0) ? true_successor_ : false_successor_;
+}
+
+
+void BlockEntryInstr::ReplacePredecessor(BlockEntryInstr* old_predecessor,
+                                         BlockEntryInstr* new_predecessor) {
+  for (intptr_t i = 0; i < predecessors_.length(); i++) {
+    if (predecessors_[i] == old_predecessor) {
+      predecessors_[i] = new_predecessor;
+      return;
+    }
+  }
+  UNREACHABLE();
+}
+
+
+void JoinEntryInstr::RemoveDeadPhis() {
+  intptr_t to = 0;
+  for (intptr_t from = 0; from < phis_.length(); from++) {
+    if (phis_[from]->replacement() == NULL) {
+      phis_[to++] = phis_[from];
+    }
+  }
+  while (phis_.length() > to) {
+    phis_.RemoveLast();
+  }
+}
+
+
+Definition* PhiInstr::UniqueInput() const {
+  Definition* result = NULL;
+  for (intptr_t i = 0; i < InputCount(); i++) {
+    Definition* input = InputAt(i)->Resolve();
+    if ((input == this) || (input == result)) continue;
+    if (result != NULL) return NULL;
+    result = input;
+  }
+  return result;
+}
+
+
+FlowGraph::FlowGraph(GraphEntryInstr* graph_entry,
+                     intptr_t parameter_count,
+                     intptr_t stack_local_count)
+    : graph_entry_(graph_entry),
+      parameter_count_(parameter_count),
+      stack_local_count_(stack_local_count),
+      reverse_postorder_(8),
+      max_ssa_temp_index_(0) {
+}
+
+
+void FlowGraph::Finalize() {
+  DiscoverBlocks();
+  ResolveReplacements();
+  ComputeUseCounts();
+}
+
+
+// Depth first traversal from the graph entry. Blocks are numbered in reverse
+// postorder and definitions in block order.
+void FlowGraph::DiscoverBlocks() {
+  GrowableArray<BlockEntryInstr*> postorder(8);
+  GrowableArray<BlockEntryInstr*> block_stack(8);
+  GrowableArray<intptr_t> successor_stack(8);
+  GrowableArray<BlockEntryInstr*> visited(8);
+  block_stack.Add(graph_entry_);
+  successor_stack.Add(0);
+  visited.Add(graph_entry_);
+  while (block_stack.length() > 0) {
+    BlockEntryInstr* block = block_stack.Last();
+    const intptr_t index = successor_stack.Last();
+    Instruction* last = block->last_instruction();
+    const intptr_t successor_count = block->IsGraphEntry()
+        ? 1 : last->SuccessorCount();
+    if (index == successor_count) {
+      postorder.Add(block);
+      block_stack.RemoveLast();
+      successor_stack.RemoveLast();
+      continue;
+    }
+    successor_stack[successor_stack.length() - 1] = index + 1;
+    BlockEntryInstr* successor = block->IsGraphEntry()
+        ? block->AsGraphEntry()->normal_entry()
+        : last->SuccessorAt(index);
+    bool seen = false;
+    for (intptr_t i = 0; i < visited.length(); i++) {
+      if (visited[i] == successor) {
+        seen = true;
+        break;
+      }
+    }
+    if (!seen) {
+      visited.Add(successor);
+      block_stack.Add(successor);
+      successor_stack.Add(0);
+    }
+  }
+  reverse_postorder_.Clear();
+  intptr_t ssa_temp_index = 0;
+  for (intptr_t i = postorder.length() - 1; i >= 0; i--) {
+    BlockEntryInstr* block = postorder[i];
+    block->set_block_id(reverse_postorder_.length());
+    reverse_postorder_.Add(block);
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        join->PhiAt(j)->set_ssa_temp_index(ssa_temp_index++);
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      Definition* defn = instr->AsDefinition();
+      if (defn != NULL) defn->set_ssa_temp_index(ssa_temp_index++);
+    }
+  }
+  max_ssa_temp_index_ = ssa_temp_index;
+}
+
+
+static void ResolveInputs(Instruction* instr) {
+  for (intptr_t i = 0; i < instr->InputCount(); i++) {
+    instr->SetInputAt(i, instr->InputAt(i)->Resolve());
+  }
+  Environment* env = instr->env();
+  if (env != NULL) {
+    for (intptr_t i = 0; i < env->Length(); i++) {
+      env->SetValueAt(i, env->ValueAt(i)->Resolve());
+    }
+  }
+}
+
+
+void FlowGraph::ResolveReplacements() {
+  for (intptr_t i = 0; i < reverse_postorder_.length(); i++) {
+    BlockEntryInstr* block = reverse_postorder_[i];
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        ResolveInputs(join->PhiAt(j));
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      ResolveInputs(instr);
+    }
+  }
+}
+
+
+static void ClearUses(Instruction* instr) {
+  for (intptr_t i = 0; i < instr->InputCount(); i++) {
+    instr->InputAt(i)->set_use_count(0);
+  }
+  Environment* env = instr->env();
+  if (env != NULL) {
+    for (intptr_t i = 0; i < env->Length(); i++) {
+      env->ValueAt(i)->set_use_count(0);
+    }
+  }
+}
+
+
+static void CountUses(Instruction* instr) {
+  for (intptr_t i = 0; i < instr->InputCount(); i++) {
+    instr->InputAt(i)->AddUse();
+  }
+  Environment* env = instr->env();
+  if (env != NULL) {
+    for (intptr_t i = 0; i < env->Length(); i++) {
+      env->ValueAt(i)->AddUse();
+    }
+  }
+}
+
+
+// Every used definition is an input or an environment value of some
+// instruction, clearing their counts first allows recounting.
+void FlowGraph::ComputeUseCounts() {
+  for (intptr_t i = 0; i < reverse_postorder_.length(); i++) {
+    BlockEntryInstr* block = reverse_postorder_[i];
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        ClearUses(join->PhiAt(j));
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      ClearUses(instr);
+    }
+  }
+  for (intptr_t i = 0; i < reverse_postorder_.length(); i++) {
+    BlockEntryInstr* block = reverse_postorder_[i];
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        CountUses(join->PhiAt(j));
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      CountUses(instr);
+    }
+  }
+}
+
+
+// Constants may be held in handles of an abstract class, e.g., type
+// arguments, print them through a handle of their actual class.
+static const char* ConstantToCString(ConstantInstr* constant) {
+  return Object::Handle(constant->value().raw()).ToCString();
+}
+
+
+static void PrintDefinitionName(Definition* defn) {
+  ConstantInstr* constant = defn->AsConstant();
+  if (constant != NULL) {
+    OS::Print("#%s", ConstantToCString(constant));
+  } else {
+    OS::Print("v%d", defn->ssa_temp_index());
+  }
+}
+
+
+static void PrintInputs(Instruction* instr) {
+  OS::Print("(");
+  for (intptr_t i = 0; i < instr->InputCount(); i++) {
+    if (i > 0) OS::Print(", ");
+    PrintDefinitionName(instr->InputAt(i));
+  }
+  OS::Print(")");
+}
+
+
+static void PrintInstruction(Instruction* instr) {
+  Definition* defn = instr->AsDefinition();
+  if (defn != NULL) {
+    OS::Print("    v%d <- ", defn->ssa_temp_index());
+  } else {
+    OS::Print("    ");
+  }
+  OS::Print("%s", instr->DebugName());
+  if (instr->IsInstanceCall()) {
+    OS::Print(":%s", instr->AsInstanceCall()->function_name().ToCString());
+  } else if (instr->IsStaticCall()) {
+    OS::Print(":%s", instr->AsStaticCall()->function().ToCString());
+  } else if (instr->IsEqualityCompare()) {
+    OS::Print(":%s", Token::Str(instr->AsEqualityCompare()->kind()));
+  } else if (instr->IsStrictCompare()) {
+    OS::Print(":%s", Token::Str(instr->AsStrictCompare()->kind()));
+  } else if (instr->IsParameter()) {
+    OS::Print(":%d", instr->AsParameter()->frame_index());
+  } else if (instr->IsConstant()) {
+    OS::Print(":%s", ConstantToCString(instr->AsConstant()));
+  } else if (instr->IsCheckClass()) {
+    CheckClassInstr* check = instr->AsCheckClass();
+    for (intptr_t i = 0; i < check->ClassCount(); i++) {
+      OS::Print("%s%s",
+                (i == 0) ? ":" : ",",
+                String::Handle(check->ClassAt(i).Name()).ToCString());
+    }
+  } else if (instr->IsClassTest()) {
+    OS::Print(":%s",
+              String::Handle(instr->AsClassTest()->cls().Name()).ToCString());
+  }
+  PrintInputs(instr);
+  if (instr->IsGoto()) {
+    OS::Print(" B%d", instr->AsGoto()->successor()->block_id());
+  } else if (instr->IsBranch()) {
+    OS::Print(" B%d B%d",
+              instr->AsBranch()->true_successor()->block_id(),
+              instr->AsBranch()->false_successor()->block_id());
+  }
+  Environment* env = instr->env();
+  if (env != NULL) {
+    OS::Print(" env@%d {", env->deopt_id());
+    for (intptr_t i = 0; i < env->Length(); i++) {
+      if (i > 0) OS::Print(i == env->local_count() ? " | " : ", ");
+      PrintDefinitionName(env->ValueAt(i));
+    }
+    OS::Print("}");
+  }
+  OS::Print("\n");
+}
+
+
+void FlowGraph::Print() const {
+  OS::Print("==== Flow graph (%d parameters, %d stack locals)\n",
+            parameter_count_, stack_local_count_);
+  for (intptr_t i = 0; i < reverse_postorder_.length(); i++) {
+    BlockEntryInstr* block = reverse_postorder_[i];
+    OS::Print("B%d [%s]", block->block_id(), block->DebugName());
+    if (block->PredecessorCount() > 0) {
+      OS::Print(" <-");
+      for (intptr_t j = 0; j < block->PredecessorCount(); j++) {
+        OS::Print(" B%d", block->PredecessorAt(j)->block_id());
+      }
+    }
+    OS::Print("\n");
+    if (block->IsJoinEntry()) {
+      JoinEntryInstr* join = block->AsJoinEntry();
+      for (intptr_t j = 0; j < join->PhiCount(); j++) {
+        PrintInstruction(join->PhiAt(j));
+      }
+    }
+    for (Instruction* instr = block->next();
+         instr != NULL;
+         instr = instr->next()) {
+      PrintInstruction(instr);
+    }
+  }
+}
+
+}  // namespace dart
@@ -0,0 +1,870 @@
+// Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
+// for details. All rights reserved. Use of this source code is governed by a
+// BSD-style license that can be found in the LICENSE file.
+
+#ifndef VM_INTERMEDIATE_LANGUAGE_H_
+#define VM_INTERMEDIATE_LANGUAGE_H_
+
+#include "vm/allocation.h"
+#include "vm/assert.h"
+#include "vm/growable_array.h"
+#include "vm/ic_data.h"
+#include "vm/object.h"
+#include "vm/token.h"
+
+namespace dart {
+
+// Flow graph intermediate representation used by the optimizing compiler.
+//
+// A flow graph is a set of basic blocks. Each block starts with a block entry
+// instruction and ends with a control instruction (goto, branch, return or
+// throw). Values are definitions in SSA form: every definition is assigned
+// exactly once and joins merge values with phis.
+//
+// Instructions that may deoptimize carry an environment describing the frame
+// of the unoptimized code at the deoptimization point of the AST node they
+// were built from: the values of the parameters and stack locals followed by
+// the values on the expression stack.
+
+#define FOR_EACH_INSTRUCTION(M)                                                \
+  M(GraphEntry)                                                                \
+  M(TargetEntry)                                                               \
+  M(JoinEntry)                                                                 \
+  M(Goto)                                                                      \
+  M(Branch)                                                                    \
+  M(Return)                                                                    \
+  M(Throw)                                                                     \
+  M(Constant)                                                                  \
+  M(Parameter)                                                                 \
+  M(Phi)                                                                       \
+  M(InstanceCall)                                                              \
+  M(StaticCall)                                                                \
+  M(EqualityCompare)                                                           \
+  M(StrictCompare)                                                             \
+  M(BooleanNegate)                                                             \
+  M(LoadInstanceField)                                                         \
+  M(StoreInstanceField)                                                        \
+  M(LoadStaticField)                                                           \
+  M(StoreStaticField)                                                          \
+  M(CreateArray)                                                               \
+  M(AllocateObject)                                                            \
+  M(CheckClass)                                                                \
+  M(ClassTest)                                                                 \
+
+
+#define FORWARD_DECLARATION(type) class type##Instr;
+FOR_EACH_INSTRUCTION(FORWARD_DECLARATION)
+#undef FORWARD_DECLARATION
+
+class BlockEntryInstr;
+class Definition;
+class Environment;
+class FlowGraphVisitor;
+
+
+#define DECLARE_INSTRUCTION(type)                                              \
+  virtual void Accept(FlowGraphVisitor* visitor);                              \
+  virtual const char* DebugName() const { return #type; }                      \
+  virtual bool Is##type() const { return true; }                               \
+  virtual type##Instr* As##type() { return this; }
+
+
+class Instruction : public ZoneAllocated {
+ public:
+  Instruction()
+      : next_(NULL),
+        previous_(NULL),
+        env_(NULL),
+        inputs_(2),
+        is_call_(false) { }
+
+  Instruction* next() const { return next_; }
+  void set_next(Instruction* instr) { next_ = instr; }
+  Instruction* previous() const { return previous_; }
+  void set_previous(Instruction* instr) { previous_ = instr; }
+
+  intptr_t InputCount() const { return inputs_.length(); }
+  Definition* InputAt(intptr_t i) const { return inputs_[i]; }
+  void SetInputAt(intptr_t i, Definition* value) { inputs_[i] = value; }
+  void AddInput(Definition* value) { inputs_.Add(value); }
+
+  // The environment used when deoptimizing at this instruction, or NULL if
+  // this instruction never deoptimizes.
+  Environment* env() const { return env_; }
+  void set_env(Environment* env) { env_ = env; }
+
+  // Set by the code generator before register allocation if the code of this
+  // instruction calls out. No register holding a value survives a call.
+  bool is_call() const { return is_call_; }
+  void set_is_call(bool value) { is_call_ = value; }
+
+  virtual bool IsBlockEntry() const { return false; }
+  virtual BlockEntryInstr* AsBlockEntry() { return NULL; }
+  virtual bool IsDefinition() const { return false; }
+  virtual Definition* AsDefinition() { return NULL; }
+  virtual bool IsControl() const { return false; }
+
+  // Successor blocks of control instructions.
+  virtual intptr_t SuccessorCount() const { return 0; }
+  virtual BlockEntryInstr* SuccessorAt(intptr_t index) const {
+    UNREACHABLE();
+    return NULL;
+  }
+
+#define INSTRUCTION_TYPE_CHECK(type)                                           \
+  virtual bool Is##type() const { return false; }                              \
+  virtual type##Instr* As##type() { return NULL; }
+FOR_EACH_INSTRUCTION(INSTRUCTION_TYPE_CHECK)
+#undef INSTRUCTION_TYPE_CHECK
+
+  virtual void Accept(FlowGraphVisitor* visitor) = 0;
+  virtual const char* DebugName() const = 0;
+
+ private:
+  Instruction* next_;
+  Instruction* previous_;
+  Environment* env_;
+  GrowableArray<Definition*> inputs_;
+  bool is_call_;
+
+  DISALLOW_COPY_AND_ASSIGN(Instruction);
+};
+
+
+// The frame state of the unoptimized code at a deoptimization point.
+class Environment : public ZoneAllocated {
+ public:
+  Environment(intptr_t deopt_id,
+              intptr_t token_index,
+              intptr_t local_count,
+              const GrowableArray<Definition*>& values)
+      : deopt_id_(deopt_id),
+        token_index_(token_index),
+        local_count_(local_count),
+        values_(values.length()) {
+    ASSERT(local_count <= values.length());
+    values_.AddArray(values);
+  }
+
+  // AST node id of the deoptimization point in unoptimized code.
+  intptr_t deopt_id() const { return deopt_id_; }
+  intptr_t token_index() const { return token_index_; }
+
+  intptr_t Length() const { return values_.length(); }
+  Definition* ValueAt(intptr_t i) const { return values_[i]; }
+  void SetValueAt(intptr_t i, Definition* value) { values_[i] = value; }
+
+  // The first 'local_count' values are the parameters and stack locals, the
+  // rest is the expression stack, bottom first.
+  intptr_t local_count() const { return local_count_; }
+  intptr_t StackHeight() const { return Length() - local_count_; }
+
+ private:
+  const intptr_t deopt_id_;
+  const intptr_t token_index_;
+  const intptr_t local_count_;
+  GrowableArray<Definition*> values_;
+
+  DISALLOW_COPY_AND_ASSIGN(Environment);
+};
+
+
+class BlockEntryInstr : public Instruction {
+ public:
+  intptr_t block_id() const { return block_id_; }
+  void set_block_id(intptr_t value) { block_id_ = value; }
+
+  intptr_t PredecessorCount() const { return predecessors_.length(); }
+  BlockEntryInstr* PredecessorAt(intptr_t i) const { return predecessors_[i]; }
+  void AddPredecessor(BlockEntryInstr* predecessor) {
+    predecessors_.Add(predecessor);
+  }
+  // Keeps the index of the predecessor, which phi inputs depend on.
+  void ReplacePredecessor(BlockEntryInstr* old_predecessor,
+                          BlockEntryInstr* new_predecessor);
+
+  Instruction* last_instruction() const { return last_instruction_; }
+  void set_last_instruction(Instruction* instr) { last_instruction_ = instr; }
+
+  virtual bool IsBlockEntry() const { return true; }
+  virtual BlockEntryInstr* AsBlockEntry() { return this; }
+
+ protected:
+  BlockEntryInstr()
+      : block_id_(-1), predecessors_(2), last_instruction_(NULL) { }
+
+ private:
+  intptr_t block_id_;
+  GrowableArray<BlockEntryInstr*> predecessors_;
+  Instruction* last_instruction_;
+
+  DISALLOW_COPY_AND_ASSIGN(BlockEntryInstr);
+};
+
+
+// The unique entry of the graph, its successor is the function body.
+class GraphEntryInstr : public BlockEntryInstr {
+ public:
+  explicit GraphEntryInstr(TargetEntryInstr* normal_entry)
+      : normal_entry_(normal_entry) { }
+
+  TargetEntryInstr* normal_entry() const { return normal_entry_; }
+
+  DECLARE_INSTRUCTION(GraphEntry)
+
+ private:
+  TargetEntryInstr* normal_entry_;
+
+  DISALLOW_COPY_AND_ASSIGN(GraphEntryInstr);
+};
+
+
+// A block with a single predecessor.
+class TargetEntryInstr : public BlockEntryInstr {
+ public:
+  TargetEntryInstr() { }
+
+  DECLARE_INSTRUCTION(TargetEntry)
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TargetEntryInstr);
+};
+
+
+// A block with any number of predecessors, the only kind of block with phis.
+// Predecessors always end with a goto.
+class JoinEntryInstr : public BlockEntryInstr {
+ public:
+  JoinEntryInstr() : phis_(2) { }
+
+  intptr_t PhiCount() const { return phis_.length(); }
+  PhiInstr* PhiAt(intptr_t i) const { return phis_[i]; }
+  void AddPhi(PhiInstr* phi) { phis_.Add(phi); }
+  void RemoveDeadPhis();
+
+  DECLARE_INSTRUCTION(JoinEntry)
+
+ private:
+  GrowableArray<PhiInstr*> phis_;
+
+  DISALLOW_COPY_AND_ASSIGN(JoinEntryInstr);
+};
+
+
+class GotoInstr : public Instruction {
+ public:
+  explicit GotoInstr(JoinEntryInstr* successor) : successor_(successor) { }
+
+  JoinEntryInstr* successor() const { return successor_; }
+
+  virtual bool IsControl() const { return true; }
+  virtual intptr_t SuccessorCount() const { return 1; }
+  virtual BlockEntryInstr* SuccessorAt(intptr_t index) const {
+    ASSERT(index == 0);
+    return successor_;
+  }
+
+  DECLARE_INSTRUCTION(Goto)
+
+ private:
+  JoinEntryInstr* successor_;
+
+  DISALLOW_COPY_AND_ASSIGN(GotoInstr);
+};
+
+
+// Continues with 'true_successor' if the value is the true object, with
+// 'false_successor' otherwise.
+class BranchInstr : public Instruction {
+ public:
+  BranchInstr(Definition* value,
+              TargetEntryInstr* true_successor,
+              TargetEntryInstr* false_successor)
+      : true_successor_(true_successor),
+        false_successor_(false_successor) {
+    AddInput(value);
+  }
+
+  Definition* value() const { return InputAt(0); }
+  TargetEntryInstr* true_successor() const { return true_successor_; }
+  TargetEntryInstr* false_successor() const { return false_successor_; }
+
+  virtual bool IsControl() const { return true; }
+  virtual intptr_t SuccessorCount() const { return 2; }
+  virtual BlockEntryInstr* SuccessorAt(intptr_t index) const;
+
+  DECLARE_INSTRUCTION(Branch)
+
+ private:
+  TargetEntryInstr* true_successor_;
+  TargetEntryInstr* false_successor_;
+
+  DISALLOW_COPY_AND_ASSIGN(BranchInstr);
+};
+
+
+class ReturnInstr : public Instruction {
+ public:
+  ReturnInstr(intptr_t token_index, Definition* value)
+      : token_index_(token_index) {
+    AddInput(value);
+  }
+
+  intptr_t token_index() const { return token_index_; }
+  Definition* value() const { return InputAt(0); }
+
+  virtual bool IsControl() const { return true; }
+
+  DECLARE_INSTRUCTION(Return)
+
+ private:
+  const intptr_t token_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(ReturnInstr);
+};
+
+
+class ThrowInstr : public Instruction {
+ public:
+  ThrowInstr(intptr_t node_id, intptr_t token_index, Definition* exception)
+      : node_id_(node_id), token_index_(token_index) {
+    AddInput(exception);
+  }
+
+  intptr_t node_id() const { return node_id_; }
+  intptr_t token_index() const { return token_index_; }
+  Definition* exception() const { return InputAt(0); }
+
+  virtual bool IsControl() const { return true; }
+
+  DECLARE_INSTRUCTION(Throw)
+
+ private:
+  const intptr_t node_id_;
+  const intptr_t token_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(ThrowInstr);
+};
+
+
+// An instruction producing a value.
+class Definition : public Instruction {
+ public:
+  Definition() : ssa_temp_index_(-1), use_count_(0), replacement_(NULL) { }
+
+  intptr_t ssa_temp_index() const { return ssa_temp_index_; }
+  void set_ssa_temp_index(intptr_t index) { ssa_temp_index_ = index; }
+
+  // Number of uses by instruction inputs, phis and environments.
+  intptr_t use_count() const { return use_count_; }
+  void set_use_count(intptr_t count) { use_count_ = count; }
+  void AddUse() { use_count_++; }
+
+  // Set when this definition has been replaced by another one, e.g., when a
+  // redundant phi is removed.
+  Definition* replacement() const { return replacement_; }
+  void set_replacement(Definition* value) {
+    ASSERT(value != this);
+    replacement_ = value;
+  }
+
+  // Follows the chain of replacements.
+  Definition* Resolve() {
+    Definition* result = this;
+    while (result->replacement() != NULL) {
+      result = result->replacement();
+    }
+    return result;
+  }
+
+  virtual bool IsDefinition() const { return true; }
+  virtual Definition* AsDefinition() { return this; }
+
+ private:
+  intptr_t ssa_temp_index_;
+  intptr_t use_count_;
+  Definition* replacement_;
+
+  DISALLOW_COPY_AND_ASSIGN(Definition);
+};
+
+
+class ConstantInstr : public Definition {
+ public:
+  explicit ConstantInstr(const Object& value) : value_(value) {
+    ASSERT(value.IsZoneHandle());
+  }
+
+  const Object& value() const { return value_; }
+
+  DECLARE_INSTRUCTION(Constant)
+
+ private:
+  const Object& value_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConstantInstr);
+};
+
+
+// The incoming value of a parameter, it lives in the caller's frame at
+// 'frame_index' words from the frame pointer.
+class ParameterInstr : public Definition {
+ public:
+  explicit ParameterInstr(intptr_t frame_index) : frame_index_(frame_index) { }
+
+  intptr_t frame_index() const { return frame_index_; }
+
+  DECLARE_INSTRUCTION(Parameter)
+
+ private:
+  const intptr_t frame_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParameterInstr);
+};
+
+
+// The i-th input of a phi flows in from the i-th predecessor of its block.
+class PhiInstr : public Definition {
+ public:
+  explicit PhiInstr(JoinEntryInstr* block) : block_(block) { }
+
+  JoinEntryInstr* block() const { return block_; }
+
+  // Returns the unique input different from this phi, or NULL if there are
+  // several.
+  Definition* UniqueInput() const;
+
+  DECLARE_INSTRUCTION(Phi)
+
+ private:
+  JoinEntryInstr* block_;
+
+  DISALLOW_COPY_AND_ASSIGN(PhiInstr);
+};
+
+
+// A dynamically dispatched call. The inputs are the receiver followed by the
+// arguments. 'token_kind' records the operator the call implements, if any:
+// binary and relational operators, Token::kNEGATE and Token::kBIT_NOT for
+// unary operators, Token::kINDEX and Token::kASSIGN_INDEX for indexed
+// accesses, Token::kGET and Token::kSET for field accesses and
+// Token::kILLEGAL for other calls.
+class InstanceCallInstr : public Definition {
+ public:
+  InstanceCallInstr(intptr_t node_id,
+                    intptr_t token_index,
+                    const String& function_name,
+                    Token::Kind token_kind,
+                    const Array& argument_names,
+                    intptr_t checked_argument_count,
+                    const ICData& ic_data)
+      : node_id_(node_id),
+        token_index_(token_index),
+        function_name_(function_name),
+        token_kind_(token_kind),
+        argument_names_(argument_names),
+        checked_argument_count_(checked_argument_count),
+        ic_data_(ic_data) {
+    ASSERT(function_name.IsZoneHandle());
+    ASSERT(argument_names.IsZoneHandle());
+  }
+
+  intptr_t node_id() const { return node_id_; }
+  void set_node_id(intptr_t value) { node_id_ = value; }
+  intptr_t token_index() const { return token_index_; }
+  void set_token_index(intptr_t value) { token_index_ = value; }
+  const String& function_name() const { return function_name_; }
+  Token::Kind token_kind() const { return token_kind_; }
+  const Array& argument_names() const { return argument_names_; }
+  intptr_t checked_argument_count() const { return checked_argument_count_; }
+  // Type feedback collected by unoptimized code at 'node_id'.
+  const ICData& ic_data() const { return ic_data_; }
+
+  intptr_t ArgumentCount() const { return InputCount(); }
+  Definition* ArgumentAt(intptr_t i) const { return InputAt(i); }
+
+  DECLARE_INSTRUCTION(InstanceCall)
+
+ private:
+  intptr_t node_id_;
+  intptr_t token_index_;
+  const String& function_name_;
+  const Token::Kind token_kind_;
+  const Array& argument_names_;
+  const intptr_t checked_argument_count_;
+  const ICData& ic_data_;
+
+  DISALLOW_COPY_AND_ASSIGN(InstanceCallInstr);
+};
+
+
+class StaticCallInstr : public Definition {
+ public:
+  StaticCallInstr(intptr_t token_index,
+                  const Function& function,
+                  const Array& argument_names)
+      : token_index_(token_index),
+        function_(function),
+        argument_names_(argument_names) {
+    ASSERT(function.IsZoneHandle());
+    ASSERT(argument_names.IsZoneHandle());
+  }
+
+  intptr_t token_index() const { return token_index_; }
+  void set_token_index(intptr_t value) { token_index_ = value; }
+  const Function& function() const { return function_; }
+  const Array& argument_names() const { return argument_names_; }
+
+  intptr_t ArgumentCount() const { return InputCount(); }
+  Definition* ArgumentAt(intptr_t i) const { return InputAt(i); }
+
+  DECLARE_INSTRUCTION(StaticCall)
+
+ private:
+  intptr_t token_index_;
+  const Function& function_;
+  const Array& argument_names_;
+
+  DISALLOW_COPY_AND_ASSIGN(StaticCallInstr);
+};
+
+
+// Operators '==' and '!='. A null left operand is compared by identity,
+// otherwise the '==' operator of the left operand is invoked.
+class EqualityCompareInstr : public Definition {
+ public:
+  EqualityCompareInstr(intptr_t node_id,
+                       intptr_t token_index,
+                       Token::Kind kind,
+                       Definition* left,
+                       Definition* right,
+                       const ICData& ic_data)
+      : node_id_(node_id),
+        token_index_(token_index),
+        kind_(kind),
+        ic_data_(ic_data) {
+    ASSERT((kind == Token::kEQ) || (kind == Token::kNE));
+    AddInput(left);
+    AddInput(right);
+  }
+
+  intptr_t node_id() const { return node_id_; }
+  void set_node_id(intptr_t value) { node_id_ = value; }
+  intptr_t token_index() const { return token_index_; }
+  void set_token_index(intptr_t value) { token_index_ = value; }
+  Token::Kind kind() const { return kind_; }
+  Definition* left() const { return InputAt(0); }
+  Definition* right() const { return InputAt(1); }
+  const ICData& ic_data() const { return ic_data_; }
+
+  DECLARE_INSTRUCTION(EqualityCompare)
+
+ private:
+  intptr_t node_id_;
+  intptr_t token_index_;
+  const Token::Kind kind_;
+  const ICData& ic_data_;
+
+  DISALLOW_COPY_AND_ASSIGN(EqualityCompareInstr);
+};
+
+
+// Operators '===' and '!=='.
+class StrictCompareInstr : public Definition {
+ public:
+  StrictCompareInstr(Token::Kind kind, Definition* left, Definition* right)
+      : kind_(kind) {
+    ASSERT((kind == Token::kEQ_STRICT) || (kind == Token::kNE_STRICT));
+    AddInput(left);
+    AddInput(right);
+  }
+
+  Token::Kind kind() const { return kind_; }
+  Definition* left() const { return InputAt(0); }
+  Definition* right() const { return InputAt(1); }
+
+  DECLARE_INSTRUCTION(StrictCompare)
+
+ private:
+  const Token::Kind kind_;
+
+  DISALLOW_COPY_AND_ASSIGN(StrictCompareInstr);
+};
+
+
+// Operator '!': false if the value is true, true otherwise.
+class BooleanNegateInstr : public Definition {
+ public:
+  explicit BooleanNegateInstr(Definition* value) {
+    AddInput(value);
+  }
+
+  Definition* value() const { return InputAt(0); }
+
+  DECLARE_INSTRUCTION(BooleanNegate)
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(BooleanNegateInstr);
+};
+
+
+class LoadInstanceFieldInstr : public Definition {
+ public:
+  LoadInstanceFieldInstr(const Field& field, Definition* instance)
+      : field_(field) {
+    ASSERT(field.IsZoneHandle());
+    AddInput(instance);
+  }
+
+  const Field& field() const { return field_; }
+  Definition* instance() const { return InputAt(0); }
+
+  DECLARE_INSTRUCTION(LoadInstanceField)
+
+ private:
+  const Field& field_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadInstanceFieldInstr);
+};
+
+
+class StoreInstanceFieldInstr : public Instruction {
+ public:
+  StoreInstanceFieldInstr(const Field& field,
+                          Definition* instance,
+                          Definition* value)
+      : field_(field) {
+    ASSERT(field.IsZoneHandle());
+    AddInput(instance);
+    AddInput(value);
+  }
+
+  const Field& field() const { return field_; }
+  Definition* instance() const { return InputAt(0); }
+  Definition* value() const { return InputAt(1); }
+
+  DECLARE_INSTRUCTION(StoreInstanceField)
+
+ private:
+  const Field& field_;
+
+  DISALLOW_COPY_AND_ASSIGN(StoreInstanceFieldInstr);
+};
+
+
+class LoadStaticFieldInstr : public Definition {
+ public:
+  explicit LoadStaticFieldInstr(const Field& field) : field_(field) {
+    ASSERT(field.IsZoneHandle());
+  }
+
+  const Field& field() const { return field_; }
+
+  DECLARE_INSTRUCTION(LoadStaticField)
+
+ private:
+  const Field& field_;
+
+  DISALLOW_COPY_AND_ASSIGN(LoadStaticFieldInstr);
+};
+
+
+class StoreStaticFieldInstr : public Instruction {
+ public:
+  StoreStaticFieldInstr(const Field& field, Definition* value)
+      : field_(field) {
+    ASSERT(field.IsZoneHandle());
+    AddInput(value);
+  }
+
+  const Field& field() const { return field_; }
+  Definition* value() const { return InputAt(0); }
+
+  DECLARE_INSTRUCTION(StoreStaticField)
+
+ private:
+  const Field& field_;
+
+  DISALLOW_COPY_AND_ASSIGN(StoreStaticFieldInstr);
+};
+
+
+// Allocates an array holding the input values.
+class CreateArrayInstr : public Definition {
+ public:
+  CreateArrayInstr(intptr_t token_index,
+                   const AbstractTypeArguments& type_arguments)
+      : token_index_(token_index), type_arguments_(type_arguments) {
+    ASSERT(type_arguments.IsZoneHandle());
+  }
+
+  intptr_t token_index() const { return token_index_; }
+  void set_token_index(intptr_t value) { token_index_ = value; }
+  const AbstractTypeArguments& type_arguments() const {
+    return type_arguments_;
+  }
+  intptr_t ElementCount() const { return InputCount(); }
+  Definition* ElementAt(intptr_t i) const { return InputAt(i); }
+
+  DECLARE_INSTRUCTION(CreateArray)
+
+ private:
+  intptr_t token_index_;
+  const AbstractTypeArguments& type_arguments_;
+
+  DISALLOW_COPY_AND_ASSIGN(CreateArrayInstr);
+};
+
+
+// Allocates an uninitialized instance of 'cls', the constructor is invoked
+// with a separate static call. The type arguments are null or instantiated.
+class AllocateObjectInstr : public Definition {
+ public:
+  AllocateObjectInstr(intptr_t token_index,
+                      const Class& cls,
+                      const AbstractTypeArguments& type_arguments)
+      : token_index_(token_index),
+        cls_(cls),
+        type_arguments_(type_arguments) {
+    ASSERT(cls.IsZoneHandle());
+    ASSERT(type_arguments.IsZoneHandle());
+  }
+
+  intptr_t token_index() const { return token_index_; }
+  void set_token_index(intptr_t value) { token_index_ = value; }
+  const Class& cls() const { return cls_; }
+  const AbstractTypeArguments& type_arguments() const {
+    return type_arguments_;
+  }
+
+  DECLARE_INSTRUCTION(AllocateObject)
+
+ private:
+  intptr_t token_index_;
+  const Class& cls_;
+  const AbstractTypeArguments& type_arguments_;
+
+  DISALLOW_COPY_AND_ASSIGN(AllocateObjectInstr);
+};
+
+
+// Deoptimizes unless the class of the value is one of 'classes', Smis have
+// the Smi class.
+class CheckClassInstr : public Instruction {
+ public:
+  CheckClassInstr(Definition* value,
+                  const GrowableArray<const Class*>& classes)
+      : classes_(classes.length()) {
+    for (intptr_t i = 0; i < classes.length(); i++) {
+      ASSERT(classes[i]->IsZoneHandle());
+      classes_.Add(classes[i]);
+    }
+    AddInput(value);
+  }
+
+  Definition* value() const { return InputAt(0); }
+  intptr_t ClassCount() const { return classes_.length(); }
+  const Class& ClassAt(intptr_t i) const { return *classes_[i]; }
+
+  DECLARE_INSTRUCTION(CheckClass)
+
+ private:
+  GrowableArray<const Class*> classes_;
+
+  DISALLOW_COPY_AND_ASSIGN(CheckClassInstr);
+};
+
+
+// True if the class of the value is 'cls', false otherwise.
+class ClassTestInstr : public Definition {
+ public:
+  ClassTestInstr(Definition* value, const Class& cls) : cls_(cls) {
+    ASSERT(cls.IsZoneHandle());
+    AddInput(value);
+  }
+
+  Definition* value() const { return InputAt(0); }
+  const Class& cls() const { return cls_; }
+
+  DECLARE_INSTRUCTION(ClassTest)
+
+ private:
+  const Class& cls_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassTestInstr);
+};
+
+#undef DECLARE_INSTRUCTION
+
+
+class FlowGraphVisitor : public ValueObject {
+ public:
+  FlowGraphVisitor() { }
+  virtual ~FlowGraphVisitor() { }
+
+#define DECLARE_VISIT_INSTRUCTION(type)                                        \
+  virtual void Visit##type(type##Instr* instr) { }
+FOR_EACH_INSTRUCTION(DECLARE_VISIT_INSTRUCTION)
+#undef DECLARE_VISIT_INSTRUCTION
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(FlowGraphVisitor);
+};
+
+
+// A function body as a graph of basic blocks. Environments index the
+// parameters first, then the stack locals.
+class FlowGraph : public ZoneAllocated {
+ public:
+  FlowGraph(GraphEntryInstr* graph_entry,
+            intptr_t parameter_count,
+            intptr_t stack_local_count);
+
+  GraphEntryInstr* graph_entry() const { return graph_entry_; }
+  intptr_t parameter_count() const { return parameter_count_; }
+  intptr_t stack_local_count() const { return stack_local_count_; }
+  intptr_t local_count() const {
+    return parameter_count_ + stack_local_count_;
+  }
+
+  // Frame index, in words from the frame pointer, of environment slot
+  // 'local_index'.
+  intptr_t FrameIndexOf(intptr_t local_index) const {
+    ASSERT((0 <= local_index) && (local_index < local_count()));
+    if (local_index < parameter_count_) {
+      return 1 + parameter_count_ - local_index;
+    }
+    return parameter_count_ - 1 - local_index;
+  }
+
+  // Blocks in reverse postorder, the graph entry first.
+  const GrowableArray<BlockEntryInstr*>& reverse_postorder() const {
+    return reverse_postorder_;
+  }
+
+  intptr_t max_ssa_temp_index() const { return max_ssa_temp_index_; }
+
+  // Computes the block order, numbers blocks and definitions, replaces uses
+  // of replaced definitions and counts uses. Called once the graph is
+  // complete, and again when blocks have been added to it.
+  void Finalize();
+
+  void Print() const;
+
+ private:
+  void DiscoverBlocks();
+  void ResolveReplacements();
+  void ComputeUseCounts();
+
+  GraphEntryInstr* graph_entry_;
+  const intptr_t parameter_count_;
+  const intptr_t stack_local_count_;
+  GrowableArray<BlockEntryInstr*> reverse_postorder_;
+  intptr_t max_ssa_temp_index_;
+
+  DISALLOW_COPY_AND_ASSIGN(FlowGraph);
+};
+
+}  // namespace dart
+
+#endif  // VM_INTERMEDIATE_LANGUAGE_H_
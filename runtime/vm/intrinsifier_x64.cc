@@ -1,15 +1,1101 @@
 // Copyright (c) 2011, the Dart project authors.  Please see the AUTHORS file
 // for details. All rights reserved. Use of this source code is governed by a
 // BSD-style license that can be found in the LICENSE file.
+//
+// The intrinsic code below is executed before a method has built its frame.
+// The return address is on the stack and the arguments below it.
+// Registers R10 (arguments descriptor) and RBX (function) must be preserved.
+// Each intrinsification method returns true if the corresponding
+// Dart method was intrinsified.
 
 #include "vm/globals.h"  // Needed here to get TARGET_ARCH_X64.
 #if defined(TARGET_ARCH_X64)
 
 #include "vm/intrinsifier.h"
 
+#include "vm/assembler.h"
+#include "vm/assembler_macros.h"
+#include "vm/object.h"
+#include "vm/object_store.h"
+#include "vm/os.h"
+#include "vm/stub_code.h"
+
 namespace dart {
 
+DEFINE_FLAG(bool, intrinsify, true, "Instrinsify when possible");
+DECLARE_FLAG(bool, enable_type_checks);
+
+// List of intrinsics: (class-name, function-name, intrinsification method).
+#define INTRINSIC_LIST(V)                                                      \
+  V(IntegerImplementation, addFromInteger, Integer_addFromInteger)             \
+  V(IntegerImplementation, +, Integer_addFromInteger)                          \
+  V(IntegerImplementation, subFromInteger, Integer_subFromInteger)             \
+  V(IntegerImplementation, -, Integer_sub)                                     \
+  V(IntegerImplementation, mulFromInteger, Integer_mulFromInteger)             \
+  V(IntegerImplementation, *, Integer_mulFromInteger)                          \
+  V(IntegerImplementation, %, Integer_modulo)                                  \
+  V(IntegerImplementation, ~/, Integer_truncDivide)                            \
+  V(IntegerImplementation, negate, Integer_negate)                             \
+  V(IntegerImplementation, bitAndFromInteger, Integer_bitAndFromInteger)       \
+  V(IntegerImplementation, &, Integer_bitAndFromInteger)                       \
+  V(IntegerImplementation, bitOrFromInteger, Integer_bitOrFromInteger)         \
+  V(IntegerImplementation, |, Integer_bitOrFromInteger)                        \
+  V(IntegerImplementation, bitXorFromInteger, Integer_bitXorFromInteger)       \
+  V(IntegerImplementation, ^, Integer_bitXorFromInteger)                       \
+  V(IntegerImplementation, greaterThanFromInteger, Integer_lessThan)           \
+  V(IntegerImplementation, >, Integer_greaterThan)                             \
+  V(IntegerImplementation, ==, Integer_equalToInteger)                         \
+  V(IntegerImplementation, equalToInteger, Integer_equalToInteger)             \
+  V(IntegerImplementation, <, Integer_lessThan)                                \
+  V(IntegerImplementation, <=, Integer_lessEqualThan)                          \
+  V(IntegerImplementation, >=, Integer_greaterEqualThan)                       \
+  V(IntegerImplementation, <<, Integer_shl)                                    \
+  V(IntegerImplementation, >>, Integer_sar)                                    \
+  V(Smi, ~, Smi_bitNegate)                                                     \
+  V(Double, >, Double_greaterThan)                                             \
+  V(Double, >=, Double_greaterEqualThan)                                       \
+  V(Double, <, Double_lessThan)                                                \
+  V(Double, <=, Double_lessEqualThan)                                          \
+  V(Double, ==, Double_equal)                                                  \
+  V(Double, +, Double_add)                                                     \
+  V(Double, -, Double_sub)                                                     \
+  V(Double, *, Double_mul)                                                     \
+  V(Double, /, Double_div)                                                     \
+  V(Double, toDouble, Double_toDouble)                                         \
+  V(Double, mulFromInteger, Double_mulFromInteger)                             \
+  V(Double, Double.fromInteger, Double_fromInteger)                            \
+  V(ObjectArray, ObjectArray., ObjectArray_Allocate)                           \
+  V(ObjectArray, get:length, Array_getLength)                                  \
+  V(ObjectArray, [], Array_getIndexed)                                         \
+  V(ObjectArray, []=, Array_setIndexed)                                        \
+  V(GrowableObjectArray, get:length, GrowableArray_getLength)                  \
+  V(GrowableObjectArray, [], GrowableArray_getIndexed)                         \
+  V(GrowableObjectArray, []=, GrowableArray_setIndexed)                        \
+  V(ImmutableArray, [], Array_getIndexed)                                      \
+  V(ImmutableArray, get:length, Array_getLength)                               \
+  V(Math, sqrt, Math_sqrt)                                                     \
+  V(Object, ==, Object_equal)                                                  \
+  V(FixedSizeArrayIterator, next, FixedSizeArrayIterator_next)                 \
+  V(FixedSizeArrayIterator, hasNext, FixedSizeArrayIterator_hasNext)           \
+  V(StringBase, get:length, String_getLength)                                  \
+  V(StringBase, charCodeAt, String_charCodeAt)                                 \
+  V(StringBase, hashCode, String_hashCode)                                     \
+  V(StringBase, isEmpty, String_isEmpty)                                       \
+
+#define __ assembler->
+
+static bool ObjectArray_Allocate(Assembler* assembler) {
+  // This snippet of inlined code uses the following registers:
+  // RAX, RCX, RDI
+  // and the newly allocated object is returned in RAX.
+  const intptr_t kTypeArgumentsOffset = 2 * kWordSize;
+  const intptr_t kArrayLengthOffset = 1 * kWordSize;
+  Label fall_through;
+
+  // Compute the size to be allocated, it is based on the array length
+  // and it computed as:
+  // RoundedAllocationSize((array_length * kwordSize) + sizeof(RawArray)).
+  __ movq(RDI, Address(RSP, kArrayLengthOffset));  // Array Length.
+  // Assert that length is a Smi.
+  __ testq(RDI, Immediate(kSmiTagSize));
+  __ j(NOT_ZERO, &fall_through);
+  // Negative lengths and lengths for which the size computation below could
+  // overflow are left to the runtime; such arrays never fit in new space.
+  const intptr_t kMaxInlineLength = 1 << 28;
+  __ cmpq(RDI, Immediate(Smi::RawValue(kMaxInlineLength)));
+  __ j(ABOVE, &fall_through);
+  intptr_t fixed_size = sizeof(RawArray) + kObjectAlignment - 1;
+  __ leaq(RDI, Address(RDI, TIMES_4, fixed_size));  // RDI is a Smi.
+  ASSERT(kSmiTagShift == 1);
+  __ andq(RDI, Immediate(-kObjectAlignment));
+
+  Heap* heap = Isolate::Current()->heap();
+
+  // RDI: allocation size.
+  __ movq(TMP, Immediate(heap->TopAddress()));
+  __ movq(RAX, Address(TMP, 0));
+  __ leaq(RCX, Address(RAX, RDI, TIMES_1, 0));
+
+  // Check if the allocation fits into the remaining space.
+  // RAX: potential new object start.
+  // RCX: potential next object start.
+  // RDI: allocation size.
+  __ movq(TMP, Immediate(heap->EndAddress()));
+  __ cmpq(RCX, Address(TMP, 0));
+  __ j(ABOVE_EQUAL, &fall_through);
+
+  // Successfully allocated the object(s), now update top to point to
+  // next object start and initialize the object.
+  __ movq(TMP, Immediate(heap->TopAddress()));
+  __ movq(Address(TMP, 0), RCX);
+  __ addq(RAX, Immediate(kHeapObjectTag));
+
+  // Initialize the tags.
+  // RAX: new object start as a tagged pointer.
+  // RCX: new object end address.
+  // RDI: allocation size.
+  {
+    Label size_tag_overflow, done;
+    __ cmpq(RDI, Immediate(RawObject::SizeTag::kMaxSizeTag));
+    __ j(ABOVE, &size_tag_overflow, Assembler::kNearJump);
+    __ shlq(RDI, Immediate(RawObject::kSizeTagBit - kObjectAlignmentLog2));
+    __ movq(FieldAddress(RAX, Array::tags_offset()), RDI);  // Tags.
+    __ jmp(&done);
+
+    __ Bind(&size_tag_overflow);
+    __ movq(FieldAddress(RAX, Array::tags_offset()), Immediate(0));
+    __ Bind(&done);
+  }
+
+  // Store class value for array.
+  // RAX: new object start as a tagged pointer.
+  // RCX: new object end address.
+  __ movq(RDI, FieldAddress(CTX, Context::isolate_offset()));
+  __ movq(RDI, Address(RDI, Isolate::object_store_offset()));
+  __ movq(RDI, Address(RDI, ObjectStore::array_class_offset()));
+  __ StoreIntoObject(RAX, FieldAddress(RAX, Array::class_offset()), RDI);
+
+  // Store the type argument field.
+  __ movq(RDI, Address(RSP, kTypeArgumentsOffset));  // type argument.
+  __ StoreIntoObject(RAX,
+                     FieldAddress(RAX, Array::type_arguments_offset()),
+                     RDI);
+
+  // Set the length field.
+  __ movq(RDI, Address(RSP, kArrayLengthOffset));  // Array Length.
+  __ StoreIntoObject(RAX, FieldAddress(RAX, Array::length_offset()), RDI);
+
+  // Initialize all array elements to raw_null.
+  // RAX: new object start as a tagged pointer.
+  // RCX: new object end address.
+  // RDI: iterator which initially points to the start of the variable
+  // data area to be initialized.
+  // TMP: raw_null, which does not fit in a 32-bit immediate.
+  const Immediate raw_null =
+      Immediate(reinterpret_cast<intptr_t>(Object::null()));
+  __ movq(TMP, raw_null);
+  __ leaq(RDI, FieldAddress(RAX, sizeof(RawArray)));
+  Label done;
+  Label init_loop;
+  __ Bind(&init_loop);
+  __ cmpq(RDI, RCX);
+  __ j(ABOVE_EQUAL, &done, Assembler::kNearJump);
+  __ movq(Address(RDI, 0), TMP);
+  __ addq(RDI, Immediate(kWordSize));
+  __ jmp(&init_loop, Assembler::kNearJump);
+  __ Bind(&done);
+  __ ret();  // returns the newly allocated object in RAX.
+
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Array_getLength(Assembler* assembler) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ movq(RAX, FieldAddress(RAX, Array::length_offset()));
+  __ ret();
+  return true;
+}
+
+
+static bool Array_getIndexed(Assembler* assembler) {
+  Label fall_through;
+  __ movq(RCX, Address(RSP, + 1 * kWordSize));  // Index.
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // Array.
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi index.
+  // Range check.
+  __ cmpq(RCX, FieldAddress(RAX, Array::length_offset()));
+  // Runtime throws exception.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+  // Note that RCX is Smi, i.e, times 2.
+  ASSERT(kSmiTagShift == 1);
+  __ movq(RAX, FieldAddress(RAX, RCX, TIMES_4, sizeof(RawArray)));
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Intrinsify only for Smi value and index. Non-smi values need a store buffer
+// update. Array length is always a Smi.
+static bool Array_setIndexed(Assembler* assembler) {
+  if (FLAG_enable_type_checks) {
+    return false;
+  }
+  Label fall_through;
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));  // Index.
+  __ testq(RCX, Immediate(kSmiTagMask));
+  // Index not Smi.
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);
+  __ movq(RAX, Address(RSP, + 3 * kWordSize));  // Array.
+  // Range check.
+  __ cmpq(RCX, FieldAddress(RAX, Array::length_offset()));
+  // Runtime throws exception.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+  // Note that RCX is Smi, i.e, times 2.
+  ASSERT(kSmiTagShift == 1);
+  __ movq(RDX, Address(RSP, + 1 * kWordSize));  // Value.
+  __ StoreIntoObject(RAX,
+                     FieldAddress(RAX, RCX, TIMES_4, sizeof(RawArray)),
+                     RDX);
+  // Caller is responsible of preserving the value if necessary.
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static intptr_t GetOffsetForField(const char* class_name_p,
+                                  const char* field_name_p) {
+  const String& class_name = String::Handle(String::NewSymbol(class_name_p));
+  const String& field_name = String::Handle(String::NewSymbol(field_name_p));
+  const Class& cls = Class::Handle(Library::Handle(
+      Library::CoreImplLibrary()).LookupClass(class_name));
+  ASSERT(!cls.IsNull());
+  const Field& field = Field::ZoneHandle(cls.LookupInstanceField(field_name));
+  ASSERT(!field.IsNull());
+  return field.Offset();
+}
+
+
+static const char* kGrowableArrayClassName = "GrowableObjectArray";
+static const char* kGrowableArrayLengthFieldName = "_length";
+static const char* kGrowableArrayArrayFieldName = "backingArray";
+
+// Read the length_ instance field.
+static bool GrowableArray_getLength(Assembler* assembler) {
+  intptr_t length_offset = GetOffsetForField(kGrowableArrayClassName,
+                                             kGrowableArrayLengthFieldName);
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ movq(RAX, FieldAddress(RAX, length_offset));
+  __ ret();
+  return true;
+}
+
+
+static bool GrowableArray_getIndexed(Assembler* assembler) {
+  intptr_t length_offset = GetOffsetForField(kGrowableArrayClassName,
+                                             kGrowableArrayLengthFieldName);
+  intptr_t array_offset = GetOffsetForField(kGrowableArrayClassName,
+                                            kGrowableArrayArrayFieldName);
+  Label fall_through;
+  __ movq(RCX, Address(RSP, + 1 * kWordSize));  // Index.
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // GrowableArray.
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi index.
+  // Range check using _length field.
+  __ cmpq(RCX, FieldAddress(RAX, length_offset));
+  // Runtime throws exception.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+  __ movq(RAX, FieldAddress(RAX, array_offset));  // backingArray.
+
+  // Note that RCX is Smi, i.e, times 2.
+  ASSERT(kSmiTagShift == 1);
+  __ movq(RAX, FieldAddress(RAX, RCX, TIMES_4, sizeof(RawArray)));
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// On stack: array (+3), index (+2), value (+1), return-address (+0).
+static bool GrowableArray_setIndexed(Assembler* assembler) {
+  if (FLAG_enable_type_checks) {
+    return false;
+  }
+  Label fall_through;
+  intptr_t length_offset = GetOffsetForField(kGrowableArrayClassName,
+                                             kGrowableArrayLengthFieldName);
+  intptr_t array_offset = GetOffsetForField(kGrowableArrayClassName,
+                                            kGrowableArrayArrayFieldName);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));  // Index.
+  __ movq(RAX, Address(RSP, + 3 * kWordSize));  // GrowableArray.
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi index.
+  // Range check using _length field.
+  __ cmpq(RCX, FieldAddress(RAX, length_offset));
+  // Runtime throws exception.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+  __ movq(RAX, FieldAddress(RAX, array_offset));  // backingArray.
+  __ movq(RDI, Address(RSP, + 1 * kWordSize));  // Value.
+  // Note that RCX is Smi, i.e, times 2.
+  ASSERT(kSmiTagShift == 1);
+  __ StoreIntoObject(RAX,
+                     FieldAddress(RAX, RCX, TIMES_4, sizeof(RawArray)),
+                     RDI);
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Tests if two top most arguments are smis, jumps to label not_smi if not.
+// Topmost argument is in RAX.
+static void TestBothArgumentsSmis(Assembler* assembler, Label* not_smi) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ orq(RCX, RAX);
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, not_smi);
+}
+
+
+// Loads the Smi or Mint argument at 'source' into 'dst' as an untagged 64-bit
+// integer. Jumps to 'not_smi_or_mint' for any other argument, including
+// Bigints. Destroys 'tmp'.
+static void LoadInt64Argument(Assembler* assembler,
+                              const Address& source,
+                              Register dst,
+                              Register tmp,
+                              Label* not_smi_or_mint) {
+  Label done, not_smi;
+  __ movq(dst, source);
+  __ testq(dst, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &not_smi, Assembler::kNearJump);
+  __ SmiUntag(dst);
+  __ jmp(&done, Assembler::kNearJump);
+  __ Bind(&not_smi);
+  __ LoadObject(tmp, Class::ZoneHandle(
+      Isolate::Current()->object_store()->mint_class()));
+  __ cmpq(tmp, FieldAddress(dst, Object::class_offset()));
+  __ j(NOT_EQUAL, not_smi_or_mint);
+  __ movq(dst, FieldAddress(dst, Mint::value_offset()));
+  __ Bind(&done);
+}
+
+
+// Loads the left argument (receiver) into RDX and the right argument into
+// RDI as untagged 64-bit integers. Jumps to 'not_smi_or_mint' if either of
+// them is neither a Smi nor a Mint. Destroys RCX.
+static void LoadInt64Arguments(Assembler* assembler, Label* not_smi_or_mint) {
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 2 * kWordSize), RDX, RCX, not_smi_or_mint);
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 1 * kWordSize), RDI, RCX, not_smi_or_mint);
+}
+
+
+// Returns the untagged 64-bit integer in 'value' as a Smi if it fits,
+// otherwise as a newly allocated Mint. Note that an instance of Mint never
+// contains a value that can be represented by Smi. Jumps to 'fall_through'
+// if the Mint cannot be allocated inline. Destroys RAX and RCX.
+static void ReturnInt64(Assembler* assembler,
+                        Register value,
+                        Label* fall_through) {
+  ASSERT((value != RAX) && (value != RCX));
+  Label not_smi;
+  __ movq(RAX, value);
+  __ SmiTag(RAX);
+  __ j(OVERFLOW, &not_smi, Assembler::kNearJump);
+  __ ret();
+  __ Bind(&not_smi);
+  const Class& mint_class = Class::ZoneHandle(
+      Isolate::Current()->object_store()->mint_class());
+  __ LoadObject(RCX, mint_class);
+  AssemblerMacros::TryAllocate(assembler,
+                               mint_class,
+                               RCX,  // Class register.
+                               fall_through,
+                               RAX);  // Result register.
+  // 'value' is not an object but an integer value.
+  __ movq(FieldAddress(RAX, Mint::value_offset()), value);
+  __ ret();
+}
+
+
+// The Smi fast paths below work on tagged values. Mint arguments and Smi
+// results that overflow take the untagged 64-bit path, which only falls
+// through to the method body if the result does not fit in a Mint.
+static bool Integer_addFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ addq(RAX, RCX);
+  __ j(OVERFLOW, &int64_op, Assembler::kNearJump);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ addq(RDX, RDI);
+  __ j(OVERFLOW, &fall_through);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_subFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ subq(RAX, Address(RSP, + 2 * kWordSize));
+  __ j(OVERFLOW, &int64_op, Assembler::kNearJump);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ subq(RDI, RDX);
+  __ j(OVERFLOW, &fall_through);
+  ReturnInt64(assembler, RDI, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_sub(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ movq(RCX, RAX);
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));
+  __ subq(RAX, RCX);
+  __ j(OVERFLOW, &int64_op, Assembler::kNearJump);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ subq(RDX, RDI);
+  __ j(OVERFLOW, &fall_through);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+
+static bool Integer_mulFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  ASSERT(kSmiTag == 0);  // Adjust code below if not the case.
+  __ SmiUntag(RAX);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ imulq(RAX, RCX);
+  __ j(OVERFLOW, &int64_op, Assembler::kNearJump);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ imulq(RDX, RDI);
+  __ j(OVERFLOW, &fall_through);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Only Smi arguments. The remainder of two tagged Smis is the tagged
+// remainder of their values, the result is then adjusted to be positive.
+static bool Integer_modulo(Assembler* assembler) {
+  Label fall_through, positive_divisor, done;
+  TestBothArgumentsSmis(assembler, &fall_through);
+  // RAX: right argument (divisor)
+  __ cmpq(RAX, Immediate(0));
+  __ j(EQUAL, &fall_through, Assembler::kNearJump);
+  __ movq(RCX, RAX);
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // Left argument (dividend).
+  __ cqo();
+  __ idivq(RCX);
+  // RDX: tagged remainder, which has the sign of the dividend.
+  __ cmpq(RDX, Immediate(0));
+  __ j(GREATER_EQUAL, &done, Assembler::kNearJump);
+  __ cmpq(RCX, Immediate(0));
+  __ j(GREATER, &positive_divisor, Assembler::kNearJump);
+  __ subq(RDX, RCX);
+  __ jmp(&done, Assembler::kNearJump);
+  __ Bind(&positive_divisor);
+  __ addq(RDX, RCX);
+  __ Bind(&done);
+  __ movq(RAX, RDX);
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Only Smi arguments. Dividing 'MIN_SMI' by -1 returns a Mint.
+static bool Integer_truncDivide(Assembler* assembler) {
+  Label fall_through;
+  TestBothArgumentsSmis(assembler, &fall_through);
+  // RAX: right argument (divisor)
+  __ cmpq(RAX, Immediate(0));
+  __ j(EQUAL, &fall_through);
+  __ movq(RCX, RAX);
+  __ SmiUntag(RCX);
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // Left argument (dividend).
+  __ SmiUntag(RAX);
+  __ cqo();
+  __ idivq(RCX);
+  __ movq(RDX, RAX);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_negate(Assembler* assembler) {
+  Label fall_through, int64_op;
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &int64_op, Assembler::kNearJump);  // Non-smi value.
+  __ negq(RAX);
+  __ j(OVERFLOW, &int64_op, Assembler::kNearJump);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 1 * kWordSize), RDX, RCX, &fall_through);
+  __ negq(RDX);
+  __ j(OVERFLOW, &fall_through);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_bitAndFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ andq(RAX, RCX);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ andq(RDX, RDI);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_bitOrFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ orq(RAX, RCX);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ orq(RDX, RDI);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_bitXorFromInteger(Assembler* assembler) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ xorq(RAX, RCX);
+  // Result is in RAX.
+  __ ret();
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ xorq(RDX, RDI);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Smi or Mint value, Smi shift count. Results that do not fit in 64 bits
+// fall through.
+static bool Integer_shl(Assembler* assembler) {
+  ASSERT(kSmiTagShift == 1);
+  ASSERT(kSmiTag == 0);
+  Label fall_through;
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // Shift count.
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through);
+  // Unsigned comparison with a tagged Smi also rejects negative counts.
+  __ cmpq(RAX, Immediate(Smi::RawValue(Mint::kBits)));
+  __ j(ABOVE_EQUAL, &fall_through);
+  __ SmiUntag(RAX);
+  __ movq(RCX, RAX);  // Shift amount must be in RCX.
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 2 * kWordSize), RDX, RDI, &fall_through);
+
+  // Overflow test - all the shifted-out bits must be same as the sign bit.
+  __ movq(RDI, RDX);
+  __ shlq(RDI, RCX);
+  __ movq(RAX, RDI);
+  __ sarq(RAX, RCX);
+  __ cmpq(RAX, RDX);
+  __ j(NOT_EQUAL, &fall_through);
+
+  // RDI is the shifted untagged value.
+  ReturnInt64(assembler, RDI, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static void ReturnBool(Assembler* assembler, Condition true_condition) {
+  Label true_label;
+  const Bool& bool_true = Bool::ZoneHandle(Bool::True());
+  const Bool& bool_false = Bool::ZoneHandle(Bool::False());
+  __ j(true_condition, &true_label, Assembler::kNearJump);
+  __ LoadObject(RAX, bool_false);
+  __ ret();
+  __ Bind(&true_label);
+  __ LoadObject(RAX, bool_true);
+  __ ret();
+}
+
+
+static bool CompareIntegers(Assembler* assembler, Condition true_condition) {
+  Label fall_through, int64_op;
+  TestBothArgumentsSmis(assembler, &int64_op);
+  // RAX contains the right argument.
+  __ cmpq(Address(RSP, + 2 * kWordSize), RAX);
+  ReturnBool(assembler, true_condition);
+  __ Bind(&int64_op);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ cmpq(RDX, RDI);
+  ReturnBool(assembler, true_condition);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Integer_lessThan(Assembler* assembler) {
+  return CompareIntegers(assembler, LESS);
+}
+
+
+static bool Integer_greaterThan(Assembler* assembler) {
+  return CompareIntegers(assembler, GREATER);
+}
+
+
+static bool Integer_lessEqualThan(Assembler* assembler) {
+  return CompareIntegers(assembler, LESS_EQUAL);
+}
+
+
+static bool Integer_greaterEqualThan(Assembler* assembler) {
+  return CompareIntegers(assembler, GREATER_EQUAL);
+}
+
+
+// This is called for Smi, Mint and Bigint receivers. Bigints are not handled.
+static bool Integer_equalToInteger(Assembler* assembler) {
+  Label fall_through, true_label, check_for_mint;
+  const Bool& bool_true = Bool::ZoneHandle(Bool::True());
+  const Bool& bool_false = Bool::ZoneHandle(Bool::False());
+  // For integer receiver '===' check first.
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ cmpq(RAX, Address(RSP, + 2 * kWordSize));
+  __ j(EQUAL, &true_label, Assembler::kNearJump);
+  __ movq(RCX, Address(RSP, + 2 * kWordSize));
+  __ orq(RAX, RCX);
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &check_for_mint, Assembler::kNearJump);
+  // Both arguments are smi, '===' is good enough.
+  __ LoadObject(RAX, bool_false);
+  __ ret();
+  __ Bind(&true_label);
+  __ LoadObject(RAX, bool_true);
+  __ ret();
+
+  // At least one of the arguments was not Smi. Since a Mint never contains a
+  // value that can be represented by Smi, comparing the 64-bit values handles
+  // Smi/Mint as well as Mint/Mint equality.
+  __ Bind(&check_for_mint);
+  LoadInt64Arguments(assembler, &fall_through);
+  __ cmpq(RDX, RDI);
+  ReturnBool(assembler, EQUAL);
+
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Smi or Mint value, non-negative Smi shift count.
+static bool Integer_sar(Assembler* assembler) {
+  Label fall_through, shift_count_ok;
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // Shift count.
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through);
+  __ cmpq(RAX, Immediate(0));
+  __ j(LESS, &fall_through);
+  Immediate count_limit = Immediate(0x3F);
+  // Check that the count is not larger than what the hardware can handle.
+  // For shifting right a 64-bit value the result is the same for all numbers
+  // >= count_limit.
+  __ SmiUntag(RAX);
+  __ cmpq(RAX, count_limit);
+  __ j(LESS_EQUAL, &shift_count_ok, Assembler::kNearJump);
+  __ movq(RAX, count_limit);
+  __ Bind(&shift_count_ok);
+  __ movq(RCX, RAX);  // Shift amount must be in RCX.
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 2 * kWordSize), RDX, RDI, &fall_through);
+  __ sarq(RDX, RCX);
+  ReturnInt64(assembler, RDX, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Smi_bitNegate(Assembler* assembler) {
+  Label fall_through;
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // Index.
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi.
+  __ notq(RAX);
+  __ andq(RAX, Immediate(~kSmiTagMask));  // Remove inverted smi-tag.
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Check if the last argument is a double, jump to label 'is_smi' if smi
+// (easy to convert to double), otherwise jump to label 'not_double_smi',
+// Returns the last argument in RAX.
+static void TestLastArgumentIsDouble(Assembler* assembler,
+                                     Label* is_smi,
+                                     Label* not_double_smi) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ testq(RAX, Immediate(kSmiTagMask));
+  __ j(ZERO, is_smi);  // Jump if Smi.
+  __ LoadObject(RCX, Class::ZoneHandle(
+      Isolate::Current()->object_store()->double_class()));
+  __ cmpq(RCX, FieldAddress(RAX, Object::class_offset()));
+  __ j(NOT_EQUAL, not_double_smi);
+  // Fall through if double.
+}
+
+
+// Both arguments on stack, arg0 (left) is a double, arg1 (right) is of unknown
+// type. Return true or false object in the register RAX. Any NaN argument
+// returns false. Any non-double arg1 causes control flow to fall through to the
+// slow case (compiled method body).
+static bool CompareDoubles(Assembler* assembler, Condition true_condition) {
+  const Bool& bool_true = Bool::ZoneHandle(Bool::True());
+  const Bool& bool_false = Bool::ZoneHandle(Bool::False());
+  Label fall_through, is_false, is_true, is_smi, double_op;
+  TestLastArgumentIsDouble(assembler, &is_smi, &fall_through);
+  // Both arguments are double, right operand is in RAX.
+  __ movsd(XMM1, FieldAddress(RAX, Double::value_offset()));
+  __ Bind(&double_op);
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // Left argument.
+  __ movsd(XMM0, FieldAddress(RAX, Double::value_offset()));
+  __ comisd(XMM0, XMM1);
+  __ j(PARITY_EVEN, &is_false, Assembler::kNearJump);  // NaN -> false;
+  __ j(true_condition, &is_true, Assembler::kNearJump);
+  // Fall through false.
+  __ Bind(&is_false);
+  __ LoadObject(RAX, bool_false);
+  __ ret();
+  __ Bind(&is_true);
+  __ LoadObject(RAX, bool_true);
+  __ ret();
+  __ Bind(&is_smi);
+  __ SmiUntag(RAX);
+  __ cvtsi2sd(XMM1, RAX);
+  __ jmp(&double_op);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// arg0 is Double, arg1 is unknown.
+static bool Double_greaterThan(Assembler* assembler) {
+  return CompareDoubles(assembler, ABOVE);
+}
+
+
+// arg0 is Double, arg1 is unknown.
+static bool Double_greaterEqualThan(Assembler* assembler) {
+  return CompareDoubles(assembler, ABOVE_EQUAL);
+}
+
+
+// arg0 is Double, arg1 is unknown.
+static bool Double_lessThan(Assembler* assembler) {
+  return CompareDoubles(assembler, BELOW);
+}
+
+
+// arg0 is Double, arg1 is unknown.
+static bool Double_equal(Assembler* assembler) {
+  return CompareDoubles(assembler, EQUAL);
+}
+
+
+// arg0 is Double, arg1 is unknown.
+static bool Double_lessEqualThan(Assembler* assembler) {
+  return CompareDoubles(assembler, BELOW_EQUAL);
+}
+
+
+static bool Double_toDouble(Assembler* assembler) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ ret();
+  return true;
+}
+
+
+// Returns the double in XMM0 in a newly allocated Double. Jumps to
+// 'fall_through' if it cannot be allocated inline. Destroys RCX.
+static void ReturnDouble(Assembler* assembler, Label* fall_through) {
+  const Class& double_class = Class::ZoneHandle(
+      Isolate::Current()->object_store()->double_class());
+  __ LoadObject(RCX, double_class);
+  AssemblerMacros::TryAllocate(assembler,
+                               double_class,
+                               RCX,  // Class register.
+                               fall_through,
+                               RAX);  // Result register.
+  __ movsd(FieldAddress(RAX, Double::value_offset()), XMM0);
+  __ ret();
+}
+
+
+// Expects RAX to contain right argument, left argument is on stack. Left
+// argument is double, right argument is of unknown type.
+static bool DoubleArithmeticOperations(Assembler* assembler, Token::Kind kind) {
+  Label fall_through;
+  TestLastArgumentIsDouble(assembler, &fall_through, &fall_through);
+  // Both arguments are double, right operand is in RAX, class in RCX.
+  __ movsd(XMM1, FieldAddress(RAX, Double::value_offset()));
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // Left argument.
+  __ movsd(XMM0, FieldAddress(RAX, Double::value_offset()));
+  switch (kind) {
+    case Token::kADD: __ addsd(XMM0, XMM1); break;
+    case Token::kSUB: __ subsd(XMM0, XMM1); break;
+    case Token::kMUL: __ mulsd(XMM0, XMM1); break;
+    case Token::kDIV: __ divsd(XMM0, XMM1); break;
+    default: UNREACHABLE();
+  }
+  ReturnDouble(assembler, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Double_add(Assembler* assembler) {
+  return DoubleArithmeticOperations(assembler, Token::kADD);
+}
+
+
+static bool Double_mul(Assembler* assembler) {
+  return DoubleArithmeticOperations(assembler, Token::kMUL);
+}
+
+
+static bool Double_sub(Assembler* assembler) {
+  return DoubleArithmeticOperations(assembler, Token::kSUB);
+}
+
+
+static bool Double_div(Assembler* assembler) {
+  return DoubleArithmeticOperations(assembler, Token::kDIV);
+}
+
+
+// Left is double right is integer (bigint, Mint or Smi)
+static bool Double_mulFromInteger(Assembler* assembler) {
+  Label fall_through;
+  // Only Smi-s and Mint-s allowed.
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 1 * kWordSize), RAX, RCX, &fall_through);
+  __ cvtsi2sd(XMM1, RAX);
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));
+  __ movsd(XMM0, FieldAddress(RAX, Double::value_offset()));
+  __ mulsd(XMM0, XMM1);
+  ReturnDouble(assembler, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool Double_fromInteger(Assembler* assembler) {
+  Label fall_through;
+  // Only Smi-s and Mint-s allowed.
+  LoadInt64Argument(assembler,
+                    Address(RSP, + 1 * kWordSize), RAX, RCX, &fall_through);
+  __ cvtsi2sd(XMM0, RAX);
+  ReturnDouble(assembler, &fall_through);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Argument type is not known
+static bool Math_sqrt(Assembler* assembler) {
+  Label fall_through, is_smi, double_op;
+  TestLastArgumentIsDouble(assembler, &is_smi, &fall_through);
+  // Argument is double and is in RAX, class in RCX.
+  __ movsd(XMM1, FieldAddress(RAX, Double::value_offset()));
+  __ Bind(&double_op);
+  __ sqrtsd(XMM0, XMM1);
+  ReturnDouble(assembler, &fall_through);
+  __ Bind(&is_smi);
+  __ SmiUntag(RAX);
+  __ cvtsi2sd(XMM1, RAX);
+  __ jmp(&double_op);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Identity comparison.
+static bool Object_equal(Assembler* assembler) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));
+  __ cmpq(RAX, Address(RSP, + 2 * kWordSize));
+  ReturnBool(assembler, EQUAL);
+  return true;
+}
+
+
+static const char* kFixedSizeArrayIteratorClassName = "FixedSizeArrayIterator";
+
+
+// Class 'FixedSizeArrayIterator':
+//   T next() {
+//     return _array[_pos++];
+//   }
+// Intrinsify: return _array[_pos++];
+// TODO(srdjan): Throw a 'NoMoreElementsException' exception if the iterator
+// has no more elements.
+static bool FixedSizeArrayIterator_next(Assembler* assembler) {
+  Label fall_through;
+  intptr_t array_offset =
+      GetOffsetForField(kFixedSizeArrayIteratorClassName, "_array");
+  intptr_t pos_offset =
+      GetOffsetForField(kFixedSizeArrayIteratorClassName, "_pos");
+  ASSERT(array_offset >= 0 && pos_offset >= 0);
+  // Receiver is not NULL.
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // Receiver.
+  __ movq(RCX, FieldAddress(RAX, pos_offset));  // Field _pos.
+  // '_pos' cannot be greater than array length and therefore is always Smi.
+#if defined(DEBUG)
+  Label pos_ok;
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(ZERO, &pos_ok, Assembler::kNearJump);
+  __ Stop("pos must be Smi");
+  __ Bind(&pos_ok);
+#endif
+  // Check that we are not trying to call 'next' when 'hasNext' is false.
+  __ movq(RAX, FieldAddress(RAX, array_offset));  // Field _array.
+  __ cmpq(RCX, FieldAddress(RAX, Array::length_offset()));  // Range check.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+
+  // RCX is Smi, i.e, times 2.
+  ASSERT(kSmiTagShift == 1);
+  __ movq(RDI, FieldAddress(RAX, RCX, TIMES_4, sizeof(RawArray)));  // Result.
+  const Immediate value = Immediate(reinterpret_cast<int64_t>(Smi::New(1)));
+  __ addq(RCX, value);  // _pos++.
+  __ j(OVERFLOW, &fall_through, Assembler::kNearJump);
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // Receiver.
+  __ StoreIntoObject(RAX, FieldAddress(RAX, pos_offset), RCX);  // Store _pos.
+  __ movq(RAX, RDI);
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+// Class 'FixedSizeArrayIterator':
+//   bool hasNext() {
+//     return _length > _pos;
+//   }
+static bool FixedSizeArrayIterator_hasNext(Assembler* assembler) {
+  Label fall_through;
+  intptr_t length_offset =
+      GetOffsetForField(kFixedSizeArrayIteratorClassName, "_length");
+  intptr_t pos_offset =
+      GetOffsetForField(kFixedSizeArrayIteratorClassName, "_pos");
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));     // Receiver.
+  __ movq(RCX, FieldAddress(RAX, length_offset));  // Field _length.
+  __ movq(RAX, FieldAddress(RAX, pos_offset));    // Field _pos.
+  __ movq(RDI, RAX);
+  __ orq(RDI, RCX);
+  __ testq(RDI, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi _length.
+  __ cmpq(RCX, RAX);     // _length > _pos.
+  ReturnBool(assembler, GREATER);
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool String_getLength(Assembler* assembler) {
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // String object.
+  __ movq(RAX, FieldAddress(RAX, String::length_offset()));
+  __ ret();
+  return true;
+}
+
+
+// TODO(srdjan): Implement for two and four byte strings as well.
+static bool String_charCodeAt(Assembler* assembler) {
+  ObjectStore* object_store = Isolate::Current()->object_store();
+  Label fall_through;
+  __ movq(RCX, Address(RSP, + 1 * kWordSize));  // Index.
+  __ movq(RAX, Address(RSP, + 2 * kWordSize));  // String.
+  __ testq(RCX, Immediate(kSmiTagMask));
+  __ j(NOT_ZERO, &fall_through, Assembler::kNearJump);  // Non-smi index.
+  // Range check.
+  __ cmpq(RCX, FieldAddress(RAX, String::length_offset()));
+  // Runtime throws exception.
+  __ j(ABOVE_EQUAL, &fall_through, Assembler::kNearJump);
+  __ movq(RDI, FieldAddress(RAX, Instance::class_offset()));
+  __ CompareObject(RDI,
+      Class::ZoneHandle(object_store->one_byte_string_class()));
+  __ j(NOT_EQUAL, &fall_through);
+  __ SmiUntag(RCX);
+  __ movzxb(RAX, FieldAddress(RAX, RCX, TIMES_1, OneByteString::data_offset()));
+  __ SmiTag(RAX);
+  __ ret();
+  __ Bind(&fall_through);
+  return false;
+}
+
+
+static bool String_hashCode(Assembler* assembler) {
+  Label fall_through;
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // String object.
+  __ movq(RAX, FieldAddress(RAX, String::hash_offset()));
+  __ cmpq(RAX, Immediate(0));
+  __ j(EQUAL, &fall_through, Assembler::kNearJump);
+  __ ret();
+  __ Bind(&fall_through);
+  // Hash not yet computed.
+  return false;
+}
+
+
+static bool String_isEmpty(Assembler* assembler) {
+  // Get length.
+  __ movq(RAX, Address(RSP, + 1 * kWordSize));  // String object.
+  __ movq(RAX, FieldAddress(RAX, String::length_offset()));
+  __ cmpq(RAX, Immediate(Smi::RawValue(0)));
+  ReturnBool(assembler, EQUAL);
+  return true;
+}
+
+#undef __
+
+
 bool Intrinsifier::Intrinsify(const Function& function, Assembler* assembler) {
+  if (!FLAG_intrinsify) return false;
+  const char* function_name = String::Handle(function.name()).ToCString();
+  const Class& function_class = Class::Handle(function.owner());
+  const char* class_name = String::Handle(function_class.Name()).ToCString();
+#define FIND_INTRINSICS(test_class_name, test_function_name, destination)      \
+  if ((strcmp(#test_function_name, function_name) == 0) &&                     \
+      (strcmp(#test_class_name, class_name) == 0)) {                           \
+    return destination(assembler);                                             \
+  }                                                                            \
+
+INTRINSIC_LIST(FIND_INTRINSICS);
+#undef FIND_INTRINSICS
   return false;
 }
 
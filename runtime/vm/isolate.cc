@@ -6,6 +6,7 @@
 
 #include "include/dart_api.h"
 
+#include "vm/allocation_profiler.h"
 #include "vm/assert.h"
 #include "vm/bigint_store.h"
 #include "vm/code_index_table.h"
@@ -17,6 +18,7 @@
 #include "vm/heap.h"
 #include "vm/message_queue.h"
 #include "vm/object_store.h"
+#include "vm/os.h"
 #include "vm/parser.h"
 #include "vm/port.h"
 #include "vm/random.h"
@@ -253,6 +255,9 @@ void Isolate::Shutdown() {
   if (FLAG_report_invocation_count) {
     PrintInvokedFunctions();
   }
+  if (FLAG_profile_allocations && (heap_ != NULL)) {
+    heap_->allocation_profiler()->Print();
+  }
   CompilerStats::Print();
   if (FLAG_generate_gdb_symbols) {
     DebugInfo::UnregisterAllSections();
@@ -312,17 +317,23 @@ RawObject* Isolate::StandardRunLoop() {
     Zone zone(this);
     HandleScope handle_scope(this);
 
-    PortMessage* message = message_queue()->Dequeue(0);
-    if (message != NULL) {
-      const Instance& msg =
-          Instance::Handle(DeserializeMessage(message->data()));
-      const Object& result = Object::Handle(
-          DartLibraryCalls::HandleMessage(
-              message->dest_port(), message->reply_port(), msg));
-      delete message;
-      if (result.IsUnhandledException()) {
-        return result.raw();
-      }
+    // Only wait briefly for a message while the heap has idle work, and do
+    // a slice of that work if none arrives.
+    int64_t wait_millis =
+        heap()->HasIdleWork() ? kIdleWaitMillis : Monitor::kNoTimeout;
+    PortMessage* message = message_queue()->Dequeue(wait_millis);
+    if (message == NULL) {
+      heap()->NotifyIdle(OS::GetCurrentTimeMicros() + kIdleSliceMicros);
+      continue;
+    }
+    const Instance& msg =
+        Instance::Handle(DeserializeMessage(message->data()));
+    const Object& result = Object::Handle(
+        DartLibraryCalls::HandleMessage(
+            message->dest_port(), message->reply_port(), msg));
+    delete message;
+    if (result.IsUnhandledException()) {
+      return result.raw();
     }
   }
 
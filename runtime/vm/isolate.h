@@ -49,7 +49,7 @@ class Isolate {
 
   void VisitWeakObjectPointers(ObjectPointerVisitor* visitor);
 
-  StoreBufferBlock* store_buffer() { return &store_buffer_; }
+  StoreBuffer* store_buffer() { return &store_buffer_; }
 
   Dart_PostMessageCallback post_message_callback() const {
     return post_message_callback_;
@@ -270,7 +270,12 @@ class Isolate {
   static const uword kStackSizeBuffer = (128 * KB);
   static const uword kDefaultStackSize = (1 * MB);
 
-  StoreBufferBlock store_buffer_;
+  // While the heap has idle work, the run loop waits this long for a message
+  // before doing a slice of that work.
+  static const int64_t kIdleWaitMillis = 1;
+  static const int64_t kIdleSliceMicros = 5000;
+
+  StoreBuffer store_buffer_;
   MessageQueue* message_queue_;
   Dart_PostMessageCallback post_message_callback_;
   Dart_ClosePortCallback close_port_callback_;
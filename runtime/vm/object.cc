@@ -4,6 +4,7 @@
 
 #include "vm/object.h"
 
+#include "vm/allocation_profiler.h"
 #include "vm/assembler.h"
 #include "vm/assert.h"
 #include "vm/bigint_operations.h"
@@ -757,6 +758,10 @@ RawObject* Object::Allocate(const Class& cls,
   uword tags = 0;
   tags = RawObject::SizeTag::update(size, tags);
   raw_obj->ptr()->tags_ = tags;
+  AllocationProfiler* profiler = heap->allocation_profiler();
+  if ((profiler != NULL) && profiler->IsSampleAddress(address)) {
+    profiler->RecordSample(cls);
+  }
   return raw_obj;
 }
 
@@ -835,6 +840,8 @@ RawClass* Class::New() {
   result.set_instance_kind(FakeObject::kInstanceKind);
   result.raw_ptr()->is_const_ = false;
   result.raw_ptr()->is_interface_ = false;
+  result.raw_ptr()->is_pretenured_ = false;
+  result.raw_ptr()->pretenured_allocations_ = 0;
   // VM backed classes are almost ready: run checks and resolve class
   // references, but do not recompute size.
   result.raw_ptr()->class_state_ = RawClass::kPreFinalized;
@@ -1107,6 +1114,8 @@ RawClass* Class::New(const String& name, const Script& script) {
   result.set_script(script);
   result.raw_ptr()->is_const_ = false;
   result.raw_ptr()->is_interface_ = false;
+  result.raw_ptr()->is_pretenured_ = false;
+  result.raw_ptr()->pretenured_allocations_ = 0;
   result.raw_ptr()->class_state_ = RawClass::kAllocated;
   result.raw_ptr()->type_arguments_instance_field_offset_ = kNoTypeArguments;
   result.raw_ptr()->num_native_fields_ = 0;
@@ -1281,6 +1290,15 @@ void Class::set_is_interface() const {
 }
 
 
+Heap::Space Class::AllocationSpace() const {
+  if (!is_pretenured()) {
+    return Heap::kNew;
+  }
+  intptr_t count = raw_ptr()->pretenured_allocations_++;
+  return ((count % kPretenuringSampleRate) == 0) ? Heap::kNew : Heap::kOld;
+}
+
+
 void Class::set_is_const() const {
   raw_ptr()->is_const_ = true;
 }
@@ -2834,6 +2852,12 @@ void Function::set_unoptimized_code(const Code& value) const {
 }
 
 
+void Function::ClearCode() const {
+  StorePointer(&raw_ptr()->code_, Code::null());
+  StorePointer(&raw_ptr()->unoptimized_code_, Code::null());
+}
+
+
 void Function::set_context_scope(const ContextScope& value) const {
   StorePointer(&raw_ptr()->context_scope_, value.raw());
 }
@@ -4262,13 +4286,14 @@ RawLibrary* Library::New() {
 RawLibrary* Library::NewLibraryHelper(const String& url,
                                       bool import_core_lib) {
   const Library& result = Library::Handle(Library::New());
-  result.raw_ptr()->name_ = url.raw();
-  result.raw_ptr()->url_ = url.raw();
-  result.raw_ptr()->private_key_ = Scanner::AllocatePrivateKey(result);
-  result.raw_ptr()->dictionary_ = Array::Empty();
-  result.raw_ptr()->anonymous_classes_ = Array::Empty();
+  result.StorePointer(&result.raw_ptr()->name_, url.raw());
+  result.StorePointer(&result.raw_ptr()->url_, url.raw());
+  result.StorePointer(&result.raw_ptr()->private_key_,
+                      Scanner::AllocatePrivateKey(result));
+  result.StorePointer(&result.raw_ptr()->dictionary_, Array::Empty());
+  result.StorePointer(&result.raw_ptr()->anonymous_classes_, Array::Empty());
   result.raw_ptr()->num_anonymous_ = 0;
-  result.raw_ptr()->imports_ = Array::Empty();
+  result.StorePointer(&result.raw_ptr()->imports_, Array::Empty());
   result.raw_ptr()->next_registered_ = Library::null();
   result.set_native_entry_resolver(NULL);
   result.raw_ptr()->corelib_imported_ = true;
@@ -4831,11 +4856,21 @@ RawCode* Code::FinalizeCode(const char* name, Assembler* assembler) {
     // Set pointer offsets list in Code object and resolve all handles in
     // the instruction stream to raw objects.
     ASSERT(code.pointer_offsets_length() == pointer_offsets.length());
+    bool has_new_pointers = false;
     for (int i = 0; i < pointer_offsets.length(); i++) {
       int offset_in_instrs = pointer_offsets[i];
       code.SetPointerOffsetAt(i, offset_in_instrs);
       const Object* object = region.Load<const Object*>(offset_in_instrs);
-      region.Store<RawObject*>(offset_in_instrs, object->raw());
+      RawObject* raw_object = object->raw();
+      region.Store<RawObject*>(offset_in_instrs, raw_object);
+      if (raw_object->IsHeapObject() && raw_object->IsNewObject()) {
+        has_new_pointers = true;
+      }
+    }
+    // Embedded pointers bypass the write barrier, remember the code object if
+    // any of them refers to new space.
+    if (has_new_pointers && !code.raw()->IsRemembered()) {
+      Isolate::Current()->store_buffer()->AddObject(code.raw());
     }
 
     // Hook up Code and Instruction objects.
@@ -4985,7 +5020,7 @@ RawString* ContextScope::NameAt(intptr_t scope_index) const {
 
 
 void ContextScope::SetNameAt(intptr_t scope_index, const String& name) const {
-  VariableDescAddr(scope_index)->name = name.raw();
+  StorePointer(&(VariableDescAddr(scope_index)->name), name.raw());
 }
 
 
@@ -5006,7 +5041,7 @@ RawAbstractType* ContextScope::TypeAt(intptr_t scope_index) const {
 
 void ContextScope::SetTypeAt(
     intptr_t scope_index, const AbstractType& type) const {
-  VariableDescAddr(scope_index)->type = type.raw();
+  StorePointer(&(VariableDescAddr(scope_index)->type), type.raw());
 }
 
 
@@ -7327,12 +7362,12 @@ RawClosure* Closure::New(const Function& function,
 
 
 void Closure::set_context(const Context& value) const {
-  raw_ptr()->context_ = value.raw();
+  StorePointer(&raw_ptr()->context_, value.raw());
 }
 
 
 void Closure::set_function(const Function& value) const {
-  raw_ptr()->function_ = value.raw();
+  StorePointer(&raw_ptr()->function_, value.raw());
 }
 
 
@@ -349,12 +349,16 @@ CLASS_LIST_NO_OBJECT(DEFINE_CLASS_TESTER);
 
   template<typename type> void StorePointer(type* addr, type value) const {
     ASSERT(Isolate::Current()->no_gc_scope_depth() == 0);
-    // TODO(iposva): Implement real store barrier here.
     *addr = value;
     // Filter stores based on source and target.
-    if (value->IsNewObject() && raw()->IsOldObject()) {
-      uword ptr = reinterpret_cast<uword>(addr);
-      Isolate::Current()->store_buffer()->AddPointer(ptr);
+    if (value->IsHeapObject() && raw()->IsOldObject()) {
+      if (value->IsNewObject()) {
+        Isolate::Current()->store_buffer()->AddSlot(
+            raw(), reinterpret_cast<RawObject**>(addr));
+      } else if (Heap::IsMarkingBarrierActive() &&
+                 !PageSpace::IsMarked(value)) {
+        Isolate::Current()->heap()->MarkingBarrier(value);
+      }
     }
   }
 
@@ -649,6 +653,19 @@ class Class : public Object {
   }
   void set_allocation_stub(const Code& value) const;
 
+  // The instances of a pretenured class are allocated in old space by its
+  // allocation stub, based on the survival rate of its instances observed by
+  // the scavenger. Every kPretenuringSampleRate-th instance is still
+  // allocated in new space so that the survival rate keeps being tracked.
+  static const intptr_t kPretenuringSampleRate = 16;
+  bool is_pretenured() const {
+    return raw_ptr()->is_pretenured_;
+  }
+  static intptr_t is_pretenured_offset() {
+    return OFFSET_OF(RawClass, is_pretenured_);
+  }
+  Heap::Space AllocationSpace() const;
+
   RawArray* constants() const;
 
   void Finalize() const;
@@ -1214,6 +1231,8 @@ class Function : public Object {
   void SetCode(const Code& value) const;
   RawCode* unoptimized_code() const { return raw_ptr()->unoptimized_code_; }
   void set_unoptimized_code(const Code& value) const;
+  // Drops the code of the function, it is compiled again when invoked.
+  void ClearCode() const;
   static intptr_t code_offset() { return OFFSET_OF(RawFunction, code_); }
   inline bool HasCode() const;
 
@@ -5,39 +5,167 @@
 #include "vm/pages.h"
 
 #include "vm/assert.h"
+#include "vm/gc_compactor.h"
 #include "vm/gc_marker.h"
 #include "vm/gc_sweeper.h"
 #include "vm/object.h"
+#include "vm/store_buffer.h"
+#include "vm/thread.h"
 #include "vm/virtual_memory.h"
+#include "vm/visitor.h"
 
 namespace dart {
 
-HeapPage* HeapPage::Initialize(VirtualMemory* memory, bool is_executable) {
+HeapPage* HeapPage::Initialize(VirtualMemory* memory, PageSpace* owner) {
   ASSERT(memory->size() > VirtualMemory::PageSize());
-  memory->Commit(is_executable);
-
   HeapPage* result = reinterpret_cast<HeapPage*>(memory->address());
   result->memory_ = memory;
+  result->owner_ = owner;
   result->next_ = NULL;
   result->used_ = 0;
   result->top_ = result->first_object_start();
+  result->card_table_ = NULL;
+  result->mark_bits_ = new uword[result->NumberOfMarkWords()];
+  result->ClearMarkBits();
+  PageTable::Register(result);
   return result;
 }
 
 
-HeapPage* HeapPage::Allocate(intptr_t size, bool is_executable) {
+HeapPage* HeapPage::Allocate(intptr_t size, PageSpace* owner) {
   VirtualMemory* memory =
       VirtualMemory::ReserveAligned(size, PageSpace::kPageAlignment);
-  return Initialize(memory, is_executable);
+  memory->Commit(owner->is_executable());
+  return Initialize(memory, owner);
+}
+
+
+HeapPage* HeapPage::AllocateHuge(intptr_t size, PageSpace* owner) {
+  ASSERT(Utils::IsAligned(size, VirtualMemory::kHugePageSize));
+  VirtualMemory* memory =
+      VirtualMemory::ReserveAligned(size, VirtualMemory::kHugePageSize);
+  memory->Commit(owner->is_executable());
+  memory->AdviseHugePages(memory->start(), memory->size());
+  return Initialize(memory, owner);
 }
 
 
 void HeapPage::Deallocate() {
+  PageTable::Unregister(this);
+  delete[] card_table_;
+  delete[] mark_bits_;
   // The memory for this object will become unavailable after the delete below.
   delete memory_;
 }
 
 
+void HeapPage::AllocateCardTable() {
+  ASSERT(!has_card_table());
+  card_table_ = new uint8_t[NumberOfCards()];
+  ClearCards();
+}
+
+
+void HeapPage::RememberAllCards() {
+  ASSERT(has_card_table());
+  memset(card_table_, 1, NumberOfCards());
+}
+
+
+void HeapPage::ClearCards() {
+  ASSERT(has_card_table());
+  memset(card_table_, 0, NumberOfCards());
+}
+
+
+intptr_t HeapPage::NumberOfMarkWords() const {
+  // Large pages contain a single object, objects only start in the first
+  // kPageSize bytes of a page.
+  intptr_t size = Utils::Minimum(static_cast<intptr_t>(end() - start()),
+                                 PageSpace::kPageSize);
+  intptr_t num_bits = size >> kObjectAlignmentLog2;
+  return (num_bits + kBitsPerWord - 1) / kBitsPerWord;
+}
+
+
+void HeapPage::ClearMarkBits() {
+  memset(mark_bits_, 0, NumberOfMarkWords() * sizeof(mark_bits_[0]));
+}
+
+
+// Restricts the pointer ranges visited to the dirty cards of a page, clearing
+// the cards on the way. Pointer ranges are expected in increasing address
+// order, a card shared by consecutive ranges is only looked up once.
+class CardVisitor : public ObjectPointerVisitor {
+ public:
+  CardVisitor(HeapPage* page, ObjectPointerVisitor* visitor)
+      : page_(page), visitor_(visitor), card_(-1), card_is_dirty_(false) {}
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    intptr_t first_card = page_->CardIndex(first);
+    intptr_t last_card = page_->CardIndex(last);
+    for (intptr_t card = first_card; card <= last_card; card++) {
+      if (card != card_) {
+        ASSERT(card > card_);
+        card_ = card;
+        card_is_dirty_ = (page_->card_table_[card] != 0);
+        page_->card_table_[card] = 0;
+      }
+      if (!card_is_dirty_) {
+        continue;
+      }
+      uword card_start = page_->start() + (card << HeapPage::kCardSizeLog2);
+      RawObject** from = reinterpret_cast<RawObject**>(card_start);
+      RawObject** to = from + (HeapPage::kCardSize / kWordSize) - 1;
+      visitor_->VisitPointers((from < first) ? first : from,
+                              (to > last) ? last : to);
+    }
+  }
+
+ private:
+  HeapPage* page_;
+  ObjectPointerVisitor* visitor_;
+  intptr_t card_;
+  bool card_is_dirty_;
+
+  DISALLOW_COPY_AND_ASSIGN(CardVisitor);
+};
+
+
+void HeapPage::VisitRememberedCards(ObjectPointerVisitor* visitor) {
+  // A large page contains a single object.
+  RawObject* raw_obj = RawObject::FromAddr(first_object_start());
+  ASSERT(raw_obj->IsArray());
+  CardVisitor card_visitor(this, visitor);
+  raw_obj->VisitPointers(&card_visitor);
+}
+
+
+intptr_t HeapPage::ReleaseFreeMemory(uword addr, intptr_t size) {
+  ASSERT((addr >= first_object_start()) && ((addr + size) <= end()));
+  intptr_t os_page_size = VirtualMemory::PageSize();
+  // A free list element holds its class, next and size fields.
+  uword first = Utils::RoundUp(addr + 2 * kObjectAlignment, os_page_size);
+  uword last = Utils::RoundDown(addr + size, os_page_size);
+  if ((last <= first) || !memory_->Discard(first, last - first)) {
+    return 0;
+  }
+  return last - first;
+}
+
+
+void HeapPage::VisitObjects(ObjectVisitor* visitor) const {
+  uword obj_addr = first_object_start();
+  uword end_addr = top();
+  while (obj_addr < end_addr) {
+    RawObject* raw_obj = RawObject::FromAddr(obj_addr);
+    visitor->VisitObject(raw_obj);
+    obj_addr += raw_obj->Size();
+  }
+  ASSERT(obj_addr == end_addr);
+}
+
+
 void HeapPage::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
   uword obj_addr = first_object_start();
   uword end_addr = top();
@@ -49,35 +177,108 @@ void HeapPage::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
 }
 
 
+HeapPage** volatile PageTable::root_[1 << kRootBits];
+
+
+void PageTable::SetEntries(HeapPage* page, HeapPage* value) {
+  ASSERT(Utils::IsAligned(page->start(), PageSpace::kPageAlignment));
+  ASSERT(PageSpace::kPageAlignment == (1 << kChunkSizeLog2));
+  uword first = page->start() >> kChunkSizeLog2;
+  uword last = (page->end() - 1) >> kChunkSizeLog2;
+  ASSERT((last >> kIndexBits) == 0);
+  for (uword index = first; index <= last; index++) {
+    HeapPage** volatile* slot = &root_[index >> kLeafBits];
+    if (*slot == NULL) {
+      // Leaves are never freed. Isolates running on other threads may be
+      // installing the same leaf.
+      HeapPage** leaf = new HeapPage*[kLeafMask + 1];
+      memset(leaf, 0, (kLeafMask + 1) * sizeof(leaf[0]));
+      uword old_leaf = AtomicOperations::CompareAndSwapWord(
+          reinterpret_cast<volatile uword*>(slot),
+          0,
+          reinterpret_cast<uword>(leaf));
+      if (old_leaf != 0) {
+        delete[] leaf;
+      }
+    }
+    (*slot)[index & kLeafMask] = value;
+  }
+}
+
+
+void PageTable::Register(HeapPage* page) {
+  SetEntries(page, page);
+}
+
+
+void PageTable::Unregister(HeapPage* page) {
+  SetEntries(page, NULL);
+}
+
+
 PageSpace::PageSpace(Heap* heap, intptr_t max_capacity, bool is_executable)
     : freelist_(),
       heap_(heap),
       pages_(NULL),
       pages_tail_(NULL),
       large_pages_(NULL),
+      page_cache_(NULL),
+      page_cache_size_(0),
+      sweep_cursor_(NULL),
+      sweep_end_(NULL),
+      release_budget_(0),
       max_capacity_(max_capacity),
       capacity_(0),
       in_use_(0),
       count_(0),
+      total_time_(0),
+      last_time_(0),
+      marker_(NULL),
+      in_use_after_gc_(0),
+      allocated_since_step_(0),
+      allocation_cursor_page_(NULL),
+      allocation_cursor_(0),
+      marked_large_pages_(NULL),
+      marking_steps_(0),
+      marking_time_(0),
+      max_step_time_(0),
       is_executable_(is_executable),
-      sweeping_(false) { }
+      sweeping_(false),
+      tasks_monitor_(new Monitor()) { }
 
 
 PageSpace::~PageSpace() {
+  if (marker_ != NULL) {
+    delete marker_;
+    Heap::DeactivateMarkingBarrier();
+  }
   FreePages(pages_);
   FreePages(large_pages_);
+  FreePages(page_cache_);
+  delete tasks_monitor_;
 }
 
 
 intptr_t PageSpace::LargePageSizeFor(intptr_t size) {
-  intptr_t page_size = Utils::RoundUp(size + sizeof(HeapPage),
+  intptr_t page_size = Utils::RoundUp(size + HeapPage::ObjectStartOffset(),
                                       VirtualMemory::PageSize());
   return page_size;
 }
 
 
 void PageSpace::AllocatePage() {
-  HeapPage* page = HeapPage::Allocate(kPageSize, is_executable_);
+  if ((page_cache_ == NULL) && UseHugePages()) {
+    AllocateHugePage();
+  }
+  HeapPage* page = page_cache_;
+  if (page != NULL) {
+    page_cache_ = page->next();
+    page_cache_size_--;
+    page->set_next(NULL);
+    PageTable::Register(page);
+  } else {
+    page = HeapPage::Allocate(kPageSize, this);
+  }
   if (pages_ == NULL) {
     pages_ = page;
   } else {
@@ -88,9 +289,48 @@ void PageSpace::AllocatePage() {
 }
 
 
+bool PageSpace::UseHugePages() const {
+  // Code pages are never backed by huge pages.
+  return FLAG_use_huge_pages && !is_executable_ &&
+      VirtualMemory::SupportsHugePages();
+}
+
+
+void PageSpace::AllocateHugePage() {
+  // The regular pages split off a huge page are added to the page cache. They
+  // stay backed by the huge page until one of them is released.
+  VirtualMemory* memory = VirtualMemory::ReserveAligned(
+      VirtualMemory::kHugePageSize, VirtualMemory::kHugePageSize);
+  memory->Commit(is_executable_);
+  memory->AdviseHugePages(memory->start(), memory->size());
+  while (memory != NULL) {
+    VirtualMemory* page_memory = memory;
+    if (memory->size() > kPageSize) {
+      page_memory = memory->SplitOff(kPageSize);
+    } else {
+      memory = NULL;
+    }
+    HeapPage* page = HeapPage::Initialize(page_memory, this);
+    PageTable::Unregister(page);
+    page->set_next(page_cache_);
+    page_cache_ = page;
+    page_cache_size_++;
+  }
+}
+
+
 HeapPage* PageSpace::AllocateLargePage(intptr_t size) {
   intptr_t page_size = LargePageSizeFor(size);
-  HeapPage* page = HeapPage::Allocate(page_size, is_executable_);
+  HeapPage* page;
+  if (UseHugePages() && (page_size >= VirtualMemory::kHugePageSize)) {
+    page_size = Utils::RoundUp(page_size, VirtualMemory::kHugePageSize);
+    page = HeapPage::AllocateHuge(page_size, this);
+  } else {
+    page = HeapPage::Allocate(page_size, this);
+  }
+  if (!is_executable_) {
+    page->AllocateCardTable();
+  }
   page->set_next(large_pages_);
   large_pages_ = page;
   capacity_ += page_size;
@@ -110,6 +350,70 @@ void PageSpace::FreeLargePage(HeapPage* page, HeapPage* previous_page) {
 }
 
 
+intptr_t PageSpace::FreePage(HeapPage* page) {
+  ASSERT(!page->has_card_table());
+  capacity_ -= kPageSize;
+  if (page_cache_size_ >= FLAG_old_gen_page_cache) {
+    page->Deallocate();
+    return kPageSize;
+  }
+  // Stale pointers into the cached page are no longer found in the page
+  // table.
+  PageTable::Unregister(page);
+  page->set_used(0);
+  page->set_top(page->first_object_start());
+  page->ClearMarkBits();
+  page->set_next(page_cache_);
+  page_cache_ = page;
+  page_cache_size_++;
+  return page->ReleaseFreeMemory(page->first_object_start(),
+                                 page->end() - page->first_object_start());
+}
+
+
+intptr_t PageSpace::ExcessCapacity() const {
+  if (FLAG_max_heap_free_ratio >= 100) {
+    return 0;
+  }
+  // The used bytes of the pages were computed by the marking phase.
+  intptr_t used = 0;
+  intptr_t size = 0;
+  for (HeapPage* page = pages_; page != NULL; page = page->next()) {
+    used += page->used();
+    size += kPageSize;
+  }
+  intptr_t needed = used * 100 / (100 - FLAG_max_heap_free_ratio);
+  return Utils::Maximum(size - needed, static_cast<intptr_t>(0));
+}
+
+
+intptr_t PageSpace::FreeEmptyPages(intptr_t max_pages, intptr_t* num_pages) {
+  intptr_t released = 0;
+  HeapPage* prev_page = NULL;
+  HeapPage* page = pages_;
+  while ((page != NULL) && (*num_pages < max_pages)) {
+    HeapPage* next_page = page->next();
+    if (page->used() == 0) {
+      // Remove the page from the list.
+      if (prev_page != NULL) {
+        prev_page->set_next(next_page);
+      } else {
+        pages_ = next_page;
+      }
+      if (page == pages_tail_) {
+        pages_tail_ = prev_page;
+      }
+      released += FreePage(page);
+      (*num_pages)++;
+    } else {
+      prev_page = page;
+    }
+    page = next_page;
+  }
+  return released;
+}
+
+
 void PageSpace::FreePages(HeapPage* pages) {
   HeapPage* page = pages;
   while (page != NULL) {
@@ -141,14 +445,20 @@ uword PageSpace::TryAllocate(intptr_t size) {
   uword result = 0;
   if (size < kAllocatablePageSize) {
     result = TryBumpAllocate(size);
-    if (result == 0) {
+    // Objects allocated during marking are bump allocated so that they can
+    // be found and greyed.
+    if ((result == 0) && !is_marking()) {
       result = freelist_.TryAllocate(size);
-      if ((result == 0) && CanIncreaseCapacity(kPageSize)) {
-        AllocatePage();
-        result = TryBumpAllocate(size);
-        ASSERT(result != 0);
+      // Reclaim the garbage of unswept pages before growing the space.
+      while ((result == 0) && SweepNextPage()) {
+        result = freelist_.TryAllocate(size);
       }
     }
+    if ((result == 0) && CanIncreaseCapacity(kPageSize)) {
+      AllocatePage();
+      result = TryBumpAllocate(size);
+      ASSERT(result != 0);
+    }
   } else {
     // Large page allocation.
     intptr_t page_size = LargePageSizeFor(size);
@@ -166,32 +476,56 @@ uword PageSpace::TryAllocate(intptr_t size) {
   }
   if (result != 0) {
     in_use_ += size;
+    allocated_since_step_ += size;
   }
   return result;
 }
 
 
-bool PageSpace::Contains(uword addr) const {
+uword PageSpace::AllocateForEvacuation(intptr_t size) {
+  ASSERT(size < kAllocatablePageSize);
+  // Fill the holes left by sweeping first.
+  uword result = freelist_.TryAllocate(size);
+  if (result == 0) {
+    result = TryBumpAllocate(size);
+  }
+  if (result == 0) {
+    AllocatePage();
+    result = TryBumpAllocate(size);
+  }
+  ASSERT(result != 0);
+  in_use_ += size;
+  return result;
+}
+
+
+void PageSpace::FreeUnused(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Utils::IsAligned(size, kObjectAlignment));
+  freelist_.Free(addr, size);
+  in_use_ -= size;
+}
+
+
+void PageSpace::VisitObjects(ObjectVisitor* visitor) const {
+  // Unswept pages contain unreachable objects with stale pointers.
+  ASSERT(!HasUnsweptPages());
   HeapPage* page = pages_;
   while (page != NULL) {
-    if (page->Contains(addr)) {
-      return true;
-    }
+    page->VisitObjects(visitor);
     page = page->next();
   }
 
   page = large_pages_;
   while (page != NULL) {
-    if (page->Contains(addr)) {
-      return true;
-    }
+    page->VisitObjects(visitor);
     page = page->next();
   }
-  return false;
 }
 
 
 void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
+  ASSERT(!HasUnsweptPages());
   HeapPage* page = pages_;
   while (page != NULL) {
     page->VisitObjectPointers(visitor);
@@ -206,36 +540,341 @@ void PageSpace::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
 }
 
 
+bool PageSpace::SweepNextPage() {
+  if (!HasUnsweptPages()) {
+    return false;
+  }
+  HeapPage* page = sweep_cursor_;
+  sweep_cursor_ = page->next();
+  if (sweep_cursor_ == sweep_end_) {
+    sweep_cursor_ = NULL;
+    sweep_end_ = NULL;
+  }
+  // The used bytes of the page were already accounted for at the end of the
+  // mark-sweep.
+  GCSweeper sweeper(heap_, release_budget_);
+  sweeper.SweepPage(page, &freelist_);
+  release_budget_ -= sweeper.released();
+  return true;
+}
+
+
+void PageSpace::FinishSweeping() {
+  while (SweepNextPage()) {
+    // Sweep all remaining pages.
+  }
+}
+
+
+void PageSpace::GreyAllocatedObjects(ObjectPointerVisitor* visitor) {
+  ASSERT(is_marking());
+  HeapPage* page = allocation_cursor_page_;
+  uword obj_addr = allocation_cursor_;
+  if ((page == NULL) && (pages_ != NULL)) {
+    // The space did not have any pages when marking started.
+    page = pages_;
+    obj_addr = page->first_object_start();
+  }
+  while (page != NULL) {
+    uword end_addr = page->top();
+    while (obj_addr < end_addr) {
+      RawObject* raw_obj = RawObject::FromAddr(obj_addr);
+      obj_addr += raw_obj->Size();
+      // Unused parts of promotion buffers are returned to the free list.
+      if (!raw_obj->IsFreeListElement()) {
+        visitor->VisitPointer(&raw_obj);
+      }
+    }
+    ASSERT(obj_addr == end_addr);
+    allocation_cursor_page_ = page;
+    allocation_cursor_ = obj_addr;
+    page = page->next();
+    if (page != NULL) {
+      obj_addr = page->first_object_start();
+    }
+  }
+
+  // New large pages are added in front of the list.
+  page = large_pages_;
+  while (page != marked_large_pages_) {
+    RawObject* raw_obj = RawObject::FromAddr(page->first_object_start());
+    visitor->VisitPointer(&raw_obj);
+    page = page->next();
+  }
+  marked_large_pages_ = large_pages_;
+}
+
+
+void PageSpace::SweepInstructions() {
+  ASSERT(is_executable_);
+  // Code is rarely freed, the free memory is kept for new code.
+  freelist_.Reset();
+  GCSweeper sweeper(heap_, 0);
+  intptr_t in_use = 0;
+  for (HeapPage* page = pages_; page != NULL; page = page->next()) {
+    in_use += sweeper.SweepPage(page, &freelist_);
+  }
+  HeapPage* prev_page = NULL;
+  HeapPage* page = large_pages_;
+  while (page != NULL) {
+    intptr_t page_in_use = sweeper.SweepLargePage(page);
+    HeapPage* next_page = page->next();
+    if (page_in_use == 0) {
+      FreeLargePage(page, prev_page);
+    } else {
+      in_use += page_in_use;
+      prev_page = page;
+    }
+    page = next_page;
+  }
+  in_use_ = in_use;
+}
+
+
+intptr_t PageSpace::MarkingThreshold() const {
+  intptr_t threshold = FLAG_incremental_marking_threshold * MB;
+  return Utils::Maximum(threshold, 2 * in_use_after_gc_);
+}
+
+
+void PageSpace::StartIncrementalMarking() {
+  ASSERT(!is_marking());
+  ASSERT(!is_executable_);
+  // Unused code is dropped before the roots are visited so that it can be
+  // collected.
+  heap_->FlushUnusedCode();
+  Isolate* isolate = Isolate::Current();
+  NoHandleScope no_handles(isolate);
+
+  // The mark bits of the previous collection have to be cleared first.
+  FinishSweeping();
+
+  Timer timer(FLAG_verbose_gc, "StartIncrementalMarking");
+  timer.Start();
+  allocation_cursor_page_ = pages_tail_;
+  allocation_cursor_ = (pages_tail_ != NULL) ? pages_tail_->top() : 0;
+  marked_large_pages_ = large_pages_;
+  allocated_since_step_ = 0;
+  marker_ = new IncrementalMarker(heap_, this);
+  Heap::ActivateMarkingBarrier();
+  marker_->Start(isolate);
+  timer.Stop();
+
+  marking_steps_ = 1;
+  marking_time_ = timer.TotalElapsedTime();
+  max_step_time_ = marking_time_;
+}
+
+
+void PageSpace::IncrementalMarkingStep() {
+  if (!FLAG_incremental_marking || is_executable_) {
+    return;
+  }
+  // Marking only starts once the isolate has been initialized, the heap of
+  // the VM isolate is never collected.
+  Isolate* isolate = Isolate::Current();
+  if ((isolate == Dart::vm_isolate()) || (isolate->stub_code() == NULL)) {
+    return;
+  }
+  if (!is_marking()) {
+    if (in_use_ >= MarkingThreshold()) {
+      StartIncrementalMarking();
+    }
+  } else if (allocated_since_step_ >= kMarkingStepInterval) {
+    MarkingStep(kMarkingStepFactor * allocated_since_step_);
+  }
+}
+
+
+void PageSpace::MarkingStep(intptr_t budget) {
+  ASSERT(is_marking());
+  bool is_done = false;
+  {
+    NoHandleScope no_handles(Isolate::Current());
+    Timer timer(FLAG_verbose_gc, "MarkingStep");
+    timer.Start();
+    is_done = marker_->Step(budget);
+    timer.Stop();
+    int64_t step_time = timer.TotalElapsedTime();
+    marking_steps_++;
+    marking_time_ += step_time;
+    if (step_time > max_step_time_) {
+      max_step_time_ = step_time;
+    }
+  }
+  allocated_since_step_ = 0;
+  if (is_done) {
+    MarkSweep();
+  }
+}
+
+
+bool PageSpace::HasIdleWork() const {
+  if (is_marking() || HasUnsweptPages()) {
+    return true;
+  }
+  if (!FLAG_incremental_marking || is_executable_) {
+    return false;
+  }
+  Isolate* isolate = Isolate::Current();
+  if ((isolate == Dart::vm_isolate()) || (isolate->stub_code() == NULL)) {
+    return false;
+  }
+  return (in_use_ > in_use_after_gc_) &&
+         (in_use_ >= (MarkingThreshold() / 100) * kIdleMarkingPercent);
+}
+
+
+bool PageSpace::IdleStep(intptr_t budget) {
+  if (is_marking()) {
+    MarkingStep(budget);
+  } else if (HasUnsweptPages()) {
+    SweepNextPage();
+  } else if (HasIdleWork()) {
+    StartIncrementalMarking();
+  } else {
+    return false;
+  }
+  return true;
+}
+
+
+void PageSpace::RecordStore(RawObject* value) {
+  if (marker_ != NULL) {
+    marker_->MarkFromBarrier(value);
+  }
+}
+
+
+HeapPage* PageSpace::SelectPagesToEvacuate() {
+  if ((FLAG_compaction_threshold <= 0) || is_executable_) {
+    return NULL;
+  }
+  // The used bytes of the pages were computed by the marking phase.
+  intptr_t num_pages = 0;
+  intptr_t used = 0;
+  for (HeapPage* page = pages_; page != NULL; page = page->next()) {
+    num_pages++;
+    used += page->used();
+  }
+  intptr_t size = num_pages * kAllocatablePageSize;
+  if ((size - used) * 100 < FLAG_compaction_threshold * size) {
+    return NULL;
+  }
+
+  intptr_t sparse_limit =
+      kAllocatablePageSize * (100 - FLAG_compaction_threshold) / 100;
+  HeapPage* evacuated_pages = NULL;
+  HeapPage* prev_page = NULL;
+  HeapPage* page = pages_;
+  while (page != NULL) {
+    HeapPage* next_page = page->next();
+    if (page->used() <= sparse_limit) {
+      // Remove the page from the list.
+      if (prev_page != NULL) {
+        prev_page->set_next(next_page);
+      } else {
+        pages_ = next_page;
+      }
+      if (page == pages_tail_) {
+        pages_tail_ = prev_page;
+      }
+      page->set_next(evacuated_pages);
+      evacuated_pages = page;
+    } else {
+      prev_page = page;
+    }
+    page = next_page;
+  }
+  return evacuated_pages;
+}
+
+
 void PageSpace::MarkSweep() {
   // MarkSweep is not reentrant. Make sure that is the case.
   ASSERT(!sweeping_);
   sweeping_ = true;
+  // Unused code is dropped before marking so that it can be collected.
+  // Incremental marking dropped it when it started.
+  if (!is_executable_ && !is_marking()) {
+    heap_->FlushUnusedCode();
+  }
   Isolate* isolate = Isolate::Current();
   NoHandleScope no_handles(isolate);
 
+  // The mark bits of the previous collection have to be cleared first.
+  FinishSweeping();
+
   if (FLAG_verify_before_gc) {
     OS::PrintErr("Verifying before MarkSweep... ");
     heap_->Verify();
     OS::PrintErr(" done.\n");
   }
 
-  Timer timer(FLAG_verbose_gc, "MarkSweep");
+  // Always timed for the heap statistics.
+  Timer timer(true, "MarkSweep");
   timer.Start();
 
   // Mark all reachable old-gen objects.
-  GCMarker marker(heap_);
-  marker.MarkObjects(isolate, this);
+  bool was_marking = is_marking();
+  if (was_marking) {
+    marker_->Finish(isolate);
+    delete marker_;
+    marker_ = NULL;
+    Heap::DeactivateMarkingBarrier();
+  } else {
+    GCMarker marker(heap_);
+    marker.MarkObjects(isolate, this);
+  }
+
+  // Remembered objects which are about to be swept must not stay in the store
+  // buffer. Only data pages contain remembered objects.
+  if (!is_executable_) {
+    isolate->store_buffer()->RemoveUnmarkedObjects();
+  }
+
+  // The code space is swept while the mark bits of the code objects are
+  // valid.
+  if (!is_executable_) {
+    heap_->SweepCodeSpace();
+  }
+
+  // Sparse pages are evacuated instead of being swept.
+  HeapPage* evacuated_pages = SelectPagesToEvacuate();
+
+  // Memory beyond the capacity needed is given back to the system, first the
+  // pages without any reachable object, which do not need to be swept, then
+  // the large free blocks found by sweeping.
+  release_budget_ = ExcessCapacity();
+  intptr_t num_empty_pages = 0;
+  intptr_t released =
+      FreeEmptyPages(release_budget_ / kPageSize, &num_empty_pages);
+  release_budget_ -= num_empty_pages * kPageSize;
 
   // Reset the freelists and setup sweeping.
   freelist_.Reset();
-  GCSweeper sweeper(heap_);
+  GCSweeper sweeper(heap_, release_budget_);
   intptr_t in_use = 0;
 
   HeapPage* page = pages_;
+  if (FLAG_lazy_sweep && !is_executable_ && (evacuated_pages == NULL) &&
+      (pages_ != pages_tail_)) {
+    // Only sweep the last page, which is used for bump allocation, before
+    // ending the pause. The other pages are swept when allocation runs out of
+    // free memory. The marking phase computed their used bytes already.
+    sweep_cursor_ = pages_;
+    sweep_end_ = pages_tail_;
+    while (page != pages_tail_) {
+      in_use += page->used();
+      page = page->next();
+    }
+  }
   while (page != NULL) {
     in_use += sweeper.SweepPage(page, &freelist_);
     page = page->next();
   }
+  released += sweeper.released();
+  release_budget_ -= sweeper.released();
 
   HeapPage* prev_page = NULL;
   page = large_pages_;
@@ -243,6 +882,7 @@ void PageSpace::MarkSweep() {
     intptr_t page_in_use = sweeper.SweepLargePage(page);
     HeapPage* next_page = page->next();
     if (page_in_use == 0) {
+      released += page->memory_->size();
       FreeLargePage(page, prev_page);
     } else {
       in_use += page_in_use;
@@ -256,12 +896,53 @@ void PageSpace::MarkSweep() {
   intptr_t in_use_before = in_use_;
   in_use_ = in_use;
 
+  // Move the live objects of the evacuated pages into the swept pages, which
+  // accounts for them in in_use_, and release the evacuated pages.
+  intptr_t num_evacuated = 0;
+  intptr_t moved = 0;
+  if (evacuated_pages != NULL) {
+    GCCompactor compactor(heap_, this);
+    moved = compactor.EvacuatePages(isolate, evacuated_pages);
+    while (evacuated_pages != NULL) {
+      HeapPage* next = evacuated_pages->next();
+      released += FreePage(evacuated_pages);
+      num_evacuated++;
+      evacuated_pages = next;
+    }
+    in_use = in_use_;
+  }
+
   timer.Stop();
+  last_time_ = timer.TotalElapsedTime();
+  total_time_ += last_time_;
+  in_use_after_gc_ = in_use;
+  allocated_since_step_ = 0;
+
   if (FLAG_verbose_gc) {
+    if (was_marking) {
+      OS::PrintErr("Incremental-Mark[%d]: %d steps, %lldus (max %lldus)\n",
+                   count_,
+                   marking_steps_,
+                   marking_time_,
+                   max_step_time_);
+    }
     const intptr_t KB2 = KB / 2;
+    if (num_evacuated > 0) {
+      OS::PrintErr("Compact[%d]: %d pages released (%dK moved)\n",
+                   count_,
+                   num_evacuated,
+                   (moved + KB2) / KB);
+    }
+    if (released > 0) {
+      OS::PrintErr("Release[%d]: %dK (%d empty pages, %d cached)\n",
+                   count_,
+                   (released + KB2) / KB,
+                   num_empty_pages,
+                   page_cache_size_);
+    }
     OS::PrintErr("Mark-Sweep[%d]: %lldus (%dK -> %dK, %dK)\n",
                  count_,
-                 timer.TotalElapsedTime(),
+                 last_time_,
                  (in_use_before + (KB2)) / KB,
                  (in_use + (KB2)) / KB,
                  (capacity_ + KB2) / KB);
@@ -5,6 +5,7 @@
 #ifndef VM_PAGES_H_
 #define VM_PAGES_H_
 
+#include "vm/atomic.h"
 #include "vm/freelist.h"
 #include "vm/globals.h"
 #include "vm/virtual_memory.h"
@@ -13,7 +14,11 @@ namespace dart {
 
 // Forward declarations.
 class Heap;
+class IncrementalMarker;
+class Monitor;
 class ObjectPointerVisitor;
+class ObjectVisitor;
+class PageSpace;
 
 // An aligned page containing old generation objects. Alignment is used to be
 // able to get to a HeapPage header quickly based on a pointer to an object.
@@ -26,6 +31,9 @@ class HeapPage {
     return memory_->Contains(addr);
   }
 
+  // The page space this page belongs to.
+  PageSpace* owner() const { return owner_; }
+
   uword start() const { return reinterpret_cast<uword>(this); }
   uword end() const { return memory_->end(); }
 
@@ -33,7 +41,13 @@ class HeapPage {
   void set_top(uword top) { top_ = top; }
 
   uword first_object_start() const {
-    return (reinterpret_cast<uword>(this) + sizeof(HeapPage));
+    return (reinterpret_cast<uword>(this) + ObjectStartOffset());
+  }
+
+  // Objects start after the page header, which is padded to keep them
+  // aligned as old objects.
+  static intptr_t ObjectStartOffset() {
+    return Utils::RoundUp(sizeof(HeapPage), kObjectAlignment);
   }
 
   void set_used(uword used) { used_ = used; }
@@ -41,22 +55,140 @@ class HeapPage {
   void AddUsed(uword size) {
     used_ += size;
   }
+  // Used by concurrent marking tasks.
+  void AtomicAddUsed(uword size) {
+    AtomicOperations::FetchAndAdd(reinterpret_cast<intptr_t*>(&used_), size);
+  }
 
+  void VisitObjects(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
 
+  // Give the memory of the OS pages entirely within the free block
+  // [addr, addr + size) back to the system. The first words of the block are
+  // kept for the free list element describing it. Returns the number of bytes
+  // released.
+  intptr_t ReleaseFreeMemory(uword addr, intptr_t size);
+
+  // The mark bits of the objects on this page are kept in a side table with
+  // one bit per kObjectAlignment bytes, so that marking and sweeping do not
+  // write to the objects themselves. The bits are cleared when the page is
+  // swept.
+  bool IsMarked(RawObject* raw_obj) const {
+    uword index = MarkBitIndex(raw_obj);
+    return (mark_bits_[index / kBitsPerWord] & MarkBitMask(index)) != 0;
+  }
+  void SetMarkBit(RawObject* raw_obj) {
+    ASSERT(!IsMarked(raw_obj));
+    uword index = MarkBitIndex(raw_obj);
+    mark_bits_[index / kBitsPerWord] |= MarkBitMask(index);
+  }
+  // Set the mark bit when several marking tasks may race for the object.
+  // Returns false if the object had already been marked.
+  bool TryAcquireMarkBit(RawObject* raw_obj) {
+    uword index = MarkBitIndex(raw_obj);
+    uword* word = &mark_bits_[index / kBitsPerWord];
+    uword mask = MarkBitMask(index);
+    uword bits;
+    do {
+      bits = *word;
+      if ((bits & mask) != 0) {
+        return false;
+      }
+    } while (AtomicOperations::CompareAndSwapWord(
+        word, bits, bits | mask) != bits);
+    return true;
+  }
+  void ClearMarkBits();
+
+  // Returns the start of the first marked object in [addr, limit), or limit
+  // if there is none. Only the mark bits are read.
+  uword NextMarkedObject(uword addr, uword limit) const {
+    ASSERT((addr >= first_object_start()) && (addr <= limit));
+    ASSERT(limit <= end());
+    uword index = (addr - start()) >> kObjectAlignmentLog2;
+    uword limit_index = (limit - start()) >> kObjectAlignmentLog2;
+    if (index >= limit_index) {
+      return limit;
+    }
+    // Skip the bits below 'addr' in the first word, then scan whole words.
+    uword word_index = index / kBitsPerWord;
+    uword last_word_index = (limit_index - 1) / kBitsPerWord;
+    uword bits = mark_bits_[word_index] & ~(MarkBitMask(index) - 1);
+    while (bits == 0) {
+      if (word_index == last_word_index) {
+        return limit;
+      }
+      bits = mark_bits_[++word_index];
+    }
+    index = word_index * kBitsPerWord + Utils::CountTrailingZeros(bits);
+    if (index >= limit_index) {
+      return limit;
+    }
+    return start() + (index << kObjectAlignmentLog2);
+  }
+
+  // Large data pages keep a card table with one dirty bit per kCardSize bytes
+  // so that the scavenger only needs to visit the updated parts of the large
+  // array they contain.
+  static const intptr_t kCardSizeLog2 = 10;
+  static const intptr_t kCardSize = 1 << kCardSizeLog2;
+
+  bool has_card_table() const { return card_table_ != NULL; }
+
+  void RememberCard(RawObject** slot) {
+    card_table_[CardIndex(slot)] = 1;
+  }
+  bool IsCardRemembered(RawObject** slot) const {
+    return card_table_[CardIndex(slot)] != 0;
+  }
+  void RememberAllCards();
+  void ClearCards();
+
+  // Visit the pointers in the dirty cards of the large array on this page.
+  // The cards are cleared before being visited.
+  void VisitRememberedCards(ObjectPointerVisitor* visitor);
+
  private:
-  static HeapPage* Initialize(VirtualMemory* memory, bool is_executable);
-  static HeapPage* Allocate(intptr_t size, bool is_executable);
+  static HeapPage* Initialize(VirtualMemory* memory, PageSpace* owner);
+  static HeapPage* Allocate(intptr_t size, PageSpace* owner);
+  // Allocate a page backed by transparent huge pages.
+  static HeapPage* AllocateHuge(intptr_t size, PageSpace* owner);
+
+  intptr_t NumberOfCards() const {
+    return (end() - start() + kCardSize - 1) >> kCardSizeLog2;
+  }
+  intptr_t CardIndex(RawObject** slot) const {
+    ASSERT(has_card_table());
+    uword addr = reinterpret_cast<uword>(slot);
+    ASSERT((addr >= first_object_start()) && (addr < end()));
+    return (addr - start()) >> kCardSizeLog2;
+  }
+
+  void AllocateCardTable();
+
+  intptr_t NumberOfMarkWords() const;
+  uword MarkBitIndex(RawObject* raw_obj) const {
+    uword addr = RawObject::ToAddr(raw_obj);
+    ASSERT((addr >= first_object_start()) && (addr < end()));
+    return (addr - start()) >> kObjectAlignmentLog2;
+  }
+  static uword MarkBitMask(uword index) {
+    return static_cast<uword>(1) << (index % kBitsPerWord);
+  }
 
   // Deallocate the virtual memory backing this page. The page pointer to this
   // page becomes immediately inaccessible.
   void Deallocate();
 
   VirtualMemory* memory_;
+  PageSpace* owner_;
   HeapPage* next_;
   uword used_;
   uword top_;
+  uint8_t* card_table_;
+  uword* mark_bits_;
 
+  friend class CardVisitor;
   friend class PageSpace;
 
   DISALLOW_ALLOCATION();
@@ -64,6 +196,57 @@ class HeapPage {
 };
 
 
+// Maps addresses to the heap page containing them in constant time, so that
+// the space of a pointer can be determined without walking the page lists.
+// Pages are aligned to PageSpace::kPageAlignment, every aligned chunk covered
+// by a page has an entry in a two level table. Lookups do not take a lock, an
+// entry is only cleared when its page is released by the isolate owning it.
+class PageTable : public AllStatic {
+ public:
+  static void Register(HeapPage* page);
+  static void Unregister(HeapPage* page);
+
+  // Returns the page containing 'addr' or NULL if 'addr' is not within a
+  // heap page of any isolate.
+  static HeapPage* Lookup(uword addr) {
+#if defined(ARCH_IS_64_BIT)
+    if ((addr >> kAddressBits) != 0) {
+      return NULL;
+    }
+#endif
+    uword index = addr >> kChunkSizeLog2;
+    HeapPage** leaf = root_[index >> kLeafBits];
+    if (leaf == NULL) {
+      return NULL;
+    }
+    HeapPage* page = leaf[index & kLeafMask];
+    if ((page == NULL) || (addr >= page->end())) {
+      // The last chunk of a large page may extend past its end.
+      return NULL;
+    }
+    return page;
+  }
+
+ private:
+  static const intptr_t kChunkSizeLog2 = 18;
+#if defined(ARCH_IS_64_BIT)
+  // Only the lower half of the 48 bit virtual address space is used by user
+  // space mappings.
+  static const intptr_t kAddressBits = 48;
+#else
+  static const intptr_t kAddressBits = 32;
+#endif
+  static const intptr_t kIndexBits = kAddressBits - kChunkSizeLog2;
+  static const intptr_t kLeafBits = kIndexBits / 2;
+  static const intptr_t kRootBits = kIndexBits - kLeafBits;
+  static const uword kLeafMask = (static_cast<uword>(1) << kLeafBits) - 1;
+
+  static void SetEntries(HeapPage* page, HeapPage* value);
+
+  static HeapPage** volatile root_[1 << kRootBits];
+};
+
+
 class PageSpace {
  public:
   // TODO(iposva): Determine heap sizes and tune the page size accordingly.
@@ -75,8 +258,29 @@ class PageSpace {
 
   uword TryAllocate(intptr_t size);
 
+  // Allocate memory for an object moved out of a page which is being
+  // evacuated. The capacity of the space may temporarily be exceeded, as the
+  // evacuated pages are released afterwards.
+  uword AllocateForEvacuation(intptr_t size);
+
+  // Return memory obtained from TryAllocate which ended up not being used,
+  // e.g. the unused tail of a promotion buffer of the parallel scavenger.
+  void FreeUnused(uword addr, intptr_t size);
+
   intptr_t in_use() const { return in_use_; }
-  bool Contains(uword addr) const;
+  intptr_t capacity() const { return capacity_; }
+  Heap* heap() const { return heap_; }
+  bool is_executable() const { return is_executable_; }
+
+  // Statistics of the mark-sweeps so far, times are in microseconds.
+  int collections() const { return count_; }
+  int64_t total_time() const { return total_time_; }
+  int64_t last_time() const { return last_time_; }
+  // Constant time, see PageTable.
+  bool Contains(uword addr) const {
+    HeapPage* page = PageTable::Lookup(addr);
+    return (page != NULL) && (page->owner() == this);
+  }
   bool IsValidAddress(uword addr) const {
     return Contains(addr);
   }
@@ -84,25 +288,92 @@ class PageSpace {
     return size <= kAllocatablePageSize;
   }
 
+  void VisitObjects(ObjectVisitor* visitor) const;
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
 
   // Collect the garbage in the page space using mark-sweep.
   void MarkSweep();
 
+  // Free the instructions which were not marked by
+  // GCMarker::MarkInstructions, only used for the code space.
+  void SweepInstructions();
+
+  // Sweep the pages left unswept by a lazy mark-sweep. Needs to be called
+  // before iterating the objects of this space.
+  void FinishSweeping();
+
+  // Incremental marking, see IncrementalMarker. Marking starts once the space
+  // has grown beyond a threshold, and the collection is finished by MarkSweep
+  // once all reachable objects have been marked.
+  bool is_marking() const { return marker_ != NULL; }
+  // Start marking or advance it depending on the bytes allocated since the
+  // last step.
+  void IncrementalMarkingStep();
+  // Visit the pointers of about 'budget' bytes of grey objects, and finish the
+  // collection if marking is complete.
+  void MarkingStep(intptr_t budget);
+  // Old generation work which can be done while the isolate is idle:
+  // advancing incremental marking, sweeping the pages left by a lazy sweep, or
+  // starting incremental marking once the space is close to the marking
+  // threshold. IdleStep does a chunk of about 'budget' bytes of that work and
+  // returns false if there was nothing to do.
+  bool HasIdleWork() const;
+  bool IdleStep(intptr_t budget);
+  // Write barrier for stores of old objects into old objects during marking.
+  void RecordStore(RawObject* value);
+  // Grey the objects allocated since the last call, as they may have been
+  // initialized without going through the write barrier.
+  void GreyAllocatedObjects(ObjectPointerVisitor* visitor);
+
+  Monitor* tasks_monitor() const { return tasks_monitor_; }
+
   static HeapPage* PageFor(RawObject* raw_obj) {
     return reinterpret_cast<HeapPage*>(
         RawObject::ToAddr(raw_obj) & ~(kPageSize -1));
   }
 
+  // Mark bit of an old object, see HeapPage::IsMarked.
+  static bool IsMarked(RawObject* raw_obj) {
+    ASSERT(raw_obj->IsHeapObject() && raw_obj->IsOldObject());
+    return PageFor(raw_obj)->IsMarked(raw_obj);
+  }
+
  private:
-  static const intptr_t kAllocatablePageSize = kPageSize - sizeof(HeapPage);
+  static const intptr_t kAllocatablePageSize =
+      kPageSize -
+      ((sizeof(HeapPage) + kObjectAlignment - 1) & ~(kObjectAlignment - 1));
+
+  // Bytes allocated between two marking steps, and bytes marked per
+  // allocated byte so that marking outpaces allocation.
+  static const intptr_t kMarkingStepInterval = 256 * KB;
+  static const intptr_t kMarkingStepFactor = 4;
+  // While idle, incremental marking starts once this percentage of the
+  // marking threshold is in use.
+  static const intptr_t kIdleMarkingPercent = 75;
 
   void AllocatePage();
+  // Fill the page cache with the regular pages of a huge page.
+  void AllocateHugePage();
   HeapPage* AllocateLargePage(intptr_t size);
   void FreeLargePage(HeapPage* page, HeapPage* previous_page);
   void FreePages(HeapPage* pages);
 
+  // Release a page which has been removed from the list of pages. Up to
+  // FLAG_old_gen_page_cache pages are kept for reuse by AllocatePage, only
+  // their memory is given back to the system. Returns the number of bytes
+  // released.
+  intptr_t FreePage(HeapPage* page);
+  // Bytes of capacity beyond what is needed to keep the free memory of the
+  // pages below FLAG_max_heap_free_ratio percent after a collection. The
+  // space would grow back right away if less memory was kept.
+  intptr_t ExcessCapacity() const;
+  // Release up to 'max_pages' pages without any marked object, they are not
+  // swept. Returns the number of bytes released.
+  intptr_t FreeEmptyPages(intptr_t max_pages, intptr_t* num_pages);
+
   static intptr_t LargePageSizeFor(intptr_t size);
+  // Whether data pages are backed by transparent huge pages.
+  bool UseHugePages() const;
   bool CanIncreaseCapacity(intptr_t increase) {
     ASSERT(capacity_ <= max_capacity_);
     return increase <= (max_capacity_ - capacity_);
@@ -110,6 +381,20 @@ class PageSpace {
 
   uword TryBumpAllocate(intptr_t size);
 
+  // Marking starts once the space has doubled since the last collection and
+  // has reached the size given by FLAG_incremental_marking_threshold.
+  intptr_t MarkingThreshold() const;
+  void StartIncrementalMarking();
+
+  // Remove the sparse pages to be evacuated by a compacting mark-sweep from the
+  // list of pages. Returns NULL if the space is not fragmented enough.
+  HeapPage* SelectPagesToEvacuate();
+
+  // Sweep the next page left unswept by the last mark-sweep. Returns false
+  // if all pages have been swept.
+  bool SweepNextPage();
+  bool HasUnsweptPages() const { return sweep_cursor_ != sweep_end_; }
+
   FreeList freelist_;
 
   Heap* heap_;
@@ -118,6 +403,19 @@ class PageSpace {
   HeapPage* pages_tail_;
   HeapPage* large_pages_;
 
+  // Empty pages kept for reuse, they do not count towards the capacity.
+  HeapPage* page_cache_;
+  intptr_t page_cache_size_;
+
+  // After a lazy mark-sweep the pages from sweep_cursor_ up to but excluding
+  // sweep_end_ still need to be swept.
+  HeapPage* sweep_cursor_;
+  HeapPage* sweep_end_;
+
+  // Bytes of free memory still to be given back to the system after the
+  // last mark-sweep, see ExcessCapacity.
+  intptr_t release_budget_;
+
   // Various sizes being tracked for this generation.
   intptr_t max_capacity_;
   intptr_t capacity_;
@@ -125,12 +423,33 @@ class PageSpace {
 
   // Old-gen GC cycle count.
   int count_;
+  // Pause times of all mark-sweeps and of the last one.
+  int64_t total_time_;
+  int64_t last_time_;
+
+  // Incremental marking state. Objects allocated during marking are bump
+  // allocated, those past the allocation cursor and in the large pages in
+  // front of marked_large_pages_ have not been greyed yet.
+  IncrementalMarker* marker_;
+  intptr_t in_use_after_gc_;
+  intptr_t allocated_since_step_;
+  HeapPage* allocation_cursor_page_;
+  uword allocation_cursor_;
+  HeapPage* marked_large_pages_;
+  // Pause statistics of the current marking cycle.
+  intptr_t marking_steps_;
+  int64_t marking_time_;
+  int64_t max_step_time_;
 
   bool is_executable_;
 
   // Keep track whether a MarkSweep is currently running.
   bool sweeping_;
 
+  // Used to wait for the helper threads of parallel marking. It outlives the
+  // individual collections so that exiting helpers can still release it.
+  Monitor* tasks_monitor_;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(PageSpace);
 };
 
@@ -3,6 +3,7 @@
 // BSD-style license that can be found in the LICENSE file.
 
 #include "vm/assert.h"
+#include "vm/heap.h"
 #include "vm/pages.h"
 #include "vm/unit_test.h"
 
@@ -31,4 +32,36 @@ TEST_CASE(Pages) {
   delete space;
 }
 
+
+TEST_CASE(HugePages) {
+  if (!VirtualMemory::SupportsHugePages()) {
+    return;
+  }
+  const intptr_t kHugePageSize = VirtualMemory::kHugePageSize;
+  bool saved_use_huge_pages = FLAG_use_huge_pages;
+  FLAG_use_huge_pages = true;
+  PageSpace* space = new PageSpace(NULL, 16 * MB);
+  // The regular pages are split off a single huge page.
+  uword first_block = space->TryAllocate(8 * kWordSize);
+  EXPECT(first_block != 0);
+  uword huge_page = first_block & ~(kHugePageSize - 1);
+  const intptr_t kBlockSize = 16 * KB;
+  intptr_t num_blocks = (kHugePageSize / kBlockSize) / 2;
+  for (intptr_t i = 0; i < num_blocks; i++) {
+    uword block = space->TryAllocate(kBlockSize);
+    EXPECT(block != 0);
+    EXPECT_EQ(huge_page, block & ~(kHugePageSize - 1));
+  }
+  EXPECT(space->capacity() > PageSpace::kPageSize);
+  EXPECT(space->capacity() < kHugePageSize);
+
+  // Large pages spanning huge pages are aligned to them.
+  uword large_block = space->TryAllocate(3 * MB);
+  EXPECT(large_block != 0);
+  HeapPage* large_page = PageSpace::PageFor(RawObject::FromAddr(large_block));
+  EXPECT(Utils::IsAligned(reinterpret_cast<uword>(large_page), kHugePageSize));
+  delete space;
+  FLAG_use_huge_pages = saved_use_huge_pages;
+}
+
 }  // namespace dart
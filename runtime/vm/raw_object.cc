@@ -31,17 +31,16 @@ void RawObject::Validate() const {
 
   // Validate that the tags_ field is sensible.
   intptr_t tags = ptr()->tags_;
-  ASSERT((tags & 0xffff00f0) == 0);
+  ASSERT((tags & 0xffff0000) == 0);
 }
 
 
-intptr_t RawObject::SizeFromClass() const {
+intptr_t RawObject::SizeFromClass(RawClass* raw_class) const {
   NoHandleScope no_handles(Isolate::Current());
 
   // Only reasonable to be called on heap objects.
   ASSERT(IsHeapObject());
 
-  RawClass* raw_class = ptr()->class_;
   intptr_t instance_size = raw_class->ptr()->instance_size_;
   ObjectKind instance_kind = raw_class->ptr()->instance_kind_;
 
@@ -172,6 +171,12 @@ intptr_t RawObject::SizeFromClass() const {
 }
 
 
+bool RawObject::IsArray() const {
+  ObjectKind kind = ptr()->class_->ptr()->instance_kind_;
+  return (kind == kArray) || (kind == kImmutableArray);
+}
+
+
 intptr_t RawObject::VisitPointers(ObjectPointerVisitor* visitor) {
   intptr_t size = 0;
   NoHandleScope no_handles(Isolate::Current());
@@ -183,8 +188,11 @@ intptr_t RawObject::VisitPointers(ObjectPointerVisitor* visitor) {
   RawClass* raw_class = ptr()->class_;
   ObjectKind kind = raw_class->ptr()->instance_kind_;
 
-  // Visit the class before visting the fields.
-  visitor->VisitPointer(reinterpret_cast<RawObject**>(&ptr()->class_));
+  // Visit the class before visting the fields. Free list elements use a fake
+  // class which does not live in the heap.
+  if (kind != kFreeListElement) {
+    visitor->VisitPointer(reinterpret_cast<RawObject**>(&ptr()->class_));
+  }
 
   switch (kind) {
 #define RAW_VISITPOINTERS(clazz) \
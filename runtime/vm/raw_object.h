@@ -143,13 +143,12 @@ class RawObject {
   // bit fields for storing tags.
   enum TagBits {
     kFreeBit = 0,
-    kMarkBit = 1,
+    kReservedBit = 1,  // Mark bits are kept in HeapPage.
     kCanonicalBit = 2,
     kFromSnapshotBit = 3,
-    kReservedBit10K = 4,
-    kReservedBit100K = 5,
-    kReservedBit1M = 6,
-    kReservedBit10M = 7,
+    kRememberedBit = 4,
+    kAgeTagBit = 5,
+    kAgeTagSize = 3,
     kSizeTagBit = 8,
     kSizeTagSize = 8,
   };
@@ -199,19 +198,32 @@ class RawObject {
     return (addr & kNewObjectAlignmentOffset) == kOldObjectAlignmentOffset;
   }
 
-  // Support for GC marking bit.
-  bool IsMarked() const {
-    return MarkBit::decode(ptr()->tags_);
+  // Support for the remembered bit of the generational write barrier. It is set
+  // on old objects while they are recorded in the store buffer.
+  bool IsRemembered() const {
+    return RememberedBit::decode(ptr()->tags_);
   }
-  void SetMarkBit() {
-    ASSERT(!IsMarked());
+  void SetRememberedBit() {
+    ASSERT(!IsRemembered());
     uword tags = ptr()->tags_;
-    ptr()->tags_ = MarkBit::update(true, tags);
+    ptr()->tags_ = RememberedBit::update(true, tags);
   }
-  void ClearMarkBit() {
-    ASSERT(IsMarked());
+  void ClearRememberedBit() {
+    ASSERT(IsRemembered());
     uword tags = ptr()->tags_;
-    ptr()->tags_ = MarkBit::update(false, tags);
+    ptr()->tags_ = RememberedBit::update(false, tags);
+  }
+
+  // Number of scavenges a new object has survived, used to decide when it is
+  // promoted. The age of old objects is zero.
+  static const intptr_t kMaxAge = (1 << kAgeTagSize) - 1;
+  intptr_t Age() const {
+    return AgeTag::decode(ptr()->tags_);
+  }
+  void SetAge(intptr_t age) {
+    ASSERT((age >= 0) && (age <= kMaxAge));
+    uword tags = ptr()->tags_;
+    ptr()->tags_ = AgeTag::update(age, tags);
   }
 
   // Support for object tags.
@@ -222,6 +234,11 @@ class RawObject {
     uword tags = ptr()->tags_;
     ptr()->tags_ = CanonicalObjectTag::update(true, tags);
   }
+  // Free list elements fill the unused memory of old pages.
+  bool IsFreeListElement() const {
+    return FreeBit::decode(ptr()->tags_);
+  }
+
   bool IsCreatedFromSnapshot() const {
     return CreatedFromSnapshotTag::decode(ptr()->tags_);
   }
@@ -242,9 +259,25 @@ class RawObject {
     return result;
   }
 
+  // Size of a live object of class 'raw_class'. Does not read the class of the
+  // object, which may be concurrently overwritten by a forwarding address
+  // during a parallel scavenge.
+  intptr_t SizeWithClass(RawClass* raw_class) const {
+    uword tags = ptr()->tags_;
+    ASSERT(!FreeBit::decode(tags));
+    intptr_t result = SizeTag::decode(tags);
+    if (result != 0) {
+      return result;
+    }
+    return SizeFromClass(raw_class);
+  }
+
   void Validate() const;
   intptr_t VisitPointers(ObjectPointerVisitor* visitor);
 
+  // Arrays on large pages are scanned card by card by the scavenger.
+  bool IsArray() const;
+
   static RawObject* FromAddr(uword addr) {
     // We expect the untagged address here.
     ASSERT((addr & kSmiTagMask) != kHeapObjectTag);
@@ -270,7 +303,10 @@ class RawObject {
  private:
   class FreeBit : public BitField<bool, kFreeBit, 1> {};
 
-  class MarkBit : public BitField<bool, kMarkBit, 1> {};
+
+  class RememberedBit : public BitField<bool, kRememberedBit, 1> {};
+
+  class AgeTag : public BitField<intptr_t, kAgeTagBit, kAgeTagSize> {};
 
   class CanonicalObjectTag : public BitField<bool, kCanonicalBit, 1> {};
 
@@ -282,13 +318,19 @@ class RawObject {
         reinterpret_cast<uword>(this) - kHeapObjectTag);
   }
 
-  intptr_t SizeFromClass() const;
+  intptr_t SizeFromClass() const {
+    return SizeFromClass(ptr()->class_);
+  }
+  intptr_t SizeFromClass(RawClass* raw_class) const;
 
   friend class Object;
   friend class Array;
   friend class SnapshotWriter;
   friend class SnapshotReader;
   friend class MarkingVisitor;
+  friend class Scavenger;
+  friend class ClassHistogram;
+  friend class HeapGraphWriter;
 
   DISALLOW_ALLOCATION();
   DISALLOW_IMPLICIT_CONSTRUCTORS(RawObject);
@@ -337,9 +379,12 @@ class RawClass : public RawObject {
   int8_t class_state_;  // Of type ClassState.
   bool is_const_;
   bool is_interface_;
+  bool is_pretenured_;  // Instances are allocated in old space.
+  intptr_t pretenured_allocations_;  // Selects the instances still sampled.
 
   friend class Object;
   friend class RawInstance;
+  friend class Scavenger;
   friend RawClass* AllocateFakeClass();
 };
 
@@ -646,6 +691,7 @@ class RawInstructions : public RawObject {
   uint8_t data_[0];
 
   friend class RawCode;
+  friend class InstructionsMarker;
 };
 
 
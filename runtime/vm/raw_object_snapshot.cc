@@ -59,7 +59,7 @@ RawClass* Class::ReadFrom(SnapshotReader* reader,
     // allocations may happen.
     intptr_t num_flds = (cls.raw()->to() - cls.raw()->from());
     for (intptr_t i = 0; i <= num_flds; i++) {
-      *(cls.raw()->from() + i) = reader->ReadObject();
+      cls.StorePointer((cls.raw()->from() + i), reader->ReadObject());
     }
   } else {
     cls ^= reader->ReadClassId(object_id);
@@ -124,7 +124,8 @@ RawUnresolvedClass* UnresolvedClass::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (unresolved_class.raw()->to() -
                        unresolved_class.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(unresolved_class.raw()->from() + i) = reader->ReadObject();
+    unresolved_class.StorePointer((unresolved_class.raw()->from() + i),
+                                  reader->ReadObject());
   }
   return unresolved_class.raw();
 }
@@ -188,7 +189,8 @@ RawType* Type::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (parameterized_type.raw()->to() -
                        parameterized_type.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(parameterized_type.raw()->from() + i) = reader->ReadObject();
+    parameterized_type.StorePointer((parameterized_type.raw()->from() + i),
+                                    reader->ReadObject());
   }
 
   // If object needs to be a canonical object, Canonicalize it.
@@ -243,7 +245,8 @@ RawTypeParameter* TypeParameter::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (type_parameter.raw()->to() -
                        type_parameter.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(type_parameter.raw()->from() + i) = reader->ReadObject();
+    type_parameter.StorePointer((type_parameter.raw()->from() + i),
+                                reader->ReadObject());
   }
 
   return type_parameter.raw();
@@ -292,7 +295,8 @@ RawInstantiatedType* InstantiatedType::ReadFrom(SnapshotReader* reader,
   intptr_t num_flds = (instantiated_type.raw()->to() -
                        instantiated_type.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(instantiated_type.raw()->from() + i) = reader->ReadObject();
+    instantiated_type.StorePointer((instantiated_type.raw()->from() + i),
+                                   reader->ReadObject());
   }
   return instantiated_type.raw();
 }
@@ -413,7 +417,8 @@ RawInstantiatedTypeArguments* InstantiatedTypeArguments::ReadFrom(
   intptr_t num_flds = (instantiated_type_arguments.raw()->to() -
                        instantiated_type_arguments.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(instantiated_type_arguments.raw()->from() + i) = reader->ReadObject();
+    instantiated_type_arguments.StorePointer(
+        (instantiated_type_arguments.raw()->from() + i), reader->ReadObject());
   }
   return instantiated_type_arguments.raw();
 }
@@ -468,7 +473,7 @@ RawFunction* Function::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (func.raw()->to() - func.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(func.raw()->from() + i) = reader->ReadObject();
+    func.StorePointer((func.raw()->from() + i), reader->ReadObject());
   }
 
   return func.raw();
@@ -529,7 +534,7 @@ RawField* Field::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (field.raw()->to() - field.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(field.raw()->from() + i) = reader->ReadObject();
+    field.StorePointer((field.raw()->from() + i), reader->ReadObject());
   }
 
   return field.raw();
@@ -633,7 +638,7 @@ RawScript* Script::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (script.raw()->to() - script.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(script.raw()->from() + i) = reader->ReadObject();
+    script.StorePointer((script.raw()->from() + i), reader->ReadObject());
   }
 
   return script.raw();
@@ -699,7 +704,7 @@ RawLibrary* Library::ReadFrom(SnapshotReader* reader,
     // allocations may happen.
     intptr_t num_flds = (library.raw()->to() - library.raw()->from());
     for (intptr_t i = 0; i <= num_flds; i++) {
-      *(library.raw()->from() + i) = reader->ReadObject();
+      library.StorePointer((library.raw()->from() + i), reader->ReadObject());
     }
   }
   return library.raw();
@@ -760,7 +765,7 @@ RawLibraryPrefix* LibraryPrefix::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (prefix.raw()->to() - prefix.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(prefix.raw()->from() + i) = reader->ReadObject();
+    prefix.StorePointer((prefix.raw()->from() + i), reader->ReadObject());
   }
 
   return prefix.raw();
@@ -900,7 +905,7 @@ RawContext* Context::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (context.raw()->to(num_vars) - context.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(context.raw()->from() + i) = reader->ReadObject();
+    context.StorePointer((context.raw()->from() + i), reader->ReadObject());
   }
 
   return context.raw();
@@ -950,7 +955,7 @@ RawContextScope* ContextScope::ReadFrom(SnapshotReader* reader,
   // allocations may happen.
   intptr_t num_flds = (scope.raw()->to(num_vars) - scope.raw()->from());
   for (intptr_t i = 0; i <= num_flds; i++) {
-    *(scope.raw()->from() + i) = reader->ReadObject();
+    scope.StorePointer((scope.raw()->from() + i), reader->ReadObject());
   }
 
   return scope.raw();
@@ -1634,7 +1639,7 @@ RawJSRegExp* JSRegExp::ReadFrom(SnapshotReader* reader,
   regex.raw_ptr()->num_bracket_expressions_ = GetSmi(reader->ReadIntptrValue());
   String& pattern = String::Handle(reader->isolate(), String::null());
   pattern ^= reader->ReadObject();
-  regex.raw_ptr()->pattern_ = pattern.raw();
+  regex.StorePointer(&regex.raw_ptr()->pattern_, pattern.raw());
   regex.raw_ptr()->type_ = reader->ReadIntptrValue();
   regex.raw_ptr()->flags_ = reader->ReadIntptrValue();
 
@@ -4,10 +4,14 @@
 
 #include "vm/scavenger.h"
 
+#include "vm/atomic.h"
 #include "vm/dart.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
+#include "vm/pages.h"
 #include "vm/stack_frame.h"
+#include "vm/store_buffer.h"
+#include "vm/thread.h"
 #include "vm/verifier.h"
 #include "vm/visitor.h"
 
@@ -40,12 +44,106 @@ static inline void ForwardTo(uword orignal, uword target) {
 }
 
 
+// Scavenge the pointers of an old object recorded in the store buffer.
+template<typename Visitor>
+static void ScavengeRememberedObject(RawObject* raw_object, Visitor* visitor) {
+  raw_object->ClearRememberedBit();
+  visitor->VisitingOldObject(raw_object);
+  HeapPage* page = PageSpace::PageFor(raw_object);
+  if (page->has_card_table() && raw_object->IsArray()) {
+    // Only visit the parts of large arrays which have been updated.
+    page->VisitRememberedCards(visitor);
+  } else {
+    if (page->has_card_table()) {
+      page->ClearCards();
+    }
+    raw_object->VisitPointers(visitor);
+  }
+}
+
+
+// Counts the objects of each class which were allocated since the previous
+// scavenge and how many of them survived.
+class ClassSurvivalTable : public ValueObject {
+ public:
+  struct Entry {
+    RawClass* raw_class;
+    intptr_t allocated;
+    intptr_t survived;
+  };
+
+  ClassSurvivalTable() : capacity_(kInitialCapacity), count_(0) {
+    entries_ = new Entry[capacity_];
+    memset(entries_, 0, capacity_ * sizeof(entries_[0]));
+  }
+
+  ~ClassSurvivalTable() {
+    delete[] entries_;
+  }
+
+  void Add(RawClass* raw_class, bool survived) {
+    Entry* entry = Lookup(raw_class);
+    if (entry->raw_class == NULL) {
+      entry->raw_class = raw_class;
+      count_++;
+      if ((count_ * 2) > capacity_) {
+        Grow();
+        entry = Lookup(raw_class);
+      }
+    }
+    entry->allocated++;
+    if (survived) {
+      entry->survived++;
+    }
+  }
+
+  intptr_t capacity() const { return capacity_; }
+  const Entry& At(intptr_t index) const { return entries_[index]; }
+
+ private:
+  static const intptr_t kInitialCapacity = 256;
+
+  Entry* Lookup(RawClass* raw_class) {
+    intptr_t mask = capacity_ - 1;
+    intptr_t index =
+        (reinterpret_cast<uword>(raw_class) >> kObjectAlignmentLog2) & mask;
+    while ((entries_[index].raw_class != NULL) &&
+           (entries_[index].raw_class != raw_class)) {
+      index = (index + 1) & mask;
+    }
+    return &entries_[index];
+  }
+
+  void Grow() {
+    Entry* old_entries = entries_;
+    intptr_t old_capacity = capacity_;
+    capacity_ *= 2;
+    entries_ = new Entry[capacity_];
+    memset(entries_, 0, capacity_ * sizeof(entries_[0]));
+    for (intptr_t i = 0; i < old_capacity; i++) {
+      if (old_entries[i].raw_class != NULL) {
+        *Lookup(old_entries[i].raw_class) = old_entries[i];
+      }
+    }
+    delete[] old_entries;
+  }
+
+  intptr_t capacity_;
+  intptr_t count_;
+  Entry* entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(ClassSurvivalTable);
+};
+
+
 class ScavengerVisitor : public ObjectPointerVisitor {
  public:
-  explicit ScavengerVisitor(Scavenger* scavenger)
+  ScavengerVisitor(Isolate* isolate, Scavenger* scavenger)
       : scavenger_(scavenger),
         heap_(scavenger->heap_),
-        vm_heap_(Dart::vm_isolate()->heap()) {}
+        vm_heap_(Dart::vm_isolate()->heap()),
+        store_buffer_(isolate->store_buffer()),
+        visiting_old_object_(NULL) {}
 
   void VisitPointers(RawObject** first, RawObject** last) {
     for (RawObject** current = first; current <= last; current++) {
@@ -53,9 +151,20 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     }
   }
 
+  // The old object whose pointers are currently being visited, or NULL if the
+  // pointers being visited are roots or belong to a new object.
+  void VisitingOldObject(RawObject* obj) {
+    ASSERT((obj == NULL) || obj->IsOldObject());
+    visiting_old_object_ = obj;
+  }
+
  private:
   void UpdateStoreBuffer(RawObject** p, RawObject* obj) {
-    // TODO(iposva): Implement store buffers.
+    // An old object which still refers to a surviving new object after this
+    // scavenge needs to be remembered for the next scavenge.
+    if ((visiting_old_object_ != NULL) && obj->IsNewObject()) {
+      store_buffer_->AddSlot(visiting_old_object_, p);
+    }
   }
 
   void ScavengePointer(RawObject** p) {
@@ -65,11 +174,10 @@ class ScavengerVisitor : public ObjectPointerVisitor {
     if (!raw_obj->IsHeapObject()) return;
 
     uword raw_addr = RawObject::ToAddr(raw_obj);
-    // Objects should be contained in the heap.
-    // TODO(iposva): Add an appropriate assert here or in the return block
-    // below.
     // The scavenger is only interested in objects located in the from space.
     if (!scavenger_->from_->Contains(raw_addr)) {
+      // Objects should be contained in the heap.
+      ASSERT(heap_->Contains(raw_addr) || vm_heap_->Contains(raw_addr));
       return;
     }
 
@@ -82,23 +190,21 @@ class ScavengerVisitor : public ObjectPointerVisitor {
       new_addr = ForwardedAddr(header);
     } else {
       intptr_t size = raw_obj->Size();
+      intptr_t age = raw_obj->Age();
+      bool promoted = false;
       // Check whether object should be promoted.
-      if (scavenger_->survivor_end_ <= raw_addr) {
-        // Not a survivor of a previous scavenge. Just copy the object into the
-        // to space.
+      if (!scavenger_->ShouldPromote(raw_obj)) {
+        // Not old enough yet. Just copy the object into the to space.
         new_addr = scavenger_->TryAllocate(size);
       } else {
-        // TODO(iposva): Experiment with less aggressive promotion. For example
-        // a coin toss determines if an object is promoted or whether it should
-        // survive in this generation.
-        //
-        // This object is a survivor of a previous scavenge. Attempt to promote
-        // the object.
+        // This object has survived enough scavenges. Attempt to promote the
+        // object.
         new_addr = heap_->TryAllocate(size, Heap::kOld);
         if (new_addr != 0) {
           // If promotion succeeded then we need to remember it so that it can
           // be traversed later.
           scavenger_->PushToPromotedStack(new_addr);
+          promoted = true;
         } else {
           // Promotion did not succeed. Copy into the to space instead.
           scavenger_->had_promotion_failure_ = true;
@@ -112,6 +218,8 @@ class ScavengerVisitor : public ObjectPointerVisitor {
       memmove(reinterpret_cast<void*>(new_addr),
               reinterpret_cast<void*>(raw_addr),
               size);
+      RawObject::FromAddr(new_addr)->SetAge(
+          promoted ? 0 : Utils::Minimum(age + 1, RawObject::kMaxAge));
       // Remember forwarding address.
       ForwardTo(raw_addr, new_addr);
     }
@@ -125,6 +233,8 @@ class ScavengerVisitor : public ObjectPointerVisitor {
   Scavenger* scavenger_;
   Heap* heap_;
   Heap* vm_heap_;
+  StoreBuffer* store_buffer_;
+  RawObject* visiting_old_object_;
 
   DISALLOW_COPY_AND_ASSIGN(ScavengerVisitor);
 };
@@ -158,23 +268,613 @@ class ScavengerWeakVisitor : public ObjectPointerVisitor {
 };
 
 
+// A block of objects which have been copied by a parallel scavenge but whose
+// pointers have not been scavenged yet. Blocks are chained together when they
+// are shared between the scavenger tasks.
+class ScavengerWorkBlock {
+ public:
+  static const intptr_t kSize = 128;
+
+  ScavengerWorkBlock() : next_(NULL), top_(0) {}
+
+  ScavengerWorkBlock* next() const { return next_; }
+  void set_next(ScavengerWorkBlock* next) { next_ = next; }
+
+  intptr_t Count() const { return top_; }
+  bool IsEmpty() const { return top_ == 0; }
+  bool IsFull() const { return top_ == kSize; }
+
+  void Push(RawObject* obj) {
+    ASSERT(top_ < kSize);
+    objects_[top_++] = obj;
+  }
+  RawObject* Pop() {
+    ASSERT(top_ > 0);
+    return objects_[--top_];
+  }
+
+ private:
+  ScavengerWorkBlock* next_;
+  intptr_t top_;
+  RawObject* objects_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(ScavengerWorkBlock);
+};
+
+
+// A bump allocation buffer owned by a single scavenger task.
+class ScavengerBuffer : public ValueObject {
+ public:
+  ScavengerBuffer() : start_(0), top_(0), end_(0) {}
+
+  void Reset(uword start, intptr_t size) {
+    start_ = start;
+    top_ = start;
+    end_ = start + size;
+  }
+
+  uword top() const { return top_; }
+  intptr_t remaining() const { return end_ - top_; }
+
+  uword TryAllocate(intptr_t size) {
+    if (remaining() < size) {
+      return 0;
+    }
+    uword result = top_;
+    top_ += size;
+    return result;
+  }
+
+  // Give back the most recent allocation of this buffer. Returns false if
+  // 'addr' was not allocated from this buffer.
+  bool TryUndoAllocation(uword addr, intptr_t size) {
+    if ((addr < start_) || ((addr + size) != top_)) {
+      return false;
+    }
+    top_ = addr;
+    return true;
+  }
+
+ private:
+  uword start_;
+  uword top_;
+  uword end_;
+};
+
+
+// State shared by the tasks of a parallel scavenge. The first task runs on the
+// thread which started the scavenge, the other tasks run on helper threads.
+class ParallelScavenge {
+ public:
+  ParallelScavenge(Scavenger* scavenger,
+                   Heap* heap,
+                   Isolate* isolate,
+                   Monitor* tasks_monitor,
+                   intptr_t num_tasks);
+  ~ParallelScavenge();
+
+  intptr_t num_tasks() const { return num_tasks_; }
+  ParallelScavengerVisitor* task(intptr_t i) const {
+    ASSERT((i >= 0) && (i < num_tasks_));
+    return tasks_[i];
+  }
+
+  void StartHelpers();
+  void WaitForHelpers();
+  // Called by each helper once it is done. The helper must not access this
+  // object afterwards.
+  void HelperDone();
+
+  // Claim the next block of the remembered set, or NULL if all blocks have
+  // been claimed.
+  StoreBufferBlock* NextStoreBufferBlock();
+
+  // The old space is shared by all tasks.
+  uword AllocateOld(intptr_t size);
+  void FreeOld(uword addr, intptr_t size);
+
+  // Called by a task which ran out of work. Returns true as soon as another
+  // task shares work, and false once all tasks have run out of work.
+  bool WaitForWork();
+  bool HasIdleTasks() const { return idle_tasks_ > 0; }
+
+ private:
+  Heap* heap_;
+  Isolate* isolate_;
+  Monitor* tasks_monitor_;
+  intptr_t num_tasks_;
+  ParallelScavengerVisitor** tasks_;
+
+  // Number of helpers which are still running, protected by tasks_monitor_.
+  intptr_t running_helpers_;
+  // Number of tasks waiting for work.
+  volatile intptr_t idle_tasks_;
+
+  // Protects the old space and the remembered set blocks.
+  Mutex mutex_;
+  StoreBufferBlock* store_buffer_blocks_;
+  StoreBufferBlock* next_store_buffer_block_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavenge);
+};
+
+
+// Each task of a parallel scavenge copies objects into its own to space and
+// promotion buffers. The copied objects are forwarded by a compare-and-swap
+// on the header word of the original object, the task losing the race drops
+// its copy. Copied objects are remembered in work blocks, full blocks are
+// shared and stolen by tasks which ran out of work.
+class ParallelScavengerVisitor : public ObjectPointerVisitor {
+ public:
+  ParallelScavengerVisitor(Scavenger* scavenger,
+                           ParallelScavenge* scavenge,
+                           intptr_t id,
+                           StoreBuffer* store_buffer)
+      : scavenger_(scavenger),
+        scavenge_(scavenge),
+        id_(id),
+        store_buffer_(store_buffer),
+        visiting_old_object_(NULL),
+        copy_buffer_(),
+        promotion_buffer_(),
+        work_(new ScavengerWorkBlock()),
+        shared_blocks_(NULL),
+        shared_count_(0) {}
+
+  ~ParallelScavengerVisitor() {
+    ASSERT(work_->IsEmpty());
+    ASSERT(shared_blocks_ == NULL);
+    delete work_;
+  }
+
+  ParallelScavenge* scavenge() const { return scavenge_; }
+  StoreBuffer* store_buffer() const { return store_buffer_; }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      ScavengePointer(current);
+    }
+  }
+
+  void VisitingOldObject(RawObject* obj) {
+    ASSERT((obj == NULL) || obj->IsOldObject());
+    visiting_old_object_ = obj;
+  }
+
+  // Scavenge the claimed parts of the remembered set and all copied objects
+  // until none of the tasks has any work left.
+  void Run();
+
+  // Release the unused parts of the allocation buffers of this task.
+  void Finish();
+
+  bool HasSharedWork() const { return shared_count_ > 0; }
+  ScavengerWorkBlock* TakeSharedBlock();
+
+ private:
+  static const intptr_t kBufferSize = 32 * KB;
+  // Larger objects are allocated outside of the buffers to limit the space
+  // left unused at the end of a buffer.
+  static const intptr_t kMaxBufferedObjectSize = kBufferSize / 4;
+
+  void UpdateStoreBuffer(RawObject** p, RawObject* obj) {
+    if ((visiting_old_object_ != NULL) && obj->IsNewObject()) {
+      store_buffer_->AddSlot(visiting_old_object_, p);
+    }
+  }
+
+  void ScavengePointer(RawObject** p);
+
+  uword AllocateCopy(intptr_t size);
+  uword AllocatePromoted(intptr_t size);
+  void UndoAllocation(uword addr, intptr_t size, bool promoted);
+
+  void PushWork(RawObject* obj);
+  RawObject* PopWork();
+  void ShareBlock(ScavengerWorkBlock* block);
+  bool StealWork();
+
+  Scavenger* scavenger_;
+  ParallelScavenge* scavenge_;
+  intptr_t id_;
+  StoreBuffer* store_buffer_;
+  RawObject* visiting_old_object_;
+
+  ScavengerBuffer copy_buffer_;
+  ScavengerBuffer promotion_buffer_;
+
+  // Private work of this task.
+  ScavengerWorkBlock* work_;
+
+  // Work which can be stolen by other tasks, protected by mutex_.
+  Mutex mutex_;
+  ScavengerWorkBlock* shared_blocks_;
+  volatile intptr_t shared_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelScavengerVisitor);
+};
+
+
+void ParallelScavengerVisitor::ScavengePointer(RawObject** p) {
+  RawObject* raw_obj = *p;
+
+  // Fast exit if the raw object is a Smi.
+  if (!raw_obj->IsHeapObject()) return;
+
+  uword raw_addr = RawObject::ToAddr(raw_obj);
+  // The scavenger is only interested in objects located in the from space.
+  if (!scavenger_->from_->Contains(raw_addr)) {
+    return;
+  }
+
+  uword* header_addr = reinterpret_cast<uword*>(raw_addr);
+  uword header = *reinterpret_cast<volatile uword*>(header_addr);
+  uword new_addr = 0;
+  if (IsForwarding(header)) {
+    new_addr = ForwardedAddr(header);
+  } else {
+    // The header still holds the class of the object. Other tasks may forward
+    // the object concurrently, so the class must not be read from the object.
+    RawClass* raw_class = reinterpret_cast<RawClass*>(header);
+    intptr_t size = raw_obj->SizeWithClass(raw_class);
+    bool promoted = false;
+    if (scavenger_->ShouldPromote(raw_obj)) {
+      // This object has survived enough scavenges. Attempt to promote the
+      // object.
+      new_addr = AllocatePromoted(size);
+      if (new_addr != 0) {
+        promoted = true;
+      } else {
+        scavenger_->had_promotion_failure_ = true;
+      }
+    }
+    if (new_addr == 0) {
+      new_addr = AllocateCopy(size);
+    }
+    if (new_addr == 0) {
+      // The unused ends of the buffers of all tasks can exhaust the to space.
+      new_addr = AllocatePromoted(size);
+      if (new_addr == 0) {
+        FATAL("Exhausted heap space during parallel scavenge.");
+      }
+      promoted = true;
+    }
+    memmove(reinterpret_cast<void*>(new_addr),
+            reinterpret_cast<void*>(raw_addr),
+            size);
+    // The header might have been forwarded by another task during the copy.
+    *reinterpret_cast<uword*>(new_addr) = header;
+    RawObject::FromAddr(new_addr)->SetAge(
+        promoted ? 0 : Utils::Minimum(raw_obj->Age() + 1, RawObject::kMaxAge));
+    uword previous = AtomicOperations::CompareAndSwapWord(
+        header_addr, header, new_addr | kForwarded);
+    if (previous == header) {
+      // This task copied the object and is responsible for its pointers.
+      PushWork(RawObject::FromAddr(new_addr));
+    } else {
+      // Another task copied the object first, use its copy instead.
+      UndoAllocation(new_addr, size, promoted);
+      new_addr = ForwardedAddr(previous);
+    }
+  }
+  // Update the reference.
+  RawObject* new_obj = RawObject::FromAddr(new_addr);
+  *p = new_obj;
+  // Update the store buffer as needed.
+  UpdateStoreBuffer(p, new_obj);
+}
+
+
+uword ParallelScavengerVisitor::AllocateCopy(intptr_t size) {
+  if (size <= kMaxBufferedObjectSize) {
+    uword result = copy_buffer_.TryAllocate(size);
+    if (result != 0) {
+      return result;
+    }
+    uword buffer = scavenger_->TryAllocateShared(kBufferSize);
+    if (buffer != 0) {
+      // Keep the to space iterable by filling the rest of the old buffer.
+      if (copy_buffer_.remaining() > 0) {
+        FreeListElement::AsElement(copy_buffer_.top(),
+                                   copy_buffer_.remaining());
+      }
+      copy_buffer_.Reset(buffer, kBufferSize);
+      return copy_buffer_.TryAllocate(size);
+    }
+  }
+  return scavenger_->TryAllocateShared(size);
+}
+
+
+uword ParallelScavengerVisitor::AllocatePromoted(intptr_t size) {
+  if (size <= kMaxBufferedObjectSize) {
+    uword result = promotion_buffer_.TryAllocate(size);
+    if (result != 0) {
+      return result;
+    }
+    uword buffer = scavenge_->AllocateOld(kBufferSize);
+    if (buffer != 0) {
+      if (promotion_buffer_.remaining() > 0) {
+        scavenge_->FreeOld(promotion_buffer_.top(),
+                           promotion_buffer_.remaining());
+      }
+      promotion_buffer_.Reset(buffer, kBufferSize);
+      return promotion_buffer_.TryAllocate(size);
+    }
+  }
+  return scavenge_->AllocateOld(size);
+}
+
+
+void ParallelScavengerVisitor::UndoAllocation(uword addr,
+                                              intptr_t size,
+                                              bool promoted) {
+  if (promoted) {
+    if (!promotion_buffer_.TryUndoAllocation(addr, size)) {
+      scavenge_->FreeOld(addr, size);
+    }
+  } else {
+    if (!copy_buffer_.TryUndoAllocation(addr, size)) {
+      // Memory allocated directly in the to space cannot be given back.
+      FreeListElement::AsElement(addr, size);
+    }
+  }
+}
+
+
+void ParallelScavengerVisitor::Finish() {
+  if (copy_buffer_.remaining() > 0) {
+    FreeListElement::AsElement(copy_buffer_.top(), copy_buffer_.remaining());
+  }
+  copy_buffer_.Reset(0, 0);
+  if (promotion_buffer_.remaining() > 0) {
+    scavenge_->FreeOld(promotion_buffer_.top(), promotion_buffer_.remaining());
+  }
+  promotion_buffer_.Reset(0, 0);
+}
+
+
+void ParallelScavengerVisitor::PushWork(RawObject* obj) {
+  if (work_->IsFull()) {
+    ShareBlock(work_);
+    work_ = new ScavengerWorkBlock();
+  }
+  work_->Push(obj);
+}
+
+
+RawObject* ParallelScavengerVisitor::PopWork() {
+  if (work_->IsEmpty()) {
+    if (!StealWork()) {
+      return NULL;
+    }
+  } else if ((work_->Count() > 1) &&
+             !HasSharedWork() &&
+             scavenge_->HasIdleTasks()) {
+    // Give half of the private work to the tasks waiting for work.
+    ScavengerWorkBlock* block = new ScavengerWorkBlock();
+    intptr_t count = work_->Count() / 2;
+    for (intptr_t i = 0; i < count; i++) {
+      block->Push(work_->Pop());
+    }
+    ShareBlock(block);
+  }
+  return work_->Pop();
+}
+
+
+void ParallelScavengerVisitor::ShareBlock(ScavengerWorkBlock* block) {
+  MutexLocker ml(&mutex_);
+  block->set_next(shared_blocks_);
+  shared_blocks_ = block;
+  shared_count_++;
+}
+
+
+ScavengerWorkBlock* ParallelScavengerVisitor::TakeSharedBlock() {
+  if (!HasSharedWork()) {
+    return NULL;
+  }
+  MutexLocker ml(&mutex_);
+  ScavengerWorkBlock* block = shared_blocks_;
+  if (block != NULL) {
+    shared_blocks_ = block->next();
+    shared_count_--;
+    block->set_next(NULL);
+  }
+  return block;
+}
+
+
+bool ParallelScavengerVisitor::StealWork() {
+  ASSERT(work_->IsEmpty());
+  // Take back shared work of this task first, then steal from the others.
+  intptr_t num_tasks = scavenge_->num_tasks();
+  for (intptr_t i = 0; i < num_tasks; i++) {
+    ParallelScavengerVisitor* task = scavenge_->task((id_ + i) % num_tasks);
+    ScavengerWorkBlock* block = task->TakeSharedBlock();
+    if (block != NULL) {
+      delete work_;
+      work_ = block;
+      return true;
+    }
+  }
+  return false;
+}
+
+
+void ParallelScavengerVisitor::Run() {
+  StoreBufferBlock* block = scavenge_->NextStoreBufferBlock();
+  while (block != NULL) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      ScavengeRememberedObject(block->At(i), this);
+    }
+    VisitingOldObject(NULL);
+    block = scavenge_->NextStoreBufferBlock();
+  }
+  do {
+    RawObject* raw_obj = PopWork();
+    while (raw_obj != NULL) {
+      // Promoted objects which still refer to new objects after the scavenge
+      // need to be remembered.
+      VisitingOldObject(raw_obj->IsOldObject() ? raw_obj : NULL);
+      raw_obj->VisitPointers(this);
+      raw_obj = PopWork();
+    }
+    VisitingOldObject(NULL);
+  } while (scavenge_->WaitForWork());
+}
+
+
+ParallelScavenge::ParallelScavenge(Scavenger* scavenger,
+                                   Heap* heap,
+                                   Isolate* isolate,
+                                   Monitor* tasks_monitor,
+                                   intptr_t num_tasks)
+    : heap_(heap),
+      isolate_(isolate),
+      tasks_monitor_(tasks_monitor),
+      num_tasks_(num_tasks),
+      tasks_(new ParallelScavengerVisitor*[num_tasks]),
+      running_helpers_(0),
+      idle_tasks_(0),
+      mutex_() {
+  ASSERT(num_tasks > 1);
+  // The first task remembers old objects in the store buffer of the isolate,
+  // the helpers use their own store buffers.
+  tasks_[0] = new ParallelScavengerVisitor(scavenger, this, 0,
+                                           isolate->store_buffer());
+  for (intptr_t i = 1; i < num_tasks; i++) {
+    tasks_[i] = new ParallelScavengerVisitor(scavenger, this, i,
+                                             new StoreBuffer());
+  }
+  // Detach the remembered set, the tasks divide its blocks among themselves.
+  store_buffer_blocks_ = isolate->store_buffer()->TakeBlocks();
+  next_store_buffer_block_ = store_buffer_blocks_;
+}
+
+
+ParallelScavenge::~ParallelScavenge() {
+  ASSERT(running_helpers_ == 0);
+  StoreBuffer* store_buffer = isolate_->store_buffer();
+  for (intptr_t i = 1; i < num_tasks_; i++) {
+    StoreBuffer* helper_store_buffer = tasks_[i]->store_buffer();
+    store_buffer->MergeFrom(helper_store_buffer);
+    delete helper_store_buffer;
+    delete tasks_[i];
+  }
+  delete tasks_[0];
+  delete[] tasks_;
+  StoreBuffer::DeleteBlocks(store_buffer_blocks_);
+}
+
+
+static void ParallelScavengerTask(uword parameter) {
+  ParallelScavengerVisitor* visitor =
+      reinterpret_cast<ParallelScavengerVisitor*>(parameter);
+  visitor->Run();
+  visitor->Finish();
+  visitor->scavenge()->HelperDone();
+}
+
+
+void ParallelScavenge::StartHelpers() {
+  running_helpers_ = num_tasks_ - 1;
+  for (intptr_t i = 1; i < num_tasks_; i++) {
+    new Thread(ParallelScavengerTask, reinterpret_cast<uword>(tasks_[i]));
+  }
+}
+
+
+void ParallelScavenge::WaitForHelpers() {
+  MonitorLocker ml(tasks_monitor_);
+  while (running_helpers_ > 0) {
+    ml.Wait();
+  }
+}
+
+
+void ParallelScavenge::HelperDone() {
+  MonitorLocker ml(tasks_monitor_);
+  running_helpers_--;
+  if (running_helpers_ == 0) {
+    ml.Notify();
+  }
+}
+
+
+StoreBufferBlock* ParallelScavenge::NextStoreBufferBlock() {
+  MutexLocker ml(&mutex_);
+  StoreBufferBlock* block = next_store_buffer_block_;
+  if (block != NULL) {
+    next_store_buffer_block_ = block->next();
+  }
+  return block;
+}
+
+
+uword ParallelScavenge::AllocateOld(intptr_t size) {
+  MutexLocker ml(&mutex_);
+  return heap_->TryAllocate(size, Heap::kOld);
+}
+
+
+void ParallelScavenge::FreeOld(uword addr, intptr_t size) {
+  MutexLocker ml(&mutex_);
+  heap_->FreeUnused(addr, size, Heap::kOld);
+}
+
+
+bool ParallelScavenge::WaitForWork() {
+  AtomicOperations::FetchAndAdd(&idle_tasks_, 1);
+  // Work is only shared by tasks which are not idle. Once all tasks are idle
+  // the scavenge is complete.
+  while (idle_tasks_ < num_tasks_) {
+    for (intptr_t i = 0; i < num_tasks_; i++) {
+      if (tasks_[i]->HasSharedWork()) {
+        AtomicOperations::FetchAndAdd(&idle_tasks_, -1);
+        return true;
+      }
+    }
+    // Let the busy tasks run if there are more tasks than processors.
+    OS::Sleep(0);
+  }
+  return false;
+}
+
+
 Scavenger::Scavenger(Heap* heap, intptr_t max_capacity, uword object_alignment)
     : heap_(heap),
       object_alignment_(object_alignment),
       count_(0),
-      scavenging_(false) {
-  // Allocate the virtual memory for this scavenge heap.
-  space_ = VirtualMemory::Reserve(max_capacity);
+      total_time_(0),
+      last_time_(0),
+      promoted_bytes_(0),
+      scavenging_(false),
+      had_promotion_failure_(false),
+      tasks_monitor_(new Monitor()) {
+  tenuring_threshold_ = MaxTenuringThreshold();
+  // Reserve the virtual memory for this scavenge heap. With huge pages both
+  // semi-spaces start at a huge page boundary.
+  use_huge_pages_ = FLAG_use_huge_pages && VirtualMemory::SupportsHugePages();
+  if (use_huge_pages_) {
+    space_ = VirtualMemory::ReserveAligned(
+        Utils::RoundUp(max_capacity, 2 * VirtualMemory::kHugePageSize),
+        VirtualMemory::kHugePageSize);
+  } else {
+    space_ = VirtualMemory::Reserve(max_capacity);
+  }
   ASSERT(space_ != NULL);
 
-  // Allocate the entire space at the beginning.
-  space_->Commit(false);
-
-  // Setup the semi spaces.
-  uword semi_space_size = space_->size() / 2;
-  ASSERT((semi_space_size & (VirtualMemory::PageSize() - 1)) == 0);
+  // Setup the semi spaces, only their initial size is committed.
+  max_semi_space_size_ = space_->size() / 2;
+  ASSERT((max_semi_space_size_ & (VirtualMemory::PageSize() - 1)) == 0);
+  intptr_t semi_space_size =
+      Utils::Minimum(kInitialSemiSpaceSize, max_semi_space_size_);
+  uword middle = space_->start() + max_semi_space_size_;
+  CommitSemiSpace(space_->start(), semi_space_size);
+  CommitSemiSpace(middle, semi_space_size);
   to_ = new MemoryRegion(space_->address(), semi_space_size);
-  uword middle = space_->start() + semi_space_size;
   from_ = new MemoryRegion(reinterpret_cast<void*>(middle), semi_space_size);
 
   // Make sure that the two semi-spaces are aligned properly.
@@ -184,8 +884,9 @@ Scavenger::Scavenger(Heap* heap, intptr_t max_capacity, uword object_alignment)
   // Setup local fields.
   top_ = FirstObjectStart();
   end_ = to_->end();
-
-  survivor_end_ = FirstObjectStart();
+  survivors_end_ = top_;
+  allocation_limit_ = 0;
+  last_scavenge_end_ = OS::GetCurrentTimeMicros();
 
 #if defined(DEBUG)
   memset(to_->pointer(), 0xf3, to_->size());
@@ -198,6 +899,103 @@ Scavenger::~Scavenger() {
   delete to_;
   delete from_;
   delete space_;
+  delete tasks_monitor_;
+}
+
+
+intptr_t Scavenger::MaxTenuringThreshold() {
+  if (FLAG_tenuring_threshold < 1) {
+    return 1;
+  }
+  return Utils::Minimum(FLAG_tenuring_threshold,
+                        static_cast<int>(RawObject::kMaxAge + 1));
+}
+
+
+void Scavenger::UpdateTenuringThreshold() {
+  intptr_t max_threshold = MaxTenuringThreshold();
+  if (!FLAG_adaptive_tenuring || (max_threshold <= 2)) {
+    // After a scavenge all new objects have survived at least once, a lower
+    // threshold than 2 cannot be derived from their ages.
+    tenuring_threshold_ = max_threshold;
+    return;
+  }
+  // Bytes of the survivors of this scavenge by age.
+  intptr_t survivor_bytes[RawObject::kMaxAge + 1];
+  for (intptr_t age = 0; age <= RawObject::kMaxAge; age++) {
+    survivor_bytes[age] = 0;
+  }
+  uword cur = FirstObjectStart();
+  while (cur < top_) {
+    RawObject* raw_obj = RawObject::FromAddr(cur);
+    intptr_t size = raw_obj->Size();
+    // Skip the unused ends of the buffers of a parallel scavenge.
+    if (!raw_obj->IsFreeListElement()) {
+      survivor_bytes[raw_obj->Age()] += size;
+    }
+    cur += size;
+  }
+  // Promote the older survivors at the next scavenge if the survivors up to
+  // their age exceed the target, as objects which survived several scavenges
+  // are likely to survive more.
+  intptr_t target = (to_->size() / 100) * kTargetSurvivorPercent;
+  intptr_t total = 0;
+  tenuring_threshold_ = max_threshold;
+  for (intptr_t age = 1; age < (max_threshold - 1); age++) {
+    total += survivor_bytes[age];
+    if (total > target) {
+      tenuring_threshold_ = age + 1;
+      break;
+    }
+  }
+}
+
+
+void Scavenger::UpdatePretenuring(uword from_top) {
+  ClassSurvivalTable table;
+  uword cur = from_->start() | object_alignment_;
+  while (cur < from_top) {
+    RawObject* raw_obj = RawObject::FromAddr(cur);
+    uword header = *reinterpret_cast<uword*>(cur);
+    RawObject* current_obj = raw_obj;
+    bool survived = IsForwarding(header);
+    if (survived) {
+      current_obj = RawObject::FromAddr(ForwardedAddr(header));
+    }
+    // The tags of forwarded objects are still intact. Objects which survived
+    // a previous scavenge were not allocated since then.
+    if (!raw_obj->IsFreeListElement() && (raw_obj->Age() == 0)) {
+      table.Add(current_obj->ptr()->class_, survived);
+    }
+    cur += current_obj->Size();
+  }
+  Heap* vm_heap = Dart::vm_isolate()->heap();
+  intptr_t pretenured = 0;
+  intptr_t reverted = 0;
+  for (intptr_t i = 0; i < table.capacity(); i++) {
+    const ClassSurvivalTable::Entry& entry = table.At(i);
+    // The classes of the VM isolate are shared by all isolates.
+    if ((entry.raw_class == NULL) ||
+        (entry.allocated < kMinPretenuringSamples) ||
+        vm_heap->Contains(RawObject::ToAddr(entry.raw_class))) {
+      continue;
+    }
+    intptr_t survival_percent = (entry.survived * 100) / entry.allocated;
+    RawClass* raw_class = entry.raw_class;
+    if (!raw_class->ptr()->is_pretenured_ &&
+        (survival_percent >= kPretenureSurvivalPercent)) {
+      raw_class->ptr()->is_pretenured_ = true;
+      pretenured++;
+    } else if (raw_class->ptr()->is_pretenured_ &&
+               (survival_percent < kDepretenureSurvivalPercent)) {
+      raw_class->ptr()->is_pretenured_ = false;
+      reverted++;
+    }
+  }
+  if (FLAG_verbose_gc && ((pretenured > 0) || (reverted > 0))) {
+    OS::PrintErr("Pretenuring[%d]: %d classes pretenured, %d reverted\n",
+                 count_, pretenured, reverted);
+  }
 }
 
 
@@ -209,13 +1007,77 @@ void Scavenger::Prologue() {
   to_ = temp;
   top_ = FirstObjectStart();
   end_ = to_->end();
+  // The flag might have been lowered since the last scavenge.
+  tenuring_threshold_ =
+      Utils::Minimum(tenuring_threshold_, MaxTenuringThreshold());
+}
+
+
+void Scavenger::AdjustCapacity(int64_t mutator_time) {
+  intptr_t size = to_->size();
+  intptr_t survived = in_use();
+  intptr_t new_size = size;
+  if ((size < max_semi_space_size_) &&
+      ((mutator_time < kGrowIntervalMicros) ||
+       (survived > (size / 100) * kGrowSurvivorPercent))) {
+    new_size = Utils::Minimum(2 * size, max_semi_space_size_);
+  } else if ((size > kInitialSemiSpaceSize) &&
+             (mutator_time > kShrinkIntervalMicros) &&
+             (survived < (size / 100) * kShrinkSurvivorPercent)) {
+    new_size = size / 2;
+  }
+  if (new_size != size) {
+    ResizeSemiSpaces(new_size);
+  }
+}
+
+
+void Scavenger::ResizeSemiSpaces(intptr_t new_size) {
+  ASSERT(in_use() <= new_size);
+  intptr_t size = to_->size();
+  ASSERT(from_->size() == size);
+  uword to_start = to_->start();
+  uword from_start = from_->start();
+  if (new_size > size) {
+    intptr_t delta = new_size - size;
+    if (!CommitSemiSpace(to_start + size, delta) ||
+        !CommitSemiSpace(from_start + size, delta)) {
+      FATAL("Out of memory while growing new space.");
+    }
+#if defined(DEBUG)
+    memset(reinterpret_cast<void*>(to_start + size), 0xf3, delta);
+#endif  // defined(DEBUG)
+  } else {
+    intptr_t delta = size - new_size;
+    space_->Decommit(to_start + new_size, delta);
+    space_->Decommit(from_start + new_size, delta);
+  }
+  delete to_;
+  delete from_;
+  to_ = new MemoryRegion(reinterpret_cast<void*>(to_start), new_size);
+  from_ = new MemoryRegion(reinterpret_cast<void*>(from_start), new_size);
+  end_ = to_->end();
+}
+
+
+bool Scavenger::CommitSemiSpace(uword addr, intptr_t size) {
+  if (!space_->Commit(addr, size, false)) {
+    return false;
+  }
+  if (use_huge_pages_) {
+    // The advice is merged with the one of the adjacent committed memory, a
+    // semi-space is backed by huge pages once it spans whole huge pages.
+    space_->AdviseHugePages(addr, size);
+  }
+  return true;
 }
 
 
-void Scavenger::Epilogue() {
+void Scavenger::Epilogue(int64_t mutator_time) {
   // All objects in the to space have been copied from the from space at this
   // moment.
-  survivor_end_ = top_;
+  UpdateTenuringThreshold();
+  AdjustCapacity(mutator_time);
 
 #if defined(DEBUG)
   memset(from_->pointer(), 0xf3, from_->size());
@@ -223,10 +1085,28 @@ void Scavenger::Epilogue() {
 }
 
 
-void Scavenger::IterateRoots(Isolate* isolate, ObjectPointerVisitor* visitor) {
+void Scavenger::IterateStoreBuffers(Isolate* isolate,
+                                    ScavengerVisitor* visitor) {
+  // Detach the remembered set before visiting it. Objects which still refer to
+  // new space after this scavenge are added back to a fresh store buffer by
+  // the visitor.
+  StoreBufferBlock* blocks = isolate->store_buffer()->TakeBlocks();
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      ScavengeRememberedObject(block->At(i), visitor);
+    }
+  }
+  visitor->VisitingOldObject(NULL);
+  StoreBuffer::DeleteBlocks(blocks);
+}
+
+
+void Scavenger::IterateRoots(Isolate* isolate, ScavengerVisitor* visitor) {
   isolate->VisitStrongObjectPointers(visitor,
                                      StackFrameIterator::kDontValidateFrames);
-  heap_->IterateOldPointers(visitor);
+  IterateStoreBuffers(isolate, visitor);
 }
 
 
@@ -236,7 +1116,7 @@ void Scavenger::IterateWeakRoots(Isolate* isolate,
 }
 
 
-void Scavenger::ProcessToSpace(ObjectPointerVisitor* visitor) {
+void Scavenger::ProcessToSpace(ScavengerVisitor* visitor) {
   uword resolved_top = FirstObjectStart();
   // Iterate until all work has been drained.
   while ((resolved_top < top_) || PromotedStackHasMore()) {
@@ -249,12 +1129,45 @@ void Scavenger::ProcessToSpace(ObjectPointerVisitor* visitor) {
       // Resolve or copy all objects referred to by the current object. This
       // can potentially push more objects on this stack as well as add more
       // objects to be resolved in the to space.
+      visitor->VisitingOldObject(raw_object);
       raw_object->VisitPointers(visitor);
+      visitor->VisitingOldObject(NULL);
     }
   }
 }
 
 
+void Scavenger::ScavengeInParallel(Isolate* isolate, intptr_t num_tasks) {
+  ParallelScavenge scavenge(this, heap_, isolate, tasks_monitor_, num_tasks);
+  scavenge.StartHelpers();
+  // The helpers start with the remembered set while this thread scavenges the
+  // roots of the isolate.
+  ParallelScavengerVisitor* visitor = scavenge.task(0);
+  isolate->VisitStrongObjectPointers(visitor,
+                                     StackFrameIterator::kDontValidateFrames);
+  visitor->Run();
+  visitor->Finish();
+  scavenge.WaitForHelpers();
+}
+
+
+uword Scavenger::TryAllocateShared(intptr_t size) {
+  ASSERT(Utils::IsAligned(size, kObjectAlignment));
+  uword result;
+  do {
+    result = top_;
+    intptr_t remaining = end_ - result;
+    if (remaining < size) {
+      return 0;
+    }
+  } while (AtomicOperations::CompareAndSwapWord(&top_, result, result + size)
+           != result);
+  ASSERT(to_->Contains(result));
+  ASSERT((result & kObjectAlignmentMask) == object_alignment_);
+  return result;
+}
+
+
 void Scavenger::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
   uword cur = FirstObjectStart();
   while (cur < top_) {
@@ -264,6 +1177,23 @@ void Scavenger::VisitObjectPointers(ObjectPointerVisitor* visitor) const {
 }
 
 
+void Scavenger::SetAllocationLimit(intptr_t distance) {
+  ASSERT(distance > 0);
+  allocation_limit_ = top_ + distance;
+  end_ = Utils::Minimum(allocation_limit_, to_->end());
+}
+
+
+void Scavenger::VisitObjects(ObjectVisitor* visitor) const {
+  uword cur = FirstObjectStart();
+  while (cur < top_) {
+    RawObject* raw_obj = RawObject::FromAddr(cur);
+    visitor->VisitObject(raw_obj);
+    cur += raw_obj->Size();
+  }
+}
+
+
 void Scavenger::Scavenge() {
   // Scavenging is not reentrant. Make sure that is the case.
   ASSERT(!scavenging_);
@@ -277,19 +1207,44 @@ void Scavenger::Scavenge() {
     OS::PrintErr(" done.\n");
   }
 
-  Timer timer(FLAG_verbose_gc, "Scavenge");
+  int64_t mutator_time = OS::GetCurrentTimeMicros() - last_scavenge_end_;
+  // Always timed for the heap statistics.
+  Timer timer(true, "Scavenge");
   timer.Start();
-  // Setup the visitor and run a scavenge.
-  ScavengerVisitor visitor(this);
+  // Old space only grows by promotion during a scavenge.
+  intptr_t old_in_use = heap_->Used(Heap::kOld);
+  // The objects allocated since the last scavenge end here in the from space.
+  uword from_top = top_;
+  intptr_t limit_distance =
+      (allocation_limit_ != 0) ? (allocation_limit_ - top_) : 0;
   Prologue();
-  IterateRoots(isolate, &visitor);
-  ProcessToSpace(&visitor);
+  if (FLAG_scavenger_tasks > 1) {
+    ScavengeInParallel(isolate, FLAG_scavenger_tasks);
+  } else {
+    // Setup the visitor and run a scavenge.
+    ScavengerVisitor visitor(isolate, this);
+    IterateRoots(isolate, &visitor);
+    ProcessToSpace(&visitor);
+  }
   ScavengerWeakVisitor weak_visitor(this);
   IterateWeakRoots(isolate, &weak_visitor);
-  Epilogue();
+  if (FLAG_pretenuring) {
+    UpdatePretenuring(from_top);
+  }
+  Epilogue(mutator_time);
+  survivors_end_ = top_;
+  if (limit_distance > 0) {
+    SetAllocationLimit(limit_distance);
+  }
   timer.Stop();
+  last_time_ = timer.TotalElapsedTime();
+  total_time_ += last_time_;
+  promoted_bytes_ += heap_->Used(Heap::kOld) - old_in_use;
   if (FLAG_verbose_gc) {
-    OS::PrintErr("Scavenge[%d]: %dus\n", count_, timer.TotalElapsedTime());
+    OS::PrintErr("Scavenge[%d]: %lldus (tenuring threshold %d, "
+                 "%dK semi-space)\n",
+                 count_, last_time_, tenuring_threshold_,
+                 (capacity() / KB));
   }
 
   if (FLAG_verify_after_gc) {
@@ -299,6 +1254,7 @@ void Scavenger::Scavenge() {
   }
 
   count_++;
+  last_scavenge_end_ = OS::GetCurrentTimeMicros();
   // Done scavenging. Reset the marker.
   ASSERT(scavenging_);
   scavenging_ = false;
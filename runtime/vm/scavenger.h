@@ -18,8 +18,15 @@ namespace dart {
 // Forward declarations.
 class Heap;
 class Isolate;
+class Monitor;
+class ParallelScavengerVisitor;
+class ScavengerVisitor;
 
 DECLARE_FLAG(bool, gc_at_alloc);
+DECLARE_FLAG(int, scavenger_tasks);
+DECLARE_FLAG(int, tenuring_threshold);
+DECLARE_FLAG(bool, adaptive_tenuring);
+DECLARE_FLAG(bool, pretenuring);
 
 class Scavenger {
  public:
@@ -61,6 +68,15 @@ class Scavenger {
   // Collect the garbage in this scavenger.
   void Scavenge();
 
+  // Lower the end of the allocation area to 'distance' bytes above the
+  // current top. The allocation crossing it fails in TryAllocate and in
+  // generated code, and goes through Heap::AllocateNew where it is sampled.
+  // The remaining distance is carried over scavenges.
+  void SetAllocationLimit(intptr_t distance);
+  bool AllocationLimitReached(intptr_t size) const {
+    return (allocation_limit_ != 0) && ((top_ + size) > allocation_limit_);
+  }
+
   // Accessors to generate code for inlined allocation.
   uword* TopAddress() { return &top_; }
   uword* EndAddress() { return &end_; }
@@ -68,16 +84,76 @@ class Scavenger {
   static intptr_t end_offset() { return OFFSET_OF(Scavenger, end_); }
 
   intptr_t in_use() const { return (top_ - FirstObjectStart()); }
+  // Bytes allocated since the last scavenge.
+  intptr_t allocated_since_scavenge() const { return top_ - survivors_end_; }
+  // Size of the committed part of a semi-space.
+  intptr_t capacity() const { return to_->size(); }
 
   void VisitObjectPointers(ObjectPointerVisitor* visitor) const;
+  void VisitObjects(ObjectVisitor* visitor) const;
+
+  // New objects are promoted by the scavenge they survive for the
+  // tenuring_threshold-th time.
+  intptr_t tenuring_threshold() const { return tenuring_threshold_; }
+
+  // Statistics of the scavenges so far, times are in microseconds.
+  int collections() const { return count_; }
+  int64_t total_time() const { return total_time_; }
+  int64_t last_time() const { return last_time_; }
+  int64_t promoted_bytes() const { return promoted_bytes_; }
 
  private:
+  // Survivors are promoted earlier while they fill more than this percentage
+  // of the to space after a scavenge.
+  static const intptr_t kTargetSurvivorPercent = 50;
+
+  // The semi-spaces start small and are only committed up to their current
+  // size. They double while the mutator allocates quickly or while many
+  // objects survive, and halve while the isolate is mostly idle.
+  static const intptr_t kInitialSemiSpaceSize = 512 * KB;
+  static const int64_t kGrowIntervalMicros = 100 * 1000;
+  static const int64_t kShrinkIntervalMicros = 1000 * 1000;
+  static const intptr_t kGrowSurvivorPercent = 25;
+  static const intptr_t kShrinkSurvivorPercent = 10;
+
+  // A class is pretenured once this percentage of its instances allocated
+  // since the previous scavenge survive, and reverted to allocating in new
+  // space when fewer than kDepretenureSurvivalPercent do. Classes with fewer
+  // sampled instances keep their state.
+  static const intptr_t kMinPretenuringSamples = 100;
+  static const intptr_t kPretenureSurvivalPercent = 90;
+  static const intptr_t kDepretenureSurvivalPercent = 50;
+
   uword FirstObjectStart() const { return to_->start() | object_alignment_; }
+
+  // Whether a surviving new object is copied to old space, based on its age
+  // before this scavenge.
+  bool ShouldPromote(RawObject* raw_obj) const {
+    return (raw_obj->Age() + 1) >= tenuring_threshold_;
+  }
+  static intptr_t MaxTenuringThreshold();
+  void UpdateTenuringThreshold();
+  // Update the pretenuring decisions from the survival of the objects
+  // allocated since the previous scavenge, which are in the from space below
+  // 'from_top'.
+  void UpdatePretenuring(uword from_top);
+
   void Prologue();
-  void IterateRoots(Isolate* isolate, ObjectPointerVisitor* visitor);
+  void IterateStoreBuffers(Isolate* isolate, ScavengerVisitor* visitor);
+  void IterateRoots(Isolate* isolate, ScavengerVisitor* visitor);
   void IterateWeakRoots(Isolate* isolate, ObjectPointerVisitor* visitor);
-  void ProcessToSpace(ObjectPointerVisitor* visitor);
-  void Epilogue();
+  void ProcessToSpace(ScavengerVisitor* visitor);
+  void ScavengeInParallel(Isolate* isolate, intptr_t num_tasks);
+  void Epilogue(int64_t mutator_time);
+  void AdjustCapacity(int64_t mutator_time);
+  void ResizeSemiSpaces(intptr_t new_size);
+  // Commit a part of a semi-space, advising the OS to back it with huge
+  // pages if they are used.
+  bool CommitSemiSpace(uword addr, intptr_t size);
+
+  // Allocate in the to space while several scavenger tasks are copying
+  // objects concurrently.
+  uword TryAllocateShared(intptr_t size);
 
   // During a scavenge we need to remember the promoted objects.
   // This is implemented as a stack of objects at the end of the to space. As
@@ -98,7 +174,12 @@ class Scavenger {
     return end_ < to_->end();
   }
 
+  // The reservation for both semi-spaces at their maximum size, the first
+  // half holds one semi-space and the second half the other.
   VirtualMemory* space_;
+  intptr_t max_semi_space_size_;
+  // Whether the semi-spaces are aligned to huge pages and backed by them.
+  bool use_huge_pages_;
   MemoryRegion* to_;
   MemoryRegion* from_;
 
@@ -108,20 +189,39 @@ class Scavenger {
   // from generated code.
   uword top_;
   uword end_;
+  // End of the objects which survived the last scavenge.
+  uword survivors_end_;
+  // Sampling limit, see SetAllocationLimit. It may be beyond the end of the
+  // to space, in which case end_ is not lowered.
+  uword allocation_limit_;
 
-  // Objects below this address have survived a scavenge.
-  uword survivor_end_;
+  // Current tenuring threshold, at most --tenuring_threshold.
+  intptr_t tenuring_threshold_;
 
   // All object are aligned to this value.
   uword object_alignment_;
 
+  // Time at which the last scavenge ended, to compute the time spent by the
+  // mutator between scavenges.
+  int64_t last_scavenge_end_;
+
   // Scavenge cycle count.
   int count_;
+  // Pause times of all scavenges and of the last one, and bytes promoted by
+  // all scavenges.
+  int64_t total_time_;
+  int64_t last_time_;
+  int64_t promoted_bytes_;
   // Keep track whether a scavenge is currently running.
   bool scavenging_;
   // Keep track whether the scavenge had a promotion failure.
   bool had_promotion_failure_;
 
+  // Used to wait for the helper threads of a parallel scavenge. It outlives
+  // the individual scavenges so that exiting helpers can still release it.
+  Monitor* tasks_monitor_;
+
+  friend class ParallelScavengerVisitor;
   friend class ScavengerVisitor;
   friend class ScavengerWeakVisitor;
 
@@ -5,12 +5,147 @@
 #include "vm/store_buffer.h"
 
 #include "vm/assert.h"
+#include "vm/heap.h"
+#include "vm/isolate.h"
+#include "vm/pages.h"
+#include "vm/raw_object.h"
+#include "vm/visitor.h"
 
 namespace dart {
 
-void StoreBufferBlock::ProcessBuffer() {
-  // TODO(iposva): Do the right thing for store buffer overflow.
-  top_ = 0;  // Currently just reset back to the beginning.
+void StoreBufferBlock::VisitObjectPointers(ObjectPointerVisitor* visitor) {
+  if (top_ > 0) {
+    visitor->VisitPointers(&pointers_[0], &pointers_[top_ - 1]);
+  }
+}
+
+
+StoreBuffer::StoreBuffer()
+    : blocks_(new StoreBufferBlock()),
+      full_blocks_(0) {
+}
+
+
+StoreBuffer::~StoreBuffer() {
+  DeleteBlocks(blocks_);
+}
+
+
+void StoreBuffer::Push(RawObject* obj) {
+  blocks_->Add(obj);
+  if (blocks_->IsFull()) {
+    StoreBufferBlock* block = new StoreBufferBlock();
+    block->set_next(blocks_);
+    blocks_ = block;
+    full_blocks_++;
+  }
+}
+
+
+void StoreBuffer::AddObject(RawObject* obj) {
+  ASSERT(obj->IsOldObject());
+  obj->SetRememberedBit();
+  Push(obj);
+}
+
+
+void StoreBuffer::AddSlot(RawObject* obj, RawObject** slot) {
+  HeapPage* page = PageSpace::PageFor(obj);
+  if (page->has_card_table()) {
+    page->RememberCard(slot);
+  }
+  if (!obj->IsRemembered()) {
+    AddObject(obj);
+  }
+}
+
+
+void StoreBuffer::UpdateFromGeneratedCode(RawObject* obj, RawObject** slot) {
+  StoreBuffer* store_buffer = Isolate::Current()->store_buffer();
+  if (slot != NULL) {
+    RawObject* value = *slot;
+    if (value->IsNewObject()) {
+      store_buffer->AddSlot(obj, slot);
+    } else if (!PageSpace::IsMarked(value)) {
+      // Old objects are only filtered in while the old generation is being
+      // marked incrementally.
+      Isolate::Current()->heap()->MarkingBarrier(value);
+    }
+    return;
+  }
+  // The elements of an array allocated in old space were initialized. Arrays
+  // allocated during incremental marking are greyed as a whole, see
+  // PageSpace::GreyAllocatedObjects.
+  HeapPage* page = PageSpace::PageFor(obj);
+  if (page->has_card_table()) {
+    page->RememberAllCards();
+  }
+  if (!obj->IsRemembered()) {
+    store_buffer->AddObject(obj);
+  }
+}
+
+
+intptr_t StoreBuffer::Length() const {
+  return (full_blocks_ * StoreBufferBlock::kSize) + blocks_->Count();
+}
+
+
+StoreBufferBlock* StoreBuffer::TakeBlocks() {
+  StoreBufferBlock* result = blocks_;
+  blocks_ = new StoreBufferBlock();
+  full_blocks_ = 0;
+  return result;
+}
+
+
+void StoreBuffer::DeleteBlocks(StoreBufferBlock* blocks) {
+  while (blocks != NULL) {
+    StoreBufferBlock* next = blocks->next();
+    delete blocks;
+    blocks = next;
+  }
+}
+
+
+void StoreBuffer::MergeFrom(StoreBuffer* other) {
+  StoreBufferBlock* blocks = other->TakeBlocks();
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      // The objects keep their remembered bit.
+      Push(block->At(i));
+    }
+  }
+  DeleteBlocks(blocks);
+}
+
+
+void StoreBuffer::RemoveUnmarkedObjects() {
+  StoreBufferBlock* blocks = TakeBlocks();
+  for (StoreBufferBlock* block = blocks;
+       block != NULL;
+       block = block->next()) {
+    for (intptr_t i = 0; i < block->Count(); i++) {
+      RawObject* raw_obj = block->At(i);
+      // Unmarked objects are about to be swept, there is no need to clear
+      // their remembered bit.
+      if (PageSpace::IsMarked(raw_obj)) {
+        Push(raw_obj);
+      }
+    }
+  }
+  DeleteBlocks(blocks);
+}
+
+
+void StoreBuffer::VisitObjectPointers(ObjectPointerVisitor* visitor) {
+  for (StoreBufferBlock* block = blocks_;
+       block != NULL;
+       block = block->next()) {
+    block->VisitObjectPointers(visitor);
+  }
 }
 
 }  // namespace dart
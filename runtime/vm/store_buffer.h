@@ -6,37 +6,99 @@
 #define VM_STORE_BUFFER_H_
 
 #include "vm/assert.h"
+#include "vm/globals.h"
 
 namespace dart {
 
+// Forward declarations.
+class ObjectPointerVisitor;
+class RawObject;
+
+// A block of remembered old objects. Blocks are chained together by the
+// StoreBuffer once they fill up.
 class StoreBufferBlock {
  public:
   // Each block contains kSize pointers.
   static const int32_t kSize = 1024;
 
-  StoreBufferBlock() : top_(0) {}
+  StoreBufferBlock() : next_(NULL), top_(0) {}
+
+  StoreBufferBlock* next() const { return next_; }
+  void set_next(StoreBufferBlock* next) { next_ = next; }
+
+  intptr_t Count() const { return top_; }
+  bool IsFull() const { return top_ == kSize; }
 
-  static int top_offset() { return OFFSET_OF(StoreBufferBlock, top_); }
-  static int pointers_offset() {
-    return OFFSET_OF(StoreBufferBlock, pointers_);
+  RawObject* At(intptr_t i) const {
+    ASSERT((i >= 0) && (i < top_));
+    return pointers_[i];
   }
 
-  // Add a pointer to the block of pointers. The buffer will be processed if it
-  // has been filled by this operation.
-  void AddPointer(uword pointer) {
+  void Add(RawObject* obj) {
     ASSERT(top_ < kSize);
-    pointers_[top_++] = pointer;
-    if (top_ == kSize) {
-      ProcessBuffer();
-    }
+    pointers_[top_++] = obj;
   }
 
-  // Process this store buffer and remember its contents in the heap.
-  void ProcessBuffer();
+  void Reset() { top_ = 0; }
+
+  void VisitObjectPointers(ObjectPointerVisitor* visitor);
 
  private:
+  StoreBufferBlock* next_;
   int32_t top_;
-  uword pointers_[kSize];
+  RawObject* pointers_[kSize];
+
+  DISALLOW_COPY_AND_ASSIGN(StoreBufferBlock);
+};
+
+
+// The store buffer is the remembered set of the generational collector. It
+// records the old objects which may contain pointers into new space. Every
+// old object is recorded at most once, the remembered bit in the object header
+// is used to filter duplicates.
+class StoreBuffer {
+ public:
+  StoreBuffer();
+  ~StoreBuffer();
+
+  // Remember an old object which has been updated to point to a new object.
+  void AddObject(RawObject* obj);
+
+  // Remember that 'slot' of the old object 'obj' has been updated to point to
+  // a new object. Large arrays additionally record the card of the slot.
+  void AddSlot(RawObject* obj, RawObject** slot);
+
+  // Entry used by the write barrier in generated code. A NULL 'slot' marks
+  // every card of a large array as updated.
+  static void UpdateFromGeneratedCode(RawObject* obj, RawObject** slot);
+
+  // Number of objects currently remembered.
+  intptr_t Length() const;
+
+  // Detach the list of recorded blocks and start over with an empty buffer.
+  // The caller is responsible for releasing the returned blocks using
+  // DeleteBlocks.
+  StoreBufferBlock* TakeBlocks();
+  static void DeleteBlocks(StoreBufferBlock* blocks);
+
+  // Move the objects remembered by 'other' into this store buffer.
+  void MergeFrom(StoreBuffer* other);
+
+  // Drop all remembered objects which were not marked by the last marking
+  // phase. Must be called after marking and before sweeping.
+  void RemoveUnmarkedObjects();
+
+  // Visit the remembered objects, e.g. to update them after they were moved.
+  void VisitObjectPointers(ObjectPointerVisitor* visitor);
+
+ private:
+  void Push(RawObject* obj);
+
+  // The block currently being filled. Full blocks are chained behind it.
+  StoreBufferBlock* blocks_;
+  intptr_t full_blocks_;
+
+  DISALLOW_COPY_AND_ASSIGN(StoreBuffer);
 };
 
 }  // namespace dart
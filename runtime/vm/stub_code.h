@@ -23,6 +23,7 @@ class RawCode;
   V(DartCallToRuntime)                                                         \
   V(StubCallToRuntime)                                                         \
   V(PrintStopMessage)                                                          \
+  V(UpdateStoreBuffer)                                                         \
   V(CallNativeCFunction)                                                       \
   V(AllocateArray)                                                             \
   V(CallNoSuchMethodFunction)                                                  \
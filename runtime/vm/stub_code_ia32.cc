@@ -12,6 +12,7 @@
 #include "vm/pages.h"
 #include "vm/resolver.h"
 #include "vm/scavenger.h"
+#include "vm/store_buffer.h"
 #include "vm/stub_code.h"
 
 
@@ -22,6 +23,7 @@ namespace dart {
 DEFINE_FLAG(bool, inline_alloc, true, "Inline allocation of objects.");
 DEFINE_FLAG(bool, use_slow_path, false,
     "Set to true for debugging & verifying the slow paths.");
+DECLARE_FLAG(bool, pretenuring);
 
 // Input parameters:
 //   ESP : points to return address.
@@ -151,6 +153,46 @@ void StubCode::GeneratePrintStopMessageStub(Assembler* assembler) {
   __ ret();
 }
 
+// Input parameters:
+//   ESP : points to return address.
+//   ESP + 4 : address of the updated slot, or NULL if unknown.
+//   EAX : old object which has been updated to point to a new object.
+// Must preserve all registers.
+void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
+  // Preserve caller-saved registers.
+  __ pushl(EAX);
+  __ pushl(ECX);
+  __ pushl(EDX);
+
+  __ EnterFrame(0);
+
+  // Reserve space for the native arguments and align frame before entering
+  // the C++ world.
+  __ AddImmediate(ESP, Immediate(-2 * kWordSize));
+  if (OS::ActivationFrameAlignment() > 0) {
+    __ andl(ESP, Immediate(~(OS::ActivationFrameAlignment() - 1)));
+  }
+
+  // Pass the object and the slot, and call the runtime.
+  __ movl(Address(ESP, 0), EAX);
+  __ movl(ECX, Address(EBP, 5 * kWordSize));
+  __ movl(Address(ESP, kWordSize), ECX);
+  const uword entry =
+      reinterpret_cast<uword>(&StoreBuffer::UpdateFromGeneratedCode);
+  __ movl(EAX, Immediate(entry));
+  __ call(EAX);
+
+  __ LeaveFrame();
+
+  // Restore caller-saved registers.
+  __ popl(EDX);
+  __ popl(ECX);
+  __ popl(EAX);
+
+  __ ret();
+}
+
+
 
 // Input parameters:
 //   ESP : points to return address.
@@ -424,6 +466,16 @@ static void PushArgumentsArray(Assembler* assembler, intptr_t arg_offset) {
   __ Bind(&loop_condition);
   __ decl(EDX);
   __ j(POSITIVE, &loop, Assembler::kNearJump);
+  // The array may have been allocated in old space, in which case it has to be
+  // remembered as the stored elements may be new objects.
+  Label array_is_new;
+  __ movl(EAX, Address(ESP, 0));
+  __ testl(EAX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &array_is_new, Assembler::kNearJump);
+  __ pushl(Immediate(0));  // All elements have been updated.
+  __ call(&StubCode::UpdateStoreBufferLabel());
+  __ AddImmediate(ESP, Immediate(kWordSize));
+  __ Bind(&array_is_new);
 }
 
 
@@ -1143,6 +1195,13 @@ void StubCode::GenerateAllocationStubForClass(Assembler* assembler,
       PageSpace::IsPageAllocatableSize(instance_size + type_args_size)) {
     Label slow_case;
     Heap* heap = Isolate::Current()->heap();
+    if (FLAG_pretenuring) {
+      // Pretenured classes are allocated in old space by the runtime.
+      __ LoadObject(EAX, cls);
+      __ movzxb(EAX, FieldAddress(EAX, Class::is_pretenured_offset()));
+      __ testl(EAX, EAX);
+      __ j(NOT_ZERO, &slow_case);
+    }
     __ movl(EAX, Address::Absolute(heap->TopAddress()));
     __ leal(EBX, Address(EAX, instance_size));
     if (is_cls_parameterized) {
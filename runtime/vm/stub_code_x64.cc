@@ -12,6 +12,7 @@
 #include "vm/pages.h"
 #include "vm/resolver.h"
 #include "vm/scavenger.h"
+#include "vm/store_buffer.h"
 #include "vm/stub_code.h"
 
 
@@ -22,6 +23,7 @@ namespace dart {
 DEFINE_FLAG(bool, inline_alloc, true, "Inline allocation of objects.");
 DEFINE_FLAG(bool, use_slow_path, false,
     "Set to true for debugging & verifying the slow paths.");
+DECLARE_FLAG(bool, pretenuring);
 
 // Input parameters:
 //   RSP : points to return address.
@@ -158,6 +160,53 @@ void StubCode::GeneratePrintStopMessageStub(Assembler* assembler) {
   __ ret();
 }
 
+// Input parameters:
+//   RSP : points to return address.
+//   RSP + 8 : address of the updated slot, or NULL if unknown.
+//   RAX : old object which has been updated to point to a new object.
+// Must preserve all registers, except TMP.
+void StubCode::GenerateUpdateStoreBufferStub(Assembler* assembler) {
+  // Preserve caller-saved registers.
+  __ pushq(RAX);
+  __ pushq(RCX);
+  __ pushq(RDX);
+  __ pushq(RSI);
+  __ pushq(RDI);
+  __ pushq(R8);
+  __ pushq(R9);
+  __ pushq(R10);
+
+  __ EnterFrame(0);
+
+  // Align frame before entering C++ world.
+  if (OS::ActivationFrameAlignment() > 0) {
+    __ andq(RSP, Immediate(~(OS::ActivationFrameAlignment() - 1)));
+  }
+
+  // Pass the object and the slot, and call the runtime.
+  __ movq(RDI, RAX);
+  __ movq(RSI, Address(RBP, 10 * kWordSize));
+  const uword entry =
+      reinterpret_cast<uword>(&StoreBuffer::UpdateFromGeneratedCode);
+  __ movq(TMP, Immediate(entry));
+  __ call(TMP);
+
+  __ LeaveFrame();
+
+  // Restore caller-saved registers.
+  __ popq(R10);
+  __ popq(R9);
+  __ popq(R8);
+  __ popq(RDI);
+  __ popq(RSI);
+  __ popq(RDX);
+  __ popq(RCX);
+  __ popq(RAX);
+
+  __ ret();
+}
+
+
 
 // Input parameters:
 //   RSP : points to return address.
@@ -275,13 +324,47 @@ void StubCode::GenerateCallStaticFunctionStub(Assembler* assembler) {
 }
 
 
+// Called from the pre-entry code of unoptimized code once the invocation
+// counter threshold has been reached.
+// RAX: function object.
+// R10: arguments descriptor array (num_args is first Smi element).
 void StubCode::GenerateOptimizeInvokedFunctionStub(Assembler* assembler) {
-  __ Unimplemented("OptimizeInvokedFunction stub");
+  __ EnterFrame(0);
+  __ pushq(R10);  // Preserve arguments descriptor array.
+  __ pushq(RAX);  // Preserve target function.
+  __ pushq(RAX);  // Target function.
+  __ CallRuntimeFromStub(kOptimizeInvokedFunctionRuntimeEntry);
+  __ popq(RAX);  // discard argument.
+  __ popq(RAX);  // Restore function.
+  __ popq(R10);  // Restore arguments descriptor array.
+  __ movq(RAX, FieldAddress(RAX, Function::code_offset()));
+  __ movq(RAX, FieldAddress(RAX, Code::instructions_offset()));
+  __ addq(RAX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
+  __ LeaveFrame();
+  __ jmp(RAX);
+  __ int3();
 }
 
 
+// Called from a static call only when an invalid code has been entered
+// (invalid because its function was optimized or deoptimized).
+// RBX: function object.
+// R10: arguments descriptor array (num_args is first Smi element).
 void StubCode::GenerateFixCallersTargetStub(Assembler* assembler) {
-  __ Unimplemented("FixCallersTarget stub");
+  __ EnterFrame(0);
+  __ pushq(R10);  // Preserve arguments descriptor array.
+  __ pushq(RBX);  // Preserve target function.
+  __ pushq(RBX);  // Target function.
+  __ CallRuntimeFromStub(kFixCallersTargetRuntimeEntry);
+  __ popq(RAX);  // discard argument.
+  __ popq(RAX);  // Restore function.
+  __ popq(R10);  // Restore arguments descriptor array.
+  __ movq(RAX, FieldAddress(RAX, Function::code_offset()));
+  __ movq(RAX, FieldAddress(RAX, Code::instructions_offset()));
+  __ addq(RAX, Immediate(Instructions::HeaderSize() - kHeapObjectTag));
+  __ LeaveFrame();
+  __ jmp(RAX);
+  __ int3();
 }
 
 
@@ -396,6 +479,16 @@ static void PushArgumentsArray(Assembler* assembler, intptr_t arg_offset) {
   __ Bind(&loop_condition);
   __ decq(R10);
   __ j(POSITIVE, &loop, Assembler::kNearJump);
+  // The array may have been allocated in old space, in which case it has to be
+  // remembered as the stored elements may be new objects.
+  Label array_is_new;
+  __ movq(RAX, Address(RSP, 0));
+  __ testq(RAX, Immediate(kNewObjectAlignmentOffset));
+  __ j(NOT_ZERO, &array_is_new, Assembler::kNearJump);
+  __ pushq(Immediate(0));  // All elements have been updated.
+  __ call(&StubCode::UpdateStoreBufferLabel());
+  __ AddImmediate(RSP, Immediate(kWordSize));
+  __ Bind(&array_is_new);
 }
 
 
@@ -593,7 +686,17 @@ void StubCode::GenerateMegamorphicLookupStub(Assembler* assembler) {
 
 
 void StubCode::GenerateDeoptimizeStub(Assembler* assembler) {
-  __ Unimplemented("Deoptimize stub");
+  __ EnterFrame(0);
+  // RAX: deoptimization reason id.
+  // Stack at this point:
+  // TOS + 0: Saved RBP of function frame that will be deoptimized. <== RBP
+  // TOS + 1: Deoptimization point (return address), will be patched.
+  // TOS + 2: top-of-stack at deoptimization point (all arguments on stack).
+  __ pushq(RAX);
+  __ CallRuntimeFromStub(kDeoptimizeRuntimeEntry);
+  __ popq(RAX);
+  __ LeaveFrame();
+  __ ret();
 }
 
 
@@ -676,7 +779,7 @@ void StubCode::GenerateAllocateArrayStub(Assembler* assembler) {
     // R10: Array length as Smi.
     {
       Label size_tag_overflow, done;
-      __ leaq(RBX, Address(R10, TIMES_2, fixed_size));  // R10 is Smi.
+      __ leaq(RBX, Address(R10, TIMES_4, fixed_size));  // R10 is Smi.
       ASSERT(kSmiTagShift == 1);
       __ andq(RBX, Immediate(-kObjectAlignment));
       __ cmpq(RBX, Immediate(RawObject::SizeTag::kMaxSizeTag));
@@ -907,6 +1010,13 @@ void StubCode::GenerateAllocationStubForClass(Assembler* assembler,
       PageSpace::IsPageAllocatableSize(instance_size + type_args_size)) {
     Label slow_case;
     Heap* heap = Isolate::Current()->heap();
+    if (FLAG_pretenuring) {
+      // Pretenured classes are allocated in old space by the runtime.
+      __ LoadObject(RAX, cls);
+      __ movzxb(RAX, FieldAddress(RAX, Class::is_pretenured_offset()));
+      __ testq(RAX, RAX);
+      __ j(NOT_ZERO, &slow_case);
+    }
     __ movq(RAX, Immediate(heap->TopAddress()));
     __ movq(RAX, Address(RAX, 0));
     __ leaq(RBX, Address(RAX, instance_size));
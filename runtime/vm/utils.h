@@ -78,6 +78,43 @@ class Utils {
   static uint32_t RoundUpToPowerOfTwo(uint32_t x);
   static int CountOneBits(uint32_t x);
 
+  // Returns kBitsPerWord if x is zero. The portable implementation is from
+  // "Hacker's Delight" by Henry S. Warren, Jr., section 5-4, extended to 64-bit
+  // words.
+  static inline int CountTrailingZeros(uword x) {
+    if (x == 0) {
+      return kBitsPerWord;
+    }
+#if defined(__GNUC__)
+    return __builtin_ctzl(x);
+#else
+    int n = 1;
+#if defined(ARCH_IS_64_BIT)
+    if ((x & 0xFFFFFFFF) == 0) {
+      n += 32;
+      x >>= 32;
+    }
+#endif
+    if ((x & 0x0000FFFF) == 0) {
+      n += 16;
+      x >>= 16;
+    }
+    if ((x & 0x000000FF) == 0) {
+      n += 8;
+      x >>= 8;
+    }
+    if ((x & 0x0000000F) == 0) {
+      n += 4;
+      x >>= 4;
+    }
+    if ((x & 0x00000003) == 0) {
+      n += 2;
+      x >>= 2;
+    }
+    return n - static_cast<int>(x & 1);
+#endif
+  }
+
   // Computes a hash value for the given string.
   static uint32_t StringHash(const char* data, int length);
 
@@ -121,6 +121,19 @@ UNIT_TEST_CASE(CountOneBits) {
 }
 
 
+UNIT_TEST_CASE(CountTrailingZeros) {
+  EXPECT_EQ(kBitsPerWord, Utils::CountTrailingZeros(0));
+  EXPECT_EQ(0, Utils::CountTrailingZeros(1));
+  EXPECT_EQ(4, Utils::CountTrailingZeros(0x00000010));
+  EXPECT_EQ(16, Utils::CountTrailingZeros(0x00010000));
+  EXPECT_EQ(28, Utils::CountTrailingZeros(0x30000000));
+  EXPECT_EQ(kBitsPerWord - 1,
+            Utils::CountTrailingZeros(static_cast<uword>(1) <<
+                                      (kBitsPerWord - 1)));
+  EXPECT_EQ(0, Utils::CountTrailingZeros(~static_cast<uword>(0)));
+}
+
+
 UNIT_TEST_CASE(IsInt) {
   EXPECT(Utils::IsInt(8, 16));
   EXPECT(Utils::IsInt(8, 127));
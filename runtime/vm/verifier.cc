@@ -10,6 +10,7 @@
 #include "vm/heap.h"
 #include "vm/isolate.h"
 #include "vm/object.h"
+#include "vm/pages.h"
 #include "vm/raw_object.h"
 #include "vm/stack_frame.h"
 
@@ -39,6 +40,50 @@ void VerifyPointersVisitor::VisitPointers(RawObject** first, RawObject** last) {
 }
 
 
+class NewPointerFinder : public ObjectPointerVisitor {
+ public:
+  // Pointers into new space are also expected to be covered by a dirty card
+  // if 'page' is not NULL.
+  explicit NewPointerFinder(HeapPage* page) : page_(page), found_(false) {}
+
+  bool found() const { return found_; }
+
+  void VisitPointers(RawObject** first, RawObject** last) {
+    for (RawObject** current = first; current <= last; current++) {
+      RawObject* raw_obj = *current;
+      if (raw_obj->IsHeapObject() &&
+          !FreeListElement::IsSpecialClass(raw_obj) &&
+          raw_obj->IsNewObject() &&
+          !Dart::vm_isolate()->heap()->Contains(RawObject::ToAddr(raw_obj))) {
+        found_ = true;
+        if ((page_ != NULL) && !page_->IsCardRemembered(current)) {
+          FATAL1("Slot 0x%lx refers to new space but its card is clean\n",
+                 reinterpret_cast<uword>(current));
+        }
+      }
+    }
+  }
+
+ private:
+  HeapPage* page_;
+  bool found_;
+
+  DISALLOW_COPY_AND_ASSIGN(NewPointerFinder);
+};
+
+
+void VerifyStoreBufferVisitor::VisitObject(RawObject* obj) {
+  HeapPage* page = PageSpace::PageFor(obj);
+  bool uses_cards = page->has_card_table() && obj->IsArray();
+  NewPointerFinder finder(uses_cards ? page : NULL);
+  obj->VisitPointers(&finder);
+  if (finder.found() && !obj->IsRemembered()) {
+    FATAL1("Old object 0x%lx refers to new space but is not remembered\n",
+           RawObject::ToAddr(obj));
+  }
+}
+
+
 void VerifyPointersVisitor::VerifyPointers() {
   NoGCScope no_gc;
   VerifyPointersVisitor visitor;
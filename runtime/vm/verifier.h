@@ -34,6 +34,16 @@ class VerifyPointersVisitor : public ObjectPointerVisitor {
   static void VerifyPointers();
 };
 
+
+// Verifies that all old objects referring to new objects are remembered in the
+// store buffer, i.e. that the write barrier did not miss any store.
+class VerifyStoreBufferVisitor : public ObjectVisitor {
+ public:
+  VerifyStoreBufferVisitor() {}
+
+  virtual void VisitObject(RawObject* obj);
+};
+
 }  // namespace dart
 
 #endif  // VM_VERIFIER_H_
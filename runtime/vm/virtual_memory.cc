@@ -22,6 +22,16 @@ VirtualMemory* VirtualMemory::ReserveAligned(intptr_t size,
 }
 
 
+VirtualMemory* VirtualMemory::SplitOff(intptr_t size) {
+  ASSERT(reserved_pointer_ == NULL);
+  ASSERT((size & (PageSize() - 1)) == 0);
+  ASSERT((size > 0) && (size < this->size()));
+  MemoryRegion region(address(), size);
+  region_.Subregion(region_, size, this->size() - size);
+  return new VirtualMemory(region, NULL);
+}
+
+
 void VirtualMemory::Truncate(uword new_start, intptr_t new_size) {
   ASSERT(new_start >= start());
   ASSERT((new_size & (PageSize() - 1)) == 0);
@@ -32,6 +32,29 @@ class VirtualMemory {
     return Commit(start(), size(), is_executable);
   }
 
+  // Commit a reserved memory area, so that the memory can be accessed.
+  bool Commit(uword addr, intptr_t size, bool is_executable);
+
+  // Decommit a committed memory area. Its contents are discarded and the
+  // backing memory is given back to the system, the addresses stay reserved.
+  bool Decommit(uword addr, intptr_t size);
+
+  // Discard the contents of a committed memory area and give the backing
+  // memory back to the system. The area stays accessible, it is backed again
+  // once it is touched.
+  bool Discard(uword addr, intptr_t size);
+
+  // Advise the system to back a committed memory area with transparent huge
+  // pages. Only the parts of the area covering whole kHugePageSize aligned
+  // chunks benefit. Committing the area again drops the advice. Returns false
+  // if huge pages are not supported.
+  bool AdviseHugePages(uword addr, intptr_t size);
+
+  // Split off the first 'size' bytes of this segment into a new segment,
+  // which is released independently. Only supported on operating systems
+  // where sub segments can be given back to the system.
+  VirtualMemory* SplitOff(intptr_t size);
+
   // Reserves a virtual memory segment with size. If a segment of the requested
   // size cannot be allocated NULL is returned.
   static VirtualMemory* Reserve(intptr_t size);
@@ -46,6 +69,13 @@ class VirtualMemory {
     return page_size_;
   }
 
+  // Returns true if memory can be backed by transparent huge pages, see
+  // AdviseHugePages.
+  static bool SupportsHugePages();
+
+  // Size and alignment of a transparent huge page.
+  static const intptr_t kHugePageSize = 2 * MB;
+
  private:
   // Truncate this virtual memory segment.
   void Truncate(uword new_start, intptr_t size);
@@ -60,9 +90,6 @@ class VirtualMemory {
       region_(region.pointer(), region.size()),
       reserved_pointer_(reserved_pointer) { }
 
-  // Commit a reserved memory area, so that the memory can be accessed.
-  bool Commit(uword addr, intptr_t size, bool is_executable);
-
   MemoryRegion region_;
 
   // The original pointer returned by the OS for this virtual memory
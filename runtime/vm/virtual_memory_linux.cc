@@ -25,6 +25,15 @@ void VirtualMemory::InitOnce() {
 }
 
 
+bool VirtualMemory::SupportsHugePages() {
+#if defined(MADV_HUGEPAGE)
+  return true;
+#else
+  return false;
+#endif  // defined(MADV_HUGEPAGE)
+}
+
+
 VirtualMemory* VirtualMemory::Reserve(intptr_t size) {
   void* address = mmap(NULL, size, PROT_NONE,
                        MAP_PRIVATE | MAP_ANON | MAP_NORESERVE,
@@ -71,4 +80,35 @@ bool VirtualMemory::Commit(uword addr, intptr_t size, bool executable) {
   return true;
 }
 
+
+bool VirtualMemory::Decommit(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  // Mapping fresh inaccessible pages over the range releases its memory.
+  void* address = mmap(reinterpret_cast<void*>(addr), size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANON | MAP_NORESERVE | MAP_FIXED,
+                       -1, 0);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  return true;
+}
+
+
+bool VirtualMemory::Discard(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  return madvise(reinterpret_cast<void*>(addr), size, MADV_DONTNEED) == 0;
+}
+
+bool VirtualMemory::AdviseHugePages(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+#if defined(MADV_HUGEPAGE)
+  return madvise(reinterpret_cast<void*>(addr), size, MADV_HUGEPAGE) == 0;
+#else
+  return false;
+#endif  // defined(MADV_HUGEPAGE)
+}
+
 }  // namespace dart
@@ -24,6 +24,11 @@ void VirtualMemory::InitOnce() {
 }
 
 
+bool VirtualMemory::SupportsHugePages() {
+  return false;
+}
+
+
 VirtualMemory* VirtualMemory::Reserve(intptr_t size) {
   ASSERT((size & (PageSize() - 1)) == 0);
   void* address = mmap(NULL, size, PROT_NONE,
@@ -71,4 +76,33 @@ bool VirtualMemory::Commit(uword addr, intptr_t size, bool executable) {
   return true;
 }
 
+
+bool VirtualMemory::Decommit(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  // Mapping fresh inaccessible pages over the range releases its memory.
+  void* address = mmap(reinterpret_cast<void*>(addr), size, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANON | MAP_NORESERVE | MAP_FIXED,
+                       -1, 0);
+  if (address == MAP_FAILED) {
+    return false;
+  }
+  return true;
+}
+
+
+bool VirtualMemory::Discard(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  // MADV_DONTNEED does not release anonymous memory on Mac OS.
+  return madvise(reinterpret_cast<void*>(addr), size, MADV_FREE) == 0;
+}
+
+
+bool VirtualMemory::AdviseHugePages(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  return false;
+}
+
 }  // namespace dart
@@ -36,6 +36,12 @@ UNIT_TEST_CASE(AllocateVirtualMemory) {
   buf[5] = 0;
   EXPECT_STREQ("ac/dc", buf);
 
+  // Discarded memory stays accessible.
+  EXPECT(vm->Discard(vm->start(), kVirtualMemoryBlockSize));
+  buf[0] = 'a';
+  buf[1] = 0;
+  EXPECT_STREQ("a", buf);
+
   delete vm;
 
   const intptr_t kAlignment = 1 * MB;
@@ -44,4 +50,32 @@ UNIT_TEST_CASE(AllocateVirtualMemory) {
   delete vm;
 }
 
+
+UNIT_TEST_CASE(SplitOffVirtualMemory) {
+  const intptr_t kSize = VirtualMemory::kHugePageSize;
+  const intptr_t kPartSize = kSize / 4;
+  VirtualMemory* vm = VirtualMemory::ReserveAligned(kSize, kSize);
+  EXPECT(vm != NULL);
+  EXPECT(vm->Commit(false));
+  uword start = vm->start();
+  // Huge pages are only an advice, it is ignored where they are disabled.
+  if (VirtualMemory::SupportsHugePages()) {
+    vm->AdviseHugePages(vm->start(), vm->size());
+  }
+  VirtualMemory* part = vm->SplitOff(kPartSize);
+  EXPECT_EQ(start, part->start());
+  EXPECT_EQ(kPartSize, part->size());
+  EXPECT_EQ(start + kPartSize, vm->start());
+  EXPECT_EQ(kSize - kPartSize, vm->size());
+  EXPECT(!vm->Contains(part->start()));
+
+  // The parts stay accessible after the other one is released.
+  char* buf = reinterpret_cast<char*>(vm->address());
+  buf[0] = 'a';
+  delete part;
+  buf[1] = 0;
+  EXPECT_STREQ("a", buf);
+  delete vm;
+}
+
 }  // namespace dart
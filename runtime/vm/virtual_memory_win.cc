@@ -17,6 +17,11 @@ void VirtualMemory::InitOnce() {
 }
 
 
+bool VirtualMemory::SupportsHugePages() {
+  return false;
+}
+
+
 VirtualMemory* VirtualMemory::Reserve(intptr_t size) {
   void* address = VirtualAlloc(NULL, size, MEM_RESERVE, PAGE_NOACCESS);
   if (address == NULL) {
@@ -52,10 +57,40 @@ bool VirtualMemory::Commit(uword addr, intptr_t size, bool executable) {
   ASSERT(Contains(addr));
   ASSERT(Contains(addr + size) || (addr + size == end()));
   int prot = executable ? PAGE_EXECUTE_READWRITE : PAGE_READWRITE;
-  if (VirtualAlloc(address(), size, MEM_COMMIT, prot) == NULL) {
+  if (VirtualAlloc(reinterpret_cast<void*>(addr), size, MEM_COMMIT, prot)
+      == NULL) {
+    return false;
+  }
+  return true;
+}
+
+
+bool VirtualMemory::Decommit(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  if (!VirtualFree(reinterpret_cast<void*>(addr), size, MEM_DECOMMIT)) {
+    return false;
+  }
+  return true;
+}
+
+
+bool VirtualMemory::Discard(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  // The protection is ignored when resetting memory, but has to be valid.
+  if (VirtualAlloc(reinterpret_cast<void*>(addr), size, MEM_RESET,
+                   PAGE_READWRITE) == NULL) {
     return false;
   }
   return true;
 }
 
+
+bool VirtualMemory::AdviseHugePages(uword addr, intptr_t size) {
+  ASSERT(Contains(addr));
+  ASSERT(Contains(addr + size) || (addr + size == end()));
+  return false;
+}
+
 }  // namespace dart